@@ -61,6 +61,10 @@ namespace GAGCore
 		CursorType nextType;
 		//! the current frame of cursor sprite.
 		int currentFrame;
+		//! the rectangle covered by the latest draw, valid if lastDrawn is true
+		int lastX, lastY, lastW, lastH;
+		//! true if the cursor has been drawn at least once
+		bool lastDrawn;
 		
 	public:
 		//! Constructor, set default values
@@ -77,6 +81,10 @@ namespace GAGCore
 		void setDefaultColor();
 		//! Draw the current cursor with its current frame at a given pos
 		void draw(DrawableSurface *ds, int x, int y);
+		//! Get the rectangle covered by the latest draw, return false if the cursor was never drawn
+		bool getLastRect(int *x, int *y, int *w, int *h);
+		//! Return true if the next draw at the same position would differ from the latest one
+		bool isAnimated(void);
 	};
 }
 
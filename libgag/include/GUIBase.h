@@ -101,6 +101,10 @@ namespace GAGGUI
 		std::string tooltipFont;
 		//! We need a font to draw the tooltip
 		GAGCore::Font *tooltipFontPtr;
+		//! True if the tooltip was displayed at last timer tick
+		bool tooltipShown;
+		//! Visibility at last paint, used by Screen to catch direct changes to visible
+		bool wasVisible;
 	public:
 		//! if the widget is visible it receive paint event, timer event and SDL event. Otherwise it receive no events.
 		bool visible;
@@ -142,6 +146,8 @@ namespace GAGGUI
 		virtual void paint(void) = 0;
 		//! Draw the tooltip
 		void displayTooltip(void);
+		//! Mark the area covered by the widget as needing a repaint. By default the whole screen is invalidated
+		virtual void invalidate(void);
 		/*! Initialize internal Widget's data. Subclasses
 		 * can perform additional initialization by overriding
 		 * internalInit */
@@ -247,12 +253,19 @@ namespace GAGGUI
 		Sint32 getHeight() const { return h; }
 		
 		//! Sets the screen position
-		virtual void setScreenPosition(int nx, int ny) { x = nx; y = ny; }
+		virtual void setScreenPosition(int nx, int ny) { invalidate(); x = nx; y = ny; invalidate(); }
+		
+		//! Invalidate only the rectangle of the widget
+		virtual void invalidate(void);
 	
 	protected:
 		//! Compute the actual position from the layout informations
 		virtual void getScreenPos(int *sx, int *sy, int *sw, int *sh);
 		bool isPtInRect(int px, int py, int x, int y, int w, int h) { if ((px>x) && (py>y) && (px<x+w) && (py<y+h)) return true; else return false; }
+		//! Restrict drawing to the intersection of (x, y, w, h) and the current clip rect, which is saved in oldClip
+		void pushClipRect(int x, int y, int w, int h, SDL_Rect *oldClip);
+		//! Restore the clip rect saved by pushClipRect
+		void popClipRect(const SDL_Rect &oldClip);
 		//! Screen that contains the widget
 	};
 	
@@ -278,6 +291,7 @@ namespace GAGGUI
 		virtual void paint(void);
 		
 	protected:
+		//! Return the highlight value for this frame and advance the animation, invalidating the widget while it runs
 		unsigned getNextHighlightValue(void);
 		virtual void onSDLMouseMotion(SDL_Event *event);
 	};
@@ -297,6 +311,11 @@ namespace GAGGUI
 		//! the graphic context associated with this screen
 		GAGCore::DrawableSurface *gfx;
 		
+		//! the rectangles to repaint at next dispatchPaint, kept merged
+		std::vector<SDL_Rect> damagedRects;
+		//! true if the whole screen must be repainted at next dispatchPaint
+		bool fullyDamaged;
+		
 	public:
 		//! The animation frame for screen creation
 		int animationFrame;
@@ -314,6 +333,13 @@ namespace GAGGUI
 		virtual void onAction(Widget *source, Action action, int par1, int par2)=0;
 		//! Full screen paint, call paint(0, 0, gfx->getW(), gfx->getH())
 		virtual void paint(void);
+		//! Return true if paint draws something different at each frame, in which case the whole screen is repainted every frame
+		virtual bool hasAnimatedBackground(void) { return false; }
+		
+		//! Request a repaint of the whole screen at next dispatchPaint
+		void invalidate(void) { fullyDamaged = true; }
+		//! Request a repaint of the rectangle (x, y, w, h) at next dispatchPaint
+		void invalidate(int x, int y, int w, int h);
 		
 		//! Run the screen until someone call endExecute(returnCode). Return returnCode
 		virtual int execute(GAGCore::DrawableSurface *gfx, int stepLength);
@@ -329,7 +355,11 @@ namespace GAGGUI
 		void dispatchTimer(Uint32 tick);
 		//! Call init on each widget before the first call
 		void dispatchInit(void);
-		//! Call paint on each widget after having called paint on the screen itself. Do a full update after
+		/*! Call paint on each widget after having called paint on the screen itself, and update the display.
+		 * Only the damaged rectangles are repainted and updated, unless the surface
+		 * cannot be partially updated or the screen has an animated background.
+		 * Nothing is done if nothing was invalidated since last call.
+		 */
 		void dispatchPaint(void);
 		//! Return the associated drawable surface
 		GAGCore::DrawableSurface *getSurface(void) { return gfx; }
@@ -337,6 +367,10 @@ namespace GAGGUI
 		int getW(void);
 		//! Return the height of the screen
 		int getH(void);
+		
+	protected:
+		//! Paint the screen and the widgets, clipped to the current clip rect of gfx
+		void paintClipped(void);
 	};
 	
 	
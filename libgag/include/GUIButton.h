@@ -142,7 +142,7 @@ namespace GAGGUI
 		//! Clear the color list
 		virtual void clearColors(void) { v.clear(); }
 		//! Set the color selection to default
-		virtual void setSelectedColor(int c=0) { selColor=c; }
+		virtual void setSelectedColor(int c=0) { selColor=c; invalidate(); }
 		//! Return the color sel
 		virtual int getSelectedColor(void) { return selColor; }
 		//! Return the number of possible colors
@@ -40,7 +40,7 @@ namespace GAGGUI
 		ProgressBar(int x, int y, int w, Uint32 hAlign, Uint32 vAlign, int range = 100, int value = 0, const char* font = 0, std::string format = "%0");
 		virtual ~ProgressBar() { }
 		
-		void setValue(int value) { this->value = value; }
+		void setValue(int value) { if (this->value != value) { this->value = value; invalidate(); } }
 		
 		virtual void internalInit(void);
 		virtual void paint(void);
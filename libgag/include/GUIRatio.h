@@ -68,7 +68,7 @@ namespace GAGGUI
 		virtual void internalInit(void);
 		virtual void paint(void);
 	
-		void set(int newValue) {value=newValue;};
+		void set(int newValue) {value=newValue; invalidate();};
 		int getMax(void);
 		int get(void);
 	
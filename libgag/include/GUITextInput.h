@@ -86,7 +86,7 @@ namespace GAGGUI
 		}
 		
 		// cursor / activation
-		void setCursorPos(size_t pos){ cursPos = pos;};
+		void setCursorPos(size_t pos){ cursPos = pos; invalidate(); };
 		void deactivate(void) { activated = false; recomputeTextInfos(); }
 		void activate(void) { activated = true; recomputeTextInfos(); }
 		
@@ -29,6 +29,7 @@
 #include <valarray>
 
 #include <set>
+#include <list>
 #include <boost/tuple/tuple.hpp>
 
 
@@ -156,6 +157,7 @@ namespace GAGCore
 	protected:
 		friend struct Color;
 		friend class GraphicContext;
+		friend class TrueTypeFont;
 		//! the underlying software SDL surface
 		SDL_Surface *sdlsurface;
 		//! The clipping rect, we do not draw outside it
@@ -203,6 +205,8 @@ namespace GAGCore
 		virtual void setClipRect(int x, int y, int w, int h);
 		virtual void setClipRect(void);
 		virtual void nextFrame(void) { flushTextPictures(); }
+		//! Like nextFrame, but only the given rectangles have changed since the previous frame
+		virtual void nextFrame(const std::vector<SDL_Rect> &updatedRects) { nextFrame(); }
 		virtual bool loadImage(const std::string name);
 		virtual void shiftHSV(float hue, float sat, float lum);
 		
@@ -212,6 +216,10 @@ namespace GAGCore
 		
 		// capability querying
 		virtual bool canDrawStretchedSprite(void) { return false; }
+		//! Return true if the content of the previous frame is kept, so that only changed rectangles need to be redrawn
+		virtual bool canUpdatePartially(void) { return true; }
+		//! Get the rectangle of what nextFrame draws over the content, such as a custom cursor, return false if there is none
+		virtual bool getOverlayRect(int *x, int *y, int *w, int *h, bool *animated) { return false; }
 		
 		// drawing commands
 		virtual void drawPixel(int x, int y, const Color& color);
@@ -333,6 +341,7 @@ namespace GAGCore
 		virtual void setClipRect(int x, int y, int w, int h);
 		virtual void setClipRect(void);
 		virtual void nextFrame(void);
+		virtual void nextFrame(const std::vector<SDL_Rect> &updatedRects);
 		//! This function does not work for GraphicContext
 		virtual bool loadImage(const std::string name) { return false; }
 		//! This function does not work for GraphicContext
@@ -342,6 +351,8 @@ namespace GAGCore
 		
 		// reimplemented drawing commands for HW (GPU / GL) accelerated version
 		virtual bool canDrawStretchedSprite(void) { return (optionFlags & USEGPU) != 0; }
+		virtual bool canUpdatePartially(void) { return (optionFlags & USEGPU) == 0; }
+		virtual bool getOverlayRect(int *x, int *y, int *w, int *h, bool *animated);
 		
 		virtual void drawPixel(int x, int y, const Color& color);
 		virtual void drawPixel(float x, float y, const Color& color);
@@ -399,21 +410,51 @@ namespace GAGCore
 		
 		//! Return the option flags
 		Uint32 getOptionFlags(void) { return optionFlags; }
+		
+	protected:
+		//! Draw the custom cursor if enabled, called by nextFrame before updating the screen
+		void drawCursor(void);
 	};
 	
 	//! A sprite is a collection of images (frames) that can be displayed one after another to make an animation
 	class Sprite
 	{
 	protected:
+		struct RotatedImage;
+		
+		//! An entry of the global least-recently-used list of team-colored surfaces
+		struct RotatedCacheEntry
+		{
+			RotatedImage *image;
+			Color color;
+			
+			RotatedCacheEntry(RotatedImage *image, const Color& color) : image(image), color(color) { }
+		};
+		typedef std::list<RotatedCacheEntry> RotatedCacheList;
+		
 		struct RotatedImage
 		{
+			//! A team-colored surface and its position in the global LRU list
+			struct Rotation
+			{
+				DrawableSurface *surface;
+				RotatedCacheList::iterator lruIt;
+			};
+			
 			DrawableSurface *orig;
-			typedef std::map<Color32, DrawableSurface *> RotationMap;
+			typedef std::map<Color32, Rotation> RotationMap;
 			RotationMap rotationMap;
 	
 			RotatedImage(DrawableSurface *s) { orig = s; }
 			~RotatedImage();
 		};
+		
+		//! All team-colored surfaces of all sprites, most recently used first
+		static RotatedCacheList rotatedCache;
+		//! Memory in bytes currently used by team-colored surfaces
+		static size_t rotatedCacheSize;
+		//! Maximum memory in bytes that team-colored surfaces may use
+		static size_t rotatedCacheBudget;
 	
 		std::string fileName;
 		std::vector <DrawableSurface *> images;
@@ -428,6 +469,10 @@ namespace GAGCore
 		bool checkBound(int index);
 		//! Return a rotated drawable surface for actColor, create it if necessary
 		virtual DrawableSurface *getRotatedSurface(int index);
+		//! Create the surface of image rotated to color and insert it in the cache, evicting old ones if over budget
+		static DrawableSurface *createRotatedSurface(RotatedImage *image, const Color& color);
+		//! Free least recently used surfaces until the cache fits in its budget, never evicting keep
+		static void shrinkRotatedCache(const DrawableSurface *keep);
 	
 	public:
 		//! Constructor
@@ -442,6 +487,13 @@ namespace GAGCore
 		virtual void setBaseColor(Uint8 r, Uint8 g, Uint8 b) { actColor = Color(r, g, b); }
 		//! Set the color to a sprite's base color
 		virtual void setBaseColor(const Color& color) { actColor = color; }
+		//! Create the team-colored frames for all colors in advance, as long as they fit in the cache budget. Return false if the budget was reached
+		virtual bool prepareBaseColors(const std::vector<Color>& colors);
+		
+		//! Set the maximum memory in bytes used by team-colored frames of all sprites
+		static void setRotatedCacheBudget(size_t bytes);
+		//! Return the memory in bytes currently used by team-colored frames of all sprites
+		static size_t getRotatedCacheSize(void) { return rotatedCacheSize; }
 		
 		//! Return the width of index frame of the sprite
 		virtual int getW(int index);
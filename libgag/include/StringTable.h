@@ -33,13 +33,17 @@ namespace GAGCore
 		std::vector<std::string> data;
 	};
 	
+	//! The translated texts. All keys are known after load(), but the translations of a language are
+	//! only read when it is first used. The few texts needed to list the languages are kept, with the
+	//! modification time and size of their translation file, in a cache, so that listing the languages
+	//! does not read all the translations.
 	class StringTable
 	{
 	public:
 		StringTable();
 		~StringTable();
-		void setLang(int l) { actLang = l; }
-		void setDefaultLang(int l) { defaultLang = l; }
+		void setLang(int l) { actLang = l; loadLanguage(l); }
+		void setDefaultLang(int l) { defaultLang = l; loadLanguage(l); }
 		int getLang(void) { return actLang; }
 		int getLangCode(const std::string & lang) { return languageCodes[lang]; }
 		bool isLangComplete(int l) { return !incomplete[l]; }
@@ -52,6 +56,15 @@ namespace GAGCore
 		void print();
 	
 	private:
+		//! Reads the translations of lang if not done yet, returns false if they are invalid
+		bool loadLanguage(int lang) const;
+		//! Returns true if the translations of lang use the same %x arguments as their keys
+		bool checkLanguage(int lang) const;
+		//! Returns true if key is a text listing the languages, which is kept in the cache
+		static bool isCachedKey(const std::string &key);
+		//! Sets the cached texts of every language, reading the translations of the languages whose cache entry is out of date
+		bool loadCachedTexts(void);
+		
 		std::vector<OneStringToken *> strings;
 		std::map<std::string, size_t> stringAccess;
 		std::map<std::string, int> languageCodes;
@@ -59,6 +72,12 @@ namespace GAGCore
 		int defaultLang;
 		int languageCount;
 		std::vector<bool> incomplete;
+		//! The file given to load(), for error messages
+		std::string indexFile;
+		//! The translation file of each language
+		std::vector<std::string> translationFiles;
+		//! Whether the translations of each language have been read
+		mutable std::vector<bool> languageLoaded;
 		
 	public:
 		enum {AI_NAME_SIZE=4};
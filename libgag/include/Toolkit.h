@@ -22,10 +22,12 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace GAGCore
 {
 	class Sprite;
+	struct Color;
 	class Font;
 	class FileManager;
 	class StringTable;
@@ -51,6 +53,8 @@ namespace GAGCore
 		
 		static Sprite *getSprite(const std::string name);
 		static void releaseSprite(const std::string name);
+		//! Create the team-colored frames of all loaded sprites for colors, so that they are not created while drawing
+		static void prepareSpritesBaseColors(const std::vector<Color>& colors);
 		
 		static void loadFont(const std::string filename, unsigned size, const std::string name);
 		static Font *getFont(const std::string name);
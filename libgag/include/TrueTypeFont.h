@@ -26,6 +26,7 @@
 #include <stack>
 #include <map>
 #include <string>
+#include <vector>
 
 struct SDL_Surface;
 
@@ -64,6 +65,19 @@ namespace GAGCore
 		DrawableSurface *getStringCached(const std::string text);
 		//! If cache is too big, remove old entry
 		void cleanupCache(void);
+		
+		struct Glyph;
+		//! Return true if the current style can be drawn glyph by glyph. Underline and bold are drawn per string, as SDL_ttf adjusts them for the whole string
+		bool canUseGlyphs(void) const;
+		/*! Lay text out glyph by glyph and return its width. If surface is not NULL, also draw it from the atlas,
+		 * with positions rounded to integers unless subPixel is true */
+		int layoutGlyphs(DrawableSurface *surface, float x, float y, const std::string &text, Uint8 alpha, bool subPixel);
+		//! If the glyph is in the atlas for the current style, return it. If it is not, render it into the atlas and return it
+		const Glyph *getGlyph(Uint16 ch);
+		//! Find room for a w x h glyph in the atlas, add a page if required
+		bool allocateGlyphRect(int w, int h, DrawableSurface **page, int *x, int *y);
+		//! Free all atlas pages and forget all glyphs
+		void clearAtlas(void);
 #ifdef HAVE_FRIBIDI 
 		char *getBIDIString (const std::string text);
 #endif		
@@ -92,6 +106,30 @@ namespace GAGCore
 		unsigned cacheHit;
 		//! number of cache miss
 		unsigned cacheMiss;
+		
+		//! A glyph rendered once in an atlas page, with its SDL_ttf metrics
+		struct Glyph
+		{
+			//! page holding the image, NULL for glyphs without pixels such as space
+			DrawableSurface *page;
+			//! position and size of the image in page
+			int x, y, w, h;
+			int minx, maxx, maxy, advance;
+		};
+		
+		struct GlyphKey
+		{
+			Uint16 ch;
+			Style style;
+			
+			bool operator<(const GlyphKey &o) const { if (ch == o.ch) return (style < o.style); else return (ch < o.ch);  }
+		};
+		
+		std::map<GlyphKey, Glyph> glyphs;
+		//! atlas pages, glyphs are packed in shelves in the last one
+		std::vector<DrawableSurface *> atlasPages;
+		//! packing position in the last page
+		int shelfX, shelfY, shelfH;
 	};
 }
 
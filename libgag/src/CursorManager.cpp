@@ -27,6 +27,7 @@ namespace GAGCore
 	{
 		nextType = currentType = CURSOR_NORMAL;
 		currentFrame = 0;
+		lastDrawn = false;
 	}
 	
 	void CursorManager::load(void)
@@ -124,7 +125,30 @@ namespace GAGCore
 			currentFrame = 0;
 		}
 		Sprite *sprite = cursors[static_cast<int>(currentType)];
-		ds->drawSprite(x-(sprite->getW(currentFrame)>>1), y-(sprite->getH(currentFrame)>>1), sprite, currentFrame);
+		lastW = sprite->getW(currentFrame);
+		lastH = sprite->getH(currentFrame);
+		lastX = x-(lastW>>1);
+		lastY = y-(lastH>>1);
+		lastDrawn = true;
+		ds->drawSprite(lastX, lastY, sprite, currentFrame);
 		currentFrame++;
 	}
+	
+	bool CursorManager::getLastRect(int *x, int *y, int *w, int *h)
+	{
+		if (!lastDrawn)
+			return false;
+		*x = lastX;
+		*y = lastY;
+		*w = lastW;
+		*h = lastH;
+		return true;
+	}
+	
+	bool CursorManager::isAnimated(void)
+	{
+		if (cursors.empty())
+			return false;
+		return (currentType != nextType) || (cursors[static_cast<int>(currentType)]->getFrameCount() > 1);
+	}
 }
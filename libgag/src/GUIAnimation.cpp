@@ -78,6 +78,7 @@ namespace GAGGUI
 				if (pos==start+count)
 					pos=start;
 				durationLeft=duration;
+				invalidate();
 			}
 		}
 	}
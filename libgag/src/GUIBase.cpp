@@ -26,6 +26,8 @@
 #include <Toolkit.h>
 
 #define SCREEN_ANIMATION_FRAME_COUNT 10
+// above this number of damaged rectangles, they are merged into their bounding box
+#define SCREEN_MAX_DAMAGED_RECTS 8
 
 using namespace GAGCore;
 
@@ -110,6 +112,8 @@ namespace GAGGUI
 	Widget::Widget()
 	{
 		this->tooltipFontPtr = NULL;
+		tooltipShown = false;
+		wasVisible = false;
 		visible=true;
 		parent=NULL;
 	}
@@ -122,6 +126,8 @@ namespace GAGGUI
 		lastIdleTick = 0;
 		my = -1;
 		mx = -1;
+		tooltipShown = false;
+		wasVisible = false;
 		visible = true;
 		parent = NULL;
 	}
@@ -143,6 +149,24 @@ namespace GAGGUI
 	{
 		currentTick = tick;
 		onTimer(tick);
+		
+		// The tooltip appears after some idle time, which does not produce any event
+		if (tooltipFontPtr != NULL && !tooltip.empty())
+		{
+			bool shown = (currentTick - lastIdleTick) > 1000 && isOnWidget(mx, my);
+			if (shown != tooltipShown)
+			{
+				tooltipShown = shown;
+				// the tooltip can be drawn outside the widget
+				parent->invalidate();
+			}
+		}
+	}
+	
+	void Widget::invalidate(void)
+	{
+		if (parent)
+			parent->invalidate();
 	}
 
 	void Widget::SDLMouseMotion(SDL_Event *event)
@@ -194,6 +218,39 @@ namespace GAGGUI
 		return (isPtInRect(_x, _y, x, y, w, h));
 	}
 
+	void RectangularWidget::invalidate(void)
+	{
+		if (parent && parent->getSurface())
+		{
+			int x, y, w, h;
+			getScreenPos(&x, &y, &w, &h);
+			parent->invalidate(x, y, w, h);
+		}
+	}
+	
+	void RectangularWidget::pushClipRect(int x, int y, int w, int h, SDL_Rect *oldClip)
+	{
+		DrawableSurface *gfx = parent->getSurface();
+		int cx, cy, cw, ch;
+		gfx->getClipRect(&cx, &cy, &cw, &ch);
+		oldClip->x = static_cast<Sint16>(cx);
+		oldClip->y = static_cast<Sint16>(cy);
+		oldClip->w = static_cast<Uint16>(cw);
+		oldClip->h = static_cast<Uint16>(ch);
+		
+		// when the screen only repaints a damaged area, we must not draw outside it
+		int x1 = std::max(x, cx);
+		int y1 = std::max(y, cy);
+		int x2 = std::min(x + w, cx + cw);
+		int y2 = std::min(y + h, cy + ch);
+		gfx->setClipRect(x1, y1, std::max(x2 - x1, 0), std::max(y2 - y1, 0));
+	}
+	
+	void RectangularWidget::popClipRect(const SDL_Rect &oldClip)
+	{
+		parent->getSurface()->setClipRect(oldClip.x, oldClip.y, oldClip.w, oldClip.h);
+	}
+	
 	void RectangularWidget::show(void)
 	{
 		visible = true;
@@ -389,6 +446,8 @@ namespace GAGGUI
 			// as actAnimationTime is decreasing over time, we have to invert prev and next highlight values
 			actHighlight = splineInterpolation(totalAnimationTime,  nextHighlightValue, prevHighlightValue, actAnimationTime);
 			actAnimationTime--;
+			// we will have to paint the next step of the animation
+			invalidate();
 		}
 		else
 			actHighlight = nextHighlightValue;
@@ -409,6 +468,8 @@ namespace GAGGUI
 		gfx = NULL;
 		returnCode = 0;
 		run = false;
+		animationFrame = 0;
+		fullyDamaged = true;
 	}
 	
 	Screen::~Screen()
@@ -474,6 +535,7 @@ namespace GAGGUI
 					case SDL_VIDEORESIZE:
 					{
 						gfx->setRes(event.resize.w, event.resize.h);
+						invalidate();
 						onAction(NULL, SCREEN_RESIZED, gfx->getW(), gfx->getH());
 					}
 					break;
@@ -551,6 +613,8 @@ namespace GAGGUI
 	
 	void Screen::dispatchEvents(SDL_Event *event)
 	{
+		// Events can change anything, including the screen itself through onSDLEvent and onAction
+		invalidate();
 		onSDLEvent(event);
 		// We put the switch here in order to avoid
 		// a switch in each specific onSDLEvent method
@@ -634,16 +698,135 @@ namespace GAGGUI
 	void Screen::dispatchInit(void)
 	{
 		animationFrame = 0;
+		invalidate();
 		for (std::set<Widget *>::iterator it=widgets.begin(); it!=widgets.end(); ++it)
 		{
 			(*it)->init();
 		}
 	}
 	
+	static bool rectsOverlap(const SDL_Rect &a, const SDL_Rect &b)
+	{
+		return (a.x < b.x + b.w) && (b.x < a.x + a.w) && (a.y < b.y + b.h) && (b.y < a.y + a.h);
+	}
+	
+	static SDL_Rect rectsUnion(const SDL_Rect &a, const SDL_Rect &b)
+	{
+		int x1 = std::min(a.x, b.x);
+		int y1 = std::min(a.y, b.y);
+		int x2 = std::max(a.x + a.w, b.x + b.w);
+		int y2 = std::max(a.y + a.h, b.y + b.h);
+		SDL_Rect r;
+		r.x = static_cast<Sint16>(x1);
+		r.y = static_cast<Sint16>(y1);
+		r.w = static_cast<Uint16>(x2 - x1);
+		r.h = static_cast<Uint16>(y2 - y1);
+		return r;
+	}
+	
+	void Screen::invalidate(int x, int y, int w, int h)
+	{
+		if (fullyDamaged)
+			return;
+		if (!gfx)
+		{
+			fullyDamaged = true;
+			return;
+		}
+		
+		// clip to the screen
+		int x1 = std::max(x, 0);
+		int y1 = std::max(y, 0);
+		int x2 = std::min(x + w, getW());
+		int y2 = std::min(y + h, getH());
+		if ((x2 <= x1) || (y2 <= y1))
+			return;
+		SDL_Rect r;
+		r.x = static_cast<Sint16>(x1);
+		r.y = static_cast<Sint16>(y1);
+		r.w = static_cast<Uint16>(x2 - x1);
+		r.h = static_cast<Uint16>(y2 - y1);
+		
+		// merge with the overlapping rectangles, restarting as the union may overlap others
+		size_t i = 0;
+		while (i < damagedRects.size())
+		{
+			if (rectsOverlap(r, damagedRects[i]))
+			{
+				r = rectsUnion(r, damagedRects[i]);
+				damagedRects[i] = damagedRects.back();
+				damagedRects.pop_back();
+				i = 0;
+			}
+			else
+				i++;
+		}
+		damagedRects.push_back(r);
+		
+		if (damagedRects.size() > SCREEN_MAX_DAMAGED_RECTS)
+		{
+			for (size_t j = 1; j < damagedRects.size(); j++)
+				damagedRects[0] = rectsUnion(damagedRects[0], damagedRects[j]);
+			damagedRects.resize(1);
+		}
+	}
+	
 	void Screen::dispatchPaint(void)
 	{
 		assert(gfx);
-		gfx->setClipRect();
+		
+		// visible is public and often changed directly, so catch changes here
+		for (std::set<Widget *>::iterator it=widgets.begin(); it!=widgets.end(); ++it)
+		{
+			if ((*it)->visible != (*it)->wasVisible)
+			{
+				(*it)->wasVisible = (*it)->visible;
+				(*it)->invalidate();
+			}
+		}
+		
+		if ((animationFrame < SCREEN_ANIMATION_FRAME_COUNT) || hasAnimatedBackground() || !gfx->canUpdatePartially())
+			invalidate();
+		
+		// what is drawn over the screen at nextFrame (the custom cursor) must be repainted below
+		int ox, oy, ow, oh;
+		bool overlayAnimated;
+		bool hasOverlay = gfx->getOverlayRect(&ox, &oy, &ow, &oh, &overlayAnimated);
+		if (!fullyDamaged && damagedRects.empty() && !(hasOverlay && overlayAnimated))
+			return;
+		if (hasOverlay)
+			invalidate(ox, oy, ow, oh);
+		
+		// take the damage, invalidations done while painting are for the next frame
+		bool full = fullyDamaged;
+		std::vector<SDL_Rect> rects;
+		rects.swap(damagedRects);
+		fullyDamaged = false;
+		
+		if (full)
+		{
+			gfx->setClipRect();
+			paintClipped();
+			gfx->nextFrame();
+		}
+		else
+		{
+			// paint once in the bounding box, so that paint is called once per frame
+			SDL_Rect bounds = rects[0];
+			for (size_t i = 1; i < rects.size(); i++)
+				bounds = rectsUnion(bounds, rects[i]);
+			gfx->setClipRect(bounds.x, bounds.y, bounds.w, bounds.h);
+			paintClipped();
+			gfx->setClipRect();
+			gfx->nextFrame(rects);
+		}
+		
+		if (animationFrame < SCREEN_ANIMATION_FRAME_COUNT)
+			animationFrame++;
+	}
+	
+	void Screen::paintClipped(void)
+	{
 		paint();
 		for (std::set<Widget *>::iterator it=widgets.begin(); it!=widgets.end(); ++it)
 		{
@@ -656,10 +839,6 @@ namespace GAGGUI
 			if ((*it)->visible)
 				(*it)->displayTooltip();
 		}
-		gfx->nextFrame();
-		
-		if (animationFrame < SCREEN_ANIMATION_FRAME_COUNT)
-			animationFrame++;
 	}
 	
 	void Screen::paint(void)
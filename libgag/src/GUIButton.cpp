@@ -129,6 +129,7 @@ namespace GAGGUI
 	{
 		assert(text.size());
 		this->text=text;
+		invalidate();
 	}
 	
 	
@@ -195,6 +196,7 @@ namespace GAGGUI
 		if (newState!=state)
 		{
 			state=newState;
+			invalidate();
 		}
 	}
 	
@@ -265,6 +267,7 @@ namespace GAGGUI
 	void TriButton::setState(Uint8 newState)
 	{
 		state = newState;
+		invalidate();
 	}
 	
 	ColorButton::ColorButton(int x, int y, int w, int h, Uint32 hAlign, Uint32 vAlign, int returnCode)
@@ -93,6 +93,7 @@ namespace GAGGUI
 		
 		// we deselect
 		this->nth = -1;
+		this->invalidate();
 	}
 	
 	void FileList::selectionChanged()
@@ -185,5 +186,6 @@ namespace GAGGUI
 	void FileList::sort(void)
 	{
 		std::sort(strings.begin(), strings.end(), strfilecmp_functor());
+		invalidate();
 	}
 }
@@ -87,6 +87,7 @@ namespace GAGGUI
 	{
 		key = nkey;
 		this->text = nkey.getTranslated();
+		invalidate();
 	}
 	
 	
@@ -74,6 +74,7 @@ namespace GAGGUI
 	{
 		strings.clear();
 		nth=-1;
+		invalidate();
 	}
 	
 	
@@ -84,6 +85,7 @@ namespace GAGGUI
 		getScreenPos(&x, &y, &w, &h);
 		
 		const unsigned count = (h-4) / textHeight;
+		const size_t oldDisp = disp;
 		switch (selectionState)
 		{
 			case UP_ARROW_PRESSED:
@@ -105,7 +107,8 @@ namespace GAGGUI
 			default:
 			break;
 		}
-		
+		if (disp != oldDisp)
+			invalidate();
 	}
 	
 	void List::onSDLMouseButtonDown(SDL_Event *event)
@@ -296,7 +299,8 @@ namespace GAGGUI
 		}
 		
 		// draw content
-		parent->getSurface()->setClipRect(x + frameLeftWidth, y + frameTopHeight, elementLength, elementsHeight);
+		SDL_Rect oldClip;
+		pushClipRect(x + frameLeftWidth, y + frameTopHeight, elementLength, elementsHeight, &oldClip);
 		int yPos = y + frameTopHeight;
 		int nextSize = textHeight;
 		size_t i = 0;
@@ -312,7 +316,7 @@ namespace GAGGUI
 			yPos += textHeight;
 		}
 		
-		parent->getSurface()->setClipRect();
+		popClipRect(oldClip);
 		
 		// draw frame
 		if (static_cast<int>(strings.size()) > count)
@@ -343,16 +347,19 @@ namespace GAGGUI
 		{
 			strings.push_back(text);
 		}
+		invalidate();
 	}
 	
 	void List::addText(const std::string &text)
 	{
 		strings.push_back(text);
+		invalidate();
 	}
 	
 	void List::sort(void)
 	{
 		std::sort(strings.begin(), strings.end(), GAGCore::naturalStringSort);
+		invalidate();
 	}
 	
 	void List::removeText(size_t pos)
@@ -366,6 +373,7 @@ namespace GAGGUI
 		const int count = (h-4) / textHeight;
 		if(disp + count > strings.size())
 			disp-=1;
+		invalidate();
 	}
 	
 	bool List::isText(const std::string &text) const
@@ -400,6 +408,7 @@ namespace GAGGUI
 	{
 		assert(pos < strings.size());
 		strings[pos]=text;
+		invalidate();
 	}
 	
 	size_t List::getCount(void) const
@@ -416,11 +425,13 @@ namespace GAGGUI
 	{
 		if ((index >= -1 ) && (index < static_cast<int>(strings.size())))
 			this->nth = index;
+		invalidate();
 	}
 	
 	void List::centerOnItem(int index)
 	{
 		const int count = (h-4) / textHeight;
 		disp = std::max(std::min(index - count/2, int(strings.size() - count)), 0);
+		invalidate();
 	}
 }
@@ -191,6 +191,7 @@ namespace GAGGUI
 		assert((nth>=0)&&(nth<(int)numbers.size()));
 		if ((nth>=0)&&(nth<(int)numbers.size()))
 			this->nth=nth;
+		invalidate();
 	}
 	
 	void Number::set(int number)
@@ -201,6 +202,7 @@ namespace GAGGUI
 				nth=i;
 				break;
 			}
+		invalidate();
 	}
 	
 	int Number::getNth(void)
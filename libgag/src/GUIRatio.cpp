@@ -187,5 +187,6 @@ namespace GAGGUI
 	{
 		this->start=start;
 		this->ratio=ratio;
+		invalidate();
 	}
 }
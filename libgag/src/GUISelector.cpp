@@ -96,6 +96,7 @@ namespace GAGGUI
 			value=static_cast<unsigned>(v);
 		
 		value = step * ((value + step/2) / step);
+		invalidate();
 	}
 	
 	void Selector::onSDLMouseButtonDown(SDL_Event *event)
@@ -102,6 +102,9 @@ namespace GAGGUI
 	{
 		if (this->text != newText)
 		{
+			// the size may change, so invalidate both old and new areas
+			invalidate();
+			
 			// copy text
 			this->text = newText;
 		
@@ -114,6 +117,7 @@ namespace GAGGUI
 					h = fontPtr->getStringHeight(newText);
 				fontPtr->popStyle();
 			}
+			invalidate();
 			parent->onAction(this, TEXT_SET, 0, 0);
 		}
 	}
@@ -121,5 +125,6 @@ namespace GAGGUI
 	void Text::setStyle(Font::Style style)
 	{
 		this->style = style;
+		invalidate();
 	}
 }
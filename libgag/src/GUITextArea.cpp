@@ -492,7 +492,8 @@ namespace GAGGUI
 		HighlightableWidget::paint();
 		
 		areaHeight=(h-8)/charHeight;
-		parent->getSurface()->setClipRect(x, y, w, h);
+		SDL_Rect oldClip;
+		pushClipRect(x, y, w, h, &oldClip);
 		
 		for (unsigned i=0;(i<areaHeight)&&((signed)i<(signed)(lines.size()-areaPos));i++)
 		{
@@ -523,11 +524,14 @@ namespace GAGGUI
 			int yPos = y+4+(charHeight*(cursorPosY-areaPos));
 			parent->getSurface()->drawLine(xPos, yPos, xPos, yPos + charHeight, Style::style->textColor);
 		}
-		parent->getSurface()->setClipRect();
+		popClipRect(oldClip);
 	}
 	
 	void TextArea::compute(void)
 	{
+		// compute is called after every change of text, cursor or scrolling
+		invalidate();
+		
 		// The only variable which is always valid is cursorPos,
 		// so now we recompute cursorPosY from it.
 		// But it is guarantied that cursorPosY < lines.size();
@@ -814,6 +818,7 @@ namespace GAGGUI
 			{
 				areaPos++;
 				scrollCursorDownLine();
+				invalidate();
 			}
 		}
 	}
@@ -826,6 +831,7 @@ namespace GAGGUI
 			{
 				areaPos--;
 				scrollCursorUpLine();
+				invalidate();
 			}
 		}
 	}
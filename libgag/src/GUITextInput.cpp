@@ -301,6 +301,8 @@ namespace GAGGUI
 	
 	void TextInput::recomputeTextInfos(void)
 	{
+		invalidate();
+
 		int x, y, w, h;
 		getScreenPos(&x, &y, &w, &h);
 	#define TEXTBOXSIDEPAD 30
@@ -31,6 +31,7 @@
 #include <string.h>
 #include <valarray>
 #include <cstdlib>
+#include <algorithm>
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -472,13 +473,30 @@ namespace GAGCore
 
 	void DrawableSurface::shiftHSV(float hue, float sat, float lum)
 	{
+		// Sprites use few distinct colors, so remember the latest conversions in a small
+		// direct-mapped table to avoid the costly HSV round trip for every pixel
+		const size_t memoSize = 256;
+		Uint32 memoIn[memoSize];
+		Uint32 memoOut[memoSize];
+		bool memoValid[memoSize];
+		std::fill(memoValid, memoValid + memoSize, false);
+		
 		Uint32 *mem = (Uint32 *)sdlsurface->pixels;
 		for (size_t i = 0; i < static_cast<size_t>(sdlsurface->w * sdlsurface->h); i++)
 		{
+			const Uint32 packed = *mem;
+			const size_t memoIndex = (packed ^ (packed >> 8) ^ (packed >> 16) ^ (packed >> 24)) & (memoSize - 1);
+			if (memoValid[memoIndex] && (memoIn[memoIndex] == packed))
+			{
+				*mem = memoOut[memoIndex];
+				mem++;
+				continue;
+			}
+			
 			// get values
 			float h, s, v;
 			Color c;
-			c.unpack(*mem);
+			c.unpack(packed);
 			c.getHSV(&h, &s, &v);
 
 			// shift
@@ -499,6 +517,9 @@ namespace GAGCore
 			// set values
 			c.setHSV(h, s, v);
 			*mem = c.pack();
+			memoValid[memoIndex] = true;
+			memoIn[memoIndex] = packed;
+			memoOut[memoIndex] = *mem;
 			mem++;
 		}
 		dirty = true;
@@ -2131,19 +2152,34 @@ namespace GAGCore
 		}
 	}
 
+	void GraphicContext::drawCursor(void)
+	{
+		if (optionFlags & CUSTOMCURSOR)
+		{
+			int mx, my;
+			unsigned b = SDL_GetMouseState(&mx, &my);
+			cursorManager.nextTypeFromMouse(this, mx, my, b != 0);
+			setClipRect();
+			cursorManager.draw(this, mx, my);
+		}
+	}
+	
+	bool GraphicContext::getOverlayRect(int *x, int *y, int *w, int *h, bool *animated)
+	{
+		if ((optionFlags & CUSTOMCURSOR) && cursorManager.getLastRect(x, y, w, h))
+		{
+			*animated = cursorManager.isAnimated();
+			return true;
+		}
+		return false;
+	}
+
 	void GraphicContext::nextFrame(void)
 	{
 		DrawableSurface::nextFrame();
 		if (sdlsurface)
 		{
-			if (optionFlags & CUSTOMCURSOR)
-			{
-				int mx, my;
-				unsigned b = SDL_GetMouseState(&mx, &my);
-				cursorManager.nextTypeFromMouse(this, mx, my, b != 0);
-				setClipRect();
-				cursorManager.draw(this, mx, my);
-			}
+			drawCursor();
 
 			#ifdef HAVE_OPENGL
 			if (optionFlags & GraphicContext::USEGPU)
@@ -2158,6 +2194,43 @@ namespace GAGCore
 			}
 		}
 	}
+	
+	void GraphicContext::nextFrame(const std::vector<SDL_Rect> &updatedRects)
+	{
+		// with GL the back buffer is undefined after a swap, so we always update everything
+		if (!canUpdatePartially())
+		{
+			nextFrame();
+			return;
+		}
+		
+		DrawableSurface::nextFrame();
+		if (sdlsurface)
+		{
+			std::vector<SDL_Rect> rects(updatedRects);
+			drawCursor();
+			int x, y, w, h;
+			if ((optionFlags & CUSTOMCURSOR) && cursorManager.getLastRect(&x, &y, &w, &h))
+			{
+				// clip the cursor rectangle to the screen, as SDL_UpdateRects requires
+				int x1 = std::max(x, 0);
+				int y1 = std::max(y, 0);
+				int x2 = std::min(x + w, getW());
+				int y2 = std::min(y + h, getH());
+				if ((x2 > x1) && (y2 > y1))
+				{
+					SDL_Rect r;
+					r.x = static_cast<Sint16>(x1);
+					r.y = static_cast<Sint16>(y1);
+					r.w = static_cast<Uint16>(x2 - x1);
+					r.h = static_cast<Uint16>(y2 - y1);
+					rects.push_back(r);
+				}
+			}
+			if (!rects.empty())
+				SDL_UpdateRects(sdlsurface, static_cast<int>(rects.size()), &rects[0]);
+		}
+	}
 
 	void GraphicContext::printScreen(const std::string filename)
 	{
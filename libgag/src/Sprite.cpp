@@ -29,12 +29,24 @@
 
 namespace GAGCore
 {
+	Sprite::RotatedCacheList Sprite::rotatedCache;
+	size_t Sprite::rotatedCacheSize = 0;
+	size_t Sprite::rotatedCacheBudget = 64 * 1024 * 1024;
+	
+	//! Return the memory used by the pixels of a surface
+	static size_t surfaceMemorySize(DrawableSurface *surface)
+	{
+		return static_cast<size_t>(surface->getW()) * static_cast<size_t>(surface->getH()) * 4;
+	}
+	
 	Sprite::RotatedImage::~RotatedImage()
 	{
 		delete orig;
 		for (RotationMap::iterator it = rotationMap.begin(); it != rotationMap.end(); ++it)
 		{
-			delete it->second;
+			rotatedCacheSize -= surfaceMemorySize(it->second.surface);
+			rotatedCache.erase(it->second.lruIt);
+			delete it->second.surface;
 		}
 	}
 	
@@ -73,31 +85,88 @@ namespace GAGCore
 	
 	DrawableSurface *Sprite::getRotatedSurface(int index)
 	{
-		RotatedImage::RotationMap::const_iterator it = rotated[index]->rotationMap.find(actColor);
-		DrawableSurface *ds;
+		RotatedImage::RotationMap::iterator it = rotated[index]->rotationMap.find(actColor);
 		if (it == rotated[index]->rotationMap.end())
 		{
-			// compute hue shift
-			float baseHue, actHue, lum, sat;
-			float hueShift;
-			Color(51, 255, 153).getHSV(&baseHue, &sat, &lum);
-			actColor.getHSV(&actHue, &sat, &lum);
-			hueShift = actHue - baseHue;
-			
-			// rotate image
-			ds = rotated[index]->orig->clone();
-			ds->shiftHSV(hueShift, 0.0f, 0.0f);
-			
-			// write back
-			rotated[index]->rotationMap[actColor] = ds;
+			return createRotatedSurface(rotated[index], actColor);
 		}
 		else
 		{
-			ds = it->second;
+			// mark as most recently used
+			rotatedCache.splice(rotatedCache.begin(), rotatedCache, it->second.lruIt);
+			return it->second.surface;
 		}
+	}
+	
+	DrawableSurface *Sprite::createRotatedSurface(RotatedImage *image, const Color& color)
+	{
+		// compute hue shift
+		float baseHue, actHue, lum, sat;
+		float hueShift;
+		Color(51, 255, 153).getHSV(&baseHue, &sat, &lum);
+		Color(color).getHSV(&actHue, &sat, &lum);
+		hueShift = actHue - baseHue;
+		
+		// rotate image
+		DrawableSurface *ds = image->orig->clone();
+		ds->shiftHSV(hueShift, 0.0f, 0.0f);
+		
+		// write back
+		rotatedCache.push_front(RotatedCacheEntry(image, color));
+		RotatedImage::Rotation &rotation = image->rotationMap[color];
+		rotation.surface = ds;
+		rotation.lruIt = rotatedCache.begin();
+		rotatedCacheSize += surfaceMemorySize(ds);
+		
+		shrinkRotatedCache(ds);
 		return ds;
 	}
 	
+	void Sprite::shrinkRotatedCache(const DrawableSurface *keep)
+	{
+		while ((rotatedCacheSize > rotatedCacheBudget) && !rotatedCache.empty())
+		{
+			RotatedCacheEntry &entry = rotatedCache.back();
+			RotatedImage::RotationMap::iterator it = entry.image->rotationMap.find(entry.color);
+			assert(it != entry.image->rotationMap.end());
+			if (it->second.surface == keep)
+				break;
+			
+			rotatedCacheSize -= surfaceMemorySize(it->second.surface);
+			delete it->second.surface;
+			entry.image->rotationMap.erase(it);
+			rotatedCache.pop_back();
+		}
+	}
+	
+	bool Sprite::prepareBaseColors(const std::vector<Color>& colors)
+	{
+		for (std::vector<RotatedImage *>::iterator rotatedIt = rotated.begin(); rotatedIt != rotated.end(); ++rotatedIt)
+		{
+			RotatedImage *image = *rotatedIt;
+			if (!image)
+				continue;
+			
+			const size_t frameSize = surfaceMemorySize(image->orig);
+			for (std::vector<Color>::const_iterator colorIt = colors.begin(); colorIt != colors.end(); ++colorIt)
+			{
+				if (image->rotationMap.find(*colorIt) != image->rotationMap.end())
+					continue;
+				// do not evict frames prepared earlier to make room for new ones
+				if (rotatedCacheSize + frameSize > rotatedCacheBudget)
+					return false;
+				createRotatedSurface(image, *colorIt);
+			}
+		}
+		return true;
+	}
+	
+	void Sprite::setRotatedCacheBudget(size_t bytes)
+	{
+		rotatedCacheBudget = bytes;
+		shrinkRotatedCache(NULL);
+	}
+	
 	Sprite::~Sprite()
 	{
 		for (std::vector <DrawableSurface *>::iterator imagesIt = images.begin(); imagesIt != images.end(); ++imagesIt)
@@ -21,6 +21,8 @@
 #include <Toolkit.h>
 #include <FileManager.h>
 #include <Stream.h>
+#include <StreamBackend.h>
+#include <BinaryStream.h>
 #include "assert.h"
 #include <iostream>
 #include <cctype>
@@ -31,6 +33,21 @@
 
 namespace GAGCore
 {
+	//! The texts listing the languages, which are kept in the cache for every language
+	static const char *cachedKeys[] = { "[language-code]", "[language]", "[language incomplete]" };
+	static const size_t cachedKeysCount = sizeof(cachedKeys) / sizeof(cachedKeys[0]);
+	//! The cache file, in the user directory
+	static const char *cacheFileName = "texts.cache";
+	//! To be increased when the format of the cache changes
+	static const Uint32 cacheVersion = 1;
+	//! The cached texts of a translation file, valid as long as the file keeps the same modification time and size
+	struct CacheEntry
+	{
+		Uint32 mtime;
+		Uint32 size;
+		std::vector<std::string> texts;
+	};
+	
 	StringTable::StringTable()
 	{
 		languageCount = 0;
@@ -75,12 +92,17 @@ namespace GAGCore
 		
 		The key file contains all keys, each one on a different line
 		A translation file contains pair of key-value for the given translation
+		
+		Only the translations of the default language are read here, the others
+		are read when their language is first used
 	*/
 	bool StringTable::load(const std::string filename)
 	{
 		std::string keyFile;
-		std::vector<std::string> translationFiles;
 		InputLineStream *inputLineStream;
+		
+		indexFile = filename;
+		translationFiles.clear();
 		 
 		// Read index file
 		inputLineStream= new InputLineStream(Toolkit::getFileManager()->openInputStreamBackend(filename));
@@ -105,12 +127,9 @@ namespace GAGCore
 			return false;
 		
 		languageCount = translationFiles.size();
+		languageLoaded.assign(languageCount, false);
 		
-		// Temporary storage for keys and translations
-		std::vector<std::string> keys;
-		std::vector<std::map<std::string, std::string> > translations(translationFiles.size());
-		
-		// Load keys
+		// Load keys, and create entries with empty translations
 		inputLineStream = new InputLineStream(Toolkit::getFileManager()->openInputStreamBackend(keyFile));
 		if (inputLineStream->isEndOfStream())
 		{
@@ -128,55 +147,66 @@ namespace GAGCore
 					if ((s.length() < 2) || (s[0] != '[') || (s[s.length()-1] != ']'))
 						std::cerr << "StringTable::load(" << keyFile << ") : keys must be in bracket. Invalid key " << s << " at line " << line << " ignored" << std::endl;
 					else
-						keys.push_back(s);
+					{
+						OneStringToken *entry = new OneStringToken;
+						entry->data.resize(languageCount);
+						stringAccess[s] = strings.size();
+						strings.push_back(entry);
+					}
 				}
 				line++;
 			}
 			delete inputLineStream;
 		}
 		
-		// Load translations
-		for (size_t i=0; i<translationFiles.size(); i++)
+		// Get the texts listing the languages
+		if (!loadCachedTexts())
+			return false;
+		
+		for(int i=0; i<languageCount; ++i)
 		{
-			inputLineStream = new InputLineStream(Toolkit::getFileManager()->openInputStreamBackend(translationFiles[i]));
-			if (inputLineStream->isEndOfStream())
-			{
-				delete inputLineStream;
-				return false;
-			}
-			else
-			{
-				while (!inputLineStream->isEndOfStream())
-				{
-					const std::string &key = inputLineStream->readLine();
-					const std::string &value = inputLineStream->readLine();
-					translations[i][key] = value;
-				}
-				delete inputLineStream;
-			}
+			languageCodes[getStringInLang("[language-code]", i)] = i;
 		}
 		
-		// Create entries
-		for (size_t i=0; i<keys.size(); i++)
+		defaultLang = getLangCode("en");
+		
+		// The default language replaces the missing translations of all others
+		return loadLanguage(defaultLang);
+	}
+	
+	
+	bool StringTable::loadLanguage(int lang) const
+	{
+		if ((lang < 0) || (lang >= languageCount))
+			return false;
+		if (languageLoaded[lang])
+			return true;
+		languageLoaded[lang] = true;
+		
+		InputLineStream *inputLineStream = new InputLineStream(Toolkit::getFileManager()->openInputStreamBackend(translationFiles[lang]));
+		if (inputLineStream->isEndOfStream())
 		{
-			const std::string &key = keys[i];
-			OneStringToken *entry = new OneStringToken;
-			
-			for (size_t j=0; j<translations.size(); j++)
-			{
-				std::map<std::string, std::string>::const_iterator it = translations[j].find(key);
-				if (it != translations[j].end())
-					entry->data.push_back(it->second);
-				else
-					entry->data.push_back("");
-			}
-			
-			stringAccess[key] = strings.size();
-			strings.push_back(entry);
+			std::cerr << "StringTable::loadLanguage(\"" << translationFiles[lang] << "\") : error, can't read translations" << std::endl;
+			delete inputLineStream;
+			return false;
 		}
+		while (!inputLineStream->isEndOfStream())
+		{
+			const std::string &key = inputLineStream->readLine();
+			const std::string &value = inputLineStream->readLine();
+			std::map<std::string, size_t>::const_iterator it = stringAccess.find(key);
+			if (it != stringAccess.end())
+				strings[it->second]->data[lang] = value;
+		}
+		delete inputLineStream;
 		
-		// Check for consistency
-		for (std::map<std::string, size_t>::iterator it=stringAccess.begin(); it!=stringAccess.end(); ++it)
+		return checkLanguage(lang);
+	}
+	
+	
+	bool StringTable::checkLanguage(int lang) const
+	{
+		for (std::map<std::string, size_t>::const_iterator it=stringAccess.begin(); it!=stringAccess.end(); ++it)
 		{
 			// For each entry...
 			bool lcwp=false;
@@ -192,17 +222,16 @@ namespace GAGCore
 						baseCount++;
 					else
 					{
-						std::cerr << "StringTable::load(\"" << filename << "\") : error, consistency : text=(" << s << "), Only %x where x is a number are supported in translations !" << std::endl;
+						std::cerr << "StringTable::load(\"" << indexFile << "\") : error, consistency : text=(" << s << "), Only %x where x is a number are supported in translations !" << std::endl;
 						assert(false);
 						return false;
 					}
 				}
 				lcwp=(c=='%');
 			}
-			// then we are sure that format are correct in all translation
-			for (size_t i=0; i<strings[it->second]->data.size(); i++)
+			// then we are sure that format are correct in the translation
 			{
-				const std::string &s = strings[it->second]->data[i];
+				const std::string &s = strings[it->second]->data[lang];
 				bool lcwp=false;
 				int count=0;
 				for (size_t j=0; j<s.length(); j++)
@@ -214,7 +243,7 @@ namespace GAGCore
 							count++;
 						else
 						{
-							std::cerr << "StringTable::load(\"" << filename << "\") : error, translation consistency : translation=(" << s << "Only %x where x is a number are supported in translations !" << std::endl;
+							std::cerr << "StringTable::load(\"" << indexFile << "\") : error, translation consistency : translation=(" << s << "Only %x where x is a number are supported in translations !" << std::endl;
 							assert(false);
 							return false;
 						}
@@ -224,19 +253,110 @@ namespace GAGCore
 				// if not, issue an error message
 				if (baseCount!=count && s!="")
 				{
-					std::cerr << "StringTable::load(\"" << filename << "\") : error, translation : in " << translationFiles[i] << ", text = [" << baseCount << "] (" << it->first << "), translation = [" << count << "] (" << s << "), doesn't match !" << std::endl;
+					std::cerr << "StringTable::load(\"" << indexFile << "\") : error, translation : in " << translationFiles[lang] << ", text = [" << baseCount << "] (" << it->first << "), translation = [" << count << "] (" << s << "), doesn't match !" << std::endl;
 					assert(false);
 					return false;
 				}
 			}
 		}
+		return true;
+	}
+	
+	
+	bool StringTable::isCachedKey(const std::string &key)
+	{
+		for (size_t k=0; k<cachedKeysCount; k++)
+			if (key == cachedKeys[k])
+				return true;
+		return false;
+	}
+	
+	
+	bool StringTable::loadCachedTexts(void)
+	{
+		std::map<std::string, CacheEntry> cache;
 		
-		for(unsigned i=0; i<translations.size(); ++i)
+		// Read the cache
+		InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(cacheFileName));
+		if (!stream->isEndOfStream() && (stream->readUint32("version") == cacheVersion))
 		{
-			languageCodes[getStringInLang("[language-code]", i)] = i;
+			Uint32 count = stream->readUint32("count");
+			for (Uint32 i=0; i<count && !stream->isEndOfStream(); i++)
+			{
+				std::string fileName = stream->readText("fileName");
+				CacheEntry &entry = cache[fileName];
+				entry.mtime = stream->readUint32("mtime");
+				entry.size = stream->readUint32("size");
+				entry.texts.resize(cachedKeysCount);
+				for (size_t k=0; k<cachedKeysCount; k++)
+					entry.texts[k] = stream->readText("text");
+			}
 		}
+		delete stream;
 		
-		defaultLang = getLangCode("en");
+		// Use it for the translation files that did not change, read the others
+		bool dirty = false;
+		for (int lang=0; lang<languageCount; lang++)
+		{
+			const std::string &fileName = translationFiles[lang];
+			StreamBackend *backend = Toolkit::getFileManager()->openInputStreamBackend(fileName);
+			if (backend->isEndOfStream())
+			{
+				std::cerr << "StringTable::load(\"" << indexFile << "\") : error, can't read " << fileName << std::endl;
+				delete backend;
+				return false;
+			}
+			backend->seekFromEnd(0);
+			Uint32 size = backend->getPosition();
+			delete backend;
+			Uint32 mtime = Toolkit::getFileManager()->mtime(fileName);
+			
+			std::map<std::string, CacheEntry>::const_iterator it = cache.find(fileName);
+			if ((it != cache.end()) && (it->second.mtime == mtime) && (it->second.size == size))
+			{
+				for (size_t k=0; k<cachedKeysCount; k++)
+				{
+					std::map<std::string, size_t>::const_iterator accessIt = stringAccess.find(cachedKeys[k]);
+					if (accessIt != stringAccess.end())
+						strings[accessIt->second]->data[lang] = it->second.texts[k];
+				}
+			}
+			else
+			{
+				if (!loadLanguage(lang))
+					return false;
+				CacheEntry &entry = cache[fileName];
+				entry.mtime = mtime;
+				entry.size = size;
+				entry.texts.resize(cachedKeysCount);
+				for (size_t k=0; k<cachedKeysCount; k++)
+				{
+					std::map<std::string, size_t>::const_iterator accessIt = stringAccess.find(cachedKeys[k]);
+					entry.texts[k] = (accessIt != stringAccess.end()) ? strings[accessIt->second]->data[lang] : "";
+				}
+				dirty = true;
+			}
+		}
+		
+		// Write it back if it changed
+		if (dirty)
+		{
+			OutputStream *outStream = new BinaryOutputStream(Toolkit::getFileManager()->openOutputStreamBackend(cacheFileName));
+			if (!outStream->isEndOfStream())
+			{
+				outStream->writeUint32(cacheVersion, "version");
+				outStream->writeUint32(cache.size(), "count");
+				for (std::map<std::string, CacheEntry>::const_iterator it = cache.begin(); it != cache.end(); ++it)
+				{
+					outStream->writeText(it->first, "fileName");
+					outStream->writeUint32(it->second.mtime, "mtime");
+					outStream->writeUint32(it->second.size, "size");
+					for (size_t k=0; k<cachedKeysCount; k++)
+						outStream->writeText(it->second.texts[k], "text");
+				}
+			}
+			delete outStream;
+		}
 		
 		return true;
 	}
@@ -244,6 +364,8 @@ namespace GAGCore
 	
 	void StringTable::print()
 	{
+		for (int i=0; i<languageCount; i++)
+			loadLanguage(i);
 		for (std::map<std::string, size_t>::iterator it=stringAccess.begin(); it!=stringAccess.end(); ++it)
 		{
 			std::cout << "name = " << it->first << "\n";
@@ -328,6 +450,8 @@ namespace GAGCore
 			}
 			else
 			{
+				if (!isCachedKey(stringname))
+					loadLanguage(lang);
 				return strings[accessIt->second]->data[lang];
 			}
 		}
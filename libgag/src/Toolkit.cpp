@@ -115,6 +115,18 @@ namespace GAGCore
 		spriteMap.erase(it);
 	}
 	
+	void Toolkit::prepareSpritesBaseColors(const std::vector<Color>& colors)
+	{
+		for (SpriteMap::iterator it=spriteMap.begin(); it!=spriteMap.end(); ++it)
+		{
+			if (!it->second->prepareBaseColors(colors))
+			{
+				std::cerr << "GAG : Sprite cache budget reached while preparing team colors, remaining frames will be created on demand" << std::endl;
+				break;
+			}
+		}
+	}
+	
 	void Toolkit::loadFont(const std::string filename, unsigned size, const std::string name)
 	{
 		assert(filename.size());
@@ -30,6 +30,8 @@
 
 using namespace std;
 #define MAX_CACHE_SIZE 128
+#define ATLAS_PAGE_SIZE 256
+#define MAX_ATLAS_PAGES 16
 
 namespace GAGCore
 {
@@ -50,6 +52,7 @@ namespace GAGCore
 		now = 0;
 		cacheHit = 0;
 		cacheMiss = 0;
+		shelfX = shelfY = shelfH = 0;
 	}
 	
 	TrueTypeFont::~TrueTypeFont()
@@ -72,6 +75,7 @@ namespace GAGCore
 			// free cache
 			for (std::map<CacheKey, CacheData>::iterator it = cache.begin(); it != cache.end(); ++it)
 				delete it->second.s;
+			clearAtlas();
 			// close font
 			TTF_CloseFont(font);
 		}
@@ -94,8 +98,11 @@ namespace GAGCore
 	
 	int TrueTypeFont::getStringWidth(const std::string string)
 	{
-		DrawableSurface *s = getStringCached(string);
 		int w;
+		if (canUseGlyphs())
+			return layoutGlyphs(NULL, 0, 0, string, Color::ALPHA_OPAQUE, false);
+		
+		DrawableSurface *s = getStringCached(string);
 		if (s)
 		{
 			w = s->getW();
@@ -109,7 +116,15 @@ namespace GAGCore
 	int TrueTypeFont::getStringHeight(const std::string string)
 	{
 		int h;
-		if (!string.empty())
+		if (!string.empty() && canUseGlyphs())
+		{
+			// a rendered string is always as high as the font, unless it is empty
+			if (layoutGlyphs(NULL, 0, 0, string, Color::ALPHA_OPAQUE, false) > 0)
+				h = TTF_FontHeight(font);
+			else
+				h = 0;
+		}
+		else if (!string.empty())
 		{
 			DrawableSurface *s = getStringCached(string);
 			if (s)
@@ -251,8 +266,215 @@ namespace GAGCore
 		}
 	}
 	
+	//! Decode the UTF-8 char at pos in text and advance pos. SDL_ttf only handles UCS-2, other chars become '?'
+	static Uint16 getNextUCS2Char(const std::string &text, size_t &pos)
+	{
+		unsigned char c = static_cast<unsigned char>(text[pos++]);
+		unsigned len, value;
+		if (c < 0x80)
+			return c;
+		else if ((c & 0xE0) == 0xC0)
+		{
+			len = 1;
+			value = c & 0x1F;
+		}
+		else if ((c & 0xF0) == 0xE0)
+		{
+			len = 2;
+			value = c & 0x0F;
+		}
+		else if ((c & 0xF8) == 0xF0)
+		{
+			len = 3;
+			value = c & 0x07;
+		}
+		else
+			return '?';
+		
+		for (unsigned i = 0; i < len; i++)
+		{
+			if ((pos >= text.size()) || ((static_cast<unsigned char>(text[pos]) & 0xC0) != 0x80))
+				return '?';
+			value = (value << 6) | (static_cast<unsigned char>(text[pos++]) & 0x3F);
+		}
+		if (value > 0xFFFF)
+			return '?';
+		return static_cast<Uint16>(value);
+	}
+	
+	bool TrueTypeFont::canUseGlyphs(void) const
+	{
+		return (styleStack.top().shape & (STYLE_BOLD | STYLE_UNDERLINE)) == 0;
+	}
+	
+	void TrueTypeFont::clearAtlas(void)
+	{
+		for (size_t i = 0; i < atlasPages.size(); i++)
+			delete atlasPages[i];
+		atlasPages.clear();
+		glyphs.clear();
+		shelfX = shelfY = shelfH = 0;
+	}
+	
+	bool TrueTypeFont::allocateGlyphRect(int w, int h, DrawableSurface **page, int *x, int *y)
+	{
+		if ((w > ATLAS_PAGE_SIZE) || (h > ATLAS_PAGE_SIZE))
+			return false;
+		
+		// start a new shelf if the glyph does not fit in the current one
+		if (shelfX + w > ATLAS_PAGE_SIZE)
+		{
+			shelfX = 0;
+			shelfY += shelfH;
+			shelfH = 0;
+		}
+		// start a new page if the shelf does not fit in the current one
+		if (atlasPages.empty() || (shelfY + h > ATLAS_PAGE_SIZE))
+		{
+			// if the atlas grew too much, we start again, only the glyphs still in use will come back
+			if (atlasPages.size() >= MAX_ATLAS_PAGES)
+				clearAtlas();
+			atlasPages.push_back(new DrawableSurface(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE));
+			shelfX = shelfY = shelfH = 0;
+		}
+		
+		*page = atlasPages.back();
+		*x = shelfX;
+		*y = shelfY;
+		// keep one transparent pixel between glyphs, for filtering in GL
+		shelfX += w + 1;
+		shelfH = std::max(shelfH, h + 1);
+		return true;
+	}
+	
+	const TrueTypeFont::Glyph *TrueTypeFont::getGlyph(Uint16 ch)
+	{
+		GlyphKey key;
+		key.ch = ch;
+		key.style = styleStack.top();
+		
+		std::map<GlyphKey, Glyph>::iterator keyIt = glyphs.find(key);
+		if (keyIt != glyphs.end())
+		{
+			cacheHit++;
+			return &keyIt->second;
+		}
+		cacheMiss++;
+		
+		Glyph glyph;
+		glyph.page = NULL;
+		glyph.x = glyph.y = glyph.w = glyph.h = 0;
+		int minx, maxx, miny, maxy, advance;
+		if (TTF_GlyphMetrics(font, ch, &minx, &maxx, &miny, &maxy, &advance) != 0)
+			minx = maxx = maxy = advance = 0;
+		glyph.minx = minx;
+		glyph.maxx = maxx;
+		glyph.maxy = maxy;
+		glyph.advance = advance;
+		
+		SDL_Color c;
+		c.r = key.style.color.r;
+		c.g = key.style.color.g;
+		c.b = key.style.color.b;
+		c.unused = key.style.color.a;
+		SDL_Surface *temp = TTF_RenderGlyph_Blended(font, ch, c);
+		if (temp)
+		{
+			DrawableSurface *page;
+			int x, y;
+			if (allocateGlyphRect(temp->w, temp->h, &page, &x, &y))
+			{
+				// copy pixels and alpha as they are, without blending
+				SDL_Surface *converted = SDL_ConvertSurface(temp, page->sdlsurface->format, SDL_SWSURFACE);
+				if (converted)
+				{
+					SDL_SetAlpha(converted, 0, 255);
+					SDL_Rect dr;
+					dr.x = static_cast<Sint16>(x);
+					dr.y = static_cast<Sint16>(y);
+					dr.w = static_cast<Uint16>(temp->w);
+					dr.h = static_cast<Uint16>(temp->h);
+					SDL_BlitSurface(converted, NULL, page->sdlsurface, &dr);
+					SDL_FreeSurface(converted);
+					page->dirty = true;
+					
+					glyph.page = page;
+					glyph.x = x;
+					glyph.y = y;
+					glyph.w = temp->w;
+					glyph.h = temp->h;
+				}
+			}
+			SDL_FreeSurface(temp);
+		}
+		
+		return &(glyphs[key] = glyph);
+	}
+	
+	int TrueTypeFont::layoutGlyphs(DrawableSurface *surface, float x, float y, const std::string &text, Uint8 alpha, bool subPixel)
+	{
+#ifdef HAVE_FRIBIDI 
+		char *bidiStr = getBIDIString(text);
+		const std::string visual(bidiStr);
+		delete []bidiStr;
+#else
+		const std::string &visual = text;
+#endif
+		// this follows the layout of TTF_RenderUTF8_Blended and TTF_SizeUTF8
+		const int ascent = TTF_FontAscent(font);
+		int minX = 0, maxX = 0;
+		int penX = 0;
+		Uint16 prevCh = 0;
+		size_t pos = 0;
+		while (pos < visual.size())
+		{
+			Uint16 ch = getNextUCS2Char(visual, pos);
+			const Glyph *glyph = getGlyph(ch);
+			
+#ifdef SDL_TTF_VERSION_ATLEAST
+#if SDL_TTF_VERSION_ATLEAST(2,0,14)
+			if (prevCh && TTF_GetFontKerning(font))
+				penX += TTF_GetFontKerningSizeGlyphs(font, prevCh, ch);
+#endif
+#endif
+			minX = std::min(minX, penX + glyph->minx);
+			maxX = std::max(maxX, penX + std::max(glyph->advance, glyph->maxx));
+			
+			// SDL_ttf shifts the whole string when the first glyph starts before the pen
+			if ((prevCh == 0) && (glyph->minx < 0))
+				penX -= glyph->minx;
+			
+			if (surface && glyph->page)
+			{
+				if (subPixel)
+					surface->drawSurface(x + static_cast<float>(penX + glyph->minx), y + static_cast<float>(ascent - glyph->maxy), glyph->page, glyph->x, glyph->y, glyph->w, glyph->h, alpha);
+				else
+					surface->drawSurface(static_cast<int>(x) + penX + glyph->minx, static_cast<int>(y) + ascent - glyph->maxy, glyph->page, glyph->x, glyph->y, glyph->w, glyph->h, alpha);
+			}
+			penX += glyph->advance;
+			prevCh = ch;
+		}
+		return maxX - minX;
+	}
+	
 	void TrueTypeFont::drawString(DrawableSurface *surface, int x, int y, int w, const std::string text, Uint8 alpha)
 	{
+		if (canUseGlyphs())
+		{
+			if (w)
+			{
+				int rx, ry, rw, rh;
+				surface->getClipRect(&rx, &ry, &rw, &rh);
+				int nrw = std::min(rw, x + w - rx);
+				surface->setClipRect(rx, ry, nrw, rh);
+				layoutGlyphs(surface, static_cast<float>(x), static_cast<float>(y), text, alpha, false);
+				surface->setClipRect(rx, ry, rw, rh);
+			}
+			else
+				layoutGlyphs(surface, static_cast<float>(x), static_cast<float>(y), text, alpha, false);
+			return;
+		}
+		
 		// get
 		DrawableSurface *s = getStringCached(text);
 		if (s == NULL)
@@ -278,6 +500,22 @@ namespace GAGCore
 	
 	void TrueTypeFont::drawString(DrawableSurface *surface, float x, float y, float w, const std::string text, Uint8 alpha)
 	{
+		if (canUseGlyphs())
+		{
+			if (w != 0.0f)
+			{
+				int rx, ry, rw, rh;
+				surface->getClipRect(&rx, &ry, &rw, &rh);
+				int nrw = std::min(rw, (int)x + (int)w - rx);
+				surface->setClipRect(rx, ry, nrw, rh);
+				layoutGlyphs(surface, x, y, text, alpha, true);
+				surface->setClipRect(rx, ry, rw, rh);
+			}
+			else
+				layoutGlyphs(surface, x, y, text, alpha, true);
+			return;
+		}
+		
 		// get
 		DrawableSurface *s = getStringCached(text);
 		if (s == NULL)
@@ -28,6 +28,12 @@ ThunkPrototype* methodMember(ScopePrototype* method)
 }
 
 
+void Code::compile(Instruction& instruction)
+{
+	instruction.opcode = Instruction::NATIVE;
+	instruction.code = this;
+}
+
 void Code::dump(std::ostream &stream) const
 {
 	stream << unmangle(typeid(*this).name());
@@ -39,15 +45,22 @@ ConstCode::ConstCode(Value* value):
 	value(value)
 {}
 
-void ConstCode::execute(Thread* thread)
+void ConstCode::compile(Instruction& instruction)
+{
+	instruction.opcode = Instruction::CONST;
+	instruction.value = value;
+	instruction.code = this;
+}
+
+void ConstCode::propagateMarkForGC(Heap* heap)
 {
-	thread->frames.back().stack.push_back(value);
+	heap->mark(value);
 }
 
 void ConstCode::dumpSpecific(std::ostream &stream) const
 {
 	stream << " ";
-	value->dump(stream);
+	dumpValue(value, stream);
 }
 
 
@@ -55,17 +68,11 @@ ValRefCode::ValRefCode(size_t index):
 	index(index)
 {}
 
-void ValRefCode::execute(Thread* thread)
+void ValRefCode::compile(Instruction& instruction)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
-	
-	Value* value = stack.back();
-	stack.pop_back();
-	
-	Scope* scope = dynamic_cast<Scope*>(value);
-	assert(scope != 0); // Should not fail if the parser is bug-free
-	
-	stack.push_back(scope->locals[index]);
+	instruction.opcode = Instruction::VAL_REF;
+	instruction.index = index;
+	instruction.code = this;
 }
 
 void ValRefCode::dumpSpecific(std::ostream &stream) const
@@ -74,54 +81,43 @@ void ValRefCode::dumpSpecific(std::ostream &stream) const
 }
 
 
-void EvalCode::execute(Thread* thread)
+void EvalCode::compile(Instruction& instruction)
 {
-	Thread::Frames& frames = thread->frames;
-	Thread::Frame::Stack& stack = frames.back().stack;
-	assert(stack.size() >= 1);
-	
-	// get the thunk
-	Thunk* thunk = dynamic_cast<Thunk*>(stack.back());
-	stack.pop_back();
-	
-	if (frames.back().nextInstr == frames.back().thunk->thunkPrototype()->body.size())
-		frames.pop_back();
-	
-	// push a new frame
-	assert(thunk != 0); // TODO: This assert can be triggered by the user
-	frames.push_back(thunk);
+	instruction.opcode = Instruction::EVAL;
+	instruction.code = this;
 }
 
 
 SelectCode::SelectCode(const std::string& name):
-	name(name)
+	name(name),
+	cachedPrototype(0),
+	cachedDef(0),
+	cachedEpoch(0)
 {}
 
-void SelectCode::execute(Thread* thread)
+void SelectCode::compile(Instruction& instruction)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
-	
-	// get receiver
-	Value* receiver = stack.back();
-	stack.pop_back();
-	
-	// get definition
-	ThunkPrototype* def = receiver->prototype->lookup(name);
+	instruction.opcode = Instruction::SELECT;
+	instruction.code = this;
+}
+
+ThunkPrototype* SelectCode::lookup(Thread* thread, Value* receiver)
+{
+	Prototype* prototype = prototypeOf(receiver);
+	ThunkPrototype* def = prototype->lookup(name);
 	if (def == 0)
 	{
 		const Thread::Frame& frame = thread->frames.back();
 		ostringstream message;
 		message << "member <" << name << "> not found in ";
-		receiver->dump(message);
-		message << "(" << receiver->prototype << ")";
+		dumpValue(receiver, message);
+		message << "(" << prototype << ")";
 		throw Exception(thread->usl->debug.find(frame.thunk->thunkPrototype(), frame.nextInstr), message.str());
 	}
-	
-	// create a thunk
-	Thunk* thunk = new Thunk(&thread->usl->heap, def, receiver);
-	
-	// put the thunk on the stack
-	stack.push_back(thunk);
+	cachedPrototype = prototype;
+	cachedDef = def;
+	cachedEpoch = Prototype::membersEpoch;
+	return def;
 }
 
 void SelectCode::dumpSpecific(std::ostream &stream) const
@@ -130,30 +126,10 @@ void SelectCode::dumpSpecific(std::ostream &stream) const
 }
 
 
-void ApplyCode::execute(Thread* thread)
+void ApplyCode::compile(Instruction& instruction)
 {
-	Thread::Frames& frames = thread->frames;
-	Thread::Frame::Stack& stack = frames.back().stack;
-	assert(stack.size() >= 2);
-	
-	// get argument
-	Value* argument = stack.back();
-	stack.pop_back();
-	
-	// get the function
-	Function* function = dynamic_cast<Function*>(stack.back());
-	assert(function != 0); // TODO: This assert can be triggered by the user
-	stack.pop_back();
-	
-	if (frames.back().nextInstr == frames.back().thunk->thunkPrototype()->body.size())
-		frames.pop_back();
-
-	// push a new frame
-	Scope* scope = new Scope(&thread->usl->heap, function->prototype, function->outer);
-	frames.push_back(scope);
-	
-	// put the argument on the stack
-	frames.back().stack.push_back(argument);
+	instruction.opcode = Instruction::APPLY;
+	instruction.code = this;
 }
 
 
@@ -161,20 +137,11 @@ ValCode::ValCode(size_t index):
 	index(index)
 {}
 
-void ValCode::execute(Thread* thread)
+void ValCode::compile(Instruction& instruction)
 {
-	assert(thread->frames.size() > 0);
-	
-	Thread::Frame& frame = thread->frames.back();
-	Thread::Frame::Stack& stack = frame.stack;
-	Scope* scope = dynamic_cast<Scope*>(frame.thunk);
-	
-	assert(stack.size() > 0);
-	assert(scope);
-	assert(scope->locals.size() > index);
-	
-	scope->locals[index] = stack.back();
-	stack.pop_back();
+	instruction.opcode = Instruction::VAL;
+	instruction.index = index;
+	instruction.code = this;
 }
 
 void ValCode::dumpSpecific(std::ostream &stream) const
@@ -183,23 +150,17 @@ void ValCode::dumpSpecific(std::ostream &stream) const
 }
 
 
-void ParentCode::execute(Thread* thread)
+void ParentCode::compile(Instruction& instruction)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
-	
-	Value* value = stack.back();
-	stack.pop_back();
-	
-	Thunk* thunk = dynamic_cast<Thunk*>(value);
-	assert(thunk != 0); // Should not fail if the parser is bug-free
-	
-	stack.push_back(thunk->outer);
+	instruction.opcode = Instruction::PARENT;
+	instruction.code = this;
 }
 
 
-void PopCode::execute(Thread* thread)
+void PopCode::compile(Instruction& instruction)
 {
-	thread->frames.back().stack.pop_back();
+	instruction.opcode = Instruction::POP;
+	instruction.code = this;
 }
 
 
@@ -207,17 +168,18 @@ DupCode::DupCode(size_t index):
 	index(index)
 {}
 
-void DupCode::execute(Thread* thread)
+void DupCode::compile(Instruction& instruction)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
-	stack.push_back(*(stack.rbegin() + index));
+	instruction.opcode = Instruction::DUP;
+	instruction.index = index;
+	instruction.code = this;
 }
 
 
-void ThunkCode::execute(Thread* thread)
+void ThunkCode::compile(Instruction& instruction)
 {
-	Thread::Frame& frame = thread->frames.back();
-	frame.stack.push_back(frame.thunk);
+	instruction.opcode = Instruction::THUNK;
+	instruction.code = this;
 }
 
 
@@ -236,22 +198,23 @@ CreateCode<ThunkType>::CreateCode(typename ThunkType::Prototype* prototype):
 	prototype(prototype)
 {}
 
+template<typename ThunkType> struct CreateOpcode;
+template<> struct CreateOpcode<Thunk> { enum { value = Instruction::CREATE_THUNK }; };
+template<> struct CreateOpcode<Scope> { enum { value = Instruction::CREATE_SCOPE }; };
+template<> struct CreateOpcode<Function> { enum { value = Instruction::CREATE_FUNCTION }; };
+
+template <typename ThunkType>
+void CreateCode<ThunkType>::compile(Instruction& instruction)
+{
+	instruction.opcode = Instruction::Opcode(CreateOpcode<ThunkType>::value);
+	instruction.prototype = prototype;
+	instruction.code = this;
+}
+
 template <typename ThunkType>
-void CreateCode<ThunkType>::execute(Thread* thread)
+void CreateCode<ThunkType>::propagateMarkForGC(Heap* heap)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
-	
-	// get receiver
-	Value* receiver = stack.back();
-	stack.pop_back();
-	
-	assert(prototype->outer == 0 || prototype->outer == receiver->prototype); // Should not fail if the parser is bug-free
-	
-	// create a thunk
-	ThunkType* thunk = new ThunkType(&thread->usl->heap, prototype, receiver);
-	
-	// put the thunk on the stack
-	stack.push_back(thunk);
+	heap->mark(prototype);
 }
 
 template <typename ThunkType>
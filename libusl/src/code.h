@@ -5,6 +5,7 @@
 #include <ostream>
 
 class Thread;
+class Heap;
 class Value;
 class Prototype;
 class ThunkPrototype;
@@ -13,10 +14,48 @@ class ScopePrototype;
 ThunkPrototype* thisMember(Prototype* outer);
 ThunkPrototype* methodMember(ScopePrototype* method);
 
+struct Code;
+
+/// Compact form of a code, run by Thread::step without a virtual call for the common operations
+struct Instruction
+{
+	enum Opcode
+	{
+		CONST,
+		VAL_REF,
+		EVAL,
+		SELECT,
+		APPLY,
+		VAL,
+		PARENT,
+		POP,
+		DUP,
+		THUNK,
+		CREATE_THUNK,
+		CREATE_SCOPE,
+		CREATE_FUNCTION,
+		NATIVE // calls code->execute()
+	};
+	
+	Opcode opcode;
+	union
+	{
+		size_t index; // VAL_REF, VAL and DUP
+		Value* value; // CONST
+		ThunkPrototype* prototype; // CREATE_THUNK, CREATE_SCOPE and CREATE_FUNCTION
+	};
+	Code* code; // the code this instruction was compiled from
+};
+
 struct Code
 {
 	virtual ~Code() { }
-	virtual void execute(Thread* thread) = 0;
+	/// Only called for codes compiled to Instruction::NATIVE, the others are run by Thread::step
+	virtual void execute(Thread* thread) { assert(false); }
+	/// Fills instruction, which runs this code
+	virtual void compile(Instruction& instruction);
+	/// Marks the values this code refers to
+	virtual void propagateMarkForGC(Heap* heap) {}
 	void dump(std::ostream &stream) const;
 	virtual void dumpSpecific(std::ostream &stream) const {};
 };
@@ -25,7 +64,8 @@ struct ConstCode: Code
 {
 	ConstCode(Value* value);
 	
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
+	virtual void propagateMarkForGC(Heap* heap);
 	virtual void dumpSpecific(std::ostream &stream) const;
 	
 	Value* value;
@@ -35,7 +75,7 @@ struct ValRefCode: Code
 {
 	ValRefCode(size_t index);
 	
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 	virtual void dumpSpecific(std::ostream &stream) const;
 	
 	size_t index;
@@ -43,29 +83,37 @@ struct ValRefCode: Code
 
 struct EvalCode: Code
 {
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 };
 
 struct SelectCode: Code
 {
 	SelectCode(const std::string& name);
 	
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 	virtual void dumpSpecific(std::ostream &stream) const;
+	/// Looks name up in the prototype of receiver and fills the cache, throws an exception if it is not found
+	ThunkPrototype* lookup(Thread* thread, Value* receiver);
 	
 	std::string name;
+	
+	// monomorphic inline cache: the definition of name in the last receiver prototype seen,
+	// valid as long as Prototype::membersEpoch has not changed since it was filled
+	Prototype* cachedPrototype;
+	ThunkPrototype* cachedDef;
+	size_t cachedEpoch;
 };
 
 struct ApplyCode: Code
 {
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 };
 
 struct ValCode: Code
 {
 	ValCode(size_t index);
 
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 	virtual void dumpSpecific(std::ostream &stream) const;
 	
 	size_t index;
@@ -73,26 +121,26 @@ struct ValCode: Code
 
 struct ParentCode: Code
 {
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 };
 
 struct PopCode: Code
 {
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 };
 
 struct DupCode: Code
 {
 	DupCode(size_t index);
 
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 	
 	size_t index;
 };
 
 struct ThunkCode: Code
 {
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
 };
 
 struct NativeCode: Code
@@ -111,7 +159,8 @@ struct CreateCode: Code
 {
 	CreateCode(typename ThunkType::Prototype* prototype);
 	
-	virtual void execute(Thread* thread);
+	virtual void compile(Instruction& instruction);
+	virtual void propagateMarkForGC(Heap* heap);
 	virtual void dumpSpecific(std::ostream &stream) const;
 	
 	typename ThunkType::Prototype* prototype;
@@ -8,41 +8,155 @@
 
 using namespace std;
 
+/// Creates a ThunkType of the prototype of instruction, whose outer value is receiver
+template<typename ThunkType>
+static inline Value* create(Heap* heap, const Instruction& instruction, Value* receiver)
+{
+	typename ThunkType::Prototype* prototype = static_cast<typename ThunkType::Prototype*>(instruction.prototype);
+	assert(prototype->outer == 0 || prototype->outer == prototypeOf(receiver)); // Should not fail if the parser is bug-free
+	return new ThunkType(heap, prototype, receiver);
+}
+
 bool Thread::step()
 {
 	if (state == RUN)
 	{
 		Thread::Frame& frame = frames.back();
 		ThunkPrototype* thunk = frame.thunk->thunkPrototype();
-		size_t nextInstr = frame.nextInstr;
-		Code* code = thunk->body[nextInstr];
+		if (thunk->bytecode.size() != thunk->body.size())
+			thunk->compile();
+		const Instruction& instruction = thunk->bytecode[frame.nextInstr];
 		frame.nextInstr++;
 		
 		// Uncomment to get *verbose* debug info on scripting
 		/*cout << thunk;
 		for (size_t i = 0; i < frames.size(); ++i)
-			cout << "[" << frames[i].stack.size() << "]";
-		cout << " " << usl->debug.find(thunk, nextInstr) << ": ";
-		code->dump(cout);
+			cout << "[" << frames[i].stackBase << "]";
+		cout << "[" << stack.size() << "]";
+		cout << " " << usl->debug.find(thunk, frame.nextInstr - 1) << ": ";
+		instruction.code->dump(cout);
 		cout << endl;*/
 		
-		code->execute(this);
+		// frame is invalid once frames have been pushed or popped
+		switch (instruction.opcode)
+		{
+			case Instruction::CONST:
+			{
+				stack.push_back(instruction.value);
+				break;
+			}
+			case Instruction::VAL_REF:
+			{
+				Scope* scope = static_cast<Scope*>(stack.back()); // Should be a scope if the parser is bug-free
+				stack.back() = scope->locals[instruction.index];
+				break;
+			}
+			case Instruction::EVAL:
+			{
+				Thunk* target = valueCast<Thunk>(stack.back());
+				assert(target != 0); // TODO: This assert can be triggered by the user
+				stack.pop_back();
+				enter(target);
+				break;
+			}
+			case Instruction::SELECT:
+			{
+				Value* receiver = stack.back();
+				
+				// get definition, from the inline cache if the receiver has the same prototype as last time
+				SelectCode* select = static_cast<SelectCode*>(instruction.code);
+				ThunkPrototype* def;
+				if (prototypeOf(receiver) == select->cachedPrototype && select->cachedEpoch == Prototype::membersEpoch)
+					def = select->cachedDef;
+				else
+					def = select->lookup(this, receiver);
+				
+				stack.back() = new Thunk(&usl->heap, def, receiver);
+				break;
+			}
+			case Instruction::APPLY:
+			{
+				assert(stack.size() >= frame.stackBase + 2);
+				Value* argument = stack.back();
+				stack.pop_back();
+				Function* function = valueCast<Function>(stack.back());
+				assert(function != 0); // TODO: This assert can be triggered by the user
+				stack.pop_back();
+				
+				// the argument is the first value of the new frame
+				Scope* scope = new Scope(&usl->heap, function->prototype, function->outer);
+				enter(scope);
+				stack.push_back(argument);
+				break;
+			}
+			case Instruction::VAL:
+			{
+				Scope* scope = static_cast<Scope*>(frame.thunk); // Should be a scope if the parser is bug-free
+				assert(scope->locals.size() > instruction.index);
+				scope->locals[instruction.index] = stack.back();
+				usl->heap.writeBarrier(stack.back());
+				stack.pop_back();
+				break;
+			}
+			case Instruction::PARENT:
+			{
+				Thunk* parent = static_cast<Thunk*>(stack.back()); // Should be a thunk if the parser is bug-free
+				stack.back() = parent->outer;
+				break;
+			}
+			case Instruction::POP:
+			{
+				stack.pop_back();
+				break;
+			}
+			case Instruction::DUP:
+			{
+				stack.push_back(*(stack.rbegin() + instruction.index));
+				break;
+			}
+			case Instruction::THUNK:
+			{
+				stack.push_back(frame.thunk);
+				break;
+			}
+			case Instruction::CREATE_THUNK:
+			{
+				stack.back() = create<Thunk>(&usl->heap, instruction, stack.back());
+				break;
+			}
+			case Instruction::CREATE_SCOPE:
+			{
+				stack.back() = create<Scope>(&usl->heap, instruction, stack.back());
+				break;
+			}
+			case Instruction::CREATE_FUNCTION:
+			{
+				stack.back() = create<Function>(&usl->heap, instruction, stack.back());
+				break;
+			}
+			case Instruction::NATIVE:
+			{
+				instruction.code->execute(this);
+				break;
+			}
+		}
 		
 		while (true)
 		{
 			Thread::Frame& frame = frames.back();
 			if (frame.nextInstr < frame.thunk->thunkPrototype()->body.size())
 				break;
-			Value* retVal = frame.stack.back();
+			Value* retVal = stack.back();
+			stack.resize(frame.stackBase);
 			frames.pop_back();
 			if (!frames.empty())
 			{
-				frames.back().stack.push_back(retVal);
+				stack.push_back(retVal);
 			}
 			else
 			{
 				#ifdef DEBUG_USL
-					retVal->dump(cout);
+					dumpValue(retVal, cout);
 					cout << endl;
 				#endif
 				state = STOP;
@@ -57,6 +171,17 @@ bool Thread::step()
 	}
 }
 
+void Thread::enter(Thunk* thunk)
+{
+	Frame& frame = frames.back();
+	if (frame.nextInstr == frame.thunk->thunkPrototype()->body.size())
+	{
+		stack.resize(frame.stackBase);
+		frames.pop_back();
+	}
+	frames.push_back(Frame(thunk, stack.size()));
+}
+
 size_t Thread::run(size_t maxSteps)
 {
 	size_t steps;
@@ -79,21 +204,17 @@ size_t Thread::run()
 	return steps;
 }
 
-void Thread::markForGC()
+void Thread::markForGC(Heap* heap)
 {
-	using namespace std;
-	using namespace __gnu_cxx;
-	
-	// mark all frames in stack
-	for_each(frames.begin(), frames.end(), mem_fun_ref(&Frame::markForGC));
+	// mark all values in stack
+	for (Stack::const_iterator it = stack.begin(); it != stack.end(); ++it)
+		heap->mark(*it);
+	// mark all frames
+	for (Frames::iterator it = frames.begin(); it != frames.end(); ++it)
+		it->markForGC(heap);
 }
 
-void Thread::Frame::markForGC()
+void Thread::Frame::markForGC(Heap* heap)
 {
-	using namespace std;
-	using namespace __gnu_cxx;
-	
-	// mark all variables in frame
-	for_each(stack.begin(), stack.end(), mem_fun(&Value::markForGC));
-	thunk->markForGC();
+	heap->mark(thunk);
 }
@@ -5,27 +5,30 @@
 #include <vector>
 #include <string>
 
+struct Heap;
 struct Thunk;
 struct Value;
 struct Usl;
 
 struct Thread
 {
+	typedef std::vector<Value*> Stack;
+	
 	struct Frame
 	{
-		typedef std::vector<Value*> Stack;
-	
 		Thunk* thunk;
-		Stack stack;
 		size_t nextInstr;
+		/// size of the stack of the thread when this frame was entered, the values of this frame are above
+		size_t stackBase;
 		
-		Frame(Thunk* thunk):
-			thunk(thunk)
+		Frame(Thunk* thunk, size_t stackBase):
+			thunk(thunk),
+			stackBase(stackBase)
 		{
 			nextInstr = 0;
 		}
 		
-		void markForGC();
+		void markForGC(Heap* heap);
 	};
 	
 	enum State {
@@ -39,18 +42,23 @@ struct Thread
 	Usl* usl;
 	State state;
 	Frames frames;
+	/// values of all the frames
+	Stack stack;
 	
 	Thread(Usl* usl, Thunk* thunk):
 		usl(usl), state(RUN)
 	{
-		frames.push_back(thunk);
+		frames.push_back(Frame(thunk, 0));
 	}
 	
 	size_t run();
 	size_t run(size_t steps);
 	bool step();
 	
-	void markForGC();
+	/// Pushes a frame evaluating thunk. The current frame is removed first if it has nothing left to do (tail-call optimisation)
+	void enter(Thunk* thunk);
+	
+	void markForGC(Heap* heap);
 };
 
 #endif // ndef INTERPRETER_H
@@ -1,22 +1,102 @@
 #include "memory.h"
 #include "interpreter.h"
 #include "types.h"
+#include "debug.h"
 
 using namespace std;
 
-void Heap::collectGarbage()
+const size_t Heap::MIN_THRESHOLD;
+
+Heap::Heap():
+	phase(IDLE),
+	epoch(0),
+	threshold(MIN_THRESHOLD),
+	allocated(0),
+	sweepPos(0),
+	sweepKept(0),
+	sweepEnd(0)
+{}
+
+void Heap::add(Value* value)
+{
+	values.push_back(value);
+	++allocated;
+}
+
+void Heap::mark(Value* value)
 {
-	// filter copy, delete unrefs
-	Values marked;
-	for (size_t i = 0; i < values.size(); i++)
+	if (value != 0 && !SmallInteger::is(value) && value->mark != epoch)
 	{
-		if (values[i]->marked)
-			marked.push_back(values[i]);
+		value->mark = epoch;
+		grey.push_back(value);
+	}
+}
+
+void Heap::startMarking()
+{
+	phase = MARK;
+	++epoch;
+	if (epoch == 0) // 0 is the mark of new values
+		++epoch;
+	grey.clear();
+}
+
+bool Heap::markStep(size_t budget)
+{
+	while (!grey.empty() && budget > 0)
+	{
+		Value* value = grey.back();
+		grey.pop_back();
+		value->propagateMarkForGC(this);
+		--budget;
+	}
+	return grey.empty();
+}
+
+void Heap::startSweeping()
+{
+	phase = SWEEP;
+	sweepPos = 0;
+	sweepKept = 0;
+	// values allocated during the sweep are after sweepEnd and are kept
+	sweepEnd = values.size();
+}
+
+bool Heap::sweepStep(size_t budget, DebugInfo* debug)
+{
+	size_t end = min(sweepEnd, sweepPos + budget);
+	bool freed = false;
+	for (; sweepPos < end; ++sweepPos)
+	{
+		Value* value = values[sweepPos];
+		values[sweepPos] = 0;
+		if (value->mark == epoch)
+		{
+			values[sweepKept++] = value;
+		}
 		else
-			delete values[i];
+		{
+			if (debug != 0)
+			{
+				ThunkPrototype* thunk = dynamic_cast<ThunkPrototype*>(value);
+				if (thunk != 0)
+					debug->thunks.erase(thunk);
+			}
+			delete value;
+			freed = true;
+		}
 	}
 	
+	// freed prototypes might be reused at the same address
+	if (freed)
+		++Prototype::membersEpoch;
+	
+	if (sweepPos < sweepEnd)
+		return false;
+	
 	// clean heap
-	swap(values, marked);
-	for_each(values.begin(), values.end(), mem_fun(&Value::clearGCMark));
+	values.erase(values.begin() + sweepKept, values.begin() + sweepEnd);
+	threshold = max(MIN_THRESHOLD, 2 * values.size());
+	phase = IDLE;
+	return true;
 }
@@ -1,17 +1,69 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <cstddef>
 #include <vector>
 
 struct Value;
+struct DebugInfo;
 
+/// All the values allocated by scripts, collected by an incremental mark and sweep.
+/// A cycle starts when the heap has grown past threshold, then marks and sweeps
+/// a bounded number of values per call, between the runs of the threads.
+/// Values not on the heap (heap == 0 at construction) are never freed.
 struct Heap
 {
 	typedef std::vector<Value*> Values;
 	
+	enum Phase
+	{
+		IDLE,
+		MARK,
+		SWEEP
+	};
+	
+	/// Number of values on the heap from which a collection cycle is started, at least
+	static const size_t MIN_THRESHOLD = 4096;
+	
 	Values values;
 	
-	void collectGarbage();
+	Phase phase;
+	/// Number of the current cycle, values whose mark is equal to it have been reached
+	unsigned epoch;
+	/// Values reached but whose references have not been followed yet
+	Values grey;
+	/// Size of values from which the next cycle starts
+	size_t threshold;
+	/// Number of values allocated since the last garbage collection step, to pace the collection
+	size_t allocated;
+	
+	/// Sweep progress: next value to look at, number of values kept so far, and end of the values to sweep
+	size_t sweepPos;
+	size_t sweepKept;
+	size_t sweepEnd;
+	
+	Heap();
+	
+	/// Adds a new value, it will be freed by the next cycle unless it is reached
+	void add(Value* value);
+	
+	/// Marks value as reached, if it was not already in this cycle
+	void mark(Value* value);
+	/// Must be called with the new value when a reference is written into an existing value
+	void writeBarrier(Value* value)
+	{
+		if (phase == MARK)
+			mark(value);
+	}
+	
+	/// Starts a new cycle, the roots must be marked afterwards
+	void startMarking();
+	/// Follows the references of at most budget grey values, returns true if there are none left
+	bool markStep(size_t budget);
+	/// Stops marking, every value which was not reached is garbage
+	void startSweeping();
+	/// Frees at most budget unreached values, returns true and goes back to IDLE when the sweep is complete
+	bool sweepStep(size_t budget, DebugInfo* debug);
 };
 
 #endif // ndef MEMORY_H
@@ -71,24 +71,35 @@ template<typename This> NativeValuePrototype<This> NativeValue<This>::prototype;
 
 
 template<typename T>
-inline const T& unbox(Thread* thread, Value*& value)
+inline T unbox(Thread* thread, Value* value)
 {
-	NativeValue<T>* native = dynamic_cast<NativeValue<T>*>(value);
+	NativeValue<T>* native = valueCast<NativeValue<T> >(value);
 	if (native == 0)
 		assert(false); // TODO: throw Exception
 	return native->value;
 }
 
 template<>
-inline Value*const& unbox<Value*>(Thread* thread, Value*& value) // ugly reference to constant pointer
+inline Value* unbox<Value*>(Thread* thread, Value* value)
 {
 	return value;
 }
 
+template<>
+inline int unbox<int>(Thread* thread, Value* value)
+{
+	if (SmallInteger::is(value))
+		return SmallInteger::unbox(value);
+	NativeValue<int>* native = valueCast<NativeValue<int> >(value);
+	if (native == 0)
+		assert(false); // TODO: throw Exception
+	return native->value;
+}
+
 template<typename T>
-inline const T& pop(Thread* thread)
+inline T pop(Thread* thread)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
+	Thread::Stack& stack = thread->stack;
 	Value* value = stack.back();
 	stack.pop_back();
 	return unbox<T>(thread, value);
@@ -107,17 +118,29 @@ inline Value* box<Value*>(Thread* thread, Value*const& value) // ugly reference
 	return value;
 }
 
+template<>
+inline Value* box<int>(Thread* thread, const int& value)
+{
+	if (SmallInteger::fits(value))
+		return SmallInteger::box(value);
+	return new NativeValue<int>(&thread->usl->heap, value);
+}
+
 template<>
 inline Value* box<bool>(Thread* thread, const bool& value)
 {
+	Usl* usl = thread->usl;
+	Value* cached = value ? usl->trueValue : usl->falseValue;
+	if (cached != 0)
+		return cached;
 	std::string name = value ? "true" : "false";
-	return thread->usl->getConstant(name);
+	return usl->getConstant(name);
 }
 
 template<typename T>
 inline void push(Thread* thread, const T& t)
 {
-	Thread::Frame::Stack& stack = thread->frames.back().stack;
+	Thread::Stack& stack = thread->stack;
 	Value* value = box(thread, t);
 	stack.push_back(value);
 }
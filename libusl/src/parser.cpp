@@ -255,6 +255,8 @@ ExpressionNode* Parser::simpleExpression()
 			string str = token.string();
 			next();
 			int value = atoi(str.c_str());
+			if (SmallInteger::fits(value))
+				return new ConstNode(position, SmallInteger::box(value));
 			return new ConstNode(position, new Integer(heap, value));
 		}
 	case STR:
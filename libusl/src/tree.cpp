@@ -58,7 +58,7 @@ void ConstNode::generate(ThunkPrototype* thunk, DebugInfo* debug, Heap* heap)
 void ConstNode::dumpSpecific(std::ostream &stream, unsigned indent) const
 {
 	stream << ' ';
-	value->dump(stream);
+	dumpValue(value, stream);
 	stream << '\n';
 }
 
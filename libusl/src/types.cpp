@@ -18,10 +18,29 @@ void Value::dump(std::ostream &stream) const
 }
 
 
+void Value::propagateMarkForGC(Heap* heap)
+{
+	heap->mark(prototype);
+}
+
+
+Prototype* SmallInteger::prototype = &Integer::prototype;
+
+void dumpValue(const Value* value, std::ostream &stream)
+{
+	if (SmallInteger::is(value))
+		stream << unmangle(typeid(Integer).name()) << "(" << SmallInteger::prototype << ")" << " = " << SmallInteger::unbox(value);
+	else
+		value->dump(stream);
+}
+
+
 Prototype Nil(0);
 Value nil(0, &Nil);
 
 
+size_t Prototype::membersEpoch = 1;
+
 Prototype::Prototype(Heap* heap):
 	Value(heap, 0)
 {}
@@ -34,6 +53,15 @@ void Prototype::addMethod(NativeCode* native)
 	native->epilogue(scope);
 	
 	members[native->name] = methodMember(scope);
+	++membersEpoch;
+}
+
+
+void Prototype::propagateMarkForGC(Heap* heap)
+{
+	Value::propagateMarkForGC(heap);
+	for (Members::const_iterator it = members.begin(); it != members.end(); ++it)
+		heap->mark(it->second);
 }
 
 
@@ -42,6 +70,22 @@ ThunkPrototype::ThunkPrototype(Heap* heap, Prototype* outer):
 	outer(outer)
 {}
 
+void ThunkPrototype::compile()
+{
+	bytecode.resize(body.size());
+	for (size_t i = 0; i < body.size(); ++i)
+		body[i]->compile(bytecode[i]);
+}
+
+void ThunkPrototype::propagateMarkForGC(Heap* heap)
+{
+	Prototype::propagateMarkForGC(heap);
+	heap->mark(outer);
+	// the code refers to constants and to the prototypes of the values it creates
+	for (Body::const_iterator it = body.begin(); it != body.end(); ++it)
+		(*it)->propagateMarkForGC(heap);
+}
+
 /*
 struct ScopeSize: NativeThunk
 {
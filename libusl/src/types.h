@@ -2,6 +2,7 @@
 #define TYPES_H
 
 #include "memory.h"
+#include "code.h"
 
 #include <cassert>
 #include <algorithm>
@@ -17,15 +18,15 @@ struct Prototype;
 struct Value
 {
 	Prototype* prototype;
-	bool marked;
+	unsigned mark; // epoch of the last garbage collection cycle which reached this value
 	
 	Value(Heap* heap, Prototype* prototype):
 		prototype(prototype)
 	{
-		marked = false;
+		mark = 0;
 		if (heap != 0)
 		{
-			heap->values.push_back(this);
+			heap->add(this);
 		}
 	}
 	
@@ -35,20 +36,43 @@ struct Value
 	
 	virtual void dumpSpecific(std::ostream &stream) const { }
 	
-	virtual void propagateMarkForGC() { }
-	
-	void markForGC()
+	/// Marks the values referenced by this one
+	virtual void propagateMarkForGC(Heap* heap);
+};
+extern Value nil;
+
+/// Integers which fit in a pointer are not allocated, but stored in the pointer itself, with the lowest bit set.
+/// Such values must not be dereferenced: use prototypeOf, valueCast and dumpValue on values which might be integers.
+struct SmallInteger
+{
+	enum
 	{
-		if (!marked)
-		{
-			marked = true;
-			propagateMarkForGC();
-		}
-	}
+		MIN = -(1 << 30),
+		MAX = (1 << 30) - 1
+	};
 	
-	void clearGCMark() { marked = false; }
+	/// The prototype of all integers
+	static Prototype* prototype;
+	
+	static bool is(const Value* value) { return (reinterpret_cast<size_t>(value) & 1) != 0; }
+	static bool fits(int value) { return value >= MIN && value <= MAX; }
+	static Value* box(int value) { return reinterpret_cast<Value*>(ptrdiff_t(value) * 2 + 1); }
+	static int unbox(const Value* value) { return int((reinterpret_cast<ptrdiff_t>(value) - 1) / 2); }
 };
-extern Value nil;
+
+inline Prototype* prototypeOf(const Value* value)
+{
+	return SmallInteger::is(value) ? SmallInteger::prototype : value->prototype;
+}
+
+/// Returns value as a T, or 0 if it is not one
+template<typename T>
+inline T* valueCast(Value* value)
+{
+	return SmallInteger::is(value) ? 0 : dynamic_cast<T*>(value);
+}
+
+void dumpValue(const Value* value, std::ostream &stream);
 
 struct ThunkPrototype;
 struct NativeCode;
@@ -58,6 +82,9 @@ struct Prototype: Value
 	
 	Members members;
 	
+	/// Incremented whenever members may have changed or prototypes may have been freed, to invalidate the inline caches
+	static size_t membersEpoch;
+	
 	Prototype(Heap* heap);
 	
 	void addMethod(NativeCode* native);
@@ -70,12 +97,7 @@ struct Prototype: Value
 		transform(members.begin(), members.end(), ostream_iterator<string>(stream, " "), select1st<Members::value_type>());
 	}
 	
-	virtual void propagateMarkForGC()
-	{
-		using namespace std;
-		using namespace __gnu_cxx;
-		for_each(members.begin(), members.end(), compose1(mem_fun(&Value::markForGC), select2nd<Members::value_type>()));
-	}
+	virtual void propagateMarkForGC(Heap* heap);
 	
 	virtual ThunkPrototype* lookup(const std::string& name) const
 	{
@@ -91,23 +113,24 @@ struct Code;
 struct ThunkPrototype: Prototype
 {
 	typedef std::vector<Code*> Body;
+	typedef std::vector<Instruction> Bytecode;
 
 	Prototype* outer;
 	Body body;
+	/// body compiled by compile(), one instruction per code, run by Thread::step
+	Bytecode bytecode;
 
 	ThunkPrototype(Heap* heap, Prototype* outer);
 	
+	/// Compiles body into bytecode, Thread::step calls it again when body has grown since
+	void compile();
+	
 	virtual void dumpSpecific(std::ostream& stream) const
 	{
 		stream << body.size() << " codes";
 	}
 	
-	virtual void propagateMarkForGC()
-	{
-		if (outer != 0)
-			outer->markForGC();
-		Prototype::propagateMarkForGC();
-	}
+	virtual void propagateMarkForGC(Heap* heap);
 };
 
 struct Thunk: Value
@@ -124,6 +147,12 @@ struct Thunk: Value
 	{
 		return static_cast<ThunkPrototype*>(prototype);
 	}
+	
+	virtual void propagateMarkForGC(Heap* heap)
+	{
+		Value::propagateMarkForGC(heap);
+		heap->mark(outer);
+	}
 };
 
 struct ScopePrototype: ThunkPrototype
@@ -153,15 +182,15 @@ struct Scope: Thunk
 			if (local == 0)
 				stream << "0(" << scopePrototype()->locals[it - locals.begin()] << ")";
 			else
-				local->dump(stream);
+				dumpValue(local, stream);
 		}
 	}
 	
-	virtual void propagateMarkForGC()
+	virtual void propagateMarkForGC(Heap* heap)
 	{
-		using namespace std;
-		using namespace __gnu_cxx;
-		for_each(locals.begin(), locals.end(), mem_fun(&Value::markForGC));
+		Thunk::propagateMarkForGC(heap);
+		for (Locals::const_iterator it = locals.begin(); it != locals.end(); ++it)
+			heap->mark(*it);
 	}
 	
 	ScopePrototype* scopePrototype() const
@@ -178,6 +207,13 @@ struct MetaPrototype: Value
 	
 	Prototype* prototype; // this is the prototype of the target, not of this meta object
 	Value* outer;
+	
+	virtual void propagateMarkForGC(Heap* heap)
+	{
+		Value::propagateMarkForGC(heap);
+		heap->mark(prototype);
+		heap->mark(outer);
+	}
 };
 
 struct Function: MetaPrototype
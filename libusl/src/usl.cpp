@@ -51,8 +51,7 @@ struct Load: NativeCode
 
 	void execute(Thread* thread)
 	{
-		Thread::Frame& frame = thread->frames.back();
-		Thread::Frame::Stack& stack = frame.stack;
+		Thread::Stack& stack = thread->stack;
 		
 		Value* argument = stack.back();
 		stack.pop_back();
@@ -63,9 +62,7 @@ struct Load: NativeCode
 		
 		auto_ptr<ifstream> stream(usl->openFile(filename));
 		Scope* scope = usl->compile(filename, *stream);
-		if (frame.nextInstr >= frame.thunk->thunkPrototype()->body.size())
-			thread->frames.pop_back(); // tail-call optimisation
-		thread->frames.push_back(scope);
+		thread->enter(scope);
 	}
 };
 
@@ -94,11 +91,14 @@ struct Yield: NativeCode
 
 void print(Value* value)
 {
-	value->dump(cout);
+	dumpValue(value, cout);
 	cout << endl;
 }
 
-Usl::Usl()
+Usl::Usl():
+	trueValue(0),
+	falseValue(0),
+	gcRootRescans(0)
 {
 	ScopePrototype* prototype = new ScopePrototype(&heap, 0);
 	prototype->addMethod(new Load());
@@ -108,19 +108,68 @@ Usl::Usl()
 	root = new Scope(&heap, prototype, 0);
 }
 
-void Usl::markGarbage() const
+void Usl::markGarbage()
 {
-	root->markForGC();
-//	for_each(threads.begin(), threads.end(), mem_fun_ref(&Thread::markForGC));
+	heap.mark(root);
+	for (Threads::iterator it = threads.begin(); it != threads.end(); ++it)
+		it->markForGC(&heap);
 }
 
 void Usl::collectGarbage()
 {
+	// finish the sweep in progress, as values after its end are kept
+	if (heap.phase == Heap::SWEEP)
+		heap.sweepStep(heap.values.size(), &debug);
+	
 	// mark
+	heap.startMarking();
 	markGarbage();
-
+	while (!heap.markStep(heap.grey.size()))
+		;
+	
 	// sweep
-	heap.collectGarbage();
+	heap.startSweeping();
+	heap.sweepStep(heap.values.size(), &debug);
+}
+
+void Usl::collectGarbageStep(size_t budget)
+{
+	switch (heap.phase)
+	{
+		case Heap::IDLE:
+		{
+			if (heap.values.size() >= heap.threshold)
+			{
+				heap.startMarking();
+				markGarbage();
+				gcRootRescans = 0;
+			}
+			break;
+		}
+		case Heap::MARK:
+		{
+			if (heap.markStep(budget))
+			{
+				// the threads have run since the roots were marked, but values written into
+				// other values went through the write barrier, so only the roots must be marked again
+				markGarbage();
+				++gcRootRescans;
+				if (gcRootRescans >= GC_MAX_ROOT_RESCANS)
+				{
+					while (!heap.markStep(heap.grey.size()))
+						;
+				}
+				if (heap.grey.empty())
+					heap.startSweeping();
+			}
+			break;
+		}
+		case Heap::SWEEP:
+		{
+			heap.sweepStep(budget, &debug);
+			break;
+		}
+	}
 }
 
 void Usl::includeScript(const std::string& name, std::istream& stream)
@@ -134,6 +183,7 @@ void Usl::includeScript(const std::string& name, std::istream& stream)
 	size_t index = rootPrototype->locals.size();
 	rootPrototype->locals.push_back(name);
 	root->locals.push_back(scope);
+	heap.writeBarrier(scope);
 	
 	for (Prototype::Members::const_iterator it = scopePrototype->members.begin(); it != scopePrototype->members.end(); ++it)
 	{
@@ -145,7 +195,9 @@ void Usl::includeScript(const std::string& name, std::istream& stream)
 		getter->body.push_back(new SelectCode(name));
 		getter->body.push_back(new EvalCode());
 		rootPrototype->members[name] = getter;
+		heap.writeBarrier(getter);
 	}
+	++Prototype::membersEpoch;
 	
 	for (size_t i = 0; i < scopePrototype->locals.size(); ++i)
 	{
@@ -171,6 +223,7 @@ void Usl::setConstant(const std::string& name, Value* value)
 
 	prototype->locals.push_back(name);
 	root->locals.push_back(value);
+	heap.writeBarrier(value);
 
 	ThunkPrototype*& getter = prototype->members[name];
 	if (getter == 0)
@@ -179,7 +232,14 @@ void Usl::setConstant(const std::string& name, Value* value)
 		getter->body.push_back(new ThunkCode());
 		getter->body.push_back(new ParentCode());
 		getter->body.push_back(new ValRefCode(index));
+		heap.writeBarrier(getter);
+		++Prototype::membersEpoch;
 	}
+	
+	if (name == "true" && trueValue == 0)
+		trueValue = value;
+	else if (name == "false" && falseValue == 0)
+		falseValue = value;
 }
 
 Value* Usl::getConstant(const std::string& name) const
@@ -213,6 +273,7 @@ Scope* Usl::compile(const std::string& name, std::istream& stream)
 	
 	ScopePrototype* prototype = new ScopePrototype(&heap, root->prototype);
 	block.generateMembers(prototype, &debug, &heap);
+	++Prototype::membersEpoch;
 	
 	Scope* scope = new Scope(&heap, prototype, root);
 	return scope;
@@ -234,7 +295,9 @@ size_t Usl::run(size_t steps)
 		total += it->run(steps);
 	}
 	
-	// TODO: garbageCollect
+	// keep up with the allocations, the amount of work only depends on the scripts so it is deterministic
+	collectGarbageStep(GC_MIN_WORK + 2 * heap.allocated);
+	heap.allocated = 0;
 	
 	return total;
 }
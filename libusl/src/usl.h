@@ -14,8 +14,12 @@ struct Usl
 	Usl();
 	virtual ~Usl() {}
 	
-	void markGarbage() const;
+	/// Marks the roots: the root scope and the frames of all threads
+	void markGarbage();
+	/// Does a complete garbage collection, finishing the current cycle if any
 	void collectGarbage();
+	/// Does a bounded amount of garbage collection work, starting a cycle if the heap has grown enough
+	void collectGarbageStep(size_t budget);
 	void includeScript(const std::string& name, std::istream& source);
 	void createThread(const std::string& name, std::istream& source);
 	void setConstant(const std::string& name, Value* value);
@@ -30,10 +34,23 @@ struct Usl
 	Scope* root;
 	Threads threads;
 	
-	/// Run one thread (round-robin over all threads) for a maximum of steps bytecodes executions
+	/// cached values of the true and false constants, used when boxing native bools
+	Value* trueValue;
+	Value* falseValue;
+	
+	/// Run one thread (round-robin over all threads) for a maximum of steps bytecodes executions,
+	/// then do some garbage collection work, proportional to the number of values allocated
 	size_t run(size_t steps);
 	
+	/// Minimum number of values marked or swept per call to run, when a collection cycle is in progress
+	static const size_t GC_MIN_WORK = 1024;
+	/// Number of times the roots are marked again before finishing the marking in one go
+	static const int GC_MAX_ROOT_RESCANS = 4;
+	
 private:
+	/// Number of times the roots have been marked again in the current cycle
+	int gcRootRescans;
+	
 	Scope* compile(const std::string& name, std::istream& source);
 	Thread* createThread(Scope* scope);
 	friend struct Load;
@@ -0,0 +1,101 @@
+#include "usl.h"
+#include "interpreter.h"
+#include "error.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+// Runs USL micro-benchmarks and reports the number of steps and the time they take.
+// usage: usl-bench [-r repeats] [-i include.usl]... bench.usl...
+// Each benchmark runs in a new Usl, after the includes, the way MapScriptUSL::syncStep runs map scripts.
+
+// processor time, so that other processes do not count
+static double now()
+{
+	return double(clock()) / CLOCKS_PER_SEC;
+}
+
+static void include(Usl& usl, const string& name)
+{
+	ifstream stream(name.c_str());
+	if (!stream)
+		throw Exception(Position(), "cannot open " + name);
+	usl.includeScript(name, stream);
+}
+
+static size_t runOnce(const vector<string>& includes, const string& name, double& duration)
+{
+	Usl usl;
+	for (size_t i = 0; i < includes.size(); ++i)
+		include(usl, includes[i]);
+
+	ifstream stream(name.c_str());
+	if (!stream)
+		throw Exception(Position(), "cannot open " + name);
+	usl.createThread(name, stream);
+
+	// same step budget per call as a map script
+	const size_t stepsMax = 10000;
+	size_t total = 0;
+	double start = now();
+	while (usl.threads.back().state != Thread::STOP)
+		total += usl.run(stepsMax);
+	duration = now() - start;
+	return total;
+}
+
+int main(int argc, char** argv)
+{
+	vector<string> includes;
+	vector<string> benchmarks;
+	int repeats = 5;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+			includes.push_back(argv[++i]);
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = max(1, atoi(argv[++i]));
+		else
+			benchmarks.push_back(argv[i]);
+	}
+	if (benchmarks.empty())
+	{
+		cerr << "usage: " << argv[0] << " [-r repeats] [-i include.usl]... bench.usl..." << endl;
+		return 1;
+	}
+
+	try
+	{
+		for (size_t b = 0; b < benchmarks.size(); ++b)
+		{
+			// report the best run, the others are slowed down by the rest of the system
+			double best = 0;
+			size_t steps = 0;
+			for (int r = 0; r < repeats; ++r)
+			{
+				double duration;
+				steps = runOnce(includes, benchmarks[b], duration);
+				if (r == 0 || duration < best)
+					best = duration;
+			}
+			cout << benchmarks[b] << ": " << steps << " steps, " << best << " s";
+			if (best > 0)
+				cout << ", " << size_t(steps / best) << " steps/s";
+			cout << endl;
+		}
+	}
+	catch(Exception& e)
+	{
+		cerr << e.position << ": " << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
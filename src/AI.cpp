@@ -24,6 +24,7 @@
 #include "Order.h"
 #include <assert.h>
 #include <Stream.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "StringTable.h"
 
@@ -78,6 +79,9 @@ AI::AI(ImplementitionID implementitionID, Player *player)
 	
 	this->implementitionID=implementitionID;
 	this->player=player;
+	thinkCount=0;
+	thinkTimeTotal=0;
+	thinkTimeMax=0;
 }
 
 AI::AI(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
@@ -85,6 +89,9 @@ AI::AI(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 	aiImplementation=NULL;
 	implementitionID=NONE;
 	this->player=player;
+	thinkCount=0;
+	thinkTimeTotal=0;
+	thinkTimeMax=0;
 	bool goodLoad=load(stream, versionMinor);
 	assert(goodLoad);
 }
@@ -102,7 +109,15 @@ boost::shared_ptr<Order> AI::getOrder(bool paused)
 	if (paused || !player->team->isAlive)
 		return shared_ptr<Order>(new NullOrder());
 	assert(aiImplementation);
-	return aiImplementation->getOrder();
+	
+	boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::universal_time();
+	boost::shared_ptr<Order> order = aiImplementation->getOrder();
+	Uint32 thinkTime = (boost::posix_time::microsec_clock::universal_time() - startTime).total_microseconds();
+	thinkCount++;
+	thinkTimeTotal += thinkTime;
+	if (thinkTime > thinkTimeMax)
+		thinkTimeMax = thinkTime;
+	return order;
 }
 
 bool AI::load(GAGCore::InputStream *stream, Sint32 versionMinor)
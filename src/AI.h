@@ -78,6 +78,13 @@ public:
 	static std::string getAIText(int id);
 
 	boost::shared_ptr<Order> getOrder(bool paused);
+	
+	//! Number of orders computed by aiImplementation
+	Uint32 thinkCount;
+	//! Total time spent computing orders in aiImplementation, in microseconds
+	Uint64 thinkTimeTotal;
+	//! Longest time spent computing a single order in aiImplementation, in microseconds
+	Uint32 thinkTimeMax;
 
 //	Uint32 step;
 };
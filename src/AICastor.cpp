@@ -17,6 +17,8 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 */
 
+#include <map>
+
 #include <StringTable.h>
 #include <SupportFunctions.h>
 #include <Toolkit.h>
@@ -126,6 +128,7 @@ void AICastor::firstInit()
 	enemyRangeMap=NULL;
 	
 	ressourcesCluster=NULL;
+	boxSumMap=NULL;
 }
 
 AICastor::AICastor(Player *player)
@@ -282,6 +285,10 @@ void AICastor::init(Player *player)
 	if (ressourcesCluster!=NULL)
 		delete[] ressourcesCluster;
 	ressourcesCluster=new Uint16[size];
+	
+	if (boxSumMap!=NULL)
+		delete[] boxSumMap;
+	boxSumMap=new Sint32[(map->w+1)*(map->h+1)];
 }
 
 AICastor::~AICastor()
@@ -339,6 +346,9 @@ AICastor::~AICastor()
 	
 	if (ressourcesCluster!=NULL)
 		delete[] ressourcesCluster;
+	
+	if (boxSumMap!=NULL)
+		delete[] boxSumMap;
 
 	for(std::list<Project *>::iterator i=projects.begin(); i!=projects.end(); ++i)
 	{
@@ -713,7 +723,7 @@ boost::shared_ptr<Order>AICastor::controlSwarms()
 	for (int i=0; i<NB_UNIT_TYPE; i++)
 		unitSum[i]=0;
 	Unit **myUnits=team->myUnits;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u)
@@ -721,7 +731,7 @@ boost::shared_ptr<Order>AICastor::controlSwarms()
 	}
 	int foodSum=0;
 	Building **myBuildings=team->myBuildings;
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b=myBuildings[i];
 		if (b && b->maxUnitWorking && b->type->canFeedUnit)
@@ -754,7 +764,7 @@ boost::shared_ptr<Order>AICastor::controlSwarms()
 	{
 		// Stop making any units!
 		Building **myBuildings=team->myBuildings;
-		for (int bi=0; bi<Building::MAX_COUNT; bi++)
+		for (int bi=team->buildingSlots.first(); bi!=-1; bi=team->buildingSlots.next(bi))
 		{
 			Building *b=myBuildings[bi];
 			if (b && b->type->unitProductionTime)
@@ -808,7 +818,7 @@ boost::shared_ptr<Order>AICastor::controlSwarms()
 	fprintf(logFile,  "discovered=%d, seeable=%d, size=%zd, explorerGoal=%d\n",
 		discovered, seeable, size, explorerGoal);
 	
-	for (int bi=0; bi<1024; bi++)
+	for (int bi=team->buildingSlots.first(); bi!=-1; bi=team->buildingSlots.next(bi))
 	{
 		Building *b=myBuildings[bi];
 		if (b && b->type->unitProductionTime)
@@ -1102,7 +1112,7 @@ boost::shared_ptr<Order>AICastor::controlStrikes()
 			if ((team->enemies&enemyTeam->me)==0)
 				continue;
 			Building **enemyBuildings=enemyTeam->myBuildings;
-			for (int bi=0; bi<Building::MAX_COUNT; bi++)
+			for (int bi=enemyTeam->buildingSlots.first(); bi!=-1; bi=enemyTeam->buildingSlots.next(bi))
 			{
 				Building *b=enemyBuildings[bi];
 				if (b==NULL || ((b->seenByMask&me)==0) || b->locked[canSwim])
@@ -1122,7 +1132,7 @@ boost::shared_ptr<Order>AICastor::controlStrikes()
 			if ((team->enemies&enemyTeam->me)==0)
 				continue;
 			Building **enemyBuildings=enemyTeam->myBuildings;
-			for (int bi=0; bi<Building::MAX_COUNT; bi++)
+			for (int bi=enemyTeam->buildingSlots.first(); bi!=-1; bi=enemyTeam->buildingSlots.next(bi))
 			{
 				Building *b=enemyBuildings[bi];
 				if (b==NULL || ((b->seenByMask&me)==0) || b->locked[canSwim] || b->type->level<bestLevel)
@@ -1159,7 +1169,7 @@ boost::shared_ptr<Order>AICastor::controlStrikes()
 	Team *enemyTeam=game->teams[strikeTeam];
 	Uint32 me=team->me;
 	Building **enemyBuildings=enemyTeam->myBuildings;
-	for (int bi=0; bi<Building::MAX_COUNT; bi++)
+	for (int bi=enemyTeam->buildingSlots.first(); bi!=-1; bi=enemyTeam->buildingSlots.next(bi))
 	{
 		Building *b=enemyBuildings[bi];
 		if (b==NULL || ((b->seenByMask&me)==0) || b->locked[canSwim])
@@ -1606,7 +1616,7 @@ boost::shared_ptr<Order>AICastor::continueProject(Project *project)
 		}
 		
 		Building **myBuildings=team->myBuildings;
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 		{
 			Building *b=myBuildings[i];
 			if (b)
@@ -1714,7 +1724,7 @@ boost::shared_ptr<Order>AICastor::continueProject(Project *project)
 		if ((project->waitFinished || overWorkers) && enoughFreeWorkers())
 		{
 			Building **myBuildings=team->myBuildings;
-			for (int i=0; i<Building::MAX_COUNT; i++)
+			for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 			{
 				Building *b=myBuildings[i];
 				if (b && b->type->shortTypeNum==project->shortTypeNum && b->maxUnitWorking<project->mainWorkers)
@@ -1763,7 +1773,7 @@ boost::shared_ptr<Order>AICastor::continueProject(Project *project)
 			Sint32 finalWorkers=project->finalWorkers;
 			
 			Building **myBuildings=team->myBuildings;
-			for (int i=0; i<Building::MAX_COUNT; i++)
+			for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 			{
 				Building *b=myBuildings[i];
 				if (b && b->type->shortTypeNum==project->shortTypeNum && b->maxUnitWorking!=finalWorkers)
@@ -1812,15 +1822,9 @@ bool AICastor::enoughFreeWorkers()
 	bool enough=(workersBalance>minBalance);
 	overWorkers=(workersBalance>minOverWorkers);
 	
-	assert(buildsAmount<1024);
-	static int oldEnough[1024];
-	static bool first=true;
-	if (first)
-	{
-		memset(oldEnough, 2, 1024*sizeof(*oldEnough));
-		first=false;
-	}
-	if ((oldEnough[buildsAmount]==2) || (enough!=oldEnough[buildsAmount]))
+	static std::map<int, bool> oldEnough;
+	std::map<int, bool>::const_iterator old=oldEnough.find(buildsAmount);
+	if ((old==oldEnough.end()) || (enough!=old->second))
 	{
 		fprintf(logFile,  "enoughFreeWorkers()=%d, workersBalance=%d, totalWorkers=%d, partFree=%d, buildsAmount=%d, minBalance=%d\n",
 			enough, workersBalance, totalWorkers, partFree, buildsAmount, minBalance);
@@ -1837,7 +1841,7 @@ void AICastor::computeCanSwim()
 	Unit **myUnits=team->myUnits;
 	int sumCanSwim=0;
 	int sumCantSwim=0;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u && u->typeNum==WORKER && u->medical==0)
@@ -1891,7 +1895,7 @@ void AICastor::computeBuildingSum()
 				buildingLevels[bi][si][li]=0;
 	
 	Building **myBuildings=team->myBuildings;
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b=myBuildings[i];
 		if (b)
@@ -1964,7 +1968,7 @@ void AICastor::computeWarLevel()
 	
 	int warPowerSum=0;
 	Unit **myUnits=team->myUnits;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u && u->medical==Unit::MED_FREE && u->typeNum==WARRIOR)
@@ -2259,7 +2263,7 @@ void AICastor::computeBuildingNeighbourMap(int dw, int dh)
 		if (!team)
 			continue;
 		Building **myBuildings=team->myBuildings;
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 		{
 			Building *b=myBuildings[i];
 			if (b && !b->type->isVirtual)
@@ -2286,15 +2290,51 @@ void AICastor::computeBuildingNeighbourMap(int dw, int dh)
 	}
 }
 
+void AICastor::addSquareToBoxSum(int x, int y, int r, Sint32 value)
+{
+	int w=map->w;
+	int h=map->h;
+	int stride=w+1;
+	// The square is split in rectangles which do not cross the map borders.
+	// A square larger than the map covers some cells several times.
+	for (int y0=(y-r)&map->hMask, yLeft=2*r+1; yLeft>0; y0=0)
+	{
+		int y1=std::min(h, y0+yLeft);
+		yLeft-=y1-y0;
+		for (int x0=(x-r)&map->wMask, xLeft=2*r+1; xLeft>0; x0=0)
+		{
+			int x1=std::min(w, x0+xLeft);
+			xLeft-=x1-x0;
+			boxSumMap[x0+y0*stride]+=value;
+			boxSumMap[x1+y0*stride]-=value;
+			boxSumMap[x0+y1*stride]-=value;
+			boxSumMap[x1+y1*stride]+=value;
+		}
+	}
+}
+
+void AICastor::integrateBoxSum()
+{
+	int w=map->w;
+	int h=map->h;
+	int stride=w+1;
+	for (int y=0; y<h; y++)
+	{
+		Sint32 *line=&boxSumMap[y*stride];
+		for (int x=1; x<w; x++)
+			line[x]+=line[x-1];
+		if (y>0)
+			for (int x=0; x<w; x++)
+				line[x]+=line[x-stride];
+	}
+}
+
 void AICastor::computeWorkPowerMap()
 {
 	int w=map->w;
 	int h=map->h;
-	int wMask=map->wMask;
-	int hMask=map->hMask;
 	//int hDec=map->hDec;
 	int wDec=map->wDec;
-	size_t size=w*h;
 	Uint8 *gradient=workPowerMap;
 	Uint8 maxRange=64;
 	if (maxRange>w/2)
@@ -2302,10 +2342,10 @@ void AICastor::computeWorkPowerMap()
 	if (maxRange>h/2)
 		maxRange=h/2;
 	
-	memset(gradient, 0, size);
+	memset(boxSumMap, 0, (w+1)*(h+1)*sizeof(Sint32));
 	
 	Unit **myUnits=team->myUnits;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u && u->typeNum==WORKER && u->medical==0 && u->activity!=Unit::ACT_UPGRADING)
@@ -2316,53 +2356,19 @@ void AICastor::computeWorkPowerMap()
 			//printf(" range=%d\n", range);
 			if (range>maxRange)
 				range=maxRange;
-			int ux=u->posX;
-			int uy=u->posY;
+			// A worker adds (range-r)>>reducer to the cells at distance r,
+			// which is the number of squares of half size range-(k<<reducer), k>0, covering them.
 			static const int reducer=3;
-			{
-				Uint8 *gp=&gradient[(ux&wMask)+((uy&hMask)<<wDec)];
-				Uint16 sum=*gp+(range>>reducer);
-				if (sum>255)
-					sum=255;
-				*gp=sum;
-			}
-			for (int r=1; r<range; r++)
-			{
-				for (int dx=-r; dx<=r; dx++)
-				{
-					Uint8 *gp=&gradient[((ux+dx)&wMask)+(((uy -r)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dx=-r; dx<=r; dx++)
-				{
-					Uint8 *gp=&gradient[((ux+dx)&wMask)+(((uy +r)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dy=(1-r); dy<r; dy++)
-				{
-					Uint8 *gp=&gradient[((ux -r)&wMask)+(((uy+dy)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dy=(1-r); dy<r; dy++)
-				{
-					Uint8 *gp=&gradient[((ux +r)&wMask)+(((uy+dy)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-			}
+			for (int k=1; (k<<reducer)<=range; k++)
+				addSquareToBoxSum(u->posX, u->posY, range-(k<<reducer), 1);
 		}
 	}
+	integrateBoxSum();
+	
+	// As all contributions are positive, saturating the sum once is the same as saturating each addition
+	for (int y=0; y<h; y++)
+		for (int x=0; x<w; x++)
+			gradient[x+(y<<wDec)]=(Uint8)std::min(255, boxSumMap[x+y*(w+1)]);
 }
 
 
@@ -2380,7 +2386,7 @@ void AICastor::computeWorkRangeMap()
 	memcpy(gradient, obstacleUnitMap, size);
 	
 	Unit **myUnits=team->myUnits;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u && u->typeNum==WORKER && u->medical==0 && u->activity!=Unit::ACT_UPGRADING)
@@ -2428,54 +2434,36 @@ void AICastor::computeHydratationMap()
 fprintf(logFile,  "computeHydratationMap()...\n");
 	int w=map->w;
 	int h=map->h;
-	int wMask=map->wMask;
-	int hMask=map->hMask;
 	//int hDec=map->hDec;
 	int wDec=map->wDec;
-	size_t size=w*h;
 	
-	Uint16 *gradient=(Uint16 *)malloc(2*size);
-	memset(gradient, 0, 2*size);
+	memset(boxSumMap, 0, (w+1)*(h+1)*sizeof(Sint32));
 	Case *cases=map->cases;
 	static const int range=16;
+	// Each sand cell adds range-r to the cells at distance r, for 0<r<range,
+	// which is the number of squares of half size r' < range covering them, minus range on the sand cell itself.
 	for (int y=0; y<h; y++)
 		for (int x=0; x<w; x++)
 		{
 			Uint16 t=cases[x+(y<<wDec)].terrain;
 			if ((t>=256)&&(t<256+16)) // if SAND
-				for (int r=1; r<range; r++)
-				{
-					for (int dx=-r; dx<=r; dx++)
-					{
-						Uint16 *gp=&gradient[((x+dx)&wMask)+(((y -r)&hMask)<<wDec)];
-						*gp+=(range-r);
-					}
-					for (int dx=-r; dx<=r; dx++)
-					{
-						Uint16 *gp=&gradient[((x+dx)&wMask)+(((y +r)&hMask)<<wDec)];
-						*gp+=(range-r);
-					}
-					for (int dy=(1-r); dy<r; dy++)
-					{
-						Uint16 *gp=&gradient[((x -r)&wMask)+(((y+dy)&hMask)<<wDec)];
-						*gp+=(range-r);
-					}
-					for (int dy=(1-r); dy<r; dy++)
-					{
-						Uint16 *gp=&gradient[((x +r)&wMask)+(((y+dy)&hMask)<<wDec)];
-						*gp+=(range-r);
-					}
-				}
+				for (int r=0; r<range; r++)
+					addSquareToBoxSum(x, y, r, 1);
+		}
+	integrateBoxSum();
+	for (int y=0; y<h; y++)
+		for (int x=0; x<w; x++)
+		{
+			Sint32 sum=boxSumMap[x+y*(w+1)];
+			Uint16 t=cases[x+(y<<wDec)].terrain;
+			if ((t>=256)&&(t<256+16)) // if SAND
+				sum-=range;
+			Uint16 value=sum>>4;
+			if (value<255)
+				hydratationMap[x+(y<<wDec)]=value;
+			else
+				hydratationMap[x+(y<<wDec)]=255;
 		}
-	for (size_t i=0; i<size; i++)
-	{
-		Uint16 value=gradient[i]>>4;
-		if (value<255)
-			hydratationMap[i]=value;
-		else
-			hydratationMap[i]=255;
-	}
-	free(gradient);
 	fprintf(logFile,  "...computeHydratationMap() done\n");
 }
 
@@ -2580,14 +2568,11 @@ void AICastor::computeEnemyPowerMap()
 	
 	int w=map->w;
 	int h=map->h;
-	int wMask=map->wMask;
-	int hMask=map->hMask;
 	//int hDec=map->hDec;
 	int wDec=map->wDec;
-	size_t size=w*h;
 	Uint8 *gradient=enemyPowerMap;
 	
-	memset(gradient, 0, size);
+	memset(boxSumMap, 0, (w+1)*(h+1)*sizeof(Sint32));
 	
 	for (int ti=0; ti<game->mapHeader.getNumberOfTeams(); ti++)
 	{
@@ -2596,59 +2581,23 @@ void AICastor::computeEnemyPowerMap()
 		if ((team->enemies&enemyTeam->me)==0)
 			continue;
 		Building **enemyBuildings=enemyTeam->myBuildings;
-		for (int bi=0; bi<Building::MAX_COUNT; bi++)
+		for (int bi=enemyTeam->buildingSlots.first(); bi!=-1; bi=enemyTeam->buildingSlots.next(bi))
 		{
 			Building *b=enemyBuildings[bi];
 			if (b==NULL || ((b->seenByMask&me)==0))
 				continue;
-			int bx=b->posX;
-			int by=b->posY;
+			// Same kernel as in computeWorkPowerMap()
 			static const int reducer=3;
 			static const int range=32; // max 32
-			{
-				Uint8 *gp=&gradient[(bx&wMask)+((by&hMask)<<wDec)];
-				Uint16 sum=*gp+(range>>reducer);
-				if (sum>255)
-					sum=255;
-				*gp=sum;
-			}
-			for (int r=1; r<range; r++)
-			{
-				for (int dx=-r; dx<=r; dx++)
-				{
-					Uint8 *gp=&gradient[((bx+dx)&wMask)+(((by -r)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dx=-r; dx<=r; dx++)
-				{
-					Uint8 *gp=&gradient[((bx+dx)&wMask)+(((by +r)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dy=(1-r); dy<r; dy++)
-				{
-					Uint8 *gp=&gradient[((bx -r)&wMask)+(((by+dy)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-				for (int dy=(1-r); dy<r; dy++)
-				{
-					Uint8 *gp=&gradient[((bx +r)&wMask)+(((by+dy)&hMask)<<wDec)];
-					Uint16 sum=*gp+((range-r)>>reducer);
-					if (sum>255)
-						sum=255;
-					*gp=sum;
-				}
-			}
+			for (int k=1; (k<<reducer)<=range; k++)
+				addSquareToBoxSum(b->posX, b->posY, range-(k<<reducer), 1);
 		}
 	}
+	integrateBoxSum();
+	
+	for (int y=0; y<h; y++)
+		for (int x=0; x<w; x++)
+			gradient[x+(y<<wDec)]=(Uint8)std::min(255, boxSumMap[x+y*(w+1)]);
 }
 
 void AICastor::computeEnemyRangeMap()
@@ -2676,7 +2625,7 @@ void AICastor::computeEnemyRangeMap()
 		if ((team->enemies & enemyTeam->me)==0)
 			continue;
 		Building **enemyBuildings=enemyTeam->myBuildings;
-		for (int bi=0; bi<Building::MAX_COUNT; bi++)
+		for (int bi=enemyTeam->buildingSlots.first(); bi!=-1; bi=enemyTeam->buildingSlots.next(bi))
 		{
 			Building *b=enemyBuildings[bi];
 			if (b==NULL || ((b->seenByMask&me)==0) || b->type->isBuildingSite)
@@ -2716,10 +2665,10 @@ void AICastor::computeEnemyWarriorsMap()
 	{
 		if ((map->fogOfWar[i]&team->me)==0)
 			continue;
-		Uint16 guid=map->cases[i].groundUnit;
+		Uint32 guid=map->cases[i].groundUnit;
 		if (guid==NOGUID)
 			continue;
-		Uint32 teamMask=(1<<(guid>>10));
+		Uint32 teamMask=(1<<Unit::GIDtoTeam(guid));
 		if ((teamMask&team->enemies)==0)
 			continue;
 		gradient[i]=32;
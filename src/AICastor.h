@@ -175,6 +175,11 @@ private:
 	void computeEnemyPowerMap();
 	void computeEnemyRangeMap();
 	void computeEnemyWarriorsMap();
+	
+	//! Adds value to every cell of the square of half size r around (x, y), wrapping around the map, in boxSumMap
+	void addSquareToBoxSum(int x, int y, int r, Sint32 value);
+	//! Turns boxSumMap into the sum of the squares added to each cell, read at boxSumMap[x+y*(w+1)]
+	void integrateBoxSum();
 
 	boost::shared_ptr<Order>findGoodBuilding(Sint32 typeNum, bool food, bool defense, bool critical);
 	
@@ -253,6 +258,9 @@ public:
 	Uint16 *ressourcesCluster;
 	
 private:
+	//! Differences of the sums of squares, of size (w+1)*(h+1), used to accumulate square shaped kernels
+	Sint32 *boxSumMap;
+	
 	FILE *logFile;
 };
 
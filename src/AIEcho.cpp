@@ -31,6 +31,8 @@
 #include <iterator>
 #include "Utilities.h"
 #include "boost/tuple/tuple_io.hpp"
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 #include "Brush.h"
 
 using namespace AIEcho;
@@ -42,6 +44,14 @@ using namespace AIEcho::SearchTools;
 using namespace boost::logic;
 using namespace boost;
 
+///Echo saves building gids in 32 bits, but before version 84 the gids themselves were Uint16 and need converting
+static Uint32 loadedBuildingGID(Uint32 gid, Sint32 versionMinor)
+{
+	if(versionMinor < 84)
+		return ::Building::GIDfromUint16(gid);
+	return gid;
+}
+
 
 
 void AIEcho::signature_write(GAGCore::OutputStream *stream)
@@ -129,7 +139,7 @@ Entities::Building::Building(int building_type, int team, bool under_constructio
 
 bool Entities::Building::is_entity(Map* map, int posx, int posy)
 {
-	int building_id=map->getBuilding(posx, posy);
+	Uint32 building_id=map->getBuilding(posx, posy);
 	if(building_id!=NOGBID)
 	{
 		int team_id=::Building::GIDtoTeam(building_id);
@@ -171,6 +181,13 @@ Entities::EntityType Entities::Building::get_type()
 
 
 
+Uint32 Entities::Building::hash_value()
+{
+	return EBuilding ^ (building_type<<4) ^ (team<<12) ^ (under_construction<<20);
+}
+
+
+
 bool Entities::Building::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("Building");
@@ -203,7 +220,7 @@ Entities::AnyTeamBuilding::AnyTeamBuilding(int team, bool under_construction) :
 
 bool Entities::AnyTeamBuilding::is_entity(Map* map, int posx, int posy)
 {
-	int building_id=map->getBuilding(posx, posy);
+	Uint32 building_id=map->getBuilding(posx, posy);
 	if(building_id!=NOGBID)
 	{
 		int team_id=::Building::GIDtoTeam(building_id);
@@ -245,6 +262,13 @@ Entities::EntityType Entities::AnyTeamBuilding::get_type()
 
 
 
+Uint32 Entities::AnyTeamBuilding::hash_value()
+{
+	return EAnyTeamBuilding ^ (team<<12) ^ (under_construction<<20);
+}
+
+
+
 bool Entities::AnyTeamBuilding::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("AnyTeamBuilding");
@@ -274,7 +298,7 @@ Entities::AnyBuilding::AnyBuilding(bool under_construction) : under_construction
 
 bool Entities::AnyBuilding::is_entity(Map* map, int posx, int posy)
 {
-	int building_id=map->getBuilding(posx, posy);
+	Uint32 building_id=map->getBuilding(posx, posy);
 	if(building_id!=NOGBID)
 	{
 		int team_id=::Building::GIDtoTeam(building_id);
@@ -311,6 +335,13 @@ Entities::EntityType Entities::AnyBuilding::get_type()
 
 
 
+Uint32 Entities::AnyBuilding::hash_value()
+{
+	return EAnyBuilding ^ (under_construction<<20);
+}
+
+
+
 bool Entities::AnyBuilding::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("AnyBuilding");
@@ -375,6 +406,13 @@ Entities::EntityType Entities::Ressource::get_type()
 
 
 
+Uint32 Entities::Ressource::hash_value()
+{
+	return ERessource ^ (ressource_type<<4);
+}
+
+
+
 bool Entities::Ressource::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("Ressource");
@@ -547,6 +585,13 @@ Entities::EntityType Entities::Position::get_type()
 }
 
 
+
+Uint32 Entities::Position::hash_value()
+{
+	return EPosition ^ (x<<4) ^ (y<<18);
+}
+
+
 bool Entities::Position::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("Position");
@@ -687,6 +732,18 @@ bool GradientInfo::operator==(const GradientInfo& rhs) const
 
 
 
+Uint32 GradientInfo::hash_value() const
+{
+	Uint32 hash=sources.size();
+	for(unsigned int i=0; i<sources.size(); ++i)
+		hash=hash*31+sources[i]->hash_value();
+	for(unsigned int i=0; i<obstacles.size(); ++i)
+		hash=hash*37+obstacles[i]->hash_value();
+	return hash;
+}
+
+
+
 bool GradientInfo::needs_updating() const
 {
 	if(needs_updated)
@@ -824,31 +881,89 @@ Gradient::Gradient(const GradientInfo& gi)
 {
 	gradient_info=gi;
 	width=0;
+	last_update=0;
+	last_use=0;
 }
 
 
 void Gradient::recalculate(Map* map)
 {
 	width=map->getW();
-//	if(gradient==NULL)
-//		gradient=new Sint16[map->getW()*map->getH()];
-//	std::fill(gradient, gradient+(map->getW()*map->getH()),0); 
+	const size_t size=map->getW()*map->getH();
+
+	std::vector<Uint8> new_cells(size);
+	classify_cells(map, new_cells);
+
+	if(gradient.size()!=size)
+	{
+		cells.swap(new_cells);
+		compute_full(map);
+		return;
+	}
 
+	std::vector<int> changed;
+	for(size_t n=0; n<size; ++n)
+		if(new_cells[n]!=cells[n])
+			changed.push_back(n);
+	cells.swap(new_cells);
+
+	//When many cells changed, repairing the gradient costs more than computing it again
+	if(changed.size() > size/8)
+		compute_full(map);
+	else if(!changed.empty())
+		compute_incremental(map, changed);
+}
+
+
+void Gradient::classify_cells(Map* map, std::vector<Uint8>& cells)
+{
+	const int h=map->getH();
+	unsigned thread_count=boost::thread::hardware_concurrency();
+	if(map->getW()*h < 128*128 || thread_count<2)
+	{
+		classify_rows(map, cells, 0, h);
+		return;
+	}
+	thread_count=std::min(thread_count, 4u);
+
+	//The entities only read the map, so the rows can be classified in parallel
+	boost::thread_group threads;
+	for(unsigned n=1; n<thread_count; ++n)
+		threads.create_thread(boost::bind(&Gradient::classify_rows, this, map, boost::ref(cells), (h*n)/thread_count, (h*(n+1))/thread_count));
+	classify_rows(map, cells, 0, h/thread_count);
+	threads.join_all();
+}
+
+
+void Gradient::classify_rows(Map* map, std::vector<Uint8>& cells, int y_begin, int y_end)
+{
+	for(int y=y_begin; y<y_end; ++y)
+	{
+		for(int x=0; x<map->getW(); ++x)
+		{
+			if(gradient_info.match_source(map, x, y))
+				cells[get_pos(x, y)]=2;
+			else if(gradient_info.match_obstacle(map, x, y))
+				cells[get_pos(x, y)]=1;
+			else
+				cells[get_pos(x, y)]=0;
+		}
+	}
+}
+
+
+void Gradient::compute_full(Map* map)
+{
 	gradient.resize(map->getW()*map->getH());
-	std::fill(gradient.begin(), gradient.end(),0); 
+	std::copy(cells.begin(), cells.end(), gradient.begin());
 
 	std::queue<position> positions;
 	for(int x=0; x<map->getW(); ++x)
 	{
 		for(int y=0; y<map->getH(); ++y)
 		{
-			if(gradient_info.match_source(map, x, y))
-			{
-				gradient[get_pos(x, y)]=2;
+			if(cells[get_pos(x, y)]==2)
 				positions.push(position(x, y));
-			}
-			else if(gradient_info.match_obstacle(map, x, y))
-				gradient[get_pos(x, y)]=1;
 		}
 	}
 	while(!positions.empty())
@@ -924,6 +1039,98 @@ void Gradient::recalculate(Map* map)
 }
 
 
+void Gradient::compute_incremental(Map* map, const std::vector<int>& changed)
+{
+	const int w=map->getW();
+	const int h=map->getH();
+
+	//The gradient holds the distance to the nearest source, so it is repaired like a shortest path tree.
+	//First, every cell that may have been reached through a changed cell is reset, following the cells
+	//exactly one step farther. The result is the same as compute_full would give.
+	std::vector<std::pair<int, int> > invalidated;
+	std::vector<int> reset;
+	std::vector<std::vector<int> > buckets(3);
+	for(unsigned int i=0; i<changed.size(); ++i)
+	{
+		int p=changed[i];
+		int old_value=gradient[p];
+		gradient[p]=cells[p];
+		if(old_value>=2)
+			invalidated.push_back(std::make_pair(p, old_value));
+		if(cells[p]==0)
+			reset.push_back(p);
+		else if(cells[p]==2)
+			buckets[2].push_back(p);
+	}
+	while(!invalidated.empty())
+	{
+		int p=invalidated.back().first;
+		int value=invalidated.back().second;
+		invalidated.pop_back();
+		int x=p%w;
+		int y=p/w;
+		for(int dy=-1; dy<=1; ++dy)
+		{
+			for(int dx=-1; dx<=1; ++dx)
+			{
+				int q=get_pos((x+dx+w)%w, (y+dy+h)%h);
+				if(gradient[q]==value+1 && cells[q]==0)
+				{
+					gradient[q]=0;
+					reset.push_back(q);
+					invalidated.push_back(std::make_pair(q, value+1));
+				}
+			}
+		}
+	}
+
+	//Then the distances are propagated again, in increasing order, from the neighbours of the reset cells
+	for(unsigned int i=0; i<reset.size(); ++i)
+	{
+		int x=reset[i]%w;
+		int y=reset[i]/w;
+		for(int dy=-1; dy<=1; ++dy)
+		{
+			for(int dx=-1; dx<=1; ++dx)
+			{
+				int q=get_pos((x+dx+w)%w, (y+dy+h)%h);
+				if(gradient[q]>=2)
+				{
+					if(gradient[q]>=int(buckets.size()))
+						buckets.resize(gradient[q]+1);
+					buckets[gradient[q]].push_back(q);
+				}
+			}
+		}
+	}
+	for(unsigned int value=2; value<buckets.size(); ++value)
+	{
+		for(unsigned int i=0; i<buckets[value].size(); ++i)
+		{
+			int p=buckets[value][i];
+			if(gradient[p]!=int(value))
+				continue;
+			int x=p%w;
+			int y=p/w;
+			for(int dy=-1; dy<=1; ++dy)
+			{
+				for(int dx=-1; dx<=1; ++dx)
+				{
+					int q=get_pos((x+dx+w)%w, (y+dy+h)%h);
+					if(gradient[q]==0 || gradient[q]>int(value+1))
+					{
+						gradient[q]=value+1;
+						if(value+1>=buckets.size())
+							buckets.resize(value+2);
+						buckets[value+1].push_back(q);
+					}
+				}
+			}
+		}
+	}
+}
+
+
 int Gradient::get_height(int posx, int posy) const
 {
 	return gradient[get_pos(posx, posy)]-2;
@@ -931,66 +1138,68 @@ int Gradient::get_height(int posx, int posy) const
 
 
 
-GradientManager::GradientManager(Map* map) : map(map), cur_update(0), timer(0)
+GradientManager::GradientManager(Map* map) : map(map), timer(0)
 {
 }
 
 
 Gradient& GradientManager::get_gradient(const GradientInfo& gi)
 {
-	for(std::vector<boost::shared_ptr<Gradient> >::iterator i=gradients.begin(); i!=gradients.end(); ++i)
+	return *get_gradient_pointer(gi);
+}
+
+
+boost::shared_ptr<Gradient> GradientManager::get_gradient_pointer(const GradientInfo& gi)
+{
+	boost::shared_ptr<Gradient> gradient=find_gradient(gi);
+	if(gradient)
 	{
-		if((*i)->get_gradient_info() == gi)
+		if(timer-gradient->last_update>150)
 		{
-			if(ticks_since_update[i-gradients.begin()]>150)
-			{
-				ticks_since_update[i-gradients.begin()]=0;
-				(*i)->recalculate(map);
-			}
-			return **i;
+			gradient->last_update=timer;
+			gradient->recalculate(map);
 		}
+		gradient->last_use=timer;
+		return gradient;
 	}
 
 	//Did not find a matching gradient
-	gradients.push_back(boost::shared_ptr<Gradient>(new Gradient(gi)));
-	(*(gradients.end()-1))->recalculate(map);
-	ticks_since_update.push_back(0);
-	return **(gradients.end()-1);
+	gradient=add_gradient(gi);
+	gradient->recalculate(map);
+	gradient->last_update=timer;
+	return gradient;
 }
 
 
 void GradientManager::queue_gradient(const GradientInfo& gi)
 {
-	for(unsigned i=0; i<gradients.size(); ++i)
+	boost::shared_ptr<Gradient> gradient=find_gradient(gi);
+	if(gradient)
 	{
-		if(gradients[i]->get_gradient_info() == gi)
+		gradient->last_use=timer;
+		if(gi.needs_updating())
 		{
-			if(gi.needs_updating())
-			{
-				queuedGradients.push(i);
-			}
-			return;
+			queuedGradients.push(gradient);
 		}
+		return;
 	}
 	//Did not find a matching gradient
-	gradients.push_back(boost::shared_ptr<Gradient>(new Gradient(gi)));
-	ticks_since_update.push_back(200);
-	queuedGradients.push(gradients.size()-1);
+	gradient=add_gradient(gi);
+	gradient->last_update=timer-200;
+	queuedGradients.push(gradient);
 }
 
 
 bool GradientManager::is_updated(const GradientInfo& gi)
 {
-	for(std::vector<boost::shared_ptr<Gradient> >::iterator i=gradients.begin(); i!=gradients.end(); ++i)
+	boost::shared_ptr<Gradient> gradient=find_gradient(gi);
+	if(gradient)
 	{
-		if((*i)->get_gradient_info() == gi)
+		if(timer-gradient->last_update>150 && gradient->get_gradient_info().needs_updating())
 		{
-			if(ticks_since_update[i-gradients.begin()]>150 && (*i)->get_gradient_info().needs_updating())
-			{
-				return false;
-			}
-			return true;
+			return false;
 		}
+		return true;
 	}
 	//If the gradient hasn't been queued to be updated, consider it updated,
 	//and it will be calculated on request
@@ -998,18 +1207,53 @@ bool GradientManager::is_updated(const GradientInfo& gi)
 }
 
 
+boost::shared_ptr<Gradient> GradientManager::find_gradient(const GradientInfo& gi)
+{
+	std::pair<GradientMap::iterator, GradientMap::iterator> range=gradients.equal_range(gi.hash_value());
+	for(GradientMap::iterator i=range.first; i!=range.second; ++i)
+	{
+		if(i->second->get_gradient_info() == gi)
+			return i->second;
+	}
+	return boost::shared_ptr<Gradient>();
+}
+
+
+boost::shared_ptr<Gradient> GradientManager::add_gradient(const GradientInfo& gi)
+{
+	//Drop the least recently used gradients that are neither queued, held by a constraint, nor used during this tick
+	while(gradients.size()>=max_gradients)
+	{
+		GradientMap::iterator oldest=gradients.end();
+		for(GradientMap::iterator i=gradients.begin(); i!=gradients.end(); ++i)
+		{
+			if(i->second.unique() && i->second->last_use!=timer &&
+			   (oldest==gradients.end() || i->second->last_use < oldest->second->last_use))
+				oldest=i;
+		}
+		if(oldest==gradients.end())
+			break;
+		gradients.erase(oldest);
+	}
+
+	boost::shared_ptr<Gradient> gradient(new Gradient(gi));
+	gradient->last_use=timer;
+	gradients.insert(std::make_pair(gi.hash_value(), gradient));
+	return gradient;
+}
+
+
 void GradientManager::update()
 {
 	timer++;
-	std::transform(ticks_since_update.begin(), ticks_since_update.end(), ticks_since_update.begin(), increment);
 
-	if((timer%1)==0 && !queuedGradients.empty())
+	if(!queuedGradients.empty())
 	{
-		int g=queuedGradients.front();
-		if(ticks_since_update[g]>50)
+		boost::shared_ptr<Gradient> gradient=queuedGradients.front();
+		if(timer-gradient->last_update>50)
 		{
-			gradients[g]->recalculate(map);
-			ticks_since_update[g]=0;
+			gradient->recalculate(map);
+			gradient->last_update=timer;
 		}
 		queuedGradients.pop();
 		return;
@@ -1066,7 +1310,7 @@ void Constraint::save_constraint(Constraint* constraint, GAGCore::OutputStream *
 
 
 
-MinimumDistance::MinimumDistance(const Gradients::GradientInfo& gi, int distance) : gi(gi), gradient_cache(NULL), distance(distance)
+MinimumDistance::MinimumDistance(const Gradients::GradientInfo& gi, int distance) : gi(gi), gradient_cache(), distance(distance)
 {
 
 }
@@ -1080,8 +1324,8 @@ int MinimumDistance::calculate_constraint(Echo& echo, int x, int y)
 
 bool MinimumDistance::passes_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	int height=gradient_cache->get_height(x, y);
 	if(height==-2)
 		return false;
@@ -1119,7 +1363,7 @@ void MinimumDistance::save(GAGCore::OutputStream *stream)
 
 
 
-MaximumDistance::MaximumDistance(const Gradients::GradientInfo& gi, int distance) : gi(gi), gradient_cache(NULL), distance(distance)
+MaximumDistance::MaximumDistance(const Gradients::GradientInfo& gi, int distance) : gi(gi), gradient_cache(), distance(distance)
 {
 
 }
@@ -1133,8 +1377,8 @@ int MaximumDistance::calculate_constraint(Echo& echo, int x, int y)
 
 bool MaximumDistance::passes_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	int height=gradient_cache->get_height(x, y);
 	if(height==-2)
 		return false;
@@ -1172,7 +1416,7 @@ void MaximumDistance::save(GAGCore::OutputStream *stream)
 
 
 
-MinimizedDistance::MinimizedDistance(const Gradients::GradientInfo& gi, int weight) : gi(gi), gradient_cache(NULL), weight(weight)
+MinimizedDistance::MinimizedDistance(const Gradients::GradientInfo& gi, int weight) : gi(gi), gradient_cache(), weight(weight)
 {
 
 }
@@ -1180,16 +1424,16 @@ MinimizedDistance::MinimizedDistance(const Gradients::GradientInfo& gi, int weig
 
 int MinimizedDistance::calculate_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	return -(gradient_cache->get_height(x, y) * weight);
 }
 
 
 bool MinimizedDistance::passes_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	return gradient_cache->get_height(x, y)!=-2;
 }
 
@@ -1222,7 +1466,7 @@ void MinimizedDistance::save(GAGCore::OutputStream *stream)
 
 
 
-MaximizedDistance::MaximizedDistance(const Gradients::GradientInfo& gi, int weight) : gi(gi), gradient_cache(NULL), weight(weight)
+MaximizedDistance::MaximizedDistance(const Gradients::GradientInfo& gi, int weight) : gi(gi), gradient_cache(), weight(weight)
 {
 
 }
@@ -1230,16 +1474,16 @@ MaximizedDistance::MaximizedDistance(const Gradients::GradientInfo& gi, int weig
 
 int MaximizedDistance::calculate_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	return gradient_cache->get_height(x, y) * weight;
 }
 
 
 bool MaximizedDistance::passes_constraint(Echo& echo, int x, int y)
 {
-	if(gradient_cache==NULL)
-		gradient_cache=&echo.get_gradient_manager().get_gradient(gi);
+	if(!gradient_cache)
+		gradient_cache=echo.get_gradient_manager().get_gradient_pointer(gi);
 	return gradient_cache->get_height(x, y)!=-2;
 }
 
@@ -1310,7 +1554,7 @@ ConstraintType CenterOfBuilding::get_type()
 bool CenterOfBuilding::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("CenterOfBuilding");
-	gbid = stream->readSint32("gbid");
+	gbid = loadedBuildingGID(stream->readSint32("gbid"), versionMinor);
 	stream->readLeaveSection();
 	return true;
 }
@@ -1464,6 +1708,35 @@ void BuildingOrder::add_condition(Condition* condition)
 
 
 
+///Fills sat with the summed area table of cells, a w by h map, extended by pad_w columns and pad_h rows wrapping around the map.
+///The entry at (x, y), in a row of w+pad_w+1 entries, is the sum of the cells in [0, x) by [0, y).
+static void build_summed_area_table(const std::vector<Uint8>& cells, int w, int h, int pad_w, int pad_h, std::vector<int>& sat)
+{
+	const int stride=w+pad_w+1;
+	sat.assign(stride*(h+pad_h+1), 0);
+	for(int y=0; y<h+pad_h; ++y)
+	{
+		const Uint8* row=&cells[(y%h)*w];
+		int row_sum=0;
+		for(int x=0; x<w+pad_w; ++x)
+		{
+			row_sum+=row[x%w];
+			sat[(y+1)*stride+x+1]=sat[y*stride+x+1]+row_sum;
+		}
+	}
+}
+
+
+
+///Returns the sum of the cells in the rectangle of size rw by rh at (x, y), for a table built by build_summed_area_table
+static int sum_in_rectangle(const std::vector<int>& sat, int w, int pad_w, int x, int y, int rw, int rh)
+{
+	const int stride=w+pad_w+1;
+	return sat[(y+rh)*stride+x+rw]-sat[(y+rh)*stride+x]-sat[y*stride+x+rw]+sat[y*stride+x];
+}
+
+
+
 position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& manager)
 {
 	position best(0,0);
@@ -1478,30 +1751,53 @@ position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& man
 		check_flag=true;
 	}
 
-	for(int x=0; x<map->getW(); ++x)
+	const int w=map->getW();
+	const int h=map->getH();
+	std::vector<Uint8> cells(w*h);
+
+	//The cells where no building can be put, summed so that a whole footprint is checked at once
+	std::vector<int> blocked_sat;
+	if(!check_flag)
 	{
-		for(int y=0; y<map->getH(); ++y)
+		for(int y=0; y<h; ++y)
+			for(int x=0; x<w; ++x)
+				cells[y*w+x]=!map->isHardSpaceForBuilding(x, y);
+		build_summed_area_table(cells, w, h, type->width, type->height, blocked_sat);
+	}
+
+	//For each constraint, the cells that do not pass it, summed the same way. Only the border of the building
+	//has to pass the constraints. A table is built when its constraint is first checked, as it is the time
+	//where the constraint would have got its gradient from the manager.
+	std::vector<std::vector<int> > failed_sats(constraints.size());
+	const bool has_inside=type->width>2 && type->height>2;
+
+	for(int x=0; x<w; ++x)
+	{
+		for(int y=0; y<h; ++y)
 		{
-			if(!check_flag && !map->isHardSpaceForBuilding(x, y, type->width, type->height))
+			if(!check_flag && sum_in_rectangle(blocked_sat, w, type->width, x, y, type->width, type->height)!=0)
 				continue;
 
 			if(check_flag && echo.get_flag_map().get_flag(x, y)!=NOGBID)
 				continue;
 			int score=0;
 			bool passes=true;
-			for(std::vector<boost::shared_ptr<Constraint> >::iterator i=constraints.begin(); i!=constraints.end(); ++i)
+			for(unsigned int n=0; n<constraints.size(); ++n)
 			{
-				for(int x2=0; x2<type->width && passes; ++x2)
-					for(int y2=0; y2<type->height && passes; ++y2)
-						if((x2==0 || y2==0 || x2==type->width-1 || y2==type->height-1))
-						{
-							if(!(*i)->passes_constraint(echo, map->normalizeX(x+x2), map->normalizeY(y+y2)))
-							{
-									passes=false;
-							}
-						}
-				if(!passes)
+				std::vector<int>& failed_sat=failed_sats[n];
+				if(failed_sat.empty())
 				{
+					for(int cy=0; cy<h; ++cy)
+						for(int cx=0; cx<w; ++cx)
+							cells[cy*w+cx]=!constraints[n]->passes_constraint(echo, cx, cy);
+					build_summed_area_table(cells, w, h, type->width, type->height, failed_sat);
+				}
+				int failed=sum_in_rectangle(failed_sat, w, type->width, x, y, type->width, type->height);
+				if(has_inside)
+					failed-=sum_in_rectangle(failed_sat, w, type->width, x+1, y+1, type->width-2, type->height-2);
+				if(failed!=0)
+				{
+					passes=false;
 					break;
 				}
 
@@ -1512,10 +1808,10 @@ position BuildingOrder::find_location(Echo& echo, Map* map, GradientManager& man
 					passes=false;
 					break;
 				}
-				score+=(*i)->calculate_constraint(echo, map->normalizeX(x), map->normalizeY(y));
-				score+=(*i)->calculate_constraint(echo, map->normalizeX(x+type->width-1), map->normalizeY(y+type->height-1));
-				score+=(*i)->calculate_constraint(echo, map->normalizeX(x), map->normalizeY(y+type->height-1));
-				score+=(*i)->calculate_constraint(echo, map->normalizeX(x+type->width-1), map->normalizeY(y));
+				score+=constraints[n]->calculate_constraint(echo, map->normalizeX(x), map->normalizeY(y));
+				score+=constraints[n]->calculate_constraint(echo, map->normalizeX(x+type->width-1), map->normalizeY(y+type->height-1));
+				score+=constraints[n]->calculate_constraint(echo, map->normalizeX(x), map->normalizeY(y+type->height-1));
+				score+=constraints[n]->calculate_constraint(echo, map->normalizeX(x+type->width-1), map->normalizeY(y));
 			}
 			if(!passes)
 				continue;
@@ -1579,14 +1875,14 @@ FlagMap::FlagMap(Echo& echo) : flagmap(echo.player->map->getW()*echo.player->map
 
 
 
-int FlagMap::get_flag(int x, int y)
+Uint32 FlagMap::get_flag(int x, int y)
 {
 	return flagmap[y*width+x];
 }
 
 
 
-void FlagMap::set_flag(int x, int y, int gid)
+void FlagMap::set_flag(int x, int y, Uint32 gid)
 {
 	flagmap[y*width+x]=gid;
 }
@@ -1602,7 +1898,7 @@ bool FlagMap::load(GAGCore::InputStream *stream, Player *player, Sint32 versionM
 	for (Uint32 flagmap_index = 0; flagmap_index < size; flagmap_index++)
 	{
 		stream->readEnterSection(flagmap_index);
-		flagmap[flagmap_index]=stream->readUint32("gid");
+		flagmap[flagmap_index]=loadedBuildingGID(stream->readUint32("gid"), versionMinor);
 		stream->readLeaveSection();
 	}
 	stream->readLeaveSection();
@@ -1640,7 +1936,7 @@ BuildingRegister::BuildingRegister(Player* player, Echo& echo) : building_id(0),
 
 void BuildingRegister::initiate()
 {
-	for(int i=0; i<Building::MAX_COUNT; ++i)
+	for(int i=player->team->buildingSlots.first(); i!=-1; i=player->team->buildingSlots.next(i))
 	{
 		Building* b=player->team->myBuildings[i];
 		if(b!=NULL)
@@ -1702,7 +1998,7 @@ bool BuildingRegister::load(GAGCore::InputStream *stream, Player *player, Sint32
 		Uint32 xpos=stream->readUint32("xpos");
 		Uint32 ypos=stream->readUint32("ypos");
 		Uint32 building_type=stream->readUint32("building_type");
-		Uint32 gid=stream->readUint32("gid");
+		Uint32 gid=loadedBuildingGID(stream->readUint32("gid"), versionMinor);
 		Uint8 upgrade_status=stream->readUint8("upgrade_status");
 		boost::logic::tribool t;
 		if(upgrade_status==0)
@@ -1795,7 +2091,7 @@ void BuildingRegister::tick()
 				pending_buildings.erase(current);
 				continue;
 			}
-			int gbid=NOGBID;
+			Uint32 gbid=NOGBID;
 			if(i->second.get<2>() > IntBuildingType::DEFENSE_BUILDING && i->second.get<2>() < IntBuildingType::STONE_WALL)
 			{
 				gbid=is_flag(echo, i->second.get<0>(), i->second.get<1>());
@@ -1841,8 +2137,8 @@ void BuildingRegister::tick()
 		}
 		else
 		{
-			const int gbid=player->map->getBuilding(i->second.get<0>(), i->second.get<1>());
-			if(gbid==NOGBID || gbid != i->second.get<3>())
+			const Uint32 gbid=player->map->getBuilding(i->second.get<0>(), i->second.get<1>());
+			if(gbid==NOGBID || gbid != (Uint32)i->second.get<3>())
 			{
 				found_iterator current=i;
 				++i;
@@ -2170,7 +2466,7 @@ boost::logic::tribool EnemyBuildingDestroyed::passes(Echo& echo)
 bool EnemyBuildingDestroyed::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)
 {
 	stream->readEnterSection("EnemyBuildingDestroyed");
-	gbid=stream->readUint32("gbid");
+	gbid=loadedBuildingGID(stream->readUint32("gbid"), versionMinor);
 	type=stream->readUint32("type");
 	level=stream->readUint32("level");
 	int posx=stream->readUint32("posx");
@@ -4322,10 +4618,10 @@ void enemy_team_iterator::set_to_next()
 }
 
 
-int SearchTools::is_flag(Echo& echo, int x, int y)
+Uint32 SearchTools::is_flag(Echo& echo, int x, int y)
 {
 	Building** buildings=echo.player->team->myBuildings;
-	for(int n=0; n<Building::MAX_COUNT; ++n)
+	for(int n=echo.player->team->buildingSlots.first(); n!=-1; n=echo.player->team->buildingSlots.next(n))
 	{
 		Building* b=buildings[n];
 		if(b)
@@ -4394,14 +4690,15 @@ bool enemy_building_iterator::operator!=(const enemy_building_iterator& rhs) con
 
 void enemy_building_iterator::set_to_next()
 {
+	const SlotSet& slots=echo->player->game->teams[team]->buildingSlots;
 	if(current_gid==-1)
 	{
-		current_index=0;
+		current_index=slots.first();
 	}
 	else
-		current_index++;
+		current_index=slots.next(current_index);
 
-	while(current_index<Building::MAX_COUNT)
+	while(current_index!=-1)
 	{
 		Building* b=echo->player->game->teams[team]->myBuildings[current_index];
 		if(b)
@@ -4436,10 +4733,10 @@ void enemy_building_iterator::set_to_next()
 				}
 			}
 		}
-		current_index++;
+		current_index=slots.next(current_index);
 	}
 
-	if(current_index==Building::MAX_COUNT)
+	if(current_index==-1)
 		is_end=true;
 }
 
@@ -4725,7 +5022,7 @@ void Echo::init_starting_buildings()
 	{
 		if(player->game->teams[t])
 		{
-			for(int bu=0; bu<Building::MAX_COUNT; ++bu)
+			for(int bu=player->game->teams[t]->buildingSlots.first(); bu!=-1; bu=player->game->teams[t]->buildingSlots.next(bu))
 			{
 				Building* b=player->game->teams[t]->myBuildings[bu];
 				if(b)
@@ -4838,7 +5135,7 @@ bool Echo::load(GAGCore::InputStream *stream, Player *player, Sint32 versionMino
 	for(Uint32 startingBuildingIndex=0; startingBuildingIndex<startingBuildingSize; ++startingBuildingIndex)
 	{
 		stream->readEnterSection(startingBuildingIndex);
-		starting_buildings.insert(stream->readUint32("gid"));
+		starting_buildings.insert(loadedBuildingGID(stream->readUint32("gid"), versionMinor));
 		stream->readLeaveSection();
 	}
 	stream->readLeaveSection();
@@ -36,6 +36,7 @@
 #include <queue>
 #include <iterator>
 #include <set>
+#include <map>
 
 namespace AIEcho
 {
@@ -179,6 +180,8 @@ namespace AIEcho
 				virtual bool can_change()=0;
 
 				virtual EntityType get_type()=0;
+				///Returns a hash of this entity, entities that compare equal must have the same hash
+				virtual Uint32 hash_value() { return get_type(); }
 				virtual bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor)=0;
 				virtual void save(GAGCore::OutputStream *stream)=0;
 				static Entity* load_entity(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
@@ -197,6 +200,7 @@ namespace AIEcho
 				bool operator==(const Entity& rhs);
 				bool can_change();
 				EntityType get_type();
+				Uint32 hash_value();
 				bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 				void save(GAGCore::OutputStream *stream);
 			private:
@@ -217,6 +221,7 @@ namespace AIEcho
 				bool operator==(const Entity& rhs);
 				bool can_change();
 				EntityType get_type();
+				Uint32 hash_value();
 				bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 				void save(GAGCore::OutputStream *stream);
 			private:
@@ -236,6 +241,7 @@ namespace AIEcho
 				bool operator==(const Entity& rhs);
 				bool can_change();
 				EntityType get_type();
+				Uint32 hash_value();
 				bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 				void save(GAGCore::OutputStream *stream);
 			private:
@@ -254,6 +260,7 @@ namespace AIEcho
 				bool operator==(const Entity& rhs);
 				bool can_change();
 				EntityType get_type();
+				Uint32 hash_value();
 				bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 				void save(GAGCore::OutputStream *stream);
 			private:
@@ -302,6 +309,7 @@ namespace AIEcho
 				bool operator==(const Entity& rhs);
 				bool can_change();
 				EntityType get_type();
+				Uint32 hash_value();
 				bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 				void save(GAGCore::OutputStream *stream);
 				int x;
@@ -355,6 +363,8 @@ namespace AIEcho
 			bool needs_updating() const;
 
 			bool operator==(const GradientInfo& rhs) const;
+			///Returns a hash of the sources and obstacles, GradientInfo that compare equal have the same hash
+			Uint32 hash_value() const;
 			std::vector<boost::shared_ptr<Entities::Entity> > sources;
 			std::vector<boost::shared_ptr<Entities::Entity> > obstacles;
 			mutable boost::logic::tribool needs_updated;
@@ -382,15 +392,30 @@ namespace AIEcho
 		private:
 			friend class AIEcho::Gradients::GradientManager;
 
-			///Causes the gradient to be updated
+			///Causes the gradient to be updated. Only the part of the gradient affected by the sources and
+			///obstacles that changed since the last update is computed again.
 			void recalculate(Map* map);
 			///Returns the gradient info for comparison
 			const GradientInfo& get_gradient_info() const { return gradient_info; }
+			///Fills cells with the kind of each position of the map, using several threads on large maps
+			void classify_cells(Map* map, std::vector<Uint8>& cells);
+			///Fills the rows [y_begin, y_end) of cells with the kind of their positions
+			void classify_rows(Map* map, std::vector<Uint8>& cells, int y_begin, int y_end);
+			///Computes the whole gradient from cells
+			void compute_full(Map* map);
+			///Repairs the gradient after the kind of the cells at the positions in changed has changed
+			void compute_incremental(Map* map, const std::vector<int>& changed);
 			int width;
 			int get_pos(int x, int y) const { return y*width + x; }
 			GradientInfo gradient_info;
 			std::vector<Sint16> gradient;
 //			Sint16* gradient;
+			///The kind of each cell when the gradient was last computed, 0 for free, 1 for obstacle and 2 for source
+			std::vector<Uint8> cells;
+			///The value of GradientManager's timer when this gradient was last computed
+			int last_update;
+			///The value of GradientManager's timer when this gradient was last requested
+			int last_use;
 		};
 
 		///The gradient manager is a very important part of the system, just like the gradient itself is. The gradient manager takes upon the task
@@ -406,6 +431,8 @@ namespace AIEcho
 			///gradients are updated sooner than that. As well, at normal game speed, 150 ticks is only 6 seconds, and you can count it yourself,
 			///not much changes in the game in six seconds.
 			Gradient& get_gradient(const GradientInfo& gi);
+			///Same as get_gradient, but the returned pointer keeps the gradient alive for as long as it is held
+			boost::shared_ptr<Gradient> get_gradient_pointer(const GradientInfo& gi);
 			///Queues up a gradient with GradientInfo to be updated. This gradient will be updated once and then never again.
 			void queue_gradient(const GradientInfo& gi);
 			///Returns true if the gradient GradientInfo has been updated recently.
@@ -413,12 +440,17 @@ namespace AIEcho
 		private:
 			friend class AIEcho::Echo;
 			void update();
-			static int increment(const int x) { return x+1; }
-			std::vector<boost::shared_ptr<Gradient> > gradients;
-			std::queue<int> queuedGradients;
-			std::vector<int> ticks_since_update;
+			///Returns the gradient matching gi, or an empty pointer if there is none
+			boost::shared_ptr<Gradient> find_gradient(const GradientInfo& gi);
+			///Creates a gradient for gi, first dropping the least recently used gradients if there are too many
+			boost::shared_ptr<Gradient> add_gradient(const GradientInfo& gi);
+			///Above this number of gradients, the least recently used ones that are not referenced elsewhere are dropped
+			static const unsigned max_gradients=96;
+			///The gradients, indexed by the hash of their GradientInfo
+			typedef std::multimap<Uint32, boost::shared_ptr<Gradient> > GradientMap;
+			GradientMap gradients;
+			std::queue<boost::shared_ptr<Gradient> > queuedGradients;
 			Map* map;
-			unsigned int cur_update;
 			int timer;
 		};
 	};
@@ -465,7 +497,7 @@ namespace AIEcho
 		public:
 			MinimumDistance(const Gradients::GradientInfo& gi, int distance);
 		protected:
-			MinimumDistance() :gradient_cache(NULL), distance(0) {}
+			MinimumDistance() :gradient_cache(), distance(0) {}
 			friend class Constraint;
 			int calculate_constraint(Echo& echo, int x, int y);
 			bool passes_constraint(Echo& echo, int x, int y);
@@ -475,7 +507,7 @@ namespace AIEcho
 			void save(GAGCore::OutputStream *stream);
 		private:
 			Gradients::GradientInfo gi;
-			Gradients::Gradient* gradient_cache;
+			boost::shared_ptr<Gradients::Gradient> gradient_cache;
 			int distance;
 		};
 
@@ -485,7 +517,7 @@ namespace AIEcho
 		public:
 			MaximumDistance(const Gradients::GradientInfo& gi, int distance);
 		protected:
-			MaximumDistance() :gradient_cache(NULL), distance(0) {}
+			MaximumDistance() :gradient_cache(), distance(0) {}
 			friend class Constraint;
 			int calculate_constraint(Echo& echo, int x, int y);
 			bool passes_constraint(Echo& echo, int x, int y);
@@ -495,7 +527,7 @@ namespace AIEcho
 			void save(GAGCore::OutputStream *stream);
 		private:
 			Gradients::GradientInfo gi;
-			Gradients::Gradient* gradient_cache;
+			boost::shared_ptr<Gradients::Gradient> gradient_cache;
 			int distance;
 		};
 
@@ -506,7 +538,7 @@ namespace AIEcho
 		public:
 			MinimizedDistance(const Gradients::GradientInfo& gi, int weight);
 		protected:
-			MinimizedDistance() :gradient_cache(NULL), weight(0) {}
+			MinimizedDistance() :gradient_cache(), weight(0) {}
 			friend class Constraint;
 			int calculate_constraint(Echo& echo, int x, int y);
 			bool passes_constraint(Echo& echo, int x, int y);
@@ -516,7 +548,7 @@ namespace AIEcho
 			void save(GAGCore::OutputStream *stream);
 		private:
 			Gradients::GradientInfo gi;
-			Gradients::Gradient* gradient_cache;
+			boost::shared_ptr<Gradients::Gradient> gradient_cache;
 			int weight;
 		};
 
@@ -527,7 +559,7 @@ namespace AIEcho
 		public:
 			MaximizedDistance(const Gradients::GradientInfo& gi, int weight);
 		protected:
-			MaximizedDistance() :gradient_cache(NULL), weight(0) {}
+			MaximizedDistance() :gradient_cache(), weight(0) {}
 			friend class Constraint;
 			int calculate_constraint(Echo& echo, int x, int y);
 			bool passes_constraint(Echo& echo, int x, int y);
@@ -537,7 +569,7 @@ namespace AIEcho
 			void save(GAGCore::OutputStream *stream);
 		private:
 			Gradients::GradientInfo gi;
-			Gradients::Gradient* gradient_cache;
+			boost::shared_ptr<Gradients::Gradient> gradient_cache;
 			int weight;
 		};
 
@@ -619,14 +651,14 @@ namespace AIEcho
 		{
 		public:
 			explicit FlagMap(Echo& echo);
-			int get_flag(int x, int y);
+			Uint32 get_flag(int x, int y);
 		private:
 			friend class AIEcho::Construction::BuildingRegister;
 			friend class AIEcho::Echo;
-			void set_flag(int x, int y, int gid);
+			void set_flag(int x, int y, Uint32 gid);
 			bool load(GAGCore::InputStream *stream, Player *player, Sint32 versionMinor);
 			void save(GAGCore::OutputStream *stream);
-			std::vector<int> flagmap;
+			std::vector<Uint32> flagmap;
 			int width;
 			Echo& echo;
 		};
@@ -1522,7 +1554,7 @@ namespace AIEcho
 		};
 
 		///This function returns whether there is a flag at the given position, and if so, its GID, if not, NOGBID
-		int is_flag(Echo& echo, int x, int y);
+		Uint32 is_flag(Echo& echo, int x, int y);
 
 		///This is an iterator that is used to iterate over enemy buildings. You only get so much information
 		///about enemy buildings, which is why you can't use the standard Conditions. It returns standard GBIDs,
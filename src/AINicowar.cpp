@@ -2100,16 +2100,16 @@ void NewNicowar::compute_defense_flag_positioning(AIEcho::Echo& echo)
 	const int h = mi.get_height();
 	
 	Uint16* counts = new Uint16[w * h];
-	Uint16* buildingGID = new Uint16[w * h];
-	Uint16* unitGID = new Uint16[w * h];
+	Uint32* buildingGID = new Uint32[w * h];
+	Uint32* unitGID = new Uint32[w * h];
 	memset(counts, 0, sizeof(Uint16) * w * h);
-	memset(buildingGID, NOGBID, sizeof(Uint16) * w * h);
-	memset(unitGID, NOGUID, sizeof(Uint16) * w * h);
+	memset(buildingGID, NOGBID, sizeof(Uint32) * w * h);
+	memset(unitGID, NOGUID, sizeof(Uint32) * w * h);
 	std::list<int> locations;
 	
 	//For every unit thats under attack, increment in the squares surrounding it.
 	//Use the 'locations' list to keep track of non-zero squares
-	for(int i=0; i<Unit::MAX_COUNT; ++i)
+	for(int i=echo.player->team->unitSlots.first(); i!=-1; i=echo.player->team->unitSlots.next(i))
 	{
 		Unit* unit = echo.player->team->myUnits[i];
 		if(unit && unit->underAttackTimer && unit->movement != Unit::MOV_ATTACKING_TARGET && unit->typeNum != EXPLORER && unitGID[(unit->posX+w)%w * h + (unit->posY+h)%h] == NOGUID)
@@ -2118,7 +2118,7 @@ void NewNicowar::compute_defense_flag_positioning(AIEcho::Echo& echo)
 			modify_points(counts, w, h, (unit->posX+w)%w, (unit->posY+h)%h, 4, 1, locations);
 		}
 	}
-	for(int i=0; i<Building::MAX_COUNT; ++i)
+	for(int i=echo.player->team->buildingSlots.first(); i!=-1; i=echo.player->team->buildingSlots.next(i))
 	{
 		Building* building = echo.player->team->myBuildings[i];
 		if(building && building->underAttackTimer && buildingGID[building->posX * h + building->posY] == NOGBID)
@@ -2182,7 +2182,7 @@ void NewNicowar::compute_defense_flag_positioning(AIEcho::Echo& echo)
 					buildingGID[nx * h + ny] = NOGBID;
 				}
 				
-				Uint16 guid = echo.player->map->getGroundUnit(nx, ny);
+				Uint32 guid = echo.player->map->getGroundUnit(nx, ny);
 				if(guid != NOGUID && (1<<Unit::GIDtoTeam(guid)) & echo.player->team->enemies)
 				{
 					Unit* unit = echo.player->game->teams[Unit::GIDtoTeam(guid)]->myUnits[Unit::GIDtoID(guid)];
@@ -2282,7 +2282,7 @@ void NewNicowar::compute_defense_flag_positioning(AIEcho::Echo& echo)
 				for(int py = -3; py<=3; ++py)
 				{
 						int ny = (b->posY + py + h)%h;
-						Uint16 guid = echo.player->map->getGroundUnit(nx, ny);
+						Uint32 guid = echo.player->map->getGroundUnit(nx, ny);
 						if(guid != NOGUID && (1<<Unit::GIDtoTeam(guid)) & echo.player->team->enemies)
 						{
 								Unit* unit = echo.player->game->teams[Unit::GIDtoTeam(guid)]->myUnits[Unit::GIDtoID(guid)];
@@ -2384,9 +2384,9 @@ void NewNicowar::compute_explorer_flag_attack_positioning(AIEcho::Echo& echo)
 	
 	if(explorer_attack_phase && target!=-1)
 	{
-		Unit** units = new Unit*[Unit::MAX_COUNT];
+		std::vector<Unit*> units(echo.player->game->teams[target]->unitSlots.capacity(), static_cast<Unit*>(NULL));
 		Unit* first = NULL;
-		for(int i=0; i<Unit::MAX_COUNT; ++i)
+		for(int i=echo.player->game->teams[target]->unitSlots.first(); i!=-1; i=echo.player->game->teams[target]->unitSlots.next(i))
 		{
 			Unit* unit = echo.player->game->teams[target]->myUnits[i];
 			if(unit && mi.is_discovered(unit->posX, unit->posY) && unit->typeNum != EXPLORER && unit->activity != Unit::ACT_UPGRADING)
@@ -2395,10 +2395,6 @@ void NewNicowar::compute_explorer_flag_attack_positioning(AIEcho::Echo& echo)
 					first = unit;
 				units[i] = unit;
 			}
-			else
-			{
-				units[i] = NULL;
-			}
 		}
 		
 		while(true)
@@ -2410,7 +2406,7 @@ void NewNicowar::compute_explorer_flag_attack_positioning(AIEcho::Echo& echo)
 			std::queue<Unit*> proccess;
 			std::queue<int> xposs;
 			std::queue<int> yposs;
-			for(int i=0; i<Unit::MAX_COUNT; ++i)
+			for(size_t i=0; i<units.size(); ++i)
 			{
 				if(units[i])
 				{
@@ -2444,7 +2440,7 @@ void NewNicowar::compute_explorer_flag_attack_positioning(AIEcho::Echo& echo)
 						int ny = (top->posY + dy + h) % h;
 						if(echo.player->map->warpDistSquare(group_x / group_size, group_y / group_size, nx, ny) < (6*6))
 						{
-							Uint16 guid = echo.player->map->getGroundUnit(nx, ny);
+							Uint32 guid = echo.player->map->getGroundUnit(nx, ny);
 							if(guid != NOGUID && Unit::GIDtoTeam(guid) == target)
 							{
 								int id = Unit::GIDtoID(guid);
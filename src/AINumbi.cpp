@@ -447,12 +447,10 @@ void AINumbi::nextMainBuilding(const int buildingType)
 	Building *b=myBuildings[mainBuilding[buildingType]];
 	if (b==NULL)
 	{
-		for (int i=1; i<Building::MAX_COUNT; i++)
-			if ((myBuildings[i])/*&&((myBuildings[i]->type->shortTypeNum==buildingType)||(myBuildings[i]->type->shortTypeNum==0))*/)
-			{
-				b=myBuildings[i];
-				break;
-			}
+		// the first building after slot 0
+		int i=team->buildingSlots.next(0);
+		if (i!=-1)
+			b=myBuildings[i];
 		if (b==NULL)
 		{
 			mainBuilding[buildingType]=0;
@@ -465,7 +463,8 @@ void AINumbi::nextMainBuilding(const int buildingType)
 	{
 		//printf("AI: nextMainBuilding uid=%d\n", b->UID);
 		int id=Building::GIDtoID(b->gid);
-		for (int i=1; i<Building::MAX_COUNT; i++)
+		// the index wraps at 0x100, further steps would only look at the same slots again
+		for (int i=1; i<=0x100; i++)
 			if ((myBuildings[(i+id)&0xFF])/*&&((myBuildings[(i+id)&0xFF]->type->shortTypeNum==buildingType)||(myBuildings[(i+id)&0xFF]->type->shortTypeNum==0))*/)
 			{
 				b=myBuildings[(i+id)&0xFF];
@@ -775,7 +774,7 @@ boost::shared_ptr<Order>AINumbi::mayAttack(int critticalMass, int critticalTimeo
 {
 	Unit **myUnits=team->myUnits;
 	int ft=0;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 		if ((myUnits[i])&&(myUnits[i]->performance[ATTACK_SPEED])&&(myUnits[i]->medical==0))
 			ft++;
 
@@ -810,7 +809,7 @@ boost::shared_ptr<Order>AINumbi::mayAttack(int critticalMass, int critticalTimeo
 			if ((*bit)->type->shortTypeNum==IntBuildingType::WAR_FLAG)
 			{
 				Building *b=*bit;
-				int gbid=map->getBuilding(b->posX, b->posY);
+				Uint32 gbid=map->getBuilding(b->posX, b->posY);
 				if (gbid==NOGBID || Building::GIDtoTeam(gbid)==teamNumber)
 					return shared_ptr<Order>(new OrderDelete(b->gid)); // The target has beed successfully killed.
 
@@ -833,7 +832,7 @@ boost::shared_ptr<Order>AINumbi::mayAttack(int critticalMass, int critticalTimeo
 		int ex=-1, ey=-1;
 		int count=0;
 		bool found=false;
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		for (int i=game->teams[e]->buildingSlots.first(); i!=-1; i=game->teams[e]->buildingSlots.next(i))
 		{
 			Building *b=game->teams[e]->myBuildings[i];
 			if (b)
@@ -902,7 +901,7 @@ boost::shared_ptr<Order>AINumbi::adjustBuildings(const int numbers, const int nu
 	//Unit **myUnits=player->team->myUnits;
 	int fb=0;
 	
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b=myBuildings[i];
 		if ((b)&&(b->type->shortTypeNum==buildingType))
@@ -945,7 +944,7 @@ boost::shared_ptr<Order>AINumbi::checkoutExpands(const int numbers, const int wo
 	
 	Building **myBuildings=team->myBuildings;
 	int ss=0;
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b=myBuildings[i];
 		if ((b)&&(b->type->shortTypeNum==0))
@@ -993,7 +992,7 @@ boost::shared_ptr<Order>AINumbi::mayUpgrade(const int ptrigger, const int ntrigg
 	int numberUpgradingDefense[4]={0, 0, 0, 0}; // number of upgrading Science buildings
 	Building *defenseBuilding[4]={0, 0, 0, 0};
 	
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b=myBuildings[i];
 		if (b)
@@ -1062,7 +1061,7 @@ boost::shared_ptr<Order>AINumbi::mayUpgrade(const int ptrigger, const int ntrigg
 	int wun[4]={0, 0, 0, 0};//working units
 	int fun[4]={0, 0, 0, 0};//free units
 	{
-		for (int i=0; i<Unit::MAX_COUNT; i++)
+		for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 		{
 			Unit *u=myUnits[i];
 			if (u)
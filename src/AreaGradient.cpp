@@ -0,0 +1,134 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "AreaGradient.h"
+
+AreaGradient::AreaGradient():
+	wDec(0),
+	wMask(0),
+	hMask(0)
+{
+}
+
+void AreaGradient::setSize(int wDec, int hDec)
+{
+	this->wDec = wDec;
+	wMask = (1 << wDec) - 1;
+	hMask = (1 << hDec) - 1;
+	visited.assign((size_t)1 << (wDec + hDec), false);
+}
+
+void AreaGradient::getNeighbours(size_t i, size_t neighbours[8]) const
+{
+	size_t y = i >> wDec;
+	size_t x = i & wMask;
+	size_t yu = ((y - 1) & hMask);
+	size_t yd = ((y + 1) & hMask);
+	size_t xl = ((x - 1) & wMask);
+	size_t xr = ((x + 1) & wMask);
+	neighbours[0] = (yu << wDec) | xl;
+	neighbours[1] = (yu << wDec) | x ;
+	neighbours[2] = (yu << wDec) | xr;
+	neighbours[3] = (y  << wDec) | xr;
+	neighbours[4] = (yd << wDec) | xr;
+	neighbours[5] = (yd << wDec) | x ;
+	neighbours[6] = (yd << wDec) | xl;
+	neighbours[7] = (y  << wDec) | xl;
+}
+
+/*! A cell one lower than an invalidated neighbour may have got its value through it, so it
+	is invalidated too. Cells below 3 don't propagate, so nothing depends on them. */
+void AreaGradient::invalidate(const unsigned char *gradient, const std::vector<size_t> &changedCells)
+{
+	invalidated.clear();
+	for (size_t i=0; i<changedCells.size(); i++)
+		if (!visited[changedCells[i]])
+		{
+			visited[changedCells[i]] = true;
+			invalidated.push_back(changedCells[i]);
+		}
+	for (size_t listCountRead=0; listCountRead<invalidated.size(); listCountRead++)
+	{
+		size_t i = invalidated[listCountRead];
+		if (gradient[i] < 3)
+			continue;
+		unsigned char g = gradient[i] - 1;
+
+		size_t neighbours[8];
+		getNeighbours(i, neighbours);
+		for (int ci=0; ci<8; ci++)
+		{
+			size_t n = neighbours[ci];
+			if (!visited[n] && gradient[n] == g)
+			{
+				visited[n] = true;
+				invalidated.push_back(n);
+			}
+		}
+	}
+}
+
+void AreaGradient::propagateInvalidated(unsigned char *gradient)
+{
+	// List the cells to propagate from, by height
+	for (size_t j=0; j<invalidated.size(); j++)
+	{
+		size_t i = invalidated[j];
+		if (gradient[i] >= 3)
+			listedAddr[gradient[i]].push_back(i);
+
+		size_t neighbours[8];
+		getNeighbours(i, neighbours);
+		for (int ci=0; ci<8; ci++)
+		{
+			size_t n = neighbours[ci];
+			if (!visited[n] && gradient[n] >= 3)
+				listedAddr[gradient[n]].push_back(n);
+		}
+	}
+
+	for (size_t j=0; j<invalidated.size(); j++)
+		visited[invalidated[j]] = false;
+
+	// Propagate, highest cells first
+	for (int height=255; height>=3; height--)
+	{
+		unsigned char g = height - 1;
+		std::vector<size_t> &list = listedAddr[height];
+		for (size_t listCountRead=0; listCountRead<list.size(); listCountRead++)
+		{
+			size_t i = list[listCountRead];
+			if (gradient[i] != height)
+				continue; // this cell got a higher value since it was listed
+
+			size_t neighbours[8];
+			getNeighbours(i, neighbours);
+			for (int ci=0; ci<8; ci++)
+			{
+				unsigned char &side = gradient[neighbours[ci]];
+				if (side > 0 && side < g)
+				{
+					side = g;
+					listedAddr[g].push_back(neighbours[ci]);
+				}
+			}
+		}
+		list.clear();
+	}
+}
@@ -0,0 +1,68 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __AREA_GRADIENT_H
+#define __AREA_GRADIENT_H
+
+#include <cstddef>
+#include <vector>
+
+///Repairs the forbidden, guard area and clear area gradients of Map after the initial value of some cells changed.
+///These gradients all have their sources at 255, 0 for the cells that can't be walked on, and are propagated
+///from the sources by decreasing the value by one at each step, never going below the initial value of a cell.
+///Given a gradient that was up to date, and all the cells whose initial value changed since, the repair
+///gives the same values as computing the gradient again from the initial values of all cells.
+class AreaGradient
+{
+public:
+	///Creates a repairer for an empty map
+	AreaGradient();
+	///Sets the size of the maps to repair, which are (1<<wDec) x (1<<hDec) and wrap around their borders
+	void setSize(int wDec, int hDec);
+
+	///Repairs gradient after the initial values of changedCells changed, initialValue(pos) must return the new
+	///initial value of the cell at pos. Returns the number of cells that were computed again.
+	template<typename InitialValue>
+	size_t repair(unsigned char *gradient, const InitialValue &initialValue, const std::vector<size_t> &changedCells)
+	{
+		invalidate(gradient, changedCells);
+		for (size_t j=0; j<invalidated.size(); j++)
+			gradient[invalidated[j]] = initialValue(invalidated[j]);
+		propagateInvalidated(gradient);
+		return invalidated.size();
+	}
+
+private:
+	///Lists in invalidated the changed cells and the cells which may have got their value through them
+	void invalidate(const unsigned char *gradient, const std::vector<size_t> &changedCells);
+	///Propagates again from the sources among the invalidated cells and from the valid cells around them
+	void propagateInvalidated(unsigned char *gradient);
+	///Puts the addresses of the 8 cells around i in neighbours
+	void getNeighbours(size_t i, size_t neighbours[8]) const;
+
+	int wDec;
+	size_t wMask, hMask;
+	///Cells already in invalidated, always all false outside of repair()
+	std::vector<bool> visited;
+	std::vector<size_t> invalidated;
+	///Cells to propagate from, by height
+	std::vector<size_t> listedAddr[256];
+};
+
+#endif
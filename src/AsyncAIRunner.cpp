@@ -0,0 +1,99 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "AsyncAIRunner.h"
+#include "AI.h"
+#include "Order.h"
+#include <assert.h>
+
+AsyncAIRunner::AsyncAIRunner()
+{
+	paused = false;
+	thread = NULL;
+}
+
+AsyncAIRunner::~AsyncAIRunner()
+{
+	clear();
+}
+
+void AsyncAIRunner::addJob(int player, AI *ai)
+{
+	assert(thread == NULL);
+	assert(!hasOrder(player));
+	Job job;
+	job.player = player;
+	job.ai = ai;
+	jobs.push_back(job);
+}
+
+void AsyncAIRunner::start(bool paused)
+{
+	assert(thread == NULL);
+	if (jobs.empty())
+		return;
+	this->paused = paused;
+	thread = new boost::thread(boost::ref(*this));
+}
+
+void AsyncAIRunner::wait()
+{
+	if (thread)
+	{
+		thread->join();
+		delete thread;
+		thread = NULL;
+	}
+}
+
+bool AsyncAIRunner::hasOrder(int player)
+{
+	for (size_t i=0; i<jobs.size(); i++)
+		if (jobs[i].player == player && jobs[i].order)
+			return true;
+	return false;
+}
+
+boost::shared_ptr<Order> AsyncAIRunner::retrieveOrder(int player)
+{
+	assert(thread == NULL);
+	for (size_t i=0; i<jobs.size(); i++)
+		if (jobs[i].player == player)
+		{
+			boost::shared_ptr<Order> order = jobs[i].order;
+			assert(order);
+			jobs.erase(jobs.begin()+i);
+			return order;
+		}
+	assert(false);
+	return boost::shared_ptr<Order>();
+}
+
+void AsyncAIRunner::clear()
+{
+	wait();
+	jobs.clear();
+}
+
+void AsyncAIRunner::operator()()
+{
+	for (size_t i=0; i<jobs.size(); i++)
+		if (!jobs[i].order)
+			jobs[i].order = jobs[i].ai->getOrder(paused);
+}
@@ -0,0 +1,70 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __ASYNC_AI_RUNNER_H
+#define __ASYNC_AI_RUNNER_H
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+class AI;
+class Order;
+
+/// Computes the orders of a set of AIs on a worker thread, while the main thread waits for the next
+/// frame. The AIs of a batch are run one after another in the order they were given, so that their
+/// calls to syncRand() and the lazy gradient updates they trigger happen in the same order as when
+/// they are run synchronously. The game, the map and the AIs must not be read nor modified while a
+/// batch runs, the lazy gradients make even drawing unsafe.
+class AsyncAIRunner
+{
+public:
+	AsyncAIRunner();
+	~AsyncAIRunner();
+	
+	/// Adds the AI of player to the next batch
+	void addJob(int player, AI *ai);
+	/// Starts computing the orders of the jobs added since the last call, using paused as the pause state
+	void start(bool paused);
+	/// Waits until the current batch, if any, is finished
+	void wait();
+	/// Returns true if the order of player has been computed and not retrieved yet
+	bool hasOrder(int player);
+	/// Returns the computed order of player and forgets it
+	boost::shared_ptr<Order> retrieveOrder(int player);
+	/// Waits for the current batch and forgets all orders not retrieved yet
+	void clear();
+	
+	/// Body of the worker thread
+	void operator()();
+	
+private:
+	struct Job
+	{
+		int player;
+		AI *ai;
+		boost::shared_ptr<Order> order;
+	};
+	
+	std::vector<Job> jobs;
+	bool paused;
+	boost::thread *thread;
+};
+
+#endif
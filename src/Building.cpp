@@ -35,6 +35,8 @@
 #include "Order.h"
 #include "Bullet.h"
 
+DEFINE_POOLED_ALLOCATION(Building)
+
 Building::Building(GAGCore::InputStream *stream, BuildingsTypes *types, Team *owner, Sint32 versionMinor)
 {
 	for (int i=0; i<2; i++)
@@ -42,11 +44,12 @@ Building::Building(GAGCore::InputStream *stream, BuildingsTypes *types, Team *ow
 		globalGradient[i]=NULL;
 		localRessources[i]=NULL;
 	}
+	freeUnitsDistancePass=0;
 	logFile = globalContainer->logFileManager->getFile("Building.log");
 	load(stream, types, owner, versionMinor);
 }
 
-Building::Building(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, BuildingsTypes *types, Sint32 unitWorking, Sint32 unitWorkingFuture)
+Building::Building(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, BuildingsTypes *types, Sint32 unitWorking, Sint32 unitWorkingFuture)
 {
 	logFile = globalContainer->logFileManager->getFile("Building.log");
 
@@ -168,6 +171,7 @@ Building::Building(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, Buildin
 		unitsFailingRequirements[i]=0;
 	}
 	unitsHarvesting.clear();
+	freeUnitsDistancePass=0;
 }
 
 Building::~Building()
@@ -207,7 +211,7 @@ void Building::load(GAGCore::InputStream *stream, BuildingsTypes *types, Team *o
 	constructionResultState = (ConstructionResultState)stream->readUint32("constructionResultState");
 
 	// identity
-	gid = stream->readUint16("gid");
+	gid = readGID(stream, "gid", versionMinor);
 	this->owner = owner;
 
 	// position
@@ -348,7 +352,7 @@ void Building::save(GAGCore::OutputStream *stream)
 	stream->writeUint32((Uint32)constructionResultState, "constructionResultState");
 
 	// identity
-	stream->writeUint16(gid, "gid");
+	stream->writeUint32(gid, "gid");
 	// we drop team
 
 	// position
@@ -432,9 +436,9 @@ void Building::loadCrossRef(GAGCore::InputStream *stream, BuildingsTypes *types,
 	{
 		std::ostringstream oss;
 		oss << "unitsWorking[" << i << "]";
-		Unit *unit = owner->myUnits[Unit::GIDtoID(stream->readUint16(oss.str().c_str()))];
+		Unit *unit = owner->myUnits[Unit::GIDtoID(Unit::readGID(stream, oss.str(), versionMinor))];
 		assert(unit);
-		unitsWorking.push_front(unit);
+		unitsWorking.push_back(unit);
 	}
 
 	subscriptionWorkingTimer = stream->readSint32("subscriptionWorkingTimer");
@@ -472,9 +476,9 @@ void Building::loadCrossRef(GAGCore::InputStream *stream, BuildingsTypes *types,
 	{
 		std::ostringstream oss;
 		oss << "unitsInside[" << i << "]";
-		Unit *unit = owner->myUnits[Unit::GIDtoID(stream->readUint16(oss.str().c_str()))];
+		Unit *unit = owner->myUnits[Unit::GIDtoID(Unit::readGID(stream, oss.str(), versionMinor))];
 		assert(unit);
-		unitsInside.push_front(unit);
+		unitsInside.push_back(unit);
 	}
 	
 	if (versionMinor>=80)
@@ -486,9 +490,9 @@ void Building::loadCrossRef(GAGCore::InputStream *stream, BuildingsTypes *types,
 		{
 			std::ostringstream oss;
 			oss << "unitsHarvesting[" << i << "]";
-			Unit *unit = owner->myUnits[Unit::GIDtoID(stream->readUint16(oss.str().c_str()))];
+			Unit *unit = owner->myUnits[Unit::GIDtoID(Unit::readGID(stream, oss.str(), versionMinor))];
 			assert(unit);
-			unitsHarvesting.push_front(unit);
+			unitsHarvesting.push_back(unit);
 		}
 	}
 
@@ -517,7 +521,7 @@ void Building::saveCrossRef(GAGCore::OutputStream *stream)
 		assert(owner->myUnits[Unit::GIDtoID((*it)->gid)]);
 		std::ostringstream oss;
 		oss << "unitsWorking[" << i++ << "]";
-		stream->writeUint16((*it)->gid, oss.str().c_str());
+		stream->writeUint32((*it)->gid, oss.str().c_str());
 	}
 
 	stream->writeSint32(subscriptionWorkingTimer, "subscriptionWorkingTimer");
@@ -545,7 +549,7 @@ void Building::saveCrossRef(GAGCore::OutputStream *stream)
 		assert(owner->myUnits[Unit::GIDtoID((*it)->gid)]);
 		std::ostringstream oss;
 		oss << "unitsInside[" << i++ << "]";
-		stream->writeUint16((*it)->gid, oss.str().c_str());
+		stream->writeUint32((*it)->gid, oss.str().c_str());
 	}
 	
 	stream->writeUint32(unitsHarvesting.size(), "nbHarvesting");
@@ -556,12 +560,90 @@ void Building::saveCrossRef(GAGCore::OutputStream *stream)
 		assert(*it);
 		std::ostringstream oss;
 		oss << "unitsHarvesting[" << i++ << "]";
-		stream->writeUint16((*it)->gid, oss.str().c_str());
+		stream->writeUint32((*it)->gid, oss.str().c_str());
+	}
+
+	stream->writeLeaveSection();
+}
+
+void Building::saveCaches(GAGCore::OutputStream *stream)
+{
+	stream->writeEnterSection("BuildingCaches");
+
+	// call lists, filled again by update() after load()
+	stream->writeUint32(inCanFeedUnit, "inCanFeedUnit");
+	stream->writeUint32(inCanHealUnit, "inCanHealUnit");
+	for (int i=0; i<NB_ABILITY; i++)
+		stream->writeUint32(inUpgrade[i], "inUpgrade");
+	stream->writeUint8(callListState, "callListState");
+	stream->writeSint32(oldPriority, "oldPriority");
+	stream->writeSint32(desiredMaxUnitWorking, "desiredMaxUnitWorking");
+	// update() sets it again when the building enters canFeedUnit
+	stream->writeUint8(canNotConvertUnitTimer, "canNotConvertUnitTimer");
+
+	// gradients
+	size_t mapSize = owner->map->getW()*owner->map->getH();
+	for (int i=0; i<2; i++)
+	{
+		stream->writeEnterSection(i);
+		stream->writeUint8(dirtyLocalGradient[i], "dirtyLocalGradient");
+		stream->write(localGradient[i], 1024, "localGradient");
+		stream->writeUint8(locked[i], "locked");
+		stream->writeUint32(lastGlobalGradientUpdateStepCounter[i], "lastGlobalGradientUpdateStepCounter");
+		stream->writeUint8(globalGradient[i] != NULL, "isGlobalGradient");
+		if (globalGradient[i])
+			stream->write(globalGradient[i], mapSize, "globalGradient");
+		stream->writeUint8(localRessources[i] != NULL, "isLocalRessources");
+		if (localRessources[i])
+			stream->write(localRessources[i], 1024, "localRessources");
+		stream->writeSint32(localRessourcesCleanTime[i], "localRessourcesCleanTime");
+		stream->writeSint32(anyRessourceToClear[i], "anyRessourceToClear");
+		stream->writeLeaveSection();
 	}
 
 	stream->writeLeaveSection();
 }
 
+void Building::loadCaches(GAGCore::InputStream *stream)
+{
+	stream->readEnterSection("BuildingCaches");
+
+	inCanFeedUnit = (InListState)stream->readUint32("inCanFeedUnit");
+	inCanHealUnit = (InListState)stream->readUint32("inCanHealUnit");
+	for (int i=0; i<NB_ABILITY; i++)
+		inUpgrade[i] = (InListState)stream->readUint32("inUpgrade");
+	callListState = stream->readUint8("callListState");
+	oldPriority = stream->readSint32("oldPriority");
+	desiredMaxUnitWorking = stream->readSint32("desiredMaxUnitWorking");
+	canNotConvertUnitTimer = stream->readUint8("canNotConvertUnitTimer");
+
+	freeGradients();
+	size_t mapSize = owner->map->getW()*owner->map->getH();
+	for (int i=0; i<2; i++)
+	{
+		stream->readEnterSection(i);
+		dirtyLocalGradient[i] = stream->readUint8("dirtyLocalGradient");
+		stream->read(localGradient[i], 1024, "localGradient");
+		locked[i] = stream->readUint8("locked");
+		lastGlobalGradientUpdateStepCounter[i] = stream->readUint32("lastGlobalGradientUpdateStepCounter");
+		if (stream->readUint8("isGlobalGradient"))
+		{
+			globalGradient[i] = new Uint8[mapSize];
+			stream->read(globalGradient[i], mapSize, "globalGradient");
+		}
+		if (stream->readUint8("isLocalRessources"))
+		{
+			localRessources[i] = new Uint8[1024];
+			stream->read(localRessources[i], 1024, "localRessources");
+		}
+		localRessourcesCleanTime[i] = stream->readSint32("localRessourcesCleanTime");
+		anyRessourceToClear[i] = stream->readSint32("anyRessourceToClear");
+		stream->readLeaveSection();
+	}
+
+	stream->readLeaveSection();
+}
+
 bool Building::isRessourceFull(void)
 {
 	for (int i=0; i<MAX_NB_RESSOURCES; i++)
@@ -767,6 +849,7 @@ void Building::cancelConstruction(Sint32 unitWorking)
 	posY=midPosY+type->decTop;
 	posXLocal=posX;
 	posYLocal=posY;
+	owner->updateTowerCoverage(GIDtoID(gid));
 
 	if (!type->isVirtual)
 		owner->map->setBuilding(posX, posY, type->width, type->height, gid);
@@ -902,6 +985,7 @@ void Building::updateCallLists(void)
 				if (inCanFeedUnit!=LS_IN)
 				{
 					owner->canFeedUnit.push_front(this);
+					owner->canFeedUnitBuckets.insert(this);
 					//A Building newly getting available to feed is locked to conversion for 150 frames
 					canNotConvertUnitTimer=150;
 					inCanFeedUnit=LS_IN;
@@ -912,6 +996,7 @@ void Building::updateCallLists(void)
 				if (inCanFeedUnit!=LS_OUT)
 				{
 					owner->canFeedUnit.remove(this);
+					owner->canFeedUnitBuckets.remove(this);
 					inCanFeedUnit=LS_OUT;
 				}
 			}
@@ -921,6 +1006,7 @@ void Building::updateCallLists(void)
 		if (type->canHealUnit && inCanHealUnit!=LS_IN)
 		{
 			owner->canHealUnit.push_front(this);
+			owner->canHealUnitBuckets.insert(this);
 			inCanHealUnit=LS_IN;
 		}
 	}
@@ -937,11 +1023,13 @@ void Building::updateCallLists(void)
 		if (type->canFeedUnit && inCanFeedUnit!=LS_OUT)
 		{
 			owner->canFeedUnit.remove(this);
+			owner->canFeedUnitBuckets.remove(this);
 			inCanFeedUnit=LS_OUT;
 		}
 		if (type->canHealUnit && inCanHealUnit!=LS_OUT)
 		{
 			owner->canHealUnit.remove(this);
+			owner->canHealUnitBuckets.remove(this);
 			inCanHealUnit=LS_OUT;
 		}
 	}
@@ -991,6 +1079,7 @@ void Building::updateBuildingSite(void)
 		owner->prestige-=type->prestige;
 		typeNum=type->nextLevel;
 		type=globalContainer->buildingsTypes.get(type->nextLevel);
+		owner->updateTowerCoverage(GIDtoID(gid));
 		assert(constructionResultState!=NO_CONSTRUCTION);
 		constructionResultState=NO_CONSTRUCTION;
 		owner->prestige+=type->prestige;
@@ -1307,6 +1396,7 @@ bool Building::tryToBuildingSiteRoom(void)
 		posY=newPosY;
 		posXLocal=posX;
 		posYLocal=posY;
+		owner->updateTowerCoverage(GIDtoID(gid));
 
 		// flag usefull :
 		unitStayRange=type->defaultUnitStayRange;
@@ -1551,123 +1641,130 @@ bool Building::subscribeToBringRessourcesStep()
 			}
 		}
 */
-		// Compute the list of candidate units
-		Unit* possibleUnits[Unit::MAX_COUNT];
-		int distances[Unit::MAX_COUNT];
-		int resource[Unit::MAX_COUNT];
+		// Compute the list of candidate units. Only units that were free when the team started
+		// assigning tasks this step can be hired, the others are just counted as not available.
+		const std::vector<Unit *> &freeUnits=owner->freeUnits;
+		const size_t freeCount=freeUnits.size();
+		std::vector<Unit*> possibleUnits(freeCount);
+		std::vector<int> distances(freeCount);
+		std::vector<int> resource(freeCount);
 		int teamNumber=owner->teamNumber;
-		for(int n=0; n<Unit::MAX_COUNT; ++n)
+		unitsFailingRequirements[UnitNotAvailable] = owner->nonFreeHarvesters;
+		for (std::list<Unit *>::iterator it=unitsWorking.begin(); it!=unitsWorking.end(); ++it)
+		{
+			Unit *unit=*it;
+			if(unit->performance[HARVEST] && unit->activity == Unit::ACT_FILLING && !owner->unitWasFree[Unit::GIDtoID(unit->gid)])
+				unitsFailingRequirements[UnitNotAvailable] -= 1;
+		}
+		for(size_t n=0; n<freeCount; ++n)
 		{
 			possibleUnits[n]=NULL;
 			distances[n] = 0;
 			resource[n] = -1;
-			Unit* unit=owner->myUnits[n];
-			if(unit)
+			Unit* unit=freeUnits[n];
+			if(!unit->performance[HARVEST])
 			{
-				if(!unit->performance[HARVEST])
-				{
-					continue;
-				}
-				else if(unit->attachedBuilding == this && unit->activity == Unit::ACT_FILLING)
-				{
-					continue;
-				}
-				else if(unit->activity != Unit::ACT_RANDOM || unit->medical != Unit::MED_FREE)
+				continue;
+			}
+			else if(unit->attachedBuilding == this && unit->activity == Unit::ACT_FILLING)
+			{
+				continue;
+			}
+			else if(unit->activity != Unit::ACT_RANDOM || unit->medical != Unit::MED_FREE)
+			{
+				unitsFailingRequirements[UnitNotAvailable] += 1;
+			}
+			else if(!canUnitWorkHere(unit))
+			{
+				unitsFailingRequirements[UnitTooLowLevel] += 1;
+			}
+			else
+			{
+				int distBuilding=0;
+				int timeLeft=(unit->hungry-unit->trigHungry)/unit->race->hungryness;
+				bool canSwim=unit->performance[SWIM];
+				if(!freeUnitBuildingAvailable(n, unit, &distBuilding))
 				{
-					unitsFailingRequirements[UnitNotAvailable] += 1;
+					unitsFailingRequirements[UnitCantAccessBuilding] += 1;
 				}
-				else if(!canUnitWorkHere(unit))
+				else if(distBuilding >= timeLeft)
 				{
-					unitsFailingRequirements[UnitTooLowLevel] += 1;
+					unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
 				}
 				else
 				{
-					int distBuilding=0;
-					int timeLeft=(unit->hungry-unit->trigHungry)/unit->race->hungryness;
-					bool canSwim=unit->performance[SWIM];
-					if(!map->buildingAvailable(this, canSwim, unit->posX, unit->posY, &distBuilding))
-					{
-						unitsFailingRequirements[UnitCantAccessBuilding] += 1;
-					}
-					else if(distBuilding >= timeLeft)
+					int unitr = unit->caryedRessource;
+					if((unitr>=0) && neededRessource(unitr))
 					{
-						unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
+						possibleUnits[n] = unit;
+						distances[n] = distBuilding;
+						resource[n] = unitr;
 					}
 					else
 					{
-						int unitr = unit->caryedRessource;
-						if((unitr>=0) && neededRessource(unitr))
+						int bestDist = 100000;
+						int bestResource = -1;
+						bool regularFound=false;
+						bool fruitFound=false;
+						bool regularFoundTooFar=false;
+						bool fruitFoundTooFar=false;
+						int x=unit->posX;
+						int y=unit->posY;
+						for(int r=0; r<MAX_NB_RESSOURCES; ++r)
 						{
-							possibleUnits[n] = unit;
-							distances[n] = distBuilding;
-							resource[n] = unitr;
-						}
-						else
-						{
-							int bestDist = 100000;
-							int bestResource = -1;
-							bool regularFound=false;
-							bool fruitFound=false;
-							bool regularFoundTooFar=false;
-							bool fruitFoundTooFar=false;
-							int x=unit->posX;
-							int y=unit->posY;
-							for(int r=0; r<MAX_NB_RESSOURCES; ++r)
+							int need = neededRessource(r);
+							if(need>0)
 							{
-								int need = neededRessource(r);
-								if(need>0)
+								if(r<BASIC_COUNT)
+									regularFound=true;
+								else
+									fruitFound=true;
+								int distResource = 0;
+								if (owner->freeUnitRessourceAvailable(n, teamNumber, r, canSwim, x, y, &distResource))
 								{
-									if(r<BASIC_COUNT)
-										regularFound=true;
-									else
-										fruitFound=true;
-									int distResource = 0;
-									if (map->ressourceAvailable(teamNumber, r, canSwim, x, y, &distResource))
+									if(distResource<timeLeft)
 									{
-										if(distResource<timeLeft)
+										int dist = (distBuilding + distResource)<<8;
+										int value = dist / need;
+										if(value < bestDist)
 										{
-											int dist = (distBuilding + distResource)<<8;
-											int value = dist / need;
-											if(value < bestDist)
-											{
-												bestDist = value;
-												bestResource=r;
-											}
+											bestDist = value;
+											bestResource=r;
 										}
+									}
+									else
+									{
+										if(r<BASIC_COUNT)
+											regularFoundTooFar=true;
 										else
-										{
-											if(r<BASIC_COUNT)
-												regularFoundTooFar=true;
-											else
-												fruitFoundTooFar=true;
-										}
+											fruitFoundTooFar=true;
 									}
 								}
 							}
-							if(bestResource == -1)
+						}
+						if(bestResource == -1)
+						{
+							if(regularFound)
 							{
-								if(regularFound)
-								{
-									if(regularFoundTooFar)
-										unitsFailingRequirements[UnitTooFarFromResource] += 1;
-									else
-										unitsFailingRequirements[UnitCantAccessResource] += 1;
-								}
-								else if(fruitFound)
-								{
-									if(fruitFoundTooFar)
-										unitsFailingRequirements[UnitCantAccessFruit] += 1;
-									else
-										unitsFailingRequirements[UnitTooFarFromFruit] += 1;
-								}
+								if(regularFoundTooFar)
+									unitsFailingRequirements[UnitTooFarFromResource] += 1;
+								else
+									unitsFailingRequirements[UnitCantAccessResource] += 1;
 							}
-							else
+							else if(fruitFound)
 							{
-								resource[n] = bestResource;
-								distances[n] = bestDist;
-								possibleUnits[n]=unit;
+								if(fruitFoundTooFar)
+									unitsFailingRequirements[UnitCantAccessFruit] += 1;
+								else
+									unitsFailingRequirements[UnitTooFarFromFruit] += 1;
 							}
 						}
+						else
+						{
+							resource[n] = bestResource;
+							distances[n] = bestDist;
+							possibleUnits[n]=unit;
+						}
 					}
 				}
 			}
@@ -1676,7 +1773,7 @@ bool Building::subscribeToBringRessourcesStep()
 		int maxLevel = -1;
 		int minValue = INT_MAX;
 		//First: we look only for units with a needed resource:
-		for(int n=0; n<Unit::MAX_COUNT; ++n)
+		for(size_t n=0; n<freeCount; ++n)
 		{
 			Unit* unit=possibleUnits[n];
 			if(unit==NULL)
@@ -1702,7 +1799,7 @@ bool Building::subscribeToBringRessourcesStep()
 		//Second: we look for an unit who is not carying a ressource:
 		if (choosen==NULL)
 		{
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			for(size_t n=0; n<freeCount; ++n)
 			{
 				Unit* unit=possibleUnits[n];
 				if(unit==NULL)
@@ -1727,7 +1824,7 @@ bool Building::subscribeToBringRessourcesStep()
 		//Third: we look for an unit who is carrying an unwanted resource:
 		if (choosen==NULL)
 		{
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			for(size_t n=0; n<freeCount; ++n)
 			{
 				Unit* unit=possibleUnits[n];
 				if(unit==NULL)
@@ -1790,75 +1887,77 @@ bool Building::subscribeForFlagingStep()
 				unitsFailingRequirements[i]=0;
 			}
 
-			//Generate the list of possible units
-			Unit* possibleUnits[Unit::MAX_COUNT];
-			int distances[Unit::MAX_COUNT];
-			for(int n=0; n<Unit::MAX_COUNT; ++n)
+			//Generate the list of possible units, among those that were free when the team started
+			//assigning tasks this step. The others are counted as not available.
+			const std::vector<Unit *> &freeUnits=owner->freeUnits;
+			const size_t freeCount=freeUnits.size();
+			std::vector<Unit*> possibleUnits(freeCount);
+			std::vector<int> distances(freeCount);
+			unitsFailingRequirements[UnitNotAvailable] = 0;
+			for (int t=0; t<NB_UNIT_TYPE; t++)
+				if (isZonableUnitType(t))
+					unitsFailingRequirements[UnitNotAvailable] += owner->nonFreeUnits[t];
+			for (std::list<Unit *>::iterator it=unitsWorking.begin(); it!=unitsWorking.end(); ++it)
+			{
+				Unit *unit=*it;
+				if(unit->attachedBuilding == this && isZonableUnitType(unit->typeNum) && !owner->unitWasFree[Unit::GIDtoID(unit->gid)])
+					unitsFailingRequirements[UnitNotAvailable] -= 1;
+			}
+			for(size_t n=0; n<freeCount; ++n)
 			{
 				possibleUnits[n]=NULL;
 				distances[n] = 0;
-				Unit* unit=owner->myUnits[n];
-				if(unit)
+				Unit* unit=freeUnits[n];
+				if(unit->attachedBuilding == this)
 				{
-					if(unit->attachedBuilding == this)
-					{
-						continue;
-					}
-					else if(type->zonable[EXPLORER] && unit->typeNum != EXPLORER)
-					{
-						continue;
-					}
-					else if(type->zonable[WORKER] && unit->typeNum != WORKER)
-					{
-						continue;
-					}
-					else if(type->zonable[WARRIOR] && unit->typeNum != WARRIOR)
+					continue;
+				}
+				else if(!isZonableUnitType(unit->typeNum))
+				{
+					continue;
+				}
+				else if(unit->activity != Unit::ACT_RANDOM || unit->medical != Unit::MED_FREE)
+				{
+					unitsFailingRequirements[UnitNotAvailable] += 1;
+				}
+				else if(!canUnitWorkHere(unit))
+				{
+					unitsFailingRequirements[UnitTooLowLevel] += 1;
+				}
+				else if(type->zonable[WARRIOR] && unit->movement == Unit::MOV_ATTACKING_TARGET)
+				{
+					unitsFailingRequirements[UnitNotAvailable] += 1;
+				}
+				else
+				{
+					int distBuilding=0;
+					int timeLeft=(unit->hungry-unit->trigHungry)/unit->race->hungryness;
+					timeLeft*=timeLeft;
+					int directdist=owner->map->warpDistSquare(unit->posX, unit->posY, posX, posY);
+					bool canSwim=unit->performance[SWIM];
+					if(type->zonable[EXPLORER] && timeLeft < directdist)
 					{
-						continue;
+						unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
 					}
-					else if(unit->activity != Unit::ACT_RANDOM || unit->medical != Unit::MED_FREE)
+					else if(!type->zonable[EXPLORER] && !freeUnitBuildingAvailable(n, unit, &distBuilding))
 					{
-						unitsFailingRequirements[UnitNotAvailable] += 1;
+						unitsFailingRequirements[UnitCantAccessBuilding] += 1;
 					}
-					else if(!canUnitWorkHere(unit))
+					else if(!type->zonable[EXPLORER] && distBuilding >= timeLeft)
 					{
-						unitsFailingRequirements[UnitTooLowLevel] += 1;
+						unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
 					}
-					else if(type->zonable[WARRIOR] && unit->movement == Unit::MOV_ATTACKING_TARGET)
+					else if(type->zonable[WORKER] && anyRessourceToClear[canSwim]==2)
 					{
-						unitsFailingRequirements[UnitNotAvailable] += 1;
+						unitsFailingRequirements[UnitCantAccessResource] += 1;
 					}
 					else
 					{
-						int distBuilding=0;
-						int timeLeft=(unit->hungry-unit->trigHungry)/unit->race->hungryness;
-						timeLeft*=timeLeft;
-						int directdist=owner->map->warpDistSquare(unit->posX, unit->posY, posX, posY);
-						bool canSwim=unit->performance[SWIM];
-						if(type->zonable[EXPLORER] && timeLeft < directdist)
-						{
-							unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
-						}
-						else if(!type->zonable[EXPLORER] && !owner->map->buildingAvailable(this, canSwim, unit->posX, unit->posY, &distBuilding))
-						{
-							unitsFailingRequirements[UnitCantAccessBuilding] += 1;
-						}
-						else if(!type->zonable[EXPLORER] && distBuilding >= timeLeft)
-						{
-							unitsFailingRequirements[UnitTooFarFromBuilding] += 1;
-						}
-						else if(type->zonable[WORKER] && anyRessourceToClear[canSwim]==2)
-						{
-							unitsFailingRequirements[UnitCantAccessResource] += 1;
-						}
+						if(type->zonable[EXPLORER])
+							distances[n]=directdist;
 						else
-						{
-							if(type->zonable[EXPLORER])
-								distances[n]=directdist;
-							else
-								distances[n]=distBuilding;
-							possibleUnits[n]=unit;
-						}
+							distances[n]=distBuilding;
+						possibleUnits[n]=unit;
 					}
 				}
 			}
@@ -1875,7 +1974,7 @@ bool Building::subscribeForFlagingStep()
 			*/
 			if (type->zonable[EXPLORER])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(size_t n=0; n<freeCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -1900,7 +1999,7 @@ bool Building::subscribeForFlagingStep()
 			}
 			else if (type->zonable[WARRIOR])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(size_t n=0; n<freeCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -1922,7 +2021,7 @@ bool Building::subscribeForFlagingStep()
 			}
 			else if (type->zonable[WORKER])
 			{
-				for(int n=0; n<Unit::MAX_COUNT; ++n)
+				for(size_t n=0; n<freeCount; ++n)
 				{
 					Unit* unit=possibleUnits[n];
 					if(unit==NULL)
@@ -1964,6 +2063,43 @@ bool Building::subscribeForFlagingStep()
 }
 
 
+bool Building::isZonableUnitType(int unitType)
+{
+	if (type->zonable[EXPLORER] && unitType != EXPLORER)
+		return false;
+	if (type->zonable[WORKER] && unitType != WORKER)
+		return false;
+	if (type->zonable[WARRIOR] && unitType != WARRIOR)
+		return false;
+	return true;
+}
+
+
+bool Building::freeUnitBuildingAvailable(size_t index, Unit *unit, int *dist)
+{
+	// Neither the units nor the map change while the team assigns tasks, so the
+	// result of Map::buildingAvailable is kept for the following rounds of the pass
+	if (freeUnitsDistancePass != owner->buildingTasksPass)
+	{
+		freeUnitsDistance.assign(owner->freeUnits.size(), -2);
+		freeUnitsDistancePass = owner->buildingTasksPass;
+	}
+	Sint32 &cached = freeUnitsDistance[index];
+	if (cached == -2)
+	{
+		int d = 0;
+		if (owner->map->buildingAvailable(this, unit->performance[SWIM], unit->posX, unit->posY, &d))
+			cached = d;
+		else
+			cached = -1;
+	}
+	if (cached < 0)
+		return false;
+	*dist = cached;
+	return true;
+}
+
+
 void Building::subscribeUnitForInside(Unit* unit)
 {
 	unitsInside.push_back(unit);
@@ -2083,6 +2219,10 @@ void Building::turretStep(Uint32 stepCounter)
 	Map *map = owner->map;
 	assert(map);
 
+	// nothing to shoot at if no enemy is in the sectors covering our range
+	if ((map->getSectorsTeamsPresence(posX-range, posY-range, 2*range+2, 2*range+2) & enemies) == 0)
+		return;
+
 	// the type of target we have found
 	enum TargetType
 	{
@@ -2150,8 +2290,8 @@ void Building::turretStep(Uint32 stepCounter)
 					targetY=0;
 					break;
 				}
-				int targetGUID = map->getGroundUnit(targetX, targetY);
-				int airTargetGUID = map->getAirUnit(targetX, targetY);
+				Uint32 targetGUID = map->getGroundUnit(targetX, targetY);
+				Uint32 airTargetGUID = map->getAirUnit(targetX, targetY);
 				if (targetGUID != NOGUID)
 				{
 					Sint32 otherTeam = Unit::GIDtoTeam(targetGUID);
@@ -2246,7 +2386,7 @@ void Building::turretStep(Uint32 stepCounter)
 				// shoot building only if no unit is found
 				if (targetFound == TARGETTYPE_NONE)
 				{
-					Uint16 targetGBID = map->getBuilding(targetX, targetY);
+					Uint32 targetGBID = map->getBuilding(targetX, targetY);
 					if (targetGBID != NOGBID)
 					{
 						Sint32 otherTeam = Building::GIDtoTeam(targetGBID);
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "BuildingUtils.h"
+#include "FixedSizePool.h"
 #include "Ressource.h"
 #include "UnitConsts.h"
 
@@ -43,7 +44,6 @@ class Order;
 class Building : public BuildingUtils
 {
 public:
-	static const int MAX_COUNT=1024;
 	///This is the buildings basic state of existance.
 	enum BuildingState
 	{
@@ -74,14 +74,18 @@ public:
 
 public:
 	Building(GAGCore::InputStream *stream, BuildingsTypes *types, Team *owner, Sint32 versionMinor);
-	Building(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, BuildingsTypes *types, Sint32 unitWorking, Sint32 unitWorkingFuture);
+	Building(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, BuildingsTypes *types, Sint32 unitWorking, Sint32 unitWorkingFuture);
 	virtual ~Building(void);
+	DECLARE_POOLED_ALLOCATION
 	void freeGradients();
 
 	void load(GAGCore::InputStream *stream, BuildingsTypes *types, Team *owner, Sint32 versionMinor);
 	void save(GAGCore::OutputStream *stream);
 	void loadCrossRef(GAGCore::InputStream *stream, BuildingsTypes *types, Team *owner, Sint32 versionMinor);
 	void saveCrossRef(GAGCore::OutputStream *stream);
+	//! Saves the gradients and the call list states, which load() resets
+	void saveCaches(GAGCore::OutputStream *stream);
+	void loadCaches(GAGCore::InputStream *stream);
 
 	bool isRessourceFull(void);
 	int neededRessource(void);
@@ -182,6 +186,16 @@ public:void step(void);
 	bool subscribeForFlagingStep();
 	/// Subscribes a unit to go inside the building.
 	void subscribeUnitForInside(Unit* unit);
+private:
+	/// Returns true if units of the given type can be called by this flag
+	bool isZonableUnitType(int unitType);
+	/// Map::buildingAvailable for the unit at index in Team::freeUnits, computed once per building tasks pass
+	bool freeUnitBuildingAvailable(size_t index, Unit *unit, int *dist);
+	/// Distance to each unit of Team::freeUnits, -2 if not computed yet, -1 if the building is not available
+	std::vector<Sint32> freeUnitsDistance;
+	/// The value of Team::buildingTasksPass freeUnitsDistance was computed for
+	Uint32 freeUnitsDistancePass;
+public:
 	/// This is a step for swarms. Swarms heal themselves and create new units
 	void swarmStep(void);
 	/// This function searches for enemies, computes the best target, and fires a bullet
@@ -325,7 +339,7 @@ private:
 
 public:
 	// identity
-	Uint16 gid; // for reservation see GIDtoID() and GIDtoTeam().
+	Uint32 gid; // for reservation see GIDtoID() and GIDtoTeam().
 	Team *owner;
 
 	// position
@@ -0,0 +1,146 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "BuildingBuckets.h"
+#include "Building.h"
+#include "BuildingType.h"
+#include "Map.h"
+#include "Team.h"
+#include <algorithm>
+
+BuildingBuckets::BuildingBuckets()
+{
+	mapW = mapH = 0;
+	bucketSize = 1;
+	bucketShift = 0;
+	bucketsW = bucketsH = 0;
+	ringCount = 0;
+	maxExtent = 0;
+	count = 0;
+	nextSerial = 0;
+}
+
+void BuildingBuckets::setMapSize(int mapW, int mapH)
+{
+	std::vector<Entry> entries;
+	for (size_t i=0; i<buckets.size(); i++)
+		entries.insert(entries.end(), buckets[i].begin(), buckets[i].end());
+
+	this->mapW = mapW;
+	this->mapH = mapH;
+	// map sizes are powers of two, so the bucket size divides both of them
+	bucketShift = 0;
+	while (bucketShift < 4 && (2<<bucketShift) <= std::min(mapW, mapH))
+		bucketShift++;
+	bucketSize = 1<<bucketShift;
+	bucketsW = mapW>>bucketShift;
+	bucketsH = mapH>>bucketShift;
+	ringCount = std::max(bucketsW, bucketsH)/2+1;
+	buckets.clear();
+	buckets.resize(bucketsW*bucketsH);
+	for (size_t i=0; i<entries.size(); i++)
+		bucketOf(entries[i].building).push_back(entries[i]);
+}
+
+void BuildingBuckets::clear()
+{
+	for (size_t i=0; i<buckets.size(); i++)
+		buckets[i].clear();
+	maxExtent = 0;
+	count = 0;
+	nextSerial = 0;
+}
+
+std::vector<BuildingBuckets::Entry> &BuildingBuckets::bucketOf(Building *building)
+{
+	int bx = (building->posX & (mapW-1)) >> bucketShift;
+	int by = (building->posY & (mapH-1)) >> bucketShift;
+	return buckets[bx+by*bucketsW];
+}
+
+void BuildingBuckets::insert(Building *building)
+{
+	Map *map = building->owner->map;
+	if (map->getW() != mapW || map->getH() != mapH)
+		setMapSize(map->getW(), map->getH());
+	Entry entry;
+	entry.building = building;
+	entry.serial = ++nextSerial;
+	bucketOf(building).push_back(entry);
+	maxExtent = std::max(maxExtent, (int)std::max(building->type->width, building->type->height));
+	count++;
+}
+
+void BuildingBuckets::remove(Building *building)
+{
+	if (count == 0)
+		return;
+	std::vector<Entry> &bucket = bucketOf(building);
+	for (size_t i=0; i<bucket.size(); i++)
+		if (bucket[i].building == building)
+		{
+			bucket[i] = bucket.back();
+			bucket.pop_back();
+			count--;
+			return;
+		}
+}
+
+///Orders entries like the mirrored list, where the last inserted building comes first
+static bool newerEntryFirst(const BuildingBuckets::Entry *a, const BuildingBuckets::Entry *b)
+{
+	return a->serial > b->serial;
+}
+
+void BuildingBuckets::getRing(int x, int y, int ring, std::vector<const Entry *> &entries) const
+{
+	if (count == 0)
+		return;
+	size_t start = entries.size();
+	int cx = (x & (mapW-1)) >> bucketShift;
+	int cy = (y & (mapH-1)) >> bucketShift;
+	for (int dy=-ring; dy<=ring; dy++)
+	{
+		// each bucket is only visited at its shortest offset
+		if (2*dy <= -bucketsH || 2*dy > bucketsH)
+			continue;
+		int by = (cy+dy+bucketsH) % bucketsH;
+		bool edgeRow = (dy == -ring || dy == ring);
+		for (int dx=-ring; dx<=ring; dx += (edgeRow ? 1 : 2*ring))
+		{
+			if (2*dx <= -bucketsW || 2*dx > bucketsW)
+				continue;
+			int bx = (cx+dx+bucketsW) % bucketsW;
+			const std::vector<Entry> &bucket = buckets[bx+by*bucketsW];
+			for (size_t i=0; i<bucket.size(); i++)
+				entries.push_back(&bucket[i]);
+			if (ring == 0)
+				break;
+		}
+	}
+	std::sort(entries.begin()+start, entries.end(), newerEntryFirst);
+}
+
+void BuildingBuckets::getWithin(int x, int y, int maxDist, std::vector<const Entry *> &entries) const
+{
+	size_t start = entries.size();
+	for (int ring=0; ring<ringCount && ringMinDistance(ring)<maxDist; ring++)
+		getRing(x, y, ring, entries);
+	std::sort(entries.begin()+start, entries.end(), newerEntryFirst);
+}
@@ -0,0 +1,82 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __BUILDING_BUCKETS_H
+#define __BUILDING_BUCKETS_H
+
+#include <vector>
+#include <GAGSys.h>
+
+class Building;
+
+///This sorts the buildings of a list, such as Team::canFeedUnit, into square buckets of the map,
+///so that the buildings close to a point can be found without looking at all of them.
+///Buckets are visited by rings of increasing distance around a point, taking the warping of the
+///map into account. Each building gets a serial number when inserted, which grows with time, so
+///that the order of the mirrored list can be used to break ties.
+class BuildingBuckets
+{
+public:
+	struct Entry
+	{
+		Building *building;
+		Uint32 serial;
+	};
+
+	BuildingBuckets();
+	///Removes all buildings
+	void clear();
+	///Adds building, it must not already be there. The buckets follow the size of the map of its owner.
+	void insert(Building *building);
+	///Removes building, does nothing if it is not there
+	void remove(Building *building);
+	///Returns the number of buildings
+	size_t size() const { return count; }
+
+	///Returns the number of rings around any point that cover the whole map
+	int getRingCount() const { return ringCount; }
+	///Returns a lower bound of the Chebyshev distance between a point and the position of a building in the ring-th ring around it
+	int ringMinDistance(int ring) const { return ring==0 ? 0 : (ring-1)*bucketSize+1; }
+	///Returns the biggest width or height of all the buildings inserted since the last clear
+	int getMaxExtent() const { return maxExtent; }
+	///Appends to entries all the buildings in the ring-th ring of buckets around (x, y),
+	///in the order of the mirrored list
+	void getRing(int x, int y, int ring, std::vector<const Entry *> &entries) const;
+	///Appends to entries all the buildings of the rings around (x, y) whose lower bound of
+	///distance is smaller than maxDist, in the order of the mirrored list
+	void getWithin(int x, int y, int maxDist, std::vector<const Entry *> &entries) const;
+
+private:
+	///Sets the size of the map, sorting again the buildings already there
+	void setMapSize(int mapW, int mapH);
+	///Returns the bucket containing the position of building
+	std::vector<Entry> &bucketOf(Building *building);
+
+	std::vector<std::vector<Entry> > buckets;
+	int mapW, mapH;
+	int bucketSize;
+	int bucketShift;
+	int bucketsW, bucketsH;
+	int ringCount;
+	int maxExtent;
+	size_t count;
+	Uint32 nextSerial;
+};
+
+#endif
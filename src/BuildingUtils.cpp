@@ -19,24 +19,39 @@
 
 #include "BuildingUtils.h"
 #include "Team.h"
+#include "Map.h"
+#include <Stream.h>
 
 
-Sint32 BuildingUtils::GIDtoID(Uint16 gid)
+Sint32 BuildingUtils::GIDtoID(Uint32 gid)
 {
-	assert(gid < BuildingUtils::MAX_COUNT * Team::MAX_COUNT);
+	assert(gid < (Uint32)(BuildingUtils::MAX_COUNT * Team::MAX_COUNT));
 	return gid % BuildingUtils::MAX_COUNT;
 }
 
-Sint32 BuildingUtils::GIDtoTeam(Uint16 gid)
+Sint32 BuildingUtils::GIDtoTeam(Uint32 gid)
 {
-	assert(gid < BuildingUtils::MAX_COUNT * Team::MAX_COUNT);
+	assert(gid < (Uint32)(BuildingUtils::MAX_COUNT * Team::MAX_COUNT));
 	return gid / BuildingUtils::MAX_COUNT;
 }
 
-Uint16 BuildingUtils::GIDfrom(Sint32 id, Sint32 team)
+Uint32 BuildingUtils::GIDfrom(Sint32 id, Sint32 team)
 {
 	assert(id < BuildingUtils::MAX_COUNT);
 	assert(team < Team::MAX_COUNT);
 	return id + team * BuildingUtils::MAX_COUNT;
 }
 
+Uint32 BuildingUtils::GIDfromUint16(Uint16 gid)
+{
+	if (gid == 0xFFFF)
+		return NOGBID;
+	return GIDfrom(gid % BuildingUtils::MAX_COUNT_UINT16, gid / BuildingUtils::MAX_COUNT_UINT16);
+}
+
+Uint32 BuildingUtils::readGID(GAGCore::InputStream *stream, const std::string &name, Sint32 versionMinor)
+{
+	if (versionMinor < 84)
+		return GIDfromUint16(stream->readUint16(name));
+	return stream->readUint32(name);
+}
@@ -22,6 +22,9 @@
 #include <SDL_endian.h>
 #include <Stream.h>
 
+DEFINE_POOLED_ALLOCATION(Bullet)
+DEFINE_POOLED_ALLOCATION(BulletExplosion)
+
 Bullet::Bullet(GAGCore::InputStream *stream, Sint32 versionMinor)
 {
 	bool good = load(stream, versionMinor);
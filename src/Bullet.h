@@ -25,6 +25,7 @@
 #define SHOOTING_COOLDOWN_MAGNITUDE 10
 
 #include <GAGSys.h>
+#include "FixedSizePool.h"
 
 namespace GAGCore
 {
@@ -39,6 +40,7 @@ public:
 	Bullet(Sint32 px, Sint32 py, Sint32 speedX, Sint32 speedY, Sint32 ticksLeft, Sint32 shootDamage, Sint32 targetX, Sint32 targetY, Sint32 revealX, Sint32 revealY, Sint32 revealW, Sint32 revealH);
 	bool load(GAGCore::InputStream *stream, Sint32 versionMinor);
 	void save(GAGCore::OutputStream *stream);
+	DECLARE_POOLED_ALLOCATION
 public:
 	Sint32 px, py; //!< pixel precision point of x,y
 	Sint32 speedX, speedY; //!< pixel precision speed.
@@ -54,6 +56,7 @@ public:
 struct BulletExplosion
 {
 	int x, y, ticksLeft;
+	DECLARE_POOLED_ALLOCATION
 };
 
 #endif
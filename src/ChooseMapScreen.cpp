@@ -21,6 +21,8 @@
 #include "GUIGlob2FileList.h"
 #include "GUIMapPreview.h"
 #include "GlobalContainer.h"
+#include "MapInfoCache.h"
+#include <FileManager.h>
 #include <FormatableString.h>
 #include <GUIButton.h>
 #include <GUIMessageBox.h>
@@ -106,10 +108,14 @@ ChooseMapScreen::ChooseMapScreen(const char *directory, const char *extension, b
 	
 	validMapSelected = false;
 	selectedType = NONE;
+
+	prefetchThumbnails(fileList);
 }
 
 ChooseMapScreen::~ChooseMapScreen()
 {
+	// don't let the worker load maps while the game starts
+	globalContainer->mapInfoCache->cancelPrefetch();
 }
 
 void ChooseMapScreen::onAction(Widget *source, Action action, int par1, int par2)
@@ -246,6 +252,7 @@ void ChooseMapScreen::onAction(Widget *source, Action action, int par1, int par2
 				alternateFileList->visible=true;
 				switchType->setText(newTypeName);
 				alternateFileList->selectionChanged();
+				prefetchThumbnails(alternateFileList);
 			}
 			else
 			{
@@ -263,12 +270,28 @@ void ChooseMapScreen::onAction(Widget *source, Action action, int par1, int par2
 				alternateFileList->visible=false;
 				switchType->setText(newTypeName);
 				fileList->selectionChanged();
+				prefetchThumbnails(fileList);
 			}
 		}
 	}
 }
 
 
+void ChooseMapScreen::prefetchThumbnails(Glob2FileList *list)
+{
+	std::vector<std::string> fileNames;
+	for (size_t i = 0; i < list->getCount(); i++)
+	{
+		const std::string &listName = list->getText(i);
+		// skip directories
+		if (listName.empty() || listName[listName.size() - 1] == DIR_SEPARATOR)
+			continue;
+		fileNames.push_back(list->listToFile(listName));
+	}
+	globalContainer->mapInfoCache->prefetch(fileNames);
+}
+
+
 void ChooseMapScreen::updateMapInformation()
 {
 	// update map name & info
@@ -89,6 +89,8 @@ protected:
 	GameHeader gameHeader;
 
 private:
+	//! Asks the map info cache to load the thumbnails of the files in list in the background
+	void prefetchThumbnails(Glob2FileList *list);
 
 	enum DirectoryMode
 	{
@@ -179,6 +179,7 @@ void ScrollingText::paint()
 void ScrollingText::onTimer(Uint32 tick)
 {
 	offset++;
+	invalidate();
 }
 
 /////////////////////////////////////////////////
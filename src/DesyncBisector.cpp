@@ -0,0 +1,377 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "DesyncBisector.h"
+
+#include "Building.h"
+#include "Engine.h"
+#include "Game.h"
+#include "GlobalContainer.h"
+#include "Player.h"
+#include "ReplayReader.h"
+#include "Team.h"
+#include "Unit.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+// Prints the fields of two checksum vectors that differ, returns true if there was any
+static bool printFieldDifferences(const std::string &what, const std::vector<Uint32> &a, const std::vector<Uint32> &b, std::ostream &out)
+{
+	if (a == b)
+		return false;
+
+	out << "  " << what << " differs:";
+	for (size_t i = 0; i < std::max(a.size(), b.size()); i++)
+	{
+		if (i >= a.size())
+			out << " [" << i << "] missing/" << b[i];
+		else if (i >= b.size())
+			out << " [" << i << "] " << a[i] << "/missing";
+		else if (a[i] != b[i])
+			out << " [" << i << "] " << a[i] << "/" << b[i];
+	}
+	out << "\n";
+	return true;
+}
+
+// Compares one layer of two maps, given as an accessor to a cell's value
+template<typename Accessor>
+static void printLayerDifferences(const std::string &name, int w, int h, Accessor value, std::ostream &out)
+{
+	int count = 0;
+	std::ostringstream cells;
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+		{
+			Uint32 a, b;
+			value(x, y, a, b);
+			if (a != b)
+			{
+				if (count < DesyncBisector::MAX_CELLS_REPORTED)
+					cells << " (" << x << "," << y << ") " << a << "/" << b;
+				count++;
+			}
+		}
+	if (count)
+		out << "  map " << name << " differs in " << count << " cells:" << cells.str() << (count > DesyncBisector::MAX_CELLS_REPORTED ? " ..." : "") << "\n";
+}
+
+// Reads a field of the Case of both maps
+template<typename T>
+struct CaseField
+{
+	Map &a, &b;
+	T Case::*field;
+	CaseField(Map &a, Map &b, T Case::*field) : a(a), b(b), field(field) { }
+	void operator()(int x, int y, Uint32 &va, Uint32 &vb) const { va = a.getCase(x, y).*field; vb = b.getCase(x, y).*field; }
+};
+
+// Reads the ressource of a Case of both maps
+struct CaseRessource
+{
+	Map &a, &b;
+	CaseRessource(Map &a, Map &b) : a(a), b(b) { }
+	void operator()(int x, int y, Uint32 &va, Uint32 &vb) const { va = a.getCase(x, y).ressource.getUint32(); vb = b.getCase(x, y).ressource.getUint32(); }
+};
+
+// Reads a whole-map array of both maps, which may not be allocated
+template<typename T>
+struct ArrayField
+{
+	const T *a, *b;
+	int w;
+	ArrayField(const T *a, const T *b, int w) : a(a), b(b), w(w) { }
+	void operator()(int x, int y, Uint32 &va, Uint32 &vb) const { va = a ? a[y*w+x] : 0; vb = b ? b[y*w+x] : 0; }
+};
+
+template<typename T>
+static void printArrayDifferences(const std::string &name, Map &a, Map &b, const T *arrayA, const T *arrayB, std::ostream &out)
+{
+	if (arrayA == NULL && arrayB == NULL)
+		return;
+	printLayerDifferences(name, a.getW(), a.getH(), ArrayField<T>(arrayA, arrayB, a.getW()), out);
+}
+
+int DesyncBisector::run(const std::string &replayA, const std::string &replayB, std::ostream &out)
+{
+	// Play the first replay to its end, remembering its checksum after every step
+	std::vector<Uint32> traceA;
+	{
+		Engine engine;
+		if (!playReplay(engine, replayA, &traceA, NULL))
+		{
+			out << "Can't play replay " << replayA << "\n";
+			return -1;
+		}
+	}
+
+	// Play the second one until it differs
+	std::vector<Uint32> traceB;
+	Engine engineB;
+	if (!playReplay(engineB, replayB, &traceB, &traceA))
+	{
+		out << "Can't play replay " << replayB << "\n";
+		return -1;
+	}
+
+	size_t step = 0;
+	while (step < traceA.size() && step < traceB.size() && traceA[step] == traceB[step])
+		step++;
+	if (step == traceA.size() || step == traceB.size())
+	{
+		out << "The games never differ in the " << std::min(traceA.size(), traceB.size()) << " steps both replays cover\n";
+		return 0;
+	}
+
+	// Play the first one again, it stops at the same step
+	Engine engineA;
+	playReplay(engineA, replayA, NULL, &traceB);
+
+	out << "The games first differ after step " << step;
+	if (step > 0)
+		out << ", they agree after step " << step - 1;
+	out << " (checksums " << std::hex << traceA[step] << "/" << traceB[step] << std::dec << ")\n";
+	out << "Differences, as value in " << replayA << "/value in " << replayB << ":\n";
+	printDifferences(engineA.getGame(), engineB.getGame(), out);
+	return 1;
+}
+
+int DesyncBisector::verifyKeyframes(const std::string &replay, std::ostream &out)
+{
+	// Play the replay from its start to its end, remembering its checksum after every step
+	std::vector<Uint32> trace;
+	std::vector<Uint32> keyframeSteps;
+	{
+		Engine engine;
+		if (!playReplay(engine, replay, &trace, NULL))
+		{
+			out << "Can't play replay " << replay << "\n";
+			return -1;
+		}
+		ReplayReader *reader = globalContainer->replayReader;
+		for (int i = 0; i < reader->getKeyframeCount(); i++)
+			keyframeSteps.push_back(reader->getKeyframeStep(i));
+	}
+	if (keyframeSteps.empty())
+	{
+		out << "Replay " << replay << " has no keyframe\n";
+		return 0;
+	}
+
+	for (size_t k = 0; k < keyframeSteps.size(); k++)
+	{
+		// Play it from the keyframe. The checksums of the steps before it are copied, so that
+		// the game can be played from the start again to the first step that differs.
+		Uint32 step = keyframeSteps[k];
+		std::vector<Uint32> seekTrace(trace.begin(), trace.begin() + std::min<size_t>(step, trace.size()));
+		Engine engine;
+		if (!restoreKeyframe(engine, replay, step))
+		{
+			out << "Can't restore the game from the keyframe at step " << step << "\n";
+			return 1;
+		}
+		engine.setCheckSumTrace(&seekTrace, &trace);
+		engine.run();
+
+		size_t end = std::min(trace.size(), seekTrace.size());
+		size_t differs = step;
+		while (differs < end && trace[differs] == seekTrace[differs])
+			differs++;
+		if (differs == trace.size())
+		{
+			out << "The keyframe at step " << step << " agrees with the replay until step " << trace.size() - 1 << "\n";
+			continue;
+		}
+		if (differs == end)
+		{
+			out << "The game restored from the keyframe at step " << step << " ends after step " << end - 1 << ", the replay after step " << trace.size() - 1 << "\n";
+			return 1;
+		}
+
+		// Play it from the start again, it stops at the same step
+		Engine linearEngine;
+		playReplay(linearEngine, replay, NULL, &seekTrace);
+
+		out << "The game restored from the keyframe at step " << step << " first differs from the replay after step " << differs;
+		out << " (checksums " << std::hex << trace[differs] << "/" << seekTrace[differs] << std::dec << ")\n";
+		out << "Differences, as value when played from the start/value when restored from the keyframe:\n";
+		printDifferences(linearEngine.getGame(), engine.getGame(), out);
+		return 1;
+	}
+	return 0;
+}
+
+bool DesyncBisector::loadReplay(Engine &engine, const std::string &fileName)
+{
+	// Run without any end condition other than the end of the replay
+	globalContainer->automaticEndingGame = true;
+	globalContainer->automaticEndingSteps = -1;
+	globalContainer->automaticGameGlobalEndConditions = true;
+
+	// The previous replay's reader isn't needed anymore
+	delete globalContainer->replayReader;
+	globalContainer->replayReader = NULL;
+
+	return engine.loadReplay(fileName) == Engine::EE_NO_ERROR;
+}
+
+bool DesyncBisector::restoreKeyframe(Engine &engine, const std::string &fileName, Uint32 step)
+{
+	if (!loadReplay(engine, fileName))
+		return false;
+	// On failure, the game either wasn't restored or is in an undefined state
+	if (!engine.restoreReplayKeyframe(step))
+		return false;
+	return globalContainer->replayReader->getCurrentStep() == step;
+}
+
+bool DesyncBisector::playReplay(Engine &engine, const std::string &fileName, std::vector<Uint32> *trace, const std::vector<Uint32> *reference)
+{
+	if (!loadReplay(engine, fileName))
+		return false;
+	engine.setCheckSumTrace(trace, reference);
+	engine.run();
+	return true;
+}
+
+void DesyncBisector::printDifferences(Game &a, Game &b, std::ostream &out)
+{
+	if (a.mapHeader.checkSum() != b.mapHeader.checkSum())
+		out << "  map header differs\n";
+
+	int teamsCount = std::min(a.mapHeader.getNumberOfTeams(), b.mapHeader.getNumberOfTeams());
+	for (int t = 0; t < teamsCount; t++)
+	{
+		Team *teamA = a.teams[t];
+		Team *teamB = b.teams[t];
+
+		int unitCount = std::max(teamA->unitSlots.capacity(), teamB->unitSlots.capacity());
+		for (int i = 0; i < unitCount; i++)
+		{
+			Unit *unitA = i < (int)teamA->unitSlots.capacity() ? teamA->myUnits[i] : NULL;
+			Unit *unitB = i < (int)teamB->unitSlots.capacity() ? teamB->myUnits[i] : NULL;
+			if (unitA == NULL && unitB == NULL)
+				continue;
+			std::ostringstream what;
+			what << "team " << t << " unit " << (unitA ? unitA->gid : unitB->gid);
+			std::vector<Uint32> fieldsA, fieldsB;
+			if (unitA)
+				unitA->checkSum(&fieldsA);
+			if (unitB)
+				unitB->checkSum(&fieldsB);
+			printFieldDifferences(what.str(), fieldsA, fieldsB, out);
+		}
+
+		int buildingCount = std::max(teamA->buildingSlots.capacity(), teamB->buildingSlots.capacity());
+		for (int i = 0; i < buildingCount; i++)
+		{
+			Building *buildingA = i < (int)teamA->buildingSlots.capacity() ? teamA->myBuildings[i] : NULL;
+			Building *buildingB = i < (int)teamB->buildingSlots.capacity() ? teamB->myBuildings[i] : NULL;
+			if (buildingA == NULL && buildingB == NULL)
+				continue;
+			std::ostringstream what;
+			what << "team " << t << " building " << (buildingA ? buildingA->gid : buildingB->gid);
+			std::vector<Uint32> fieldsA, fieldsB;
+			if (buildingA)
+				buildingA->checkSum(&fieldsA);
+			if (buildingB)
+				buildingB->checkSum(&fieldsB);
+			printFieldDifferences(what.str(), fieldsA, fieldsB, out);
+		}
+
+		// The team's own fields. They accumulate, so the first differing index is the one that matters.
+		std::vector<Uint32> fieldsA, fieldsB;
+		teamA->checkSum(&fieldsA, NULL, NULL);
+		teamB->checkSum(&fieldsB, NULL, NULL);
+		std::ostringstream what;
+		what << "team " << t;
+		printFieldDifferences(what.str(), fieldsA, fieldsB, out);
+	}
+
+	int playersCount = std::min(a.gameHeader.getNumberOfPlayers(), b.gameHeader.getNumberOfPlayers());
+	for (int p = 0; p < playersCount; p++)
+	{
+		std::vector<Uint32> fieldsA, fieldsB;
+		a.players[p]->checkSum(&fieldsA);
+		b.players[p]->checkSum(&fieldsB);
+		std::ostringstream what;
+		what << "player " << p;
+		printFieldDifferences(what.str(), fieldsA, fieldsB, out);
+	}
+
+	printMapDifferences(a.map, b.map, out);
+
+	if (a.sgslScript.checkSum() != b.sgslScript.checkSum())
+		out << "  script differs: " << a.sgslScript.checkSum() << "/" << b.sgslScript.checkSum() << "\n";
+}
+
+void DesyncBisector::printMapDifferences(Map &a, Map &b, std::ostream &out)
+{
+	if (a.getW() != b.getW() || a.getH() != b.getH())
+	{
+		out << "  map sizes differ\n";
+		return;
+	}
+	int w = a.getW();
+	int h = a.getH();
+
+	printLayerDifferences("terrain", w, h, CaseField<Uint16>(a, b, &Case::terrain), out);
+	printLayerDifferences("building", w, h, CaseField<Uint32>(a, b, &Case::building), out);
+	printLayerDifferences("ressource", w, h, CaseRessource(a, b), out);
+	printLayerDifferences("groundUnit", w, h, CaseField<Uint32>(a, b, &Case::groundUnit), out);
+	printLayerDifferences("airUnit", w, h, CaseField<Uint32>(a, b, &Case::airUnit), out);
+	printLayerDifferences("forbidden", w, h, CaseField<Uint32>(a, b, &Case::forbidden), out);
+	printLayerDifferences("guardArea", w, h, CaseField<Uint32>(a, b, &Case::guardArea), out);
+	printLayerDifferences("clearArea", w, h, CaseField<Uint32>(a, b, &Case::clearArea), out);
+	printLayerDifferences("scriptAreas", w, h, CaseField<Uint16>(a, b, &Case::scriptAreas), out);
+	printLayerDifferences("canRessourcesGrow", w, h, CaseField<Uint8>(a, b, &Case::canRessourcesGrow), out);
+	printLayerDifferences("fertility", w, h, CaseField<Uint16>(a, b, &Case::fertility), out);
+	printArrayDifferences("mapDiscovered", a, b, a.mapDiscovered, b.mapDiscovered, out);
+	printArrayDifferences("immobileUnits", a, b, a.immobileUnits, b.immobileUnits, out);
+
+	// The gradients are caches, but units follow them, so a difference there often is the cause
+	for (int t = 0; t < Team::MAX_COUNT; t++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			for (int r = 0; r < MAX_NB_RESSOURCES; r++)
+			{
+				std::ostringstream name;
+				name << "ressourcesGradient[" << t << "][" << r << "][" << s << "]";
+				printArrayDifferences(name.str(), a, b, a.ressourcesGradient[t][r][s], b.ressourcesGradient[t][r][s], out);
+			}
+			std::ostringstream forbidden, guard, clear;
+			forbidden << "forbiddenGradient[" << t << "][" << s << "]";
+			printArrayDifferences(forbidden.str(), a, b, a.forbiddenGradient[t][s], b.forbiddenGradient[t][s], out);
+			guard << "guardAreasGradient[" << t << "][" << s << "]";
+			printArrayDifferences(guard.str(), a, b, a.guardAreasGradient[t][s], b.guardAreasGradient[t][s], out);
+			clear << "clearAreasGradient[" << t << "][" << s << "]";
+			printArrayDifferences(clear.str(), a, b, a.clearAreasGradient[t][s], b.clearAreasGradient[t][s], out);
+		}
+		std::ostringstream explored, claims;
+		if (a.exploredAreaAge[t] != b.exploredAreaAge[t])
+			out << "  map exploredAreaAge[" << t << "] differs: " << a.exploredAreaAge[t] << "/" << b.exploredAreaAge[t] << "\n";
+		explored << "exploredArea[" << t << "]";
+		printArrayDifferences(explored.str(), a, b, a.exploredArea[t], b.exploredArea[t], out);
+		claims << "clearingAreaClaims[" << t << "]";
+		printArrayDifferences(claims.str(), a, b, a.clearingAreaClaims[t], b.clearingAreaClaims[t], out);
+	}
+}
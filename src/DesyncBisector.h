@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __DESYNC_BISECTOR_H
+#define __DESYNC_BISECTOR_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "Types.h"
+
+class Engine;
+class Game;
+class Map;
+
+/// Finds where two replays of the same game stop agreeing, typically the replays saved by two
+/// clients of a network game that desynchronized. Playing the same replay twice also works, any
+/// difference then comes from the engine not being deterministic.
+/// The replays are played without drawing, which is much faster than real time. The first replay
+/// is played to the end while its checksum is recorded after every step. The second one is played
+/// until its checksum differs, and the first one is played again up to that step. Then the two
+/// games are compared object by object: teams, units, buildings, players, the map layers and the
+/// gradients. The fields of units, buildings, teams and players are given by their index in the
+/// vectors filled by their checkSum() functions.
+/// The same way, verifyKeyframes() compares a replay played from its keyframes with the replay played from the start.
+class DesyncBisector
+{
+public:
+	/// Compares the replays and prints the report to out.
+	/// Returns 0 if the games never differ, 1 if they do, and -1 if a replay can't be played.
+	int run(const std::string &replayA, const std::string &replayB, std::ostream &out);
+
+	/// Checks that seeking to each keyframe of a replay gives the same game as playing it from
+	/// the start. The replay is played once while its checksum is recorded after every step, then
+	/// from each keyframe to its end, until its checksum differs. The first keyframe that leads to
+	/// another game is reported with the differences, like for two replays.
+	/// Returns 0 if all keyframes agree with the replay, 1 if one doesn't, and -1 if the replay can't be played.
+	int verifyKeyframes(const std::string &replay, std::ostream &out);
+
+	/// Prints everything that differs between two games
+	static void printDifferences(Game &a, Game &b, std::ostream &out);
+
+	/// The maximum number of differing cells printed for each map layer
+	static const int MAX_CELLS_REPORTED = 8;
+
+private:
+	/// Loads a replay to be played headless
+	bool loadReplay(Engine &engine, const std::string &fileName);
+
+	/// Loads a replay and restores the game from its keyframe taken at step
+	bool restoreKeyframe(Engine &engine, const std::string &fileName, Uint32 step);
+
+	/// Plays a replay headless until its end, or until it stops matching reference.
+	/// If trace isn't NULL, the game's checksum after every step is stored in it.
+	bool playReplay(Engine &engine, const std::string &fileName, std::vector<Uint32> *trace, const std::vector<Uint32> *reference);
+
+	/// Prints the differences between the cases of two maps
+	static void printMapDifferences(Map &a, Map &b, std::ostream &out);
+};
+
+#endif
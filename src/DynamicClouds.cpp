@@ -25,6 +25,9 @@
 #include "GraphicContext.h"
 #include "GlobalContainer.h"
 #include "SimplexNoise.h"
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 #define INT_ROUND_RSHIFT(x,places)  ( ((x)+(1<<((places)-1))) >> (places) )
 
@@ -32,14 +35,6 @@ void DynamicClouds::compute(const int viewPortX, const int viewPortY, const int
 {
 	if (globalContainer->gfx->getOptionFlags() & GraphicContext::USEGPU)
 	{
-		//tribute to the torrodial world: the viewport must never jump by more than 31.
-		//if it does, we assume a jump in the opposite direction
-		static int vpX=0;
-		static int vpY=0;
-		//Correlated Noise
-		static PerlinNoise pn;
-
-		static float offsetX=0, offsetY=0;
 		//TODO: magic numbers!!!
 		offsetX+=pn.Noise((float)time/windStability+0.7f)*windStability*maxCloudSpeed/1000.0f;
 		offsetY+=pn.Noise((float)time/windStability+1.6f)*windStability*maxCloudSpeed/1000.0f;
@@ -51,26 +46,50 @@ void DynamicClouds::compute(const int viewPortX, const int viewPortY, const int
 		hGrid=viewPortHeight/granularity+1;
 		alphaMap.resize(wGrid*hGrid);
 
-		int iCloudSize = (int)((1<<16) /cloudSize);
+		Sampling sampling;
+		sampling.iCloudSize = (int)((1<<16) /cloudSize);
 		int iCloudStability = (int)((1<<16) /cloudStability);
-		int iOffsetX = (int)(((vpX<<5) + offsetX)*iCloudSize),
-		    iOffsetY = (int)(((vpY<<5) + offsetY)*iCloudSize);
+		sampling.iOffsetX = (int)(((vpX<<5) + offsetX)*sampling.iCloudSize);
+		sampling.iOffsetY = (int)(((vpY<<5) + offsetY)*sampling.iCloudSize);
+		sampling.nz = INT_ROUND_RSHIFT(time * iCloudStability, 8);
+		sampling.noiseMultiplier = (int)((1<<8) *rootOfMaxAlpha*1.8f);
+
+		unsigned threadCount = boost::thread::hardware_concurrency();
+		if (wGrid*hGrid < 64*64 || threadCount < 2)
+		{
+			computeRows(sampling, 0, hGrid);
+			return;
+		}
+		threadCount = std::min(threadCount, 4u);
 
- 		int noiseMultiplier = (int)((1<<8) *rootOfMaxAlpha*1.8f);
-		for (int y=0; y<hGrid; y++)
-			for (int x=0; x<wGrid; x++) {
-				int nx = INT_ROUND_RSHIFT(x*granularity*iCloudSize + iOffsetX, 8);
-				int ny = INT_ROUND_RSHIFT(y*granularity*iCloudSize + iOffsetY, 8);
-				int nz = INT_ROUND_RSHIFT(time * iCloudStability, 8);
-				int noise = (SimplexNoise::getNoise3D(nx,ny,nz)) - 128;
-				int a = INT_ROUND_RSHIFT(noiseMultiplier * (-21+noise), 8);
-				int alpha = INT_ROUND_RSHIFT(a*a, 16);
-				if (alpha<0)
-					alpha=0;
-				if (alpha>maxAlpha)
-					alpha=maxAlpha;
-				alphaMap[wGrid*y+x] = alpha;
-			}
+		//the noise is a pure function, so bands of rows can be computed in parallel
+		boost::thread_group threads;
+		for (unsigned n=1; n<threadCount; n++)
+			threads.create_thread(boost::bind(&DynamicClouds::computeRows, this, boost::cref(sampling), (hGrid*n)/threadCount, (hGrid*(n+1))/threadCount));
+		computeRows(sampling, 0, hGrid/threadCount);
+		threads.join_all();
+	}
+}
+
+void DynamicClouds::computeRows(const Sampling &sampling, int yBegin, int yEnd)
+{
+	const int step = granularity*sampling.iCloudSize;
+	for (int y=yBegin; y<yEnd; y++)
+	{
+		int ny = INT_ROUND_RSHIFT(y*step + sampling.iOffsetY, 8);
+		unsigned char *line = &alphaMap[wGrid*y];
+		int nxFP = sampling.iOffsetX;
+		for (int x=0; x<wGrid; x++, nxFP+=step) {
+			int nx = INT_ROUND_RSHIFT(nxFP, 8);
+			int noise = (SimplexNoise::getNoise3D(nx,ny,sampling.nz)) - 128;
+			int a = INT_ROUND_RSHIFT(sampling.noiseMultiplier * (-21+noise), 8);
+			int alpha = INT_ROUND_RSHIFT(a*a, 16);
+			if (alpha<0)
+				alpha=0;
+			if (alpha>maxAlpha)
+				alpha=maxAlpha;
+			line[x] = alpha;
+		}
 	}
 }
 
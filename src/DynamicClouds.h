@@ -78,6 +78,25 @@ class DynamicClouds
 	int hGrid;
 	///cloud/shadow density
 	std::valarray<unsigned char> alphaMap;
+	/** viewport position, unwrapped: tribute to the torrodial world, the viewport must
+	 * never jump by more than 31. if it does, we assume a jump in the opposite direction
+	 */
+	int vpX, vpY;
+	///correlated noise driving the wind
+	PerlinNoise pn;
+	///distance the wind has moved the clouds
+	float offsetX, offsetY;
+
+	///parameters of the noise sampling shared by the rows of a frame
+	struct Sampling
+	{
+		int iCloudSize;
+		int iOffsetX, iOffsetY;
+		int nz;
+		int noiseMultiplier;
+	};
+	///computes the rows [yBegin, yEnd) of alphaMap. Rows are independent and may be computed in parallel
+	void computeRows(const Sampling &sampling, int yBegin, int yEnd);
 public:
 	 ///render() distinguishes between CLOUD and SHADOW
 	enum Layer {
@@ -97,6 +116,12 @@ public:
 		cloudStability=settings->cloudStability;
 		cloudSize=settings->cloudSize;
 		cloudHeight=(float)settings->cloudHeight/100.0f;
+		wGrid=0;
+		hGrid=0;
+		vpX=0;
+		vpY=0;
+		offsetX=0;
+		offsetY=0;
 	}
 	virtual ~DynamicClouds() { }
 	/**
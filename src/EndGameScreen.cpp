@@ -65,11 +65,13 @@ EndGameStat::~EndGameStat()
 void EndGameStat::setStatType(EndOfGameStat::Type type)
 {
 	this->type=type;
+	invalidate();
 }
 
 void EndGameStat::setEnabledState(int teamNum, bool isEnabled)
 {
 	isTeamEnabled[teamNum]=isEnabled;
+	invalidate();
 }
 
 void EndGameStat::paint(void)
@@ -43,12 +43,15 @@
 #include "ReplayWriter.h"
 
 #include <iostream>
+#include <sstream>
 
 using namespace boost;
 
 Engine::Engine()
 {
 	net=NULL;
+	checkSumTrace=NULL;
+	checkSumReference=NULL;
 	logFile = globalContainer->logFileManager->getFile("Engine.log");
 }
 
@@ -236,6 +239,26 @@ void Engine::createRandomGame()
 
 
 
+int Engine::initWarBenchmark(const std::string &mapFileName)
+{
+	MapHeader mapHeader = loadMapHeader(mapFileName);
+	if (mapHeader.getNumberOfTeams() == 0)
+		return EE_CANT_LOAD_MAP;
+	
+	// Warriors rushing each other keep the turrets and the attack scans busy
+	GameHeader gameHeader = createRandomGame(mapHeader.getNumberOfTeams(), AI::WARRUSH);
+	gameHeader.setRandomSeed(5489);
+	
+	gui.localPlayer=0;
+	gui.localTeamNo=0;
+	
+	if (initGame(mapHeader, gameHeader) != EE_NO_ERROR)
+		return EE_CANT_LOAD_MAP;
+	return EE_NO_ERROR;
+}
+
+
+
 bool Engine::haveMap(const MapHeader& mapHeader)
 {
 	// FIXME: This is a fairly ugly way to test if the file exists
@@ -318,6 +341,9 @@ int Engine::run(void)
 
 		while (gui.isRunning)
 		{
+			// the orders of asynchronous AIs must be ready before the gui may touch the game
+			asyncAI.wait();
+			
 			nextGuiStep--;
 			
 			// Set the replay speed
@@ -397,7 +423,11 @@ int Engine::run(void)
 				{
 					if (gui.game.players[i]->ai && !net->orderRecieved(i))
 					{
-						shared_ptr<Order> order=gui.game.players[i]->ai->getOrder(gui.gamePaused);
+						shared_ptr<Order> order;
+						if (asyncAI.hasOrder(i))
+							order=asyncAI.retrieveOrder(i);
+						else
+							order=gui.game.players[i]->ai->getOrder(gui.gamePaused);
 						net->pushOrder(order, i, true);
 					}
 				}
@@ -415,6 +445,18 @@ int Engine::run(void)
 					// Enable this to do test if checksums in the replay match
 					//if (globalContainer->replayReader) globalContainer->replayReader->setCheckSum(checksum);
 					if (globalContainer->replayWriter) globalContainer->replayWriter->setCheckSum(checksum);
+
+					if (checkSumTrace && gui.game.stepCounter >= checkSumTrace->size())
+					{
+						checkSumTrace->resize(gui.game.stepCounter + 1, 0);
+						(*checkSumTrace)[gui.game.stepCounter] = checksum;
+					}
+					// Stop right away, before any order is executed, so that the game can be inspected
+					if (checkSumReference && gui.game.stepCounter < checkSumReference->size() && (*checkSumReference)[gui.game.stepCounter] != checksum)
+					{
+						gui.isRunning = false;
+						break;
+					}
 				}
 
 				// We proceed network:
@@ -458,6 +500,15 @@ int Engine::run(void)
 				}
 				*/
 
+				// Jump forward in place if the replay's progress bar was clicked. When a keyframe
+				// is a better starting point, the gui asked for the replay to be loaded again instead.
+				if (globalContainer->replaying && globalContainer->replaySeekStep && !gui.flushOutgoingAndExit)
+				{
+					Uint32 targetStep = globalContainer->replaySeekStep;
+					globalContainer->replaySeekStep = 0;
+					fastForwardReplay(targetStep);
+				}
+
 				// Load the replay's orders
 				if (globalContainer->replaying)
 				{
@@ -478,7 +529,14 @@ int Engine::run(void)
 					
 					if (globalContainer->replayReader->isFinished())
 					{
-						gui.showEndOfReplayScreen();
+						// Without a display there is nobody to show the end of the replay to
+						if (globalContainer->runNoX)
+						{
+							gui.gamePaused = true;
+							gui.isRunning = false;
+						}
+						else
+							gui.showEndOfReplayScreen();
 					}
 				}
 				
@@ -492,6 +550,11 @@ int Engine::run(void)
 					}
 					
 					gui.game.syncStep(gui.localTeamNo);
+
+					// Let the replay take a snapshot of the game from time to time, for seeking, if asked for.
+					// It is off by default, as serialising a big game stalls this step.
+					if (globalContainer->replayKeyframes && globalContainer->replayWriter && globalContainer->replayWriter->isKeyframeDue())
+						globalContainer->replayWriter->pushKeyframe(gui);
 				}
 			}
 
@@ -504,15 +567,28 @@ int Engine::run(void)
 					printf("nox::gui.game.checkSum() = %08x\n", gui.game.checkSum());
 				}
 			}
+			if(!globalContainer->runNoX && nextGuiStep == 0)
+			{
+				// we draw
+				gui.drawAll(gui.localTeamNo);
+				globalContainer->gfx->nextFrame();
+			}
+
+			// Start computing the ai orders needed by the next frame, they will see the same game
+			// state as if they were computed there. Nothing reads the game, the map or the AIs until
+			// the batch is joined: at the start of the next frame, or before drawing interpolated frames.
+			// A save would record the AIs one batch ahead and miss their orders, so there is no batch
+			// before a step that may save the game.
+			if (globalContainer->asyncAI && gui.isRunning && !gui.hardPause && !gui.maySaveGame())
+			{
+				for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
+					if (gui.game.players[i]->ai && !net->orderRecieved(i) && !asyncAI.hasOrder(i))
+						asyncAI.addJob(i, gui.game.players[i]->ai);
+				asyncAI.start(gui.gamePaused);
+			}
+
 			if(!globalContainer->runNoX)
 			{
-				if (nextGuiStep == 0)
-				{
-					// we draw
-					gui.drawAll(gui.localTeamNo);
-					globalContainer->gfx->nextFrame();
-				}
-				
 				// if required, save videoshot
 				if (!(globalContainer->videoshotName.empty()) && 
 					!(globalContainer->gfx->getOptionFlags() & GraphicContext::USEGPU)
@@ -534,7 +610,19 @@ int Engine::run(void)
 
 				//Any inconsistancies in the delays will be smoothed throughout the following frames,
 				Sint32 delay = std::max(0, needToBeTime - currentTime);
-				SDL_Delay(delay);
+				// Use the spare time to draw the units on their way to the next step
+				if (globalContainer->interpolateFrames && nextGuiStep == 0 && networkReadyToExecute &&
+				    !gui.gamePaused && !gui.hardPause &&
+				    !(globalContainer->replaying && globalContainer->replayFastForward))
+				{
+					// drawing reads the gradients that the AIs compute lazily
+					asyncAI.wait();
+					drawInterpolatedFrames(needToBeTime, speed, startTime);
+					currentTime = SDL_GetTicks() - startTime;
+					SDL_Delay(std::max(0, needToBeTime - currentTime));
+				}
+				else
+					SDL_Delay(delay);
 				
 				// we set CPU stats
 //				net->setLeftTicks(computationAvailableTicks);//We may have to tell others IP players to wait for our slow computer.
@@ -559,6 +647,7 @@ int Engine::run(void)
 				break;
 			}
 		}
+		asyncAI.clear();
 
 		if(globalContainer->automaticEndingGame)
 		{
@@ -566,6 +655,12 @@ int Engine::run(void)
 			int seconds = (time / 25) % 60;
 			int minutes = (time / 25) / 60;
 			std::cout<< "automaticEndingGame ended: "<<time<<" ticks, "<<minutes<<" minutes, "<<seconds<<" seconds"<<std::endl;
+			for (int i=0; i<gui.game.gameHeader.getNumberOfPlayers(); i++)
+			{
+				AI *ai = gui.game.players[i]->ai;
+				if (ai && ai->thinkCount)
+					printf("nox::ai of player %d (%s): %d orders, %d ms total, %d us mean, %d us max\n", i, AI::getAIText(ai->implementitionID).c_str(), ai->thinkCount, (int)(ai->thinkTimeTotal/1000), (int)(ai->thinkTimeTotal/ai->thinkCount), ai->thinkTimeMax);
+			}
 		}
 
 		cpuStats.format();
@@ -865,7 +960,7 @@ MapHeader Engine::chooseRandomMap()
 
 
 
-GameHeader Engine::createRandomGame(int numberOfTeams)
+GameHeader Engine::createRandomGame(int numberOfTeams, AI::ImplementitionID aiType)
 {
 	GameHeader gameHeader;
 	int count = 0;
@@ -878,7 +973,9 @@ GameHeader Engine::createRandomGame(int numberOfTeams)
 		}
 		else
 		{
-			AI::ImplementitionID iid=static_cast<AI::ImplementitionID>(syncRand() % 5 + 1);
+			AI::ImplementitionID iid=aiType;
+			if (iid==AI::NONE)
+				iid=static_cast<AI::ImplementitionID>(syncRand() % 5 + 1);
 			FormatableString name("%0 %1");
 			name.arg(AINames::getAIText(iid)).arg(i-1);
 			gameHeader.getBasePlayer(count) = BasePlayer(i, name.c_str(), teamColor, Player::playerTypeFromImplementitionID(iid));
@@ -939,15 +1036,142 @@ int Engine::loadReplay(const std::string &fileName)
 	else if(ret == -1)
 		return -1;
 
+	// If the progress bar was clicked, go to that step, starting from the closest keyframe
+	if (globalContainer->replaySeekStep)
+	{
+		Uint32 targetStep = globalContainer->replaySeekStep;
+		globalContainer->replaySeekStep = 0;
+		if (!restoreReplayKeyframe(targetStep))
+		{
+			// Start again from the beginning of the replay
+			if (!gui.loadFromHeaders(mapHeader, gameHeader, true, false, true))
+				return EE_CANT_LOAD_MAP;
+			gui.game.clearingUncontrolledTeams();
+			finalAdjustements();
+		}
+		fastForwardReplay(targetStep);
+	}
+
 	return EE_NO_ERROR;
 }
 
-void Engine::finalAdjustements(void)
+bool Engine::restoreReplayKeyframe(Uint32 targetStep)
+{
+	ReplayReader *reader = globalContainer->replayReader;
+	int keyframe = reader->findKeyframe(targetStep);
+	if (keyframe < 0)
+		return true;
+
+	InputStream *stream = reader->openKeyframe(keyframe);
+	if (stream == NULL)
+		return true;
+
+	Uint32 checksum = stream->readUint32("checksum");
+	std::istringstream randomState(stream->readText("syncRandState"));
+	bool loaded = false;
+	try
+	{
+		// The caches come after the game, a loaded game only plays on like the saved one with them
+		loaded = gui.load(stream, true) && gui.game.loadCaches(stream);
+	}
+	catch (std::exception &e)
+	{
+		loaded = false;
+	}
+	delete stream;
+
+	// The keyframe is only usable if it gives back exactly the game that was played
+	if (!loaded || gui.game.checkSum(NULL, NULL, NULL) != checksum)
+	{
+		std::cerr << "Engine::restoreReplayKeyframe : can't use the keyframe at step " << reader->getKeyframeStep(keyframe) << std::endl;
+		return false;
+	}
+	randomState >> randomGenerator;
+
+	// As in loadReplay(), the orders only come from the replay
+	for (int p=0; p<gui.game.gameHeader.getNumberOfPlayers(); p++)
+	{
+		gui.game.players[p]->makeItAI(AI::NONE);
+		gui.game.gameHeader.getBasePlayer(p).makeItAI(AI::NONE);
+	}
+	// The alliances may have been changed by orders since the start, the keyframe has them
+	finalAdjustements(false);
+
+	reader->jumpToKeyframe(keyframe);
+	return true;
+}
+
+void Engine::fastForwardReplay(Uint32 targetStep)
+{
+	ReplayReader *reader = globalContainer->replayReader;
+	assert(reader);
+
+	// This is what run() does for each step of a replay, without the network and the drawing
+	while (reader->getCurrentStep() < targetStep && !reader->isFinished())
+	{
+		while (reader->hasMoreOrdersThisStep())
+		{
+			shared_ptr<Order> order = reader->retrieveOrder();
+
+			if (order->getOrderType() != ORDER_PLAYER_QUIT_GAME &&
+			    order->getOrderType() != ORDER_PAUSE_GAME &&
+			    order->getOrderType() != ORDER_NULL)
+			{
+				gui.executeOrder(order);
+			}
+		}
+
+		reader->advanceStep();
+		gui.game.syncStep(gui.localTeamNo);
+	}
+}
+
+void Engine::drawInterpolatedFrames(Sint32 needToBeTime, int speed, Sint32 startTime)
+{
+	// Do not draw faster than this, the remaining time is given back to the system
+	const Sint32 minFrameTicks = 10;
+	Sint32 drawTicks = minFrameTicks;
+
+	while (true)
+	{
+		Sint32 currentTime = SDL_GetTicks() - startTime;
+		Sint32 timeLeft = needToBeTime - currentTime;
+		// Only draw if the frame will be done before the next step is due
+		if (timeLeft <= std::max(minFrameTicks, drawTicks))
+			break;
+
+		// 0 is the step that was just computed, 256 would be the next one
+		Sint32 progress = ((speed - timeLeft) << 8) / speed;
+		gui.game.drawStepProgress = std::max(1, std::min(255, progress));
+		gui.drawAll(gui.localTeamNo);
+		globalContainer->gfx->nextFrame();
+
+		drawTicks = (SDL_GetTicks() - startTime) - currentTime;
+		if (drawTicks < minFrameTicks)
+			SDL_Delay(minFrameTicks - drawTicks);
+	}
+	gui.game.drawStepProgress = 0;
+}
+
+void Engine::setCheckSumTrace(std::vector<Uint32> *trace, const std::vector<Uint32> *reference)
+{
+	checkSumTrace = trace;
+	checkSumReference = reference;
+}
+
+void Engine::finalAdjustements(bool setAlliances)
 {
 	gui.adjustLocalTeam();
 	if (!globalContainer->runNoX)
 	{
 		gui.adjustInitialViewport();
+		
+		// Create team-colored sprites now rather than on their first draw
+		std::vector<Color> teamColors;
+		for (int t=0; t<gui.game.mapHeader.getNumberOfTeams(); t++)
+			teamColors.push_back(gui.game.teams[t]->color);
+		Toolkit::prepareSpritesBaseColors(teamColors);
 	}
-	gui.game.setAlliances();
+	if (setAlliances)
+		gui.game.setAlliances();
 }
@@ -25,12 +25,14 @@
 #include "Header.h"
 #include "GameGUI.h"
 #include <string>
+#include <vector>
 #include "Campaign.h"
 #include "MapHeader.h"
 #include "GameHeader.h"
 #include "NetEngine.h"
 #include "MultiplayerGame.h"
 #include "CPUStatisticsManager.h"
+#include "AsyncAIRunner.h"
 
 
 class MultiplayersJoin;
@@ -70,8 +72,16 @@ public:
 	//! This function creates a game with a random map and random AI for every team
 	void createRandomGame();
 
+	/// Initiates a game on the given map where every team is played by AIWarrush, with a fixed random seed,
+	/// so that runs can be timed against each other
+	int initWarBenchmark(const std::string &mapFileName);
+
 	/// Load a replay
 	int loadReplay(const std::string &fileName);
+
+	/// Restores the game from the last keyframe of the replay at or before targetStep, if there is one.
+	/// Returns false if the keyframe was unusable; the game is then in an undefined state and must be reloaded.
+	bool restoreReplayKeyframe(Uint32 targetStep);
 	
 	///Tells whether a map matching mapHeader is located on this system
 	bool haveMap(const MapHeader& mapHeader);
@@ -79,6 +89,13 @@ public:
 	//! Run game. A valid gui and netGame must exists
 	int run();
 
+	/// If trace isn't NULL, run() stores in it the game's checksum after every step, indexed by step.
+	/// If reference isn't NULL, run() stops as soon as the checksum differs from the one in reference at the same step.
+	void setCheckSumTrace(std::vector<Uint32> *trace, const std::vector<Uint32> *reference = NULL);
+
+	/// Returns the game, for tools that inspect it once run() has returned
+	Game &getGame() { return gui.game; }
+
 	//! Type of error the engine init function can return
 	enum EngineError
 	{
@@ -115,14 +132,22 @@ private:
 
 	//! Load a game. Return true on success
 	bool loadGame(const std::string &filename);
-	//! Do the final adjustements, like setting local teams and viewport, rendering minimap
-	void finalAdjustements(void);
+	//! Do the final adjustements, like setting local teams and viewport, rendering minimap.
+	//! The alliances are set from the game header, unless setAlliances is false.
+	void finalAdjustements(bool setAlliances = true);
+
+	/// Plays the replay without drawing anything until targetStep is reached
+	void fastForwardReplay(Uint32 targetStep);
+	/// Spends the time left until needToBeTime drawing frames where the units move between their
+	/// current and next positions. Only the drawing is interpolated, the game state is left untouched
+	void drawInterpolatedFrames(Sint32 needToBeTime, int speed, Sint32 startTime);
 
 	///This function will choose a random map from the available maps
 	MapHeader chooseRandomMap();
 	
-	///This function prepares a random set of AI's in a GameHeader, first player is always human + ai team
-	GameHeader createRandomGame(int numberOfTeams);
+	///This function prepares a random set of AI's in a GameHeader, first player is always human + ai team.
+	///If aiType isn't AI::NONE, all AI's are of this type
+	GameHeader createRandomGame(int numberOfTeams, AI::ImplementitionID aiType = AI::NONE);
 
 	//! The GUI, contains the whole game also
 	GameGUI gui;
@@ -132,9 +157,16 @@ private:
 	shared_ptr<MultiplayerGame> multiplayer;
 
 	CPUStatisticsManager cpuStats;
+	//! Computes the AI orders on a worker thread when globalContainer->asyncAI is set
+	AsyncAIRunner asyncAI;
 
 	Sint32 automaticGameStartTick, automaticGameEndTick;
 
+	//! Checksums of the game after every step, see setCheckSumTrace()
+	std::vector<Uint32> *checkSumTrace;
+	//! Checksums to compare the game with, see setCheckSumTrace()
+	const std::vector<Uint32> *checkSumReference;
+
 	FILE *logFile;
 
 	static const bool verbose = false;
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "FixedSizePool.h"
+#include <new>
+#include <assert.h>
+
+// every element is aligned as strictly as anything operator new may return
+static const size_t POOL_ALIGNMENT = 16;
+
+FixedSizePool::FixedSizePool(size_t elementSize, size_t elementsPerSlab)
+{
+	requestedSize = elementSize;
+	if (elementSize < sizeof(FreeElement))
+		elementSize = sizeof(FreeElement);
+	this->elementSize = (elementSize + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+	this->elementsPerSlab = elementsPerSlab;
+	freeList = NULL;
+	allocatedCount = 0;
+}
+
+void FixedSizePool::grow()
+{
+	char *slab = static_cast<char *>(::operator new(elementSize * elementsPerSlab));
+	slabs.push_back(slab);
+	// link the elements so that they are handed out in address order
+	for (size_t i = elementsPerSlab; i > 0; i--)
+	{
+		FreeElement *element = reinterpret_cast<FreeElement *>(slab + (i - 1) * elementSize);
+		element->next = freeList;
+		freeList = element;
+	}
+}
+
+void *FixedSizePool::allocate(size_t size)
+{
+	if (size != requestedSize)
+		return ::operator new(size);
+	if (freeList == NULL)
+		grow();
+	FreeElement *element = freeList;
+	freeList = element->next;
+	allocatedCount++;
+	return element;
+}
+
+void FixedSizePool::release(void *p, size_t size)
+{
+	if (p == NULL)
+		return;
+	if (size != requestedSize)
+	{
+		::operator delete(p);
+		return;
+	}
+	assert(allocatedCount > 0);
+	FreeElement *element = static_cast<FreeElement *>(p);
+	element->next = freeList;
+	freeList = element;
+	allocatedCount--;
+}
@@ -0,0 +1,88 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __FIXED_SIZE_POOL_H
+#define __FIXED_SIZE_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+///This allocates objects of one size from big slabs, and keeps freed objects in a list
+///to reuse them. Objects never move, and the slabs are only returned to the system when
+///the program ends. This is meant to be used from the operator new and operator delete
+///of classes that are created and destroyed very often during a game, such as Unit,
+///Building or Bullet. It is not thread safe, allocations must happen in the game thread.
+class FixedSizePool
+{
+public:
+	///Creates a pool for objects of elementSize bytes, getting elementsPerSlab objects at once from the system
+	FixedSizePool(size_t elementSize, size_t elementsPerSlab=256);
+
+	///Returns memory for an object of size bytes. Sizes other than the one of the pool, for instance
+	///of derived classes, are forwarded to the global operator new.
+	void *allocate(size_t size);
+	///Gives back memory returned by allocate(size)
+	void release(void *p, size_t size);
+
+	///Returns the number of objects currently allocated from the pool
+	size_t getAllocatedCount() const { return allocatedCount; }
+	///Returns the number of bytes the pool got from the system
+	size_t getReservedSize() const { return slabs.size() * elementsPerSlab * elementSize; }
+
+private:
+	///Gets a new slab from the system and adds its objects to the free list
+	void grow();
+
+	struct FreeElement
+	{
+		FreeElement *next;
+	};
+
+	size_t requestedSize;
+	size_t elementSize;
+	size_t elementsPerSlab;
+	FreeElement *freeList;
+	std::vector<char *> slabs;
+	size_t allocatedCount;
+};
+
+///Declares a class specific operator new and operator delete using a FixedSizePool
+#define DECLARE_POOLED_ALLOCATION \
+	static void *operator new(size_t size); \
+	static void operator delete(void *p, size_t size); \
+	static FixedSizePool &getPool(void);
+
+///Defines the operator new and operator delete declared by DECLARE_POOLED_ALLOCATION in className.
+///The pool is created on first use, so objects can be allocated during static initialisation.
+#define DEFINE_POOLED_ALLOCATION(className) \
+	FixedSizePool &className::getPool(void) \
+	{ \
+		static FixedSizePool *pool = new FixedSizePool(sizeof(className)); \
+		return *pool; \
+	} \
+	void *className::operator new(size_t size) \
+	{ \
+		return getPool().allocate(size); \
+	} \
+	void className::operator delete(void *p, size_t size) \
+	{ \
+		getPool().release(p, size); \
+	}
+
+#endif
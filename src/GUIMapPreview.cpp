@@ -28,7 +28,10 @@
 using namespace GAGCore;
 
 #include "GUIMapPreview.h"
+#include "GlobalContainer.h"
 #include "Map.h"
+#include "MapHeader.h"
+#include "MapInfoCache.h"
 #include "Utilities.h"
 
 MapPreview::MapPreview(int x, int y, Uint32 hAlign, Uint32 vAlign)
@@ -80,7 +83,9 @@ bool MapPreview::isThumbnailLoaded()
 void MapPreview::setMapThumbnail(const std::string& mapName)
 {
 	MapThumbnail *n = new MapThumbnail();
-	n->loadFromMap(mapName);
+	MapHeader header;
+	if (!mapName.empty())
+		globalContainer->mapInfoCache->get(mapName, header, *n);
 	setMapThumbnail(*n);
 	delete n;
 }
@@ -103,6 +108,7 @@ void MapPreview::setMapThumbnail(const MapThumbnail &nthumbnail)
 	{
 		surface = NULL;
 	}
+	invalidate();
 }
 
 
@@ -165,6 +165,7 @@ void Game::clearGame()
 
 	// Clears selections
 	mouseUnit = NULL;
+	drawStepProgress = 0;
 	selectedUnit = NULL;
 	selectedBuilding = NULL;
 
@@ -281,6 +282,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 					{
 						size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
 						map.cases[index].forbidden|=teamMask;
+						map.setAreaGradientSourceChanged(index);
 						if (oc->teamNumber == players[localPlayer]->teamNumber)
 							map.localForbiddenMap.set(index, true);
 					}
@@ -293,7 +295,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderModifyBuilding> omb=boost::static_pointer_cast<OrderModifyBuilding>(order);
-			Uint16 gid=omb->gid;
+			Uint32 gid=omb->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -314,7 +316,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderModifyExchange> ome=boost::static_pointer_cast<OrderModifyExchange>(order);
-			Uint16 gid=ome->gid;
+			Uint32 gid=ome->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -337,7 +339,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderModifyFlag> omf=boost::static_pointer_cast<OrderModifyFlag>(order);
-			Uint16 gid=omf->gid;
+			Uint32 gid=omf->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -384,7 +386,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderModifyClearingFlag> omcf=boost::static_pointer_cast<OrderModifyClearingFlag>(order);
-			Uint16 gid=omcf->gid;
+			Uint32 gid=omcf->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -433,7 +435,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderMoveFlag> omf=boost::static_pointer_cast<OrderMoveFlag> (order);
-			Uint16 gid=omf->gid;
+			Uint32 gid=omf->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			bool drop=omf->drop;
@@ -486,6 +488,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 		{
 			fprintf(logFile, "ORDER_ALTERATE_FORBIDDEN");
 			boost::shared_ptr<OrderAlterateForbidden> oaa = boost::static_pointer_cast<OrderAlterateForbidden>(order);
+			std::vector<size_t> changedCells;
 			if (oaa->type == BrushTool::MODE_ADD)
 			{
 				Uint32 teamMask = Team::teamNumberToMask(oaa->teamNumber);
@@ -497,6 +500,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (!(map.cases[index].forbidden & teamMask))
+								changedCells.push_back(index);
 							map.cases[index].forbidden |= teamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -516,6 +521,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (map.cases[index].forbidden & ~notTeamMask)
+								changedCells.push_back(index);
 							map.cases[index].forbidden &= notTeamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -530,15 +537,17 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			}
 			else
 				assert(false);
-			map.updateForbiddenGradient(oaa->teamNumber);
-			map.updateGuardAreasGradient(oaa->teamNumber);
-			map.updateClearAreasGradient(oaa->teamNumber);
+			// Only the cells around the changed ones need to be computed again
+			map.updateForbiddenGradient(oaa->teamNumber, changedCells);
+			map.updateGuardAreasGradient(oaa->teamNumber, changedCells);
+			map.updateClearAreasGradient(oaa->teamNumber, changedCells);
 		}
 		break;
 		case ORDER_ALTERATE_GUARD_AREA:
 		{
 			fprintf(logFile, "ORDER_ALTERATE_GUARD_AREA");
 			boost::shared_ptr<OrderAlterateGuardArea> oaa = boost::static_pointer_cast<OrderAlterateGuardArea>(order);
+			std::vector<size_t> changedCells;
 			if (oaa->type == BrushTool::MODE_ADD)
 			{
 				Uint32 teamMask = Team::teamNumberToMask(oaa->teamNumber);
@@ -550,6 +559,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (!(map.cases[index].guardArea & teamMask))
+								changedCells.push_back(index);
 							map.cases[index].guardArea |= teamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -569,6 +580,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (map.cases[index].guardArea & ~notTeamMask)
+								changedCells.push_back(index);
 							map.cases[index].guardArea &= notTeamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -579,13 +592,14 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			}
 			else
 				assert(false);
-			map.updateGuardAreasGradient(oaa->teamNumber);
+			map.updateGuardAreasGradient(oaa->teamNumber, changedCells);
 		}
 		break;
 		case ORDER_ALTERATE_CLEAR_AREA:
 		{
 			fprintf(logFile, "ORDER_ALTERATE_CLEAR_AREA");
 			boost::shared_ptr<OrderAlterateClearArea> oaa = boost::static_pointer_cast<OrderAlterateClearArea>(order);
+			std::vector<size_t> changedCells;
 			if (oaa->type == BrushTool::MODE_ADD)
 			{
 				Uint32 teamMask = Team::teamNumberToMask(oaa->teamNumber);
@@ -597,6 +611,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (!(map.cases[index].clearArea & teamMask))
+								changedCells.push_back(index);
 							map.cases[index].clearArea |= teamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -616,6 +632,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 						{
 							size_t index = (x&map.wMask)+(((y&map.hMask)<<map.wDec));
 							// Update real map
+							if (map.cases[index].clearArea & ~notTeamMask)
+								changedCells.push_back(index);
 							map.cases[index].clearArea &= notTeamMask;
 							// Update local map
 							if (oaa->teamNumber == players[localPlayer]->teamNumber)
@@ -626,7 +644,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			}
 			else
 				assert(false);
-			map.updateClearAreasGradient(oaa->teamNumber);
+			map.updateClearAreasGradient(oaa->teamNumber, changedCells);
 		}
 		break;
 		case ORDER_MODIFY_SWARM:
@@ -634,7 +652,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderModifySwarm> oms=boost::static_pointer_cast<OrderModifySwarm>(order);
-			Uint16 gid=oms->gid;
+			Uint32 gid=oms->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -653,7 +671,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 		break;
 		case ORDER_DELETE:
 		{
-			Uint16 gid=boost::static_pointer_cast<OrderDelete>(order)->gid;
+			Uint32 gid=boost::static_pointer_cast<OrderDelete>(order)->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -673,7 +691,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 		break;
 		case ORDER_CHANGE_PRIORITY:
 		{
-			Uint16 gid=boost::static_pointer_cast<OrderChangePriority>(order)->gid;
+			Uint32 gid=boost::static_pointer_cast<OrderChangePriority>(order)->gid;
 			Sint32 priority=boost::static_pointer_cast<OrderChangePriority>(order)->priority;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
@@ -688,7 +706,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 		break;
 		case ORDER_CANCEL_DELETE:
 		{
-			Uint16 gid=boost::static_pointer_cast<OrderCancelDelete>(order)->gid;
+			Uint32 gid=boost::static_pointer_cast<OrderCancelDelete>(order)->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Building *b=teams[team]->myBuildings[id];
@@ -704,7 +722,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderConstruction> oc = boost::static_pointer_cast<OrderConstruction>(order);
-			Uint16 gid = oc->gid;
+			Uint32 gid = oc->gid;
 
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
@@ -722,7 +740,7 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			if (!isPlayerAlive)
 				break;
 			boost::shared_ptr<OrderConstruction> oc = boost::static_pointer_cast<OrderConstruction>(order);
-			Uint16 gid=oc->gid;
+			Uint32 gid=oc->gid;
 			int team=Building::GIDtoTeam(gid);
 			int id=Building::GIDtoID(gid);
 			Team *t=teams[team];
@@ -743,6 +761,8 @@ void Game::executeOrder(boost::shared_ptr<Order> order, int localPlayer)
 			teams[team]->sharedVisionExchange=sao->visionExchangeMask;
 			teams[team]->sharedVisionFood=sao->visionFoodMask;
 			teams[team]->sharedVisionOther=sao->visionOtherMask;
+			// the guard area gradients avoid allied buildings
+			map.invalidateAreaGradients();
 			fprintf(logFile, "ORDER_SET_ALLIANCE");
 		}
 		break;
@@ -797,6 +817,7 @@ void Game::setAlliances(void)
 			}
 		}
 	}
+	map.invalidateAreaGradients();
 }
 
 bool Game::load(GAGCore::InputStream *stream)
@@ -901,6 +922,9 @@ bool Game::load(GAGCore::InputStream *stream)
 		stream->readLeaveSection();
 		return false;
 	}
+	// The buildings were set while the map was still empty
+	for (int i=0; i<mapHeader.getNumberOfTeams(); ++i)
+		teams[i]->updateTowerCoverageMapSize();
 
 	stream->read(signature, 4, "signatureAfterMap");
 	if (memcmp(signature,"GaMa", 4)!=0)
@@ -1121,6 +1145,118 @@ void Game::save(GAGCore::OutputStream *stream, bool fileIsAMap, const std::strin
 	stream->writeLeaveSection();
 }
 
+void Game::saveCaches(GAGCore::OutputStream *stream)
+{
+	assert(stream);
+	stream->writeEnterSection("GameCaches");
+	stream->write("GaCB", 4, "signatureStart");
+
+	///Save the building projects still waiting for their area to clear
+	stream->writeUint32(buildProjects.size(), "buildProjectsCount");
+	stream->writeEnterSection("buildProjects");
+	Uint32 i = 0;
+	for (std::list<BuildProject>::iterator bpi=buildProjects.begin(); bpi!=buildProjects.end(); ++bpi)
+	{
+		stream->writeEnterSection(i++);
+		stream->writeSint32(bpi->posX, "posX");
+		stream->writeSint32(bpi->posY, "posY");
+		stream->writeSint32(bpi->teamNumber, "teamNumber");
+		stream->writeSint32(bpi->typeNum, "typeNum");
+		stream->writeSint32(bpi->unitWorking, "unitWorking");
+		stream->writeSint32(bpi->unitWorkingFuture, "unitWorkingFuture");
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+
+	///Save the results of the last prestige and winning conditions checks
+	stream->writeSint32(totalPrestige, "totalPrestige");
+	stream->writeUint8(totalPrestigeReached, "totalPrestigeReached");
+	stream->writeUint8(isGameEnded, "isGameEnded");
+
+	///Save teams, then map
+	stream->writeEnterSection("teams");
+	for (int t=0; t<mapHeader.getNumberOfTeams(); ++t)
+	{
+		stream->writeEnterSection(t);
+		teams[t]->saveCaches(stream);
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+	map.saveCaches(stream);
+
+	stream->write("GaCE", 4, "signatureEnd");
+	stream->writeLeaveSection();
+}
+
+bool Game::loadCaches(GAGCore::InputStream *stream)
+{
+	assert(stream);
+	stream->readEnterSection("GameCaches");
+
+	char signature[4];
+	stream->read(signature, 4, "signatureStart");
+	if (memcmp(signature, "GaCB", 4)!=0)
+	{
+		fprintf(logFile, "Signature missmatch at Game::loadCaches begin\n");
+		stream->readLeaveSection();
+		return false;
+	}
+
+	///Load the building projects
+	buildProjects.clear();
+	Uint32 buildProjectsCount = stream->readUint32("buildProjectsCount");
+	stream->readEnterSection("buildProjects");
+	for (Uint32 i=0; i<buildProjectsCount && !stream->isEndOfStream(); i++)
+	{
+		stream->readEnterSection(i);
+		BuildProject buildProject;
+		buildProject.posX = stream->readSint32("posX");
+		buildProject.posY = stream->readSint32("posY");
+		buildProject.teamNumber = stream->readSint32("teamNumber");
+		buildProject.typeNum = stream->readSint32("typeNum");
+		buildProject.unitWorking = stream->readSint32("unitWorking");
+		buildProject.unitWorkingFuture = stream->readSint32("unitWorkingFuture");
+		buildProjects.push_back(buildProject);
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+
+	///Load the results of the last checks
+	totalPrestige = stream->readSint32("totalPrestige");
+	totalPrestigeReached = stream->readUint8("totalPrestigeReached");
+	isGameEnded = stream->readUint8("isGameEnded");
+
+	///Load teams, then map
+	stream->readEnterSection("teams");
+	for (int t=0; t<mapHeader.getNumberOfTeams(); ++t)
+	{
+		stream->readEnterSection(t);
+		if (!teams[t]->loadCaches(stream))
+		{
+			fprintf(logFile, "Game::loadCaches::teams[%d]->loadCaches\n", t);
+			stream->readLeaveSection(3);
+			return false;
+		}
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+	if (!map.loadCaches(stream))
+	{
+		fprintf(logFile, "Game::loadCaches::map.loadCaches\n");
+		stream->readLeaveSection();
+		return false;
+	}
+
+	stream->read(signature, 4, "signatureEnd");
+	stream->readLeaveSection();
+	if (memcmp(signature, "GaCE", 4)!=0)
+	{
+		fprintf(logFile, "Signature missmatch at Game::loadCaches end\n");
+		return false;
+	}
+	return true;
+}
+
 void Game::buildProjectSyncStep(Sint32 localTeam)
 {
 	for (std::list<BuildProject>::iterator bpi=buildProjects.begin(); bpi!=buildProjects.end();)
@@ -1143,6 +1279,7 @@ void Game::buildProjectSyncStep(Sint32 localTeam)
 					size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
 					// Update real map
 					map.cases[index].forbidden&=notTeamMask;
+					map.setAreaGradientSourceChanged(index);
 					// Update local map
 					if (teamNumber == localTeam)
 						map.localForbiddenMap.set(index, false);
@@ -1165,6 +1302,7 @@ void Game::buildProjectSyncStep(Sint32 localTeam)
 						size_t index=(x&map.wMask)+(((y&map.hMask)<<map.wDec));
 						// Update real map
 						map.cases[index].forbidden&=notTeamMask;
+						map.setAreaGradientSourceChanged(index);
 						// Update local map
 						if (teamNumber == localTeam)
 							map.localForbiddenMap.set(index, false);
@@ -1252,7 +1390,7 @@ void Game::syncStep(Sint32 localTeam)
 		{
 			map.switchFogOfWar();
 			for (int t=0; t<mapHeader.getNumberOfTeams(); t++)
-				for (int i=0; i<Building::MAX_COUNT; i++)
+				for (int i=teams[t]->buildingSlots.first(); i!=-1; i=teams[t]->buildingSlots.next(i))
 				{
 					Building *b=teams[t]->myBuildings[i];
 					if (b)
@@ -1407,7 +1545,7 @@ void Game::regenerateDiscoveryMap(void)
 	map.unsetMapDiscovered();
 	for (int t=0; t<mapHeader.getNumberOfTeams(); t++)
 	{
-		for (int i=0; i<Unit::MAX_COUNT; i++)
+		for (int i=teams[t]->unitSlots.first(); i!=-1; i=teams[t]->unitSlots.next(i))
 		{
 			Unit *u=teams[t]->myUnits[i];
 			if (u)
@@ -1415,7 +1553,7 @@ void Game::regenerateDiscoveryMap(void)
 				map.setMapDiscovered(u->posX-1, u->posY-1, 3, 3, teams[t]->sharedVisionOther);
 			}
 		}
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		for (int i=teams[t]->buildingSlots.first(); i!=-1; i=teams[t]->buildingSlots.next(i))
 		{
 			Building *b=teams[t]->myBuildings[i];
 			if (b)
@@ -1444,24 +1582,18 @@ Unit *Game::addUnit(int x, int y, int team, Sint32 typeNum, int level, int delta
 	if (!free)
 		return NULL;
 
-	int id=-1;
-	for (int i=0; i<Unit::MAX_COUNT; i++)//we search for a free place for a unit.
-		if (teams[team]->myUnits[i]==NULL)
-		{
-			id=i;
-			break;
-		}
+	int id=teams[team]->getFreeUnitId();//we search for a free place for a unit.
 	if (id==-1)
 		return NULL;
 
 	//ok, now we can safely deposite an unit.
-	int gid=Unit::GIDfrom(id, team);
+	Uint32 gid=Unit::GIDfrom(id, team);
 	if (fly)
 		map.setAirUnit(x, y, gid);
 	else
 		map.setGroundUnit(x, y, gid);
 
-	teams[team]->myUnits[id]= new Unit(x, y, gid, typeNum, teams[team], level);
+	teams[team]->setUnit(id, new Unit(x, y, gid, typeNum, teams[team], level));
 	teams[team]->myUnits[id]->dx=dx;
 	teams[team]->myUnits[id]->dy=dy;
 	teams[team]->myUnits[id]->directionFromDxDy();
@@ -1475,13 +1607,7 @@ Building *Game::addBuilding(int x, int y, int typeNum, int teamNumber, Sint32 un
 	Team *team=teams[teamNumber];
 	assert(team);
 
-	int id=-1;
-	for (int i=0; i<Building::MAX_COUNT; i++)//we search for a free place for a building.
-		if (team->myBuildings[i]==NULL)
-		{
-			id=i;
-			break;
-		}
+	int id=team->getFreeBuildingId();//we search for a free place for a building.
 	if (id==-1)
 	{
 		//TODO:Building limit reached!
@@ -1489,7 +1615,7 @@ Building *Game::addBuilding(int x, int y, int typeNum, int teamNumber, Sint32 un
 	}
 
 	//ok, now we can safely deposite an building.
-	int gid=Building::GIDfrom(id, teamNumber);
+	Uint32 gid=Building::GIDfrom(id, teamNumber);
 
 	int w=globalContainer->buildingsTypes.get(typeNum)->width;
 	int h=globalContainer->buildingsTypes.get(typeNum)->height;
@@ -1502,7 +1628,7 @@ Building *Game::addBuilding(int x, int y, int typeNum, int teamNumber, Sint32 un
 		team->virtualBuildings.push_front(b);
 	else
 		map.setBuilding(x, y, w, h, gid);
-	team->myBuildings[id]=b;
+	team->setBuilding(id, b);
 	return b;
 }
 
@@ -1511,33 +1637,33 @@ bool Game::removeUnitAndBuildingAndFlags(int x, int y, unsigned flags)
 	bool found=false;
 	if (flags & DEL_GROUND_UNIT)
 	{
-		Uint16 gauid=map.getAirUnit(x, y);
+		Uint32 gauid=map.getAirUnit(x, y);
 		if (gauid!=NOGUID)
 		{
 			int id=Unit::GIDtoID(gauid);
 			int team=Unit::GIDtoTeam(gauid);
 			map.setAirUnit(x, y, NOGUID);
 			delete (teams[team]->myUnits[id]);
-			teams[team]->myUnits[id]=NULL;
+			teams[team]->setUnit(id, NULL);
 			found=true;
 		}
 	}
 	if (flags & DEL_AIR_UNIT)
 	{
-		Uint16 gguid=map.getGroundUnit(x, y);
+		Uint32 gguid=map.getGroundUnit(x, y);
 		if (gguid!=NOGUID)
 		{
 			int id=Unit::GIDtoID(gguid);
 			int team=Unit::GIDtoTeam(gguid);
 			map.setGroundUnit(x, y, NOGUID);
 			delete (teams[team]->myUnits[id]);
-			teams[team]->myUnits[id]=NULL;
+			teams[team]->setUnit(id, NULL);
 			found=true;
 		}
 	}
 	if (flags & DEL_BUILDING)
 	{
-		Uint16 gbid=map.getBuilding(x, y);
+		Uint32 gbid=map.getBuilding(x, y);
 		if (gbid!=NOGBID)
 		{
 			int id=Building::GIDtoID(gbid);
@@ -1546,7 +1672,7 @@ bool Game::removeUnitAndBuildingAndFlags(int x, int y, unsigned flags)
 			if (!b->type->isVirtual)
 				map.setBuilding(b->posX, b->posY, b->type->width, b->type->height, NOGBID);
 			delete b;
-			teams[team]->myBuildings[id]=NULL;
+			teams[team]->setBuilding(id, NULL);
 			found=true;
 		}
 	}
@@ -1557,7 +1683,7 @@ bool Game::removeUnitAndBuildingAndFlags(int x, int y, unsigned flags)
 				if ((*bi)->posX==x && (*bi)->posY==y)
 				{
 					teams[ti]->virtualBuildings.erase(bi);
-					teams[ti]->myBuildings[Building::GIDtoID((*bi)->gid)]=NULL;
+					teams[ti]->setBuilding(Building::GIDtoID((*bi)->gid), NULL);
 					delete *bi;
 					found=true;
 					break;
@@ -1652,7 +1778,7 @@ bool Game::checkHardRoomForBuilding(int x, int y, const BuildingType *bt)
 
 
 
-Unit* Game::getUnit(int guid)
+Unit* Game::getUnit(Uint32 guid)
 {
 	if(guid == NOGUID)
 		return NULL;
@@ -1731,7 +1857,7 @@ void Game::drawPointBar(int x, int y, BarOrientation orientation, int maxLength,
 		assert(false);
 }
 
-void Game::drawUnit(int x, int y, Uint16 gid, int viewportX, int viewportY, int screenW, int screenH, int localTeam, Uint32 drawOptions)
+void Game::drawUnit(int x, int y, Uint32 gid, int viewportX, int viewportY, int screenW, int screenH, int localTeam, Uint32 drawOptions)
 {
 	int id=Unit::GIDtoID(gid);
 	int team=Unit::GIDtoTeam(gid);
@@ -1758,7 +1884,12 @@ void Game::drawUnit(int x, int y, Uint16 gid, int viewportX, int viewportY, int
 	imgid=unit->skin->startImage[unit->action];
 	int px, py;
 	map.mapCaseToDisplayable(unit->posX, unit->posY, &px, &py, viewportX, viewportY);
-	int deltaLeft=255-unit->delta;
+	// On frames drawn between two steps, advance the unit by the part of
+	// its speed that corresponds to the elapsed fraction of the step
+	int delta=unit->delta;
+	if (drawStepProgress)
+		delta=std::min(255, delta+((unit->speed*drawStepProgress)>>8));
+	int deltaLeft=255-delta;
 	if (unit->action<BUILD)
 	{
 		px-=(unit->dx*deltaLeft)>>3;
@@ -1770,7 +1901,6 @@ void Game::drawUnit(int x, int y, Uint16 gid, int viewportX, int viewportY, int
 	}
 
 	int dir=unit->direction;
-	int delta=unit->delta;
 	assert(dir>=0);
 	assert(dir<9);
 	assert(delta>=0);
@@ -1977,7 +2107,7 @@ inline void Game::drawMapGroundUnits(int left, int top, int right, int bot, int
 	for (int y=top-1; y<=bot; y++)
 		for (int x=left-1; x<=right; x++)
 		{
-			Uint16 gid=map.getGroundUnit(x+viewportX, y+viewportY);
+			Uint32 gid=map.getGroundUnit(x+viewportX, y+viewportY);
 			if (gid!=NOGUID)
 				drawUnit(x, y, gid, viewportX, viewportY, (sw>>5), (sh>>5), localTeam, drawOptions);
 		}
@@ -2107,7 +2237,7 @@ inline void Game::drawMapBuilding(int x, int y, int gid, int viewportX, int view
 	if (type->crossConnectMultiImage)
 	{
 		int add = 0;
-		Uint16 b;
+		Uint32 b;
 		// Up
 		b = map.getBuilding(building->posXLocal, building->posYLocal-1);
 		if ((b != NOGBID) &&
@@ -2277,7 +2407,7 @@ inline void Game::drawMapGroundBuildings(int left, int top, int right, int bot,
 	for (int y=top-1; y<=bot; y++)
 		for (int x=left-1; x<=right; x++)
 		{
-			Uint16 gid=map.getBuilding(x+viewportX, y+viewportY);
+			Uint32 gid=map.getBuilding(x+viewportX, y+viewportY);
 			if (gid!=NOGBID) // Then this is a building
 			{
 				//globalContainer->gfx->drawRect(x<<5, y<<5, 32, 32, 255, 128, 0);
@@ -2394,7 +2524,7 @@ inline void Game::drawMapAirUnits(int left, int top, int right, int bot, int sw,
 	for (int y=top-1; y<=bot; y++)
 		for (int x=left-1; x<=right; x++)
 		{
-			Uint16 gid=map.getAirUnit(x+viewportX, y+viewportY);
+			Uint32 gid=map.getAirUnit(x+viewportX, y+viewportY);
 			if (gid!=NOGUID)
 				drawUnit(x, y, gid, viewportX, viewportY, (sw>>5), (sh>>5), localTeam, drawOptions);
 		}
@@ -2611,7 +2741,7 @@ inline void Game::drawUnitPathLines(int left, int top, int right, int bot, int s
 {
 	if ((drawOptions & DRAW_PATH_LINE) != 0)
 	{
-		for(int i=0; i<Unit::MAX_COUNT; ++i)
+		for(int i=teams[localTeam]->unitSlots.first(); i!=-1; i=teams[localTeam]->unitSlots.next(i))
 		{
 			Unit *unit=teams[localTeam]->myUnits[i];
 			if (unit)
@@ -2819,7 +2949,10 @@ void Game::drawMap(int sx, int sy, int sw, int sh, int righMargin, int topMargin
 	int right=((sx+sw+31)>>5);
 	int bot=((sy+sh+31)>>5);
 
-	time++;
+	// Only frames drawn on a game step advance the animations, so that the
+	// water keeps its pace when extra frames are drawn in between
+	if (drawStepProgress == 0)
+		time++;
 	drawMapWater(sw, sh, viewportX, viewportY, time);
 	drawMapTerrain(left, top, right, bot, viewportX, viewportY, localTeam, drawOptions);
 	drawMapRessources(left, top, right, bot, viewportX, viewportY, localTeam, drawOptions);
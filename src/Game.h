@@ -65,6 +65,13 @@ public:
 	///Saves data to a stream
 	void save(GAGCore::OutputStream *stream, bool fileIsAMap, const std::string& name);
 
+	///Saves what save() leaves out because load() computes it again, but differently than the
+	///steps played since, such as the gradients. With it, a loaded game plays on exactly like
+	///the saved one, which replay keyframes need.
+	void saveCaches(GAGCore::OutputStream *stream);
+	///Loads what saveCaches() saved, after load() for the same game
+	bool loadCaches(GAGCore::InputStream *stream);
+
 	enum FlagForRemoval
 	{
 		DEL_BUILDING=0x1,
@@ -138,14 +145,14 @@ public:
 	bool removeUnitAndBuildingAndFlags(int x, int y, unsigned flags=DEL_UNIT|DEL_BUILDING|DEL_FLAG);
 	bool removeUnitAndBuildingAndFlags(int x, int y, int size, unsigned flags=DEL_UNIT|DEL_BUILDING|DEL_FLAG);
 	///A convenience function, returns a pointer to the unit with the guid, or NULL otherwise
-	Unit* getUnit(int guid);
+	Unit* getUnit(Uint32 guid);
 
 	bool checkRoomForBuilding(int mousePosX, int mousePosY, const BuildingType *bt, int *buildingPosX, int *buildingPosY, int teamNumber, bool checkFow=true);
 	bool checkRoomForBuilding(int x, int y, const BuildingType *bt, int teamNumber, bool checkFow=true);
 	bool checkHardRoomForBuilding(int coordX, int coordY, const BuildingType *bt, int *mapX, int *mapY);
 	bool checkHardRoomForBuilding(int x, int y, const BuildingType *bt);
 
-	void drawUnit(int x, int y, Uint16 gid, int viewportX, int viewportY, int screenW, int screenH, int localTeam, Uint32 drawOptions);
+	void drawUnit(int x, int y, Uint32 gid, int viewportX, int viewportY, int screenW, int screenH, int localTeam, Uint32 drawOptions);
 	void drawMap(int sx, int sy, int sw, int sh, int righMargin, int topMargin, int viewportX, int viewportY, int teamSelected, Uint32 drawOptions = 0, std::set<Building*> *visibleBuildings = 0);
 
 	///Sets the mask respresenting which players the game is waiting on
@@ -251,6 +258,8 @@ public:
 	Unit *mouseUnit;
 	Unit *selectedUnit;
 	Building *selectedBuilding;
+	//! Fraction (0-255) of the current step elapsed when drawing between two steps, 0 on step frames. Never used by the simulation
+	int drawStepProgress;
 
 	Uint32 stepCounter;
 	int totalPrestige;
@@ -61,6 +61,9 @@
 #define TYPING_INPUT_BASE_INC 7
 #define TYPING_INPUT_MAX_POS 46
 
+// the game is autosaved when the step counter modulo 256 has this value
+#define AUTOSAVE_STEP 79
+
 // these values are manually layouted for cuteste perception
 #define YPOS_BASE_DEFAULT 180
 #define YPOS_BASE_CONSTRUCTION (YPOS_BASE_DEFAULT + 5)
@@ -319,7 +322,7 @@ void GameGUI::moveFlag(int mx, int my, bool drop)
 		||(selBuild->posYLocal!=posY)
 		||(drop && (selectionPushedPosX!=posX || selectionPushedPosY!=posY)))
 	{
-		Uint16 gid=selBuild->gid;
+		Uint32 gid=selBuild->gid;
 		shared_ptr<OrderMoveFlag> oms(new OrderMoveFlag(gid, posX, posY, drop));
 		// First, we check if anoter move of the same flag is already in the "orderQueue".
 		bool found=false;
@@ -635,7 +638,7 @@ void GameGUI::syncStep(void)
 	assert(localTeam);
 	assert(teamStats);
 
-	if ((game.stepCounter&255) == 79)
+	if ((game.stepCounter&255) == AUTOSAVE_STEP)
 	{
 		const std::string name = Toolkit::getStringTable()->getString("[auto save]");
 		std::string fileName = glob2NameToFilename("games", name, "game");
@@ -652,6 +655,11 @@ void GameGUI::syncStep(void)
 	}
 }
 
+bool GameGUI::maySaveGame(void) const
+{
+	return ((game.stepCounter&255) == AUTOSAVE_STEP) || (inGameMenu != IGM_NONE);
+}
+
 bool GameGUI::processScrollableWidget(SDL_Event *event)
 {
 	scrollableText->translateAndProcessEvent(event);
@@ -1954,7 +1962,7 @@ void GameGUI::handleMapClick(int mx, int my, int button)
 		else 
 		{
 			// then for building
-			Uint16 gbid=game.map.getBuilding(mapX, mapY);
+			Uint32 gbid=game.map.getBuilding(mapX, mapY);
 			if (gbid != NOGBID)
 			{
 				int buildingTeam=Building::GIDtoTeam(gbid);
@@ -2561,6 +2569,26 @@ void GameGUI::handleReplayProgressBarClick(int mx, int my, int button)
 				gamePaused = false;
 				globalContainer->replayFastForward = true;
 			}
+
+			// Jump to the step that was clicked on the progress bar
+			int barX = REPLAY_PROGRESS_BAR_X_OFFSET + REPLAY_PROGRESS_BAR_CAP_WIDTH - 1;
+			int barWidth = REPLAY_BAR_WIDTH - 2*REPLAY_PROGRESS_BAR_X_OFFSET - REPLAY_PROGRESS_BAR_NUM_BUTTONS * REPLAY_PROGRESS_BAR_BUTTON_WIDTH - 2*REPLAY_PROGRESS_BAR_CAP_WIDTH + 2;
+			if (mx >= barX && mx < barX + barWidth && !flushOutgoingAndExit)
+			{
+				ReplayReader *reader = globalContainer->replayReader;
+				Uint32 targetStep = (Uint32)(((Uint64)(mx - barX) * reader->getNumStepsTotal()) / barWidth);
+				globalContainer->replaySeekStep = targetStep;
+
+				// Going backwards, or forward past a keyframe, is done by loading the replay again (see Engine::loadReplay).
+				// Otherwise the engine simply plays the replay up to the target step.
+				int keyframe = reader->findKeyframe(targetStep);
+				if (targetStep < reader->getCurrentStep() || (keyframe >= 0 && reader->getKeyframeStep(keyframe) > reader->getCurrentStep()))
+				{
+					toLoadGameFileName = globalContainer->replayFileName;
+					orderQueue.push_back(shared_ptr<Order>(new PlayerQuitsGameOrder(localPlayer)));
+					flushOutgoingAndExit=true;
+				}
+			}
 		}
 	}
 }
@@ -2580,29 +2608,34 @@ boost::shared_ptr<Order> GameGUI::getOrder(void)
 
 void GameGUI::drawParticles(void)
 {
+	// frames drawn between two steps keep the particles still
+	const bool advance = (game.drawStepProgress == 0);
 	for (ParticleSet::iterator it = particles.begin(); it != particles.end(); )
 	{
 		Particle* p = *it;
 		
-		// delete old particles
-		if (p->age >= p->lifeSpan)
+		if (advance)
 		{
-			ParticleSet::iterator oldIt = it;
-			++it;
-			
-			delete *oldIt;
-			particles.erase(oldIt);
+			// delete old particles
+			if (p->age >= p->lifeSpan)
+			{
+				ParticleSet::iterator oldIt = it;
+				++it;
+				
+				delete *oldIt;
+				particles.erase(oldIt);
+				
+				continue;
+			}
+			else
+				p->age++;
 			
-			continue;
+			// do stupid physics
+			p->x += p->vx;
+			p->y += p->vy;
+			p->vx += p->ax;
+			p->vy += p->ay;
 		}
-		else
-			p->age++;
-		
-		// do stupid physics
-		p->x += p->vx;
-		p->y += p->vy;
-		p->vx += p->ax;
-		p->vy += p->ay;
 		
 		// get image
 		float img = (float)p->startImg + (float)((p->endImg - p->startImg) * p->age) / ((float)p->lifeSpan + 1);
@@ -4337,6 +4370,9 @@ void GameGUI::drawInGameTextInput(void)
 	typingInputScreen->decY=globalContainer->gfx->getH()-typingInputScreenPos;
 	typingInputScreen->dispatchPaint();
 	globalContainer->gfx->drawSurface((int)typingInputScreen->decX, (int)typingInputScreen->decY, typingInputScreen->getSurface());
+	// frames drawn between two steps keep the input still, so that it slides at the same speed
+	if (game.drawStepProgress != 0)
+		return;
 	if (typingInputScreenInc>0)
 	{
 		if (typingInputScreenPos<TYPING_INPUT_MAX_POS-TYPING_INPUT_BASE_INC)
@@ -4397,8 +4433,9 @@ void GameGUI::drawAll(int team)
 		
 		game.drawMap(0, 0, globalContainer->gfx->getW(), globalContainer->gfx->getH(), RIGHT_MENU_WIDTH, 16, viewportX, viewportY, localTeamNo, drawOptions, &visibleBuildings);
 		
-		// generate and draw particles
-		generateNewParticles(&visibleBuildings);
+		// generate and draw particles, frames drawn between two steps only redraw them
+		if (game.drawStepProgress == 0)
+			generateNewParticles(&visibleBuildings);
 		drawParticles();
 	}
 
@@ -4904,18 +4941,22 @@ void GameGUI::iterateSelection(void)
 	if (selectionMode==BUILDING_SELECTION)
 	{
 		Building* selBuild=selection.building;
-		Uint16 selectionGBID=selBuild->gid;
+		Uint32 selectionGBID=selBuild->gid;
 		assert(selBuild);
 		assert(selectionGBID!=NOGBID);
 		int pos=Building::GIDtoID(selectionGBID);
 		int team=Building::GIDtoTeam(selectionGBID);
-		int i=pos;
 		if (team==localTeamNo)
 		{
-			while (i<pos+Building::MAX_COUNT)
+			// look at the following buildings, wrapping around after the last one
+			const SlotSet &slots=game.teams[team]->buildingSlots;
+			int i=pos;
+			for (size_t n=0; n<slots.size(); n++)
 			{
-				i++;
-				Building *b=game.teams[team]->myBuildings[i % Building::MAX_COUNT];
+				i=slots.next(i);
+				if (i==-1)
+					i=slots.first();
+				Building *b=game.teams[team]->myBuildings[i];
 				if (b && b->typeNum==selBuild->typeNum)
 				{
 					setSelection(BUILDING_SELECTION, b);
@@ -4928,7 +4969,7 @@ void GameGUI::iterateSelection(void)
 	else if (selectionMode==TOOL_SELECTION)
 	{
 		Sint32 typeNum=globalContainer->buildingsTypes.getTypeNum(toolManager.getBuildingName(), 0, false);
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		for (int i=game.teams[localTeamNo]->buildingSlots.first(); i!=-1; i=game.teams[localTeamNo]->buildingSlots.next(i))
 		{
 			Building *b=game.teams[localTeamNo]->myBuildings[i];
 			if (b && b->typeNum==typeNum)
@@ -4943,18 +4984,20 @@ void GameGUI::iterateSelection(void)
 	{
 		Unit * selUnit = selection.unit;
 		assert(selUnit);
-		Uint16 gid = selUnit->gid;
+		Uint32 gid = selUnit->gid;
 		/* to be safe should check if gid is valid here? */
 		/* if looking at one of our pieces, continue with the next
 			one of our pieces of same type, otherwise start at the
 			beginning of our pieces of that type. */
 		Sint32 id = ((Unit::GIDtoTeam(gid) == localTeamNo) ? Unit::GIDtoID(gid) : 0);
-		id %= Unit::MAX_COUNT; /* just in case! */
 		// std::cerr << "starting id: " << id << std::endl;
+		const SlotSet &slots = game.teams[localTeamNo]->unitSlots;
 		Sint32 i = id;
-		while (1)
+		for (size_t n = 0; n < slots.size(); n++)
 		{
-			i = ((i + 1) % Unit::MAX_COUNT);
+			i = slots.next(i);
+			if (i == -1)
+				i = slots.first();
 			if (i == id) break;
 			// std::cerr << "trying id: " << i << std::endl;
 			Unit * u = game.teams[localTeamNo]->myUnits[i];
@@ -101,6 +101,8 @@ public:
 
 	// Engine has to call this every "real" steps. (or game steps)
 	void syncStep(void);
+	//! returns true if the next syncStep may autosave the game, or if a menu that may save it is open
+	bool maySaveGame(void) const;
 	//! return the local team of the player who is running glob2
 	Team *getLocalTeam(void) { return localTeam; }
 
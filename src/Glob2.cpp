@@ -29,6 +29,7 @@
 #include "CampaignSelectorScreen.h"
 #include "ChooseMapScreen.h"
 #include "CreditScreen.h"
+#include "DesyncBisector.h"
 #include "EditorMainMenu.h"
 #include "Engine.h"
 #include "Game.h"
@@ -207,6 +208,54 @@ int Glob2::runTestMapGeneration()
 	}
 	return 0;
 }
+
+
+
+int Glob2::runDesyncBisect()
+{
+	DesyncBisector bisector;
+	int result = bisector.run(globalContainer->desyncReplayA, globalContainer->desyncReplayB, std::cout);
+	return (result < 0 ? 1 : result);
+}
+
+
+int Glob2::runVerifyKeyframes()
+{
+	DesyncBisector bisector;
+	int result = bisector.verifyKeyframes(globalContainer->verifyKeyframesReplay, std::cout);
+	return (result < 0 ? 1 : result);
+}
+
+
+int Glob2::runWarBenchmark()
+{
+	// The same game is played with and without skipping the target scans where no enemy is near.
+	// Both must end in the same state, the skipped scans would not have found any target.
+	Uint32 ticks[2];
+	Uint32 checkSums[2];
+	for (int pass = 0; pass < 2; pass++)
+	{
+		globalContainer->sectorsTeamsPresence = (pass == 0);
+		Engine engine;
+		if (engine.initWarBenchmark(globalContainer->warBenchmarkMap) != Engine::EE_NO_ERROR)
+			return 1;
+		Uint32 startTick = SDL_GetTicks();
+		engine.run();
+		ticks[pass] = SDL_GetTicks() - startTick;
+		checkSums[pass] = engine.getGame().checkSum(NULL, NULL, NULL);
+		printf("bench-war::%s sectors teams presence: %u steps in %u ms, checksum %08x\n", (pass == 0) ? "with" : "without", engine.getGame().stepCounter, ticks[pass], checkSums[pass]);
+	}
+	globalContainer->sectorsTeamsPresence = true;
+	
+	if (ticks[0])
+		printf("bench-war::speedup %.2f\n", double(ticks[1]) / double(ticks[0]));
+	if (checkSums[0] != checkSums[1])
+	{
+		printf("bench-war::the games differ, skipping the scans changed the targets\n");
+		return 1;
+	}
+	return 0;
+}
 #endif  // !YOG_SERVER_ONLY
 
 
@@ -260,6 +309,27 @@ int Glob2::run(int argc, char *argv[])
 		runTestMapGeneration();
 	}
 	
+	if (globalContainer->runDesyncBisect)
+	{
+		int ret=runDesyncBisect();
+		delete globalContainer;
+		return ret;
+	}
+	
+	if (globalContainer->runVerifyKeyframes)
+	{
+		int ret=runVerifyKeyframes();
+		delete globalContainer;
+		return ret;
+	}
+	
+	if (globalContainer->runWarBenchmark)
+	{
+		int ret=runWarBenchmark();
+		delete globalContainer;
+		return ret;
+	}
+	
 	if (globalContainer->runNoX)
 	{
 		int ret=runNoX();
@@ -36,6 +36,12 @@ public:
 	int runTestGames();
 	///Generates random maps non stop until the game crashes
 	int runTestMapGeneration();
+	///Finds where the two replays given on the command line desynchronized
+	int runDesyncBisect();
+	///Checks the keyframes of the replay given on the command line
+	int runVerifyKeyframes();
+	///Times AIWarrush games on the map given on the command line, with and without skipping distant target scans
+	int runWarBenchmark();
 	int run(int argc, char *argv[]);
 };
 
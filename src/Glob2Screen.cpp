@@ -52,6 +52,11 @@ void Glob2Screen::paint(void)
 	}
 }
 
+bool Glob2Screen::hasAnimatedBackground(void)
+{
+	return (globalContainer->settings.optionFlags & GlobalContainer::OPTION_LOW_SPEED_GFX) == 0;
+}
+
 unsigned Glob2Screen::getNextTerrain(void)
 {
 	randomSeed = randomSeed * 69069;
@@ -92,6 +97,11 @@ void Glob2TabScreen::paint(void)
 	}
 }
 
+bool Glob2TabScreen::hasAnimatedBackground(void)
+{
+	return (globalContainer->settings.optionFlags & GlobalContainer::OPTION_LOW_SPEED_GFX) == 0;
+}
+
 unsigned Glob2TabScreen::getNextTerrain(void)
 {
 	randomSeed = randomSeed * 69069;
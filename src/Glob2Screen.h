@@ -32,6 +32,8 @@ public:
 	Glob2Screen();
 	virtual ~Glob2Screen();
 	virtual void paint(void);
+	//! The clouds move at every frame, unless low speed graphics are selected
+	virtual bool hasAnimatedBackground(void);
 	
 private:
 	unsigned getNextTerrain(void);
@@ -44,6 +46,8 @@ public:
 	Glob2TabScreen(bool fullScreen, bool longerButtons=false);
 	virtual ~Glob2TabScreen();
 	virtual void paint(void);
+	//! The clouds move at every frame, unless low speed graphics are selected
+	virtual bool hasAnimatedBackground(void);
 	
 private:
 	unsigned getNextTerrain(void);
@@ -38,6 +38,7 @@
 #include "UnitsSkins.h"
 #include "VoiceRecorder.h"
 #ifndef YOG_SERVER_ONLY
+#include "MapInfoCache.h"
 #include "ReplayReader.h"
 #include "ReplayWriter.h"
 #endif  // !YOG_SERVER_ONLY
@@ -95,8 +96,15 @@ GlobalContainer::GlobalContainer(void)
 	
 	runTestGames=false;
 	runTestMapGeneration=false;
+	runDesyncBisect=false;
+	runVerifyKeyframes=false;
+	runWarBenchmark=false;
+	sectorsTeamsPresence=true;
 	automaticEndingGame=false;
 	automaticEndingSteps=-1;
+	asyncAI=false;
+	replayKeyframes=false;
+	interpolateFrames=false;
 
 #ifndef YOG_SERVER_ONLY
 	gfx = NULL;
@@ -124,10 +132,13 @@ GlobalContainer::GlobalContainer(void)
 	replayVisibleTeams = 0xFFFFFFFF;
 	replayShowAreas = false;
 	replayShowFlags = true;
+	replaySeekStep = 0;
 
 #ifndef YOG_SERVER_ONLY
 	replayReader = NULL;
 	replayWriter = NULL;
+
+	mapInfoCache = new MapInfoCache();
 #endif  // !YOG_SERVER_ONLY
 
 	assert((int)USERNAME_MAX_LENGTH==(int)BasePlayer::MAX_NAME_LENGTH);
@@ -154,6 +165,9 @@ GlobalContainer::~GlobalContainer(void)
 
 	// delete title image
 	delete title;
+
+	// stop prefetching and save the map thumbnails, while the file manager is still there
+	delete mapInfoCache;
 #endif  // !YOG_SERVER_ONLY
 
 	// release resources
@@ -245,11 +259,83 @@ void GlobalContainer::parseArgs(int argc, char *argv[])
 			runNoX=true;
 			automaticGameGlobalEndConditions=true;
 		}
+		else if (strcmp(argv[i], "-replay-keyframes")==0)
+		{
+			replayKeyframes=true;
+		}
+		else if (strcmp(argv[i], "-async-ai")==0)
+		{
+			asyncAI=true;
+		}
+		else if (strcmp(argv[i], "-interpolate")==0)
+		{
+			interpolateFrames=true;
+		}
 		else if (strcmp(argv[i], "-test-map-gen")==0)
 		{
 			runTestMapGeneration = true;
 			runNoX=true;
 		}
+		else if (strcmp(argv[i], "-desync-bisect")==0)
+		{
+			if (i + 2 < argc)
+			{
+				desyncReplayA = argv[i + 1];
+				desyncReplayB = argv[i + 2];
+				runDesyncBisect = true;
+				runNoX = true;
+				i += 2;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("-desync-bisect <replay file name> <replay file name>\n");
+				printf("\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-bench-war-nox")==0)
+		{
+			bool good=true;
+			if (i + 2 < argc)
+			{
+				warBenchmarkMap = argv[i + 1];
+				good &= (sscanf(argv[i + 2], "%d", &automaticEndingSteps) == 1);
+				runWarBenchmark = true;
+				runNoX = true;
+				automaticEndingGame = true;
+				automaticGameGlobalEndConditions = true;
+				i += 2;
+			}
+			else
+			{
+				good=false;
+			}
+			if (!good)
+			{
+				printf("usage:\n");
+				printf("-bench-war-nox <map file name> <number of steps>\n");
+				printf("\n");
+				exit(0);
+			}
+		}
+		else if (strcmp(argv[i], "-verify-keyframes")==0)
+		{
+			if (i + 1 < argc)
+			{
+				verifyKeyframesReplay = argv[i + 1];
+				runVerifyKeyframes = true;
+				runNoX = true;
+				i++;
+			}
+			else
+			{
+				printf("usage:\n");
+				printf("-verify-keyframes <replay file name>\n");
+				printf("\n");
+				exit(0);
+			}
+		}
 		else if (strcmp(argv[i], "-vs")==0)
 		{
 			if (i+1 < argc)
@@ -467,6 +553,12 @@ void GlobalContainer::parseArgs(int argc, char *argv[])
 			printf("-test-games\tCreates random games with AI and tests them\n");
 			printf("-test-games-nox\tCreates random games with AI and tests them, without gui\n");
 			printf("-test-map-gen\tGenerates random maps endlessly, without gui\n");
+			printf("-async-ai\tAIs compute their orders on a worker thread while the game is drawn\n");
+			printf("-interpolate\tDraws extra frames between game steps, interpolating unit movement\n");
+			printf("-desync-bisect <replay file name> <replay file name>\tfinds the first step and the objects that differ between two replays of a game, without gui\n");
+			printf("-bench-war-nox <map file name> <number of steps>\tPlays AIWarrush against itself on the map twice, with and without skipping the target scans far from enemies, and compares the times and the checksums, without gui\n");
+			printf("-replay-keyframes\tStores snapshots of the game in its replay every few minutes, so that watching it can jump to any step quickly\n");
+			printf("-verify-keyframes <replay file name>\tchecks that seeking to each keyframe of a replay gives the same game as playing it from the start, without gui\n");
 			printf("-admin-router Allows you to connect to a YOG router to do administration\n");
 			printf("-vs <name>\tsave a videoshot as name\n");
 			printf("-replay <replay file name>\t replay the game stored in the specified file.\n");
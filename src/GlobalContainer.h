@@ -40,6 +40,7 @@ class LogFileManager;
 class UnitsSkins;
 class ReplayReader;
 class ReplayWriter;
+class MapInfoCache;
 
 class GlobalContainer
 {
@@ -118,10 +119,22 @@ public:
 	bool automaticEndingGame;
 	int automaticEndingSteps;
 	bool automaticGameGlobalEndConditions; //! Set false if the automatic game will end if the local team wins/loses, true to wait for the entire game to finish
+	bool asyncAI; //!< If true, the AIs compute their orders on a worker thread while the game is drawn
+	bool interpolateFrames; //!< If true, the spare time of each step is spent drawing frames with interpolated unit movement
+	bool replayKeyframes; //!< If true, the replay of the game stores snapshots of the game from time to time, to seek quickly when watching it
 	
 	bool runTestGames; //! runs test games
 	
 	bool runTestMapGeneration; //! runs test map generation
+
+	bool runDesyncBisect; //! compares two replays to find where they desynchronized
+	std::string desyncReplayA; //! the first replay given to -desync-bisect
+	std::string desyncReplayB; //! the second replay given to -desync-bisect
+	bool runVerifyKeyframes; //! checks that seeking to the keyframes of a replay gives the game played from the start
+	std::string verifyKeyframesReplay; //! the replay given to -verify-keyframes
+	bool runWarBenchmark; //! times a game of AIWarrush on a map, with and without the sectors teams presence
+	std::string warBenchmarkMap; //! the map given to -bench-war-nox
+	bool sectorsTeamsPresence; //!< If false, Map::getSectorsTeamsPresence reports every team, so that the target scans are never skipped
 	
 	bool hostServer;
 	bool hostRouter;
@@ -137,10 +150,13 @@ public:
 	Uint32 replayVisibleTeams; //!< A mask of which teams can be seen in the replay. Can be edited real-time.
 	bool replayShowAreas; //!< Show areas of gui.localPlayer or not. Can be edited real-time.
 	bool replayShowFlags; //!< Show all flags or show none. Can be edited real-time.
+	Uint32 replaySeekStep; //!< If not 0, the replay should jump to this step. Set by clicking on the progress bar.
 
 #ifndef YOG_SERVER_ONLY
 	ReplayReader *replayReader; //!< Reads and processes replay files, and outputs orders
 	ReplayWriter *replayWriter; //!< Writes orders into replay files
+
+	MapInfoCache *mapInfoCache; //!< Headers and thumbnails of the maps and games, for the map choosers
 #endif  // !YOG_SERVER_ONLY
 
 public:
@@ -120,7 +120,7 @@ template<typename Tint, bool canSwim> Uint8 BuildingGradientMethod<Tint, canSwim
 	int posY=building->posY;
 	int posW=building->type->width;
 	Uint32 teamMask=building->owner->me;
-	Uint16 bgid=building->gid;
+	Uint32 bgid=building->gid;
 	
 	Case& c=map->cases[square];
 	
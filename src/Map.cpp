@@ -107,10 +107,15 @@ Map::Map()
 			clearGradientUpdated[t][s] = false;
 		}
 	for (int t = 0; t < Team::MAX_COUNT; t++)
+	{
 		exploredArea[t] = NULL;
+		exploredAreaAge[t] = 0;
+	}
 	
 	undermap=NULL;
 	sectors=NULL;
+	sectorsTeamsCount=NULL;
+	sectorsTeamsPresence=NULL;
 	listedAddr=NULL;
 	
 	for (int t = 0; t < Team::MAX_COUNT; t++)
@@ -122,6 +127,9 @@ Map::Map()
 	hMask=0;
 	wDec=0;
 	hDec=0;
+	changeStamp=1;
+	areaGradientChangesStart=1;
+	memset(areaGradientChangesSeen, 0, sizeof(areaGradientChangesSeen));
 	wSector=0;
 	hSector=0;
 	sizeSector=0;
@@ -297,6 +305,14 @@ void Map::clear()
 		assert(sectors);
 		delete[] sectors;
 		sectors=NULL;
+		
+		assert(sectorsTeamsCount);
+		delete[] sectorsTeamsCount;
+		sectorsTeamsCount=NULL;
+		
+		assert(sectorsTeamsPresence);
+		delete[] sectorsTeamsPresence;
+		sectorsTeamsPresence=NULL;
 
 		assert(listedAddr);
 		delete[] listedAddr;
@@ -964,6 +980,10 @@ void Map::setSize(int wDec, int hDec, TerrainType terrainType)
 	memset(fogOfWarB, 0, size*sizeof(Uint32));
 	fogOfWar=fogOfWarA;
 	
+	changedBlocks.assign(size>>(2*CHANGE_BLOCK_SHIFT), changeStamp);
+	areaGradientRepairer.setSize(wDec, hDec);
+	invalidateAreaGradients();
+	
 	localForbiddenMap.resize(size, false);
 	localGuardAreaMap.resize(size, false);
 	localClearAreaMap.resize(size, false);
@@ -1001,6 +1021,7 @@ void Map::setSize(int wDec, int hDec, TerrainType terrainType)
 	if(sectors)
 		delete[] sectors;
 	sectors=new Sector[sizeSector];
+	initSectorsTeamsPresence();
 
 	astarpoints=new AStarAlgorithmPoint[w*h];
 
@@ -1082,6 +1103,9 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 	fogOfWar = fogOfWarA;
 	memset(fogOfWarA, 0, size*sizeof(Uint32));
 	memset(fogOfWarB, 0, size*sizeof(Uint32));
+	changedBlocks.assign(size>>(2*CHANGE_BLOCK_SHIFT), changeStamp);
+	areaGradientRepairer.setSize(wDec, hDec);
+	invalidateAreaGradients();
 	localForbiddenMap.resize(size, false);
 	localGuardAreaMap.resize(size, false);
 	localClearAreaMap.resize(size, false);
@@ -1111,11 +1135,11 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 		mapDiscovered[i] = stream->readUint32("mapDiscovered");
 
 		cases[i].terrain = stream->readUint16("terrain");
-		cases[i].building = stream->readUint16("building");
+		cases[i].building = Building::readGID(stream, "building", versionMinor);
 
 		stream->read(&(cases[i].ressource), 4, "ressource");
-		cases[i].groundUnit = stream->readUint16("groundUnit");
-		cases[i].airUnit = stream->readUint16("airUnit");
+		cases[i].groundUnit = Unit::readGID(stream, "groundUnit", versionMinor);
+		cases[i].airUnit = Unit::readGID(stream, "airUnit", versionMinor);
 		cases[i].forbidden = stream->readUint32("forbidden");
 		if(versionMinor < 62)
 			stream->readUint32("hiddenForbidden");
@@ -1180,12 +1204,12 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 		for (int t=0; t<header.getNumberOfTeams(); t++)
 		{
 			assert(exploredArea[t] == NULL);
-			exploredArea[t] = new Uint8[size];
+			exploredArea[t] = new Uint32[size];
 			initExploredArea(t);
 			makeDiscoveredAreasExplored(t);
 			
-			clearingAreaClaims[t] = new Uint16[size];
-			memset(clearingAreaClaims[t], NOGUID, size*sizeof(Uint16));
+			clearingAreaClaims[t] = new Uint32[size];
+			memset(clearingAreaClaims[t], NOGUID, size*sizeof(Uint32));
 		}
 	}
 
@@ -1195,6 +1219,7 @@ bool Map::load(GAGCore::InputStream *stream, MapHeader& header, Game *game)
 	sizeSector = wSector*hSector;
 	assert(sectors == NULL);
 	sectors = new Sector[sizeSector];
+	initSectorsTeamsPresence();
 	
 	arraysBuilt = true;
 	
@@ -1241,12 +1266,12 @@ void Map::save(GAGCore::OutputStream *stream)
 		stream->writeUint32(mapDiscovered[i], "mapDiscovered");
 
 		stream->writeUint16(cases[i].terrain, "terrain");
-		stream->writeUint16(cases[i].building, "building");
+		stream->writeUint32(cases[i].building, "building");
 		
 		stream->write(&(cases[i].ressource), 4, "ressource");
 		
-		stream->writeUint16(cases[i].groundUnit, "groundUnit");
-		stream->writeUint16(cases[i].airUnit, "airUnit");
+		stream->writeUint32(cases[i].groundUnit, "groundUnit");
+		stream->writeUint32(cases[i].airUnit, "airUnit");
 		stream->writeUint32(cases[i].forbidden, "forbidden");
 		stream->writeUint32(cases[i].guardArea, "guardArea");
 		stream->writeUint32(cases[i].clearArea, "clearArea");
@@ -1281,6 +1306,110 @@ void Map::save(GAGCore::OutputStream *stream)
 	stream->writeLeaveSection();
 }
 
+void Map::saveCaches(GAGCore::OutputStream *stream)
+{
+	assert(game);
+	stream->writeEnterSection("MapCaches");
+	stream->writeSint32(wDec, "wDec");
+	stream->writeSint32(hDec, "hDec");
+
+	// The gradients updated in turn by syncStep() and the arrays load() resets
+	stream->writeEnterSection("teams");
+	for (int t=0; t<game->mapHeader.getNumberOfTeams(); t++)
+	{
+		stream->writeEnterSection(t);
+		for (int r=0; r<MAX_RESSOURCES; r++)
+			for (int s=0; s<2; s++)
+			{
+				assert(ressourcesGradient[t][r][s]);
+				stream->write(ressourcesGradient[t][r][s], size, "ressourcesGradient");
+				stream->writeUint8(gradientUpdated[t][r][s], "gradientUpdated");
+			}
+		for (int s=0; s<2; s++)
+		{
+			assert(forbiddenGradient[t][s] && guardAreasGradient[t][s] && clearAreasGradient[t][s]);
+			stream->write(forbiddenGradient[t][s], size, "forbiddenGradient");
+			stream->write(guardAreasGradient[t][s], size, "guardAreasGradient");
+			stream->writeUint8(guardGradientUpdated[t][s], "guardGradientUpdated");
+			stream->write(clearAreasGradient[t][s], size, "clearAreasGradient");
+			stream->writeUint8(clearGradientUpdated[t][s], "clearGradientUpdated");
+		}
+		stream->writeUint32(exploredAreaAge[t], "exploredAreaAge");
+		for (size_t i=0; i<size; i++)
+			stream->writeUint32(exploredArea[t][i], "exploredArea");
+		for (size_t i=0; i<size; i++)
+			stream->writeUint32(clearingAreaClaims[t][i], "clearingAreaClaims");
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+
+	stream->write(immobileUnits, size, "immobileUnits");
+	for (size_t i=0; i<size; i++)
+	{
+		stream->writeUint32(fogOfWarA[i], "fogOfWarA");
+		stream->writeUint32(fogOfWarB[i], "fogOfWarB");
+	}
+	stream->writeUint8(fogOfWar==fogOfWarA, "fogOfWarIsA");
+
+	stream->writeLeaveSection();
+}
+
+bool Map::loadCaches(GAGCore::InputStream *stream)
+{
+	assert(game);
+	stream->readEnterSection("MapCaches");
+	Sint32 cachesWDec = stream->readSint32("wDec");
+	Sint32 cachesHDec = stream->readSint32("hDec");
+	if (cachesWDec != wDec || cachesHDec != hDec)
+	{
+		fprintf(stderr, "Map:: The caches are for a map of another size.\n");
+		stream->readLeaveSection();
+		return false;
+	}
+
+	stream->readEnterSection("teams");
+	for (int t=0; t<game->mapHeader.getNumberOfTeams(); t++)
+	{
+		stream->readEnterSection(t);
+		for (int r=0; r<MAX_RESSOURCES; r++)
+			for (int s=0; s<2; s++)
+			{
+				stream->read(ressourcesGradient[t][r][s], size, "ressourcesGradient");
+				gradientUpdated[t][r][s] = stream->readUint8("gradientUpdated");
+			}
+		for (int s=0; s<2; s++)
+		{
+			stream->read(forbiddenGradient[t][s], size, "forbiddenGradient");
+			stream->read(guardAreasGradient[t][s], size, "guardAreasGradient");
+			guardGradientUpdated[t][s] = stream->readUint8("guardGradientUpdated");
+			stream->read(clearAreasGradient[t][s], size, "clearAreasGradient");
+			clearGradientUpdated[t][s] = stream->readUint8("clearGradientUpdated");
+		}
+		exploredAreaAge[t] = stream->readUint32("exploredAreaAge");
+		for (size_t i=0; i<size; i++)
+			exploredArea[t][i] = stream->readUint32("exploredArea");
+		for (size_t i=0; i<size; i++)
+			clearingAreaClaims[t][i] = stream->readUint32("clearingAreaClaims");
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+
+	stream->read(immobileUnits, size, "immobileUnits");
+	for (size_t i=0; i<size; i++)
+	{
+		fogOfWarA[i] = stream->readUint32("fogOfWarA");
+		fogOfWarB[i] = stream->readUint32("fogOfWarB");
+	}
+	fogOfWar = stream->readUint8("fogOfWarIsA") ? fogOfWarA : fogOfWarB;
+
+	// The area gradients saved may wait for a repair from changes made before the save,
+	// which are not known anymore. A full update gives the same values as that repair.
+	invalidateAreaGradients();
+
+	stream->readLeaveSection();
+	return true;
+}
+
 void Map::addTeam(void)
 {
 	int numberOfTeam=game->mapHeader.getNumberOfTeams();
@@ -1319,12 +1448,12 @@ void Map::addTeam(void)
 	}
 	
 	assert(exploredArea[t] == NULL);
-	exploredArea[t] = new Uint8[size];
+	exploredArea[t] = new Uint32[size];
 	initExploredArea(t);
 	
 	assert(clearingAreaClaims[t] == NULL);
-	clearingAreaClaims[t] = new Uint16[size];
-	memset(clearingAreaClaims[t], NOGUID, size*sizeof(Uint16));
+	clearingAreaClaims[t] = new Uint32[size];
+	memset(clearingAreaClaims[t], NOGUID, size*sizeof(Uint32));
 }
 
 void Map::removeTeam(void)
@@ -1502,8 +1631,74 @@ void Map::syncStep(Uint32 stepCounter)
 }
 #endif  // !YOG_SERVER_ONLY
 
+void Map::initSectorsTeamsPresence()
+{
+	if (sectorsTeamsCount)
+		delete[] sectorsTeamsCount;
+	sectorsTeamsCount = new Uint16[sizeSector*Team::MAX_COUNT];
+	memset(sectorsTeamsCount, 0, sizeSector*Team::MAX_COUNT*sizeof(Uint16));
+	if (sectorsTeamsPresence)
+		delete[] sectorsTeamsPresence;
+	sectorsTeamsPresence = new Uint32[sizeSector];
+	memset(sectorsTeamsPresence, 0, sizeSector*sizeof(Uint32));
+	
+	for (int y=0; y<h; y++)
+		for (int x=0; x<w; x++)
+		{
+			const Case &c = cases[(y<<wDec)+x];
+			updateSectorTeamsPresence(x, y, NOGUID, c.groundUnit, false);
+			updateSectorTeamsPresence(x, y, NOGUID, c.airUnit, false);
+			updateSectorTeamsPresence(x, y, NOGBID, c.building, true);
+		}
+}
+
+void Map::updateSectorTeamsPresence(int x, int y, Uint32 oldGid, Uint32 newGid, bool isBuilding)
+{
+	const Uint32 noGid = isBuilding ? NOGBID : NOGUID;
+	int sector = wSector*((y&hMask)>>4)+((x&wMask)>>4);
+	Uint16 *counts = sectorsTeamsCount + sector*Team::MAX_COUNT;
+	if (oldGid != noGid)
+	{
+		int team = isBuilding ? Building::GIDtoTeam(oldGid) : Unit::GIDtoTeam(oldGid);
+		assert(counts[team] > 0);
+		if (--counts[team] == 0)
+			sectorsTeamsPresence[sector] &= ~(1<<team);
+	}
+	if (newGid != noGid)
+	{
+		int team = isBuilding ? Building::GIDtoTeam(newGid) : Unit::GIDtoTeam(newGid);
+		if (counts[team]++ == 0)
+			sectorsTeamsPresence[sector] |= (1<<team);
+	}
+}
+
+Uint32 Map::getSectorsTeamsPresence(int x, int y, int w, int h)
+{
+	// disabled to benchmark the scans against it
+	if (!globalContainer->sectorsTeamsPresence)
+		return 0xFFFFFFFF;
+
+	// number of sectors spanned, starting from the one containing (x, y)
+	int sw = std::min<int>(wSector, ((x&15)+w+15)>>4);
+	int sh = std::min<int>(hSector, ((y&15)+h+15)>>4);
+	int sx = (x&wMask)>>4;
+	int sy = (y&hMask)>>4;
+	Uint32 presence = 0;
+	for (int dy=0; dy<sh; dy++)
+	{
+		const Uint32 *line = sectorsTeamsPresence + ((sy+dy)%hSector)*wSector;
+		for (int dx=0; dx<sw; dx++)
+			presence |= line[(sx+dx)%wSector];
+	}
+	return presence;
+}
+
 void Map::switchFogOfWar(void)
 {
+	// the views show the other buffer from now on, so the cells where both differ change
+	for (size_t i=0; i<size; i++)
+		if (fogOfWarA[i] != fogOfWarB[i])
+			setCellChanged(i&wMask, i>>wDec);
 	memset(fogOfWar, 0, size*sizeof(Uint32));
 	if (fogOfWar==fogOfWarA)
 		fogOfWar=fogOfWarB;
@@ -1560,7 +1755,11 @@ void Map::decRessource(int x, int y)
 	else
 	{
 		if (!fulltype->granular || r.amount<=1)
+		{
 			r.clear();
+			setCellChanged(x, y);
+			setAreaGradientSourceChanged(x, y);
+		}
 		else
 			r.amount--;
 	}
@@ -1594,6 +1793,8 @@ bool Map::incRessource(int x, int y, int ressourceType, int variety)
 			r.variety = variety;
 			r.amount = 1;
 			r.animation = 0;
+			setCellChanged(x, y);
+			setAreaGradientSourceChanged(x, y);
 			incRessourceLog[4]++;
 			return true;
 		}
@@ -1681,7 +1882,7 @@ bool Map::isFreeForBuilding(int x, int y, int w, int h)
 	return true;
 }
 
-bool Map::isFreeForBuilding(int x, int y, int w, int h, Uint16 gid)
+bool Map::isFreeForBuilding(int x, int y, int w, int h, Uint32 gid)
 {
 	for (int yi=y; yi<y+h; yi++)
 		for (int xi=x; xi<x+w; xi++)
@@ -1689,7 +1890,7 @@ bool Map::isFreeForBuilding(int x, int y, int w, int h, Uint16 gid)
 			{
 				if (isRessource(xi, yi))
 					return false;
-				Uint16 buid=getBuilding(xi, yi);
+				Uint32 buid=getBuilding(xi, yi);
 				if (buid!=NOGBID && buid!=gid)
 					return false;
 				if (getGroundUnit(xi, yi)!=NOGUID)
@@ -1734,14 +1935,14 @@ bool Map::isHardSpaceForBuilding(int x, int y, int w, int h)
 	return true;
 }
 
-bool Map::isHardSpaceForBuilding(int x, int y, int w, int h, Uint16 gid)
+bool Map::isHardSpaceForBuilding(int x, int y, int w, int h, Uint32 gid)
 {
 	for (int yi=y; yi<y+h; yi++)
 		for (int xi=x; xi<x+w; xi++)
 		{
 			if (isRessource(xi, yi))
 				return false;
-			Uint16 buid=getBuilding(xi, yi);
+			Uint32 buid=getBuilding(xi, yi);
 			if (buid!=NOGBID && buid!=gid)
 				return false;
 			if (!isGrass(xi, yi))
@@ -1750,7 +1951,7 @@ bool Map::isHardSpaceForBuilding(int x, int y, int w, int h, Uint16 gid)
 	return true;
 }
 
-bool Map::doesUnitTouchBuilding(Unit *unit, Uint16 gbid, int *dx, int *dy)
+bool Map::doesUnitTouchBuilding(Unit *unit, Uint32 gbid, int *dx, int *dy)
 {
 	int x=unit->posX;
 	int y=unit->posY;
@@ -1766,7 +1967,7 @@ bool Map::doesUnitTouchBuilding(Unit *unit, Uint16 gbid, int *dx, int *dy)
 	return false;
 }
 
-bool Map::doesPosTouchBuilding(int x, int y, Uint16 gbid)
+bool Map::doesPosTouchBuilding(int x, int y, Uint32 gbid)
 {
 	for (int tdx=-1; tdx<=1; tdx++)
 		for (int tdy=-1; tdy<=1; tdy++)
@@ -1775,7 +1976,7 @@ bool Map::doesPosTouchBuilding(int x, int y, Uint16 gbid)
 	return false;
 }
 
-bool Map::doesPosTouchBuilding(int x, int y, Uint16 gbid, int *dx, int *dy)
+bool Map::doesPosTouchBuilding(int x, int y, Uint32 gbid, int *dx, int *dy)
 {
 	for (int tdx=-1; tdx<=1; tdx++)
 		for (int tdy=-1; tdy<=1; tdy++)
@@ -1846,7 +2047,7 @@ bool Map::doesUnitTouchEnemy(Unit *unit, int *dx, int *dy)
 	for (int tdx=-1; tdx<=1; tdx++)
 		for (int tdy=-1; tdy<=1; tdy++)
 		{
-			Sint32 gbid=getBuilding(x+tdx, y+tdy);
+			Uint32 gbid=getBuilding(x+tdx, y+tdy);
 			if (gbid!=NOGBID)
 			{
 				int otherTeam=Building::GIDtoTeam(gbid);
@@ -1874,7 +2075,7 @@ bool Map::doesUnitTouchEnemy(Unit *unit, int *dx, int *dy)
 					}
 				}
 			}
-			Sint32 guid=getGroundUnit(x+tdx, y+tdy);
+			Uint32 guid=getGroundUnit(x+tdx, y+tdy);
 			if (guid!=NOGUID)
 			{
 				int otherTeam=Unit::GIDtoTeam(guid);
@@ -1912,7 +2113,7 @@ bool Map::doesUnitTouchEnemy(Unit *unit, int *dx, int *dy)
 
 
 
-void Map::setClearingAreaClaimed(int x, int y, int teamNumber, int gid)
+void Map::setClearingAreaClaimed(int x, int y, int teamNumber, Uint32 gid)
 {
 	clearingAreaClaims[teamNumber][(normalizeY(y) << wDec) + normalizeX(x)] = gid;
 }
@@ -1926,7 +2127,7 @@ void Map::setClearingAreaUnclaimed(int x, int y, int teamNumber)
 
 
 
-int Map::isClearingAreaClaimed(int x, int y, int teamNumber)
+Uint32 Map::isClearingAreaClaimed(int x, int y, int teamNumber)
 {
 	return clearingAreaClaims[teamNumber][(normalizeY(y) << wDec) + normalizeX(x)];
 }
@@ -1935,13 +2136,19 @@ int Map::isClearingAreaClaimed(int x, int y, int teamNumber)
 
 void Map::markImmobileUnit(int x, int y, int teamNumber)
 {
-	immobileUnits[(normalizeY(y) << wDec) + normalizeX(x)] = teamNumber;
+	size_t pos = (normalizeY(y) << wDec) + normalizeX(x);
+	if (immobileUnits[pos] == 255)
+		setAreaGradientSourceChanged(pos);
+	immobileUnits[pos] = teamNumber;
 }
 
 
 void Map::clearImmobileUnit(int x, int y)
 {
-	immobileUnits[(normalizeY(y) << wDec) + normalizeX(x)] = 255;
+	size_t pos = (normalizeY(y) << wDec) + normalizeX(x);
+	if (immobileUnits[pos] != 255)
+		setAreaGradientSourceChanged(pos);
+	immobileUnits[pos] = 255;
 }
 
 
@@ -2071,7 +2278,11 @@ void Map::setNoRessource(int x, int y, int l)
 	assert(l<h);
 	for (int dx=x-(l>>1); dx<x+(l>>1)+1; dx++)
 		for (int dy=y-(l>>1); dy<y+(l>>1)+1; dy++)
+		{
 			(cases+w*(dy&hMask)+(dx&wMask))->ressource.clear();
+			setCellChanged(dx, dy);
+			setAreaGradientSourceChanged(dx, dy);
+		}
 }
 
 void Map::setRessource(int x, int y, int type, int l)
@@ -2090,6 +2301,8 @@ void Map::setRessource(int x, int y, int type, int l)
 				assert(rt->sizesCount>1);
 				rp->amount=1+syncRand()%(rt->sizesCount-1);
 				rp->animation=0;
+				setCellChanged(dx, dy);
+				setAreaGradientSourceChanged(dx, dy);
 			}
 }
 
@@ -3229,7 +3442,7 @@ void Map::updateLocalGradient(Building *building, bool canSwim)
 	int posW=building->type->width;
 	int posH=building->type->height;
 	Uint32 teamMask=building->owner->me;
-	Uint16 bgid=building->gid;
+	Uint32 bgid=building->gid;
 	
 	Uint8 *tgtGradient=building->localGradient[canSwim];
 
@@ -3550,7 +3763,7 @@ template<typename Tint> void Map::updateGlobalGradient(Building *building, bool
 	int posW=building->type->width;
 	//int posH=building->type->height;
 	Uint32 teamMask=building->owner->me;
-	Uint16 bgid=building->gid;
+	Uint32 bgid=building->gid;
 	
 	Uint8 *gradient=building->globalGradient[canSwim];
 	assert(gradient);
@@ -4450,7 +4663,7 @@ void Map::dirtyLocalGradient(int x, int y, int wl, int hl, int teamNumber)
 		for (int wi=0; wi<wl; wi++)
 		{
 			int xi=(x+wi)&wMask;
-			int bgid=cases[xi+wyi].building;
+			Uint32 bgid=cases[xi+wyi].building;
 			if (bgid!=NOGBID)
 				if (Building::GIDtoTeam(bgid)==teamNumber)
 				{
@@ -4589,6 +4802,7 @@ void Map::updateForbiddenGradient(int teamNumber, bool canSwim)
 		updateForbiddenGradient<Uint16>(teamNumber, canSwim);
 	else
 		updateForbiddenGradient<Uint32>(teamNumber, canSwim);
+	setAreaGradientUpToDate(GT_FORBIDDEN, teamNumber, canSwim);
 }
 
 template<typename Tint> void Map::updateForbiddenGradient(int teamNumber, bool canSwim)
@@ -4669,22 +4883,9 @@ template<typename Tint> void Map::updateForbiddenGradient(int teamNumber, bool c
 	// We set the obstacle and free places
 	for (size_t i=0; i<size; i++)
 	{
-		const Case& c=cases[i];
-		if (c.ressource.type!=NO_RES_TYPE)
-			testgradient[i] = 0;
-		else if (c.building!=NOGBID)
-			testgradient[i] = 0;
-		else if (!canSwim && isWater(i))
-			testgradient[i] = 0;
-		else if(immobileUnits[i] != 255)
-			testgradient[i]=0;
-		else if (c.forbidden&teamMask)
-		{
-			testgradient[i]= 1;  // Later: check if we can set it to 254.
-			listedAddr[listCountWriteInit++] = i;  // Remember this field.
-		}
-		else
-			testgradient[i] = 255;
+		testgradient[i] = areaGradientInitialValue(GT_FORBIDDEN, i, teamNumber, canSwim);
+		if (testgradient[i] == 1)
+			listedAddr[listCountWriteInit++] = i;  // Remember this field, later: check if we can set it to 254.
 	}
 
 	// Now check if the forbidden fields border free fields. 
@@ -4780,6 +4981,7 @@ void Map::updateGuardAreasGradient(int teamNumber, bool canSwim)
 		updateGuardAreasGradient<Uint16>(teamNumber, canSwim);
 	else
 		updateGuardAreasGradient<Uint32>(teamNumber, canSwim);
+	setAreaGradientUpToDate(GT_GUARD_AREA, teamNumber, canSwim);
 }
 
 template<typename Tint> void Map::updateGuardAreasGradient(int teamNumber, bool canSwim)
@@ -4790,27 +4992,11 @@ template<typename Tint> void Map::updateGuardAreasGradient(int teamNumber, bool
 	size_t listCountWrite = 0;
 	
 	// We set the obstacle and free places
-	Uint32 teamMask = Team::teamNumberToMask(teamNumber);
 	for (size_t i=0; i<size; i++)
 	{
-		const Case& c=cases[i];
-		if (c.forbidden & teamMask)
-			gradient[i] = 0;
-		else if(immobileUnits[i] != 255)
-			gradient[i]=0;
-		else if (c.ressource.type != NO_RES_TYPE)
-			gradient[i] = 0;
-		else if (c.building != NOGBID && (1<<Building::GIDtoTeam(c.building)) & (game->teams[teamNumber]->allies))
-			gradient[i] = 0;
-		else if (!canSwim && isWater(i))
-			gradient[i] = 0;
-		else if (c.guardArea & teamMask)
-		{
-			gradient[i] = 255;
+		gradient[i] = areaGradientInitialValue(GT_GUARD_AREA, i, teamNumber, canSwim);
+		if (gradient[i] == 255)
 			listedAddr[listCountWrite++] = i;
-		}
-		else
-			gradient[i] = 1;
 	}
 	
 	// Then we propagate the gradient
@@ -4836,6 +5022,7 @@ void Map::updateClearAreasGradient(int teamNumber, bool canSwim)
 		updateClearAreasGradient<Uint16>(teamNumber, canSwim);
 	else
 		updateClearAreasGradient<Uint32>(teamNumber, canSwim);
+	setAreaGradientUpToDate(GT_CLEAR_AREA, teamNumber, canSwim);
 }
 
 template<typename Tint> void Map::updateClearAreasGradient(int teamNumber, bool canSwim)
@@ -4846,27 +5033,11 @@ template<typename Tint> void Map::updateClearAreasGradient(int teamNumber, bool
 	size_t listCountWrite = 0;
 	
 	// We set the obstacle and free places
-	Uint32 teamMask = Team::teamNumberToMask(teamNumber);
 	for (size_t i=0; i<size; i++)
 	{
-		const Case& c=cases[i];
-		if (c.forbidden & teamMask)
-			gradient[i] = 0;
-		else if(c.clearArea & teamMask && (c.ressource.type == WOOD || c.ressource.type == CORN || c.ressource.type == PAPYRUS || c.ressource.type == ALGA))
-		{
-			gradient[i] = 255;
+		gradient[i] = areaGradientInitialValue(GT_CLEAR_AREA, i, teamNumber, canSwim);
+		if (gradient[i] == 255)
 			listedAddr[listCountWrite++] = i;
-		}
-		else if(immobileUnits[i] != 255)
-			gradient[i]=0;
-		else if (c.ressource.type != NO_RES_TYPE)
-			gradient[i] = 0;
-		else if (c.building != NOGBID)
-			gradient[i] = 0;
-		else if (!canSwim && isWater(i))
-			gradient[i] = 0;
-		else
-			gradient[i] = 1;
 	}
 	
 	// Then we propagate the gradient
@@ -4886,6 +5057,134 @@ void Map::updateClearAreasGradient()
 		updateClearAreasGradient(i);
 }
 
+Uint8 Map::areaGradientInitialValue(GradientType gradientType, size_t pos, int teamNumber, bool canSwim)
+{
+	const Case& c=cases[pos];
+	Uint32 teamMask = Team::teamNumberToMask(teamNumber);
+	switch (gradientType)
+	{
+		case GT_FORBIDDEN:
+			if (c.ressource.type!=NO_RES_TYPE)
+				return 0;
+			else if (c.building!=NOGBID)
+				return 0;
+			else if (!canSwim && isWater(pos))
+				return 0;
+			else if(immobileUnits[pos] != 255)
+				return 0;
+			else if (c.forbidden&teamMask)
+				return 1;
+			else
+				return 255;
+
+		case GT_GUARD_AREA:
+			if (c.forbidden & teamMask)
+				return 0;
+			else if(immobileUnits[pos] != 255)
+				return 0;
+			else if (c.ressource.type != NO_RES_TYPE)
+				return 0;
+			else if (c.building != NOGBID && (1<<Building::GIDtoTeam(c.building)) & (game->teams[teamNumber]->allies))
+				return 0;
+			else if (!canSwim && isWater(pos))
+				return 0;
+			else if (c.guardArea & teamMask)
+				return 255;
+			else
+				return 1;
+
+		case GT_CLEAR_AREA:
+			if (c.forbidden & teamMask)
+				return 0;
+			else if(c.clearArea & teamMask && (c.ressource.type == WOOD || c.ressource.type == CORN || c.ressource.type == PAPYRUS || c.ressource.type == ALGA))
+				return 255;
+			else if(immobileUnits[pos] != 255)
+				return 0;
+			else if (c.ressource.type != NO_RES_TYPE)
+				return 0;
+			else if (c.building != NOGBID)
+				return 0;
+			else if (!canSwim && isWater(pos))
+				return 0;
+			else
+				return 1;
+
+		default:
+			assert(false);
+			return 0;
+	}
+}
+
+//! Gives the initial values of an area gradient of the current map to AreaGradient::repair
+struct Map::AreaGradientInitialValue
+{
+	Map *map;
+	GradientType gradientType;
+	int teamNumber;
+	bool canSwim;
+
+	Uint8 operator()(size_t pos) const
+	{
+		return map->areaGradientInitialValue(gradientType, pos, teamNumber, canSwim);
+	}
+};
+
+void Map::setAreaGradientUpToDate(GradientType gradientType, int teamNumber, bool canSwim)
+{
+	areaGradientChangesSeen[teamNumber][gradientType - GT_FORBIDDEN][canSwim] = areaGradientChangesStart + areaGradientChanges.size();
+}
+
+/*! A repair gives the same values as a full update only if it is given all the cells whose
+	initial value changed since the gradient was last up to date: changedCells, and the cells
+	recorded by setAreaGradientSourceChanged since then. If some of these were dropped, the
+	gradient is computed fully instead. */
+void Map::updateAreaGradient(GradientType gradientType, int teamNumber, bool canSwim, const std::vector<size_t> &changedCells)
+{
+	Uint64 seen = areaGradientChangesSeen[teamNumber][gradientType - GT_FORBIDDEN][canSwim];
+	if (seen < areaGradientChangesStart)
+	{
+		if (gradientType == GT_FORBIDDEN)
+			updateForbiddenGradient(teamNumber, canSwim);
+		else if (gradientType == GT_GUARD_AREA)
+			updateGuardAreasGradient(teamNumber, canSwim);
+		else
+			updateClearAreasGradient(teamNumber, canSwim);
+		return;
+	}
+
+	std::vector<size_t> cells(changedCells);
+	cells.insert(cells.end(), areaGradientChanges.begin() + (seen - areaGradientChangesStart), areaGradientChanges.end());
+
+	Uint8 *gradient;
+	if (gradientType == GT_FORBIDDEN)
+		gradient = forbiddenGradient[teamNumber][canSwim];
+	else if (gradientType == GT_GUARD_AREA)
+		gradient = guardAreasGradient[teamNumber][canSwim];
+	else
+		gradient = clearAreasGradient[teamNumber][canSwim];
+	AreaGradientInitialValue initialValue = { this, gradientType, teamNumber, canSwim };
+	areaGradientRepairer.repair(gradient, initialValue, cells);
+	setAreaGradientUpToDate(gradientType, teamNumber, canSwim);
+}
+
+void Map::updateForbiddenGradient(int teamNumber, const std::vector<size_t> &changedCells)
+{
+	for (int s=0; s<2; s++)
+		updateAreaGradient(GT_FORBIDDEN, teamNumber, s, changedCells);
+}
+
+void Map::updateGuardAreasGradient(int teamNumber, const std::vector<size_t> &changedCells)
+{
+	for (int s=0; s<2; s++)
+		updateAreaGradient(GT_GUARD_AREA, teamNumber, s, changedCells);
+}
+
+void Map::updateClearAreasGradient(int teamNumber, const std::vector<size_t> &changedCells)
+{
+	for (int s=0; s<2; s++)
+		updateAreaGradient(GT_CLEAR_AREA, teamNumber, s, changedCells);
+}
+
 bool Map::pathfindPointToPoint(int x, int y, int targetX, int targetY, int *dx, int *dy, bool canSwim, Uint32 teamMask, int maximumLength)
 {
 	//This implements a fairly standard A* algorithm, except that each node does not store the location
@@ -4997,7 +5296,7 @@ bool Map::pathfindPointToPoint(int x, int y, int targetX, int targetY, int *dx,
 
 void Map::initExploredArea(int teamNumber)
 {
-	std::fill(exploredArea[teamNumber], exploredArea[teamNumber] + size, 0);
+	std::fill(exploredArea[teamNumber], exploredArea[teamNumber] + size, exploredAreaAge[teamNumber]);
 }
 
 void Map::makeDiscoveredAreasExplored (int teamNumber)
@@ -5019,9 +5318,8 @@ void Map::makeDiscoveredAreasExplored (int teamNumber)
 
 void Map::updateExploredArea(int teamNumber)
 {
-	for (size_t i = 0; i < size; i++)
-		if (exploredArea[teamNumber][i] > 0)
-			exploredArea[teamNumber][i]--;
+	// All cells get one step less explored, see getExplored
+	exploredAreaAge[teamNumber]++;
 }
 
 void Map::regenerateMap(int x, int y, int w, int h)
@@ -22,7 +22,9 @@
 #ifndef __MAP_H
 #define __MAP_H
 
+#include <algorithm>
 #include <list>
+#include <vector>
 #include <assert.h>
 
 #include "Building.h"
@@ -31,14 +33,15 @@
 #include "Team.h"
 #include "TerrainType.h"
 #include "BitArray.h"
+#include "AreaGradient.h"
 
 class Unit;
 
 //! No global unit identifier. This value means there is no unit. Used at Case::groundUnit or Case::airUnit.
-#define NOGUID 0xFFFF
+#define NOGUID 0xFFFFFFFF
 
 //! No global building identifier. This value means there is no building. Used at Case::building.
-#define NOGBID 0xFFFF
+#define NOGBID 0xFFFFFFFF
 
 class Map;
 class Game;
@@ -50,12 +53,12 @@ class MapHeader;
 struct Case
 {
 	Uint16 terrain;
-	Uint16 building;
+	Uint32 building;
 
 	Ressource ressource;
 
-	Uint16 groundUnit;
-	Uint16 airUnit;
+	Uint32 groundUnit;
+	Uint32 airUnit;
 
 	Uint32 forbidden; // This is a mask, one bit by team, 1=forbidden, 0=allowed
 	///The difference between forbidden zone and hidden forbidden zone is that hidden forbidden zone
@@ -106,6 +109,10 @@ public:
 	bool load(GAGCore::InputStream *stream, MapHeader& header, Game *game=NULL);
 	//! Save a map
 	void save(GAGCore::OutputStream *stream);
+	//! Save the gradients and the other arrays that load() computes again, as they are at this step
+	void saveCaches(GAGCore::OutputStream *stream);
+	//! Load what saveCaches() saved, after load() for the same map
+	bool loadCaches(GAGCore::InputStream *stream);
 	
 	// add & remove teams, used by the map editor and the random map generator
 	// Have to be called *after* session.numberOfTeam has been changed.
@@ -138,6 +145,44 @@ public:
 	//! Return the number of sectors on y, which corresponds to the sector map height
 	int getSectorH(void) const { return hSector; }
 
+	//! Size, in cells, of the side of the blocks used to track changes for the views of the map (such as the minimap)
+	enum { CHANGE_BLOCK_SHIFT = 2, CHANGE_BLOCK_SIZE = 1<<CHANGE_BLOCK_SHIFT };
+	//! Return the number of change blocks on x
+	int getChangeBlocksW(void) const { return w>>CHANGE_BLOCK_SHIFT; }
+	//! Return the number of change blocks on y
+	int getChangeBlocksH(void) const { return h>>CHANGE_BLOCK_SHIFT; }
+	//! Mark the cell at (x, y) as changed for the views of the map. This never influences the game state.
+	void setCellChanged(int x, int y)
+	{
+		changedBlocks[(((y&hMask)>>CHANGE_BLOCK_SHIFT)<<(wDec-CHANGE_BLOCK_SHIFT))+((x&wMask)>>CHANGE_BLOCK_SHIFT)] = changeStamp;
+	}
+	//! Mark the whole map as changed for the views of the map
+	void setAllCellsChanged(void) { std::fill(changedBlocks.begin(), changedBlocks.end(), changeStamp); }
+	//! Return the stamp of the last change in block (bx, by), in change blocks coordinates
+	Uint32 getBlockChangeStamp(int bx, int by) const { return changedBlocks[(by<<(wDec-CHANGE_BLOCK_SHIFT))+bx]; }
+	//! Return the stamp given to the changes made since the previous call, and start a new one.
+	//! A view having seen the changes up to stamp s must redraw the blocks whose stamp is greater than s.
+	Uint32 advanceChangeStamp(void) { return changeStamp++; }
+	
+	//! Must be called when something the forbidden, guard area or clear area gradients depend on changes at pos,
+	//! other than the area flags changed by the orders: ressource type, building, terrain, immobile unit, forbidden flag.
+	//! The cell is repaired with the next incremental update of each gradient.
+	void setAreaGradientSourceChanged(size_t pos)
+	{
+		if (areaGradientChanges.size() < (size>>3))
+			areaGradientChanges.push_back(pos);
+		else
+			invalidateAreaGradients();
+	}
+	void setAreaGradientSourceChanged(int x, int y) { setAreaGradientSourceChanged(((y&hMask)<<wDec)+(x&wMask)); }
+	//! The next update of each forbidden, guard area and clear area gradient will be a full one, for instance
+	//! because alliances changed or too many cells changed to be worth a repair
+	void invalidateAreaGradients(void)
+	{
+		areaGradientChangesStart += areaGradientChanges.size() + 1;
+		areaGradientChanges.clear();
+	}
+
 	///Returns a normalized version of the x cordinate, taking into account that x cordinates wrap arround
 	int normalizeX(int x)
 	{
@@ -154,6 +199,8 @@ public:
 	void setMapDiscovered(int x, int y, Uint32 sharedVision)
 	{
 		size_t index = ((y&hMask)<<wDec)+(x&wMask);
+		if ((fogOfWar[index] & sharedVision) != sharedVision || (mapDiscovered[index] & sharedVision) != sharedVision)
+			setCellChanged(x, y);
 		mapDiscovered[index] |= sharedVision;
 		fogOfWarA[index] |= sharedVision;
 		fogOfWarB[index] |= sharedVision;
@@ -162,15 +209,25 @@ public:
 	//! Set map to discovered state at rect (x, y, w, h) for all teams in sharedVision (mask).
 	void setMapDiscovered(int x, int y, int w, int h,  Uint32 sharedVision)
 	{
-		for (int dx=x; dx<x+w; dx++)
-			for (int dy=y; dy<y+h; dy++)
-				setMapDiscovered(dx, dy, sharedVision);
+		for (int dy=y; dy<y+h; dy++)
+		{
+			size_t line = (dy&hMask)<<wDec;
+			for (int dx=x; dx<x+w; dx++)
+			{
+				size_t index = line+(dx&wMask);
+				if ((fogOfWar[index] & sharedVision) != sharedVision || (mapDiscovered[index] & sharedVision) != sharedVision)
+					setCellChanged(dx, dy);
+				mapDiscovered[index] |= sharedVision;
+				fogOfWarA[index] |= sharedVision;
+				fogOfWarB[index] |= sharedVision;
+			}
+		}
 	}
 
 	//! Make the building at (x, y) visible for all teams in sharedVision (mask).
 	void setMapBuildingsDiscovered(int x, int y, Uint32 sharedVision, Team *teams[Team::MAX_COUNT])
 	{
-		Uint16 bgid = (cases+((y&hMask)<<wDec)+(x&wMask))->building;
+		Uint32 bgid = (cases+((y&hMask)<<wDec)+(x&wMask))->building;
 		if (bgid != NOGBID)
 		{
 			int id = Building::GIDtoID(bgid);
@@ -179,7 +236,10 @@ public:
 			assert(id<Building::MAX_COUNT);
 			assert(team>=0);
 			assert(team<Team::MAX_COUNT);
-			teams[team]->myBuildings[id]->seenByMask|=sharedVision;
+			Building *b = teams[team]->myBuildings[id];
+			if ((b->seenByMask & sharedVision) != sharedVision)
+				setCellChanged(x, y);
+			b->seenByMask|=sharedVision;
 		}
 	}
 
@@ -194,24 +254,26 @@ public:
 	//! Make the map at rect (x, y, w, h) explored by unit, i.e. to 255
 	void setMapExploredByUnit(int x, int y, int w, int h, int team)
 	{
-		for (int dx = x; dx < x + w; dx++)
-			for (int dy = y; dy < y + h; dy++)
-				exploredArea[team][((dy & hMask) << wDec) | (dx & wMask)] = 255;
+		Uint32 expiry = exploredAreaAge[team] + 255;
+		for (int dy = y; dy < y + h; dy++)
+			for (int dx = x; dx < x + w; dx++)
+				exploredArea[team][((dy & hMask) << wDec) | (dx & wMask)] = expiry;
 	}
 	
 	//! Make the map at rect (x, y, w, h) explored by building, i.e. to minimum 2
 	void setMapExploredByBuilding(int x, int y, int w, int h, int team)
 	{
-		for (int dx = x; dx < x + w; dx++)
-			for (int dy = y; dy < y + h; dy++)
-				if (exploredArea[team][((dy & hMask) << wDec) | (dx & wMask)] < 2)
-					exploredArea[team][((dy & hMask) << wDec) | (dx & wMask)] = 2;
+		for (int dy = y; dy < y + h; dy++)
+			for (int dx = x; dx < x + w; dx++)
+				if (getExplored(dx, dy, team) < 2)
+					exploredArea[team][((dy & hMask) << wDec) | (dx & wMask)] = exploredAreaAge[team] + 2;
 	}
 
 	//! Set all map for all teams to undiscovered state
 	void unsetMapDiscovered(void)
 	{
 		memset(mapDiscovered, 0, w*h*sizeof(Uint32));
+		setAllCellsChanged();
 	}
 
 	//! Returs true if map is discovered at position (x,y) for a given vision mask.
@@ -242,6 +304,7 @@ public:
 	void setMapDiscovered(void)
 	{
 		memset(mapDiscovered, ~0u, w*h*sizeof(Uint32));
+		setAllCellsChanged();
 	}
 
 	//! Returs true if map is currently discovered at position (x,y) for a given vision mask.
@@ -347,9 +410,13 @@ public:
 		return cases[((y&hMask)<<wDec)+(x&wMask)].forbidden;
 	}
 	
+	//! Returns how recently (x, y) was explored by team, 0=unexplored, 255=just explored
 	Uint8 getExplored(int x, int y, int team)
 	{
-		return exploredArea[team][((y&hMask)<<wDec)+(x&wMask)];
+		Uint32 expiry = exploredArea[team][((y&hMask)<<wDec)+(x&wMask)];
+		Uint32 age = exploredAreaAge[team];
+		// expiry is at most 255 after age, so this also works when the counters wrap
+		return (expiry - age <= 255) ? (Uint8)(expiry - age) : 0;
 	}
 	
 	Uint8 getGuardAreasGradient(int x, int y, bool canSwim, int team)
@@ -360,22 +427,27 @@ public:
 	void setTerrain(int x, int y, Uint16 terrain)
 	{
 		cases[((y&hMask)<<wDec)+(x&wMask)].terrain = terrain;
+		setCellChanged(x, y);
+		setAreaGradientSourceChanged(x, y);
 	}
 	
 	void setForbidden(int x, int y, Uint32 forbidden)
 	{
 		cases[((y&hMask)<<wDec)+(x&wMask)].forbidden = forbidden;
+		setAreaGradientSourceChanged(x, y);
 	}
 	
 	void addForbidden(int x, int y, Uint32 teamNum)
 	{
 		cases[((y&hMask)<<wDec)+(x&wMask)].forbidden |=  Team::teamNumberToMask(teamNum);
+		setAreaGradientSourceChanged(x, y);
 	}
 
 	void removeForbidden(int x, int y, Uint32 teamNum)
 	{
 		Case& c=cases[((y&hMask)<<wDec)+(x&wMask)];
 		c.forbidden ^= c.forbidden &  Team::teamNumberToMask(teamNum);
+		setAreaGradientSourceChanged(x, y);
 	}
 	
 	void addClearArea(int x, int y, Uint32 teamNum)
@@ -469,19 +541,19 @@ public:
 	bool isFreeForAirUnit(int x, int y) { return (getAirUnit(x+w, y+h)==NOGUID); }
 	bool isFreeForBuilding(int x, int y);
 	bool isFreeForBuilding(int x, int y, int w, int h);
-	bool isFreeForBuilding(int x, int y, int w, int h, Uint16 gid);
+	bool isFreeForBuilding(int x, int y, int w, int h, Uint32 gid);
 	// The "hardSpace" keywork means "Free" but you don't count Ground-Units as obstacles.
 	bool isHardSpaceForGroundUnit(int x, int y, bool canSwim, Uint32 me);
 	bool isHardSpaceForBuilding(int x, int y);
 	bool isHardSpaceForBuilding(int x, int y, int w, int h);
-	bool isHardSpaceForBuilding(int x, int y, int w, int h, Uint16 gid);
+	bool isHardSpaceForBuilding(int x, int y, int w, int h, Uint32 gid);
 	
 	//! Return true if unit has contact with building gbid. If true, put contact direction in dx, dy
-	bool doesUnitTouchBuilding(Unit *unit, Uint16 gbid, int *dx, int *dy);
+	bool doesUnitTouchBuilding(Unit *unit, Uint32 gbid, int *dx, int *dy);
 	//! Return true if (x,y) has contact with building gbid.
-	bool doesPosTouchBuilding(int x, int y, Uint16 gbid);
+	bool doesPosTouchBuilding(int x, int y, Uint32 gbid);
 	//! Return true if (x,y) has contact with building gbid. If true, put contact direction in dx, dy
-	bool doesPosTouchBuilding(int x, int y, Uint16 gbid, int *dx, int *dy);
+	bool doesPosTouchBuilding(int x, int y, Uint32 gbid, int *dx, int *dy);
 	
 	//! Return true if unit has contact with ressource of any ressourceType. If true, put contact direction in dx, dy
 	bool doesUnitTouchRessource(Unit *unit, int *dx, int *dy);
@@ -493,11 +565,11 @@ public:
 	bool doesUnitTouchEnemy(Unit *unit, int *dx, int *dy);
 
 	//! Sets this particular clearing area location as claimed
-	void setClearingAreaClaimed(int x, int y, int teamNumber, int gid);
+	void setClearingAreaClaimed(int x, int y, int teamNumber, Uint32 gid);
 	//! Sets this particular clearing area location as unclaimed
 	void setClearingAreaUnclaimed(int x, int y, int teamNumber);
 	//! Returns the gid if this clearing area is claimed, NOGUID otherwise
-	int isClearingAreaClaimed(int x, int y, int teamNumber);
+	Uint32 isClearingAreaClaimed(int x, int y, int teamNumber);
 
 	//! Marks a particular square as containing an immobile unit
 	void markImmobileUnit(int x, int y, int teamNumber);
@@ -509,26 +581,57 @@ public:
 	Uint8 getImmobileUnit(int x, int y);
 
 	//! Return GID
-	Uint16 getGroundUnit(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].groundUnit; }
-	Uint16 getAirUnit(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].airUnit; }
-	Uint16 getBuilding(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].building; }
+	Uint32 getGroundUnit(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].groundUnit; }
+	Uint32 getAirUnit(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].airUnit; }
+	Uint32 getBuilding(int x, int y) { return cases[((y&hMask)<<wDec)+(x&wMask)].building; }
 	
-	void setGroundUnit(int x, int y, Uint16 guid) { cases[((y&hMask)<<wDec)+(x&wMask)].groundUnit = guid; }
-	void setAirUnit(int x, int y, Uint16 guid) { cases[((y&hMask)<<wDec)+(x&wMask)].airUnit = guid; }
-	void setBuilding(int x, int y, int w, int h, Uint16 gbid)
+	void setGroundUnit(int x, int y, Uint32 guid)
+	{
+		Case &c = cases[((y&hMask)<<wDec)+(x&wMask)];
+		if (c.groundUnit != guid)
+		{
+			updateSectorTeamsPresence(x, y, c.groundUnit, guid, false);
+			setCellChanged(x, y);
+		}
+		c.groundUnit = guid;
+	}
+	void setAirUnit(int x, int y, Uint32 guid)
+	{
+		Case &c = cases[((y&hMask)<<wDec)+(x&wMask)];
+		if (c.airUnit != guid)
+		{
+			updateSectorTeamsPresence(x, y, c.airUnit, guid, false);
+			setCellChanged(x, y);
+		}
+		c.airUnit = guid;
+	}
+	void setBuilding(int x, int y, int w, int h, Uint32 gbid)
 	{
 		for (int yi=y; yi<y+h; yi++)
 			for (int xi=x; xi<x+w; xi++)
-				cases[((yi&hMask)<<wDec)+(xi&wMask)].building = gbid;
+			{
+				Case &c = cases[((yi&hMask)<<wDec)+(xi&wMask)];
+				if (c.building != gbid)
+				{
+					updateSectorTeamsPresence(xi, yi, c.building, gbid, true);
+					setCellChanged(xi, yi);
+					setAreaGradientSourceChanged(xi, yi);
+				}
+				c.building = gbid;
+			}
 	}
 	
+	//! Returns the mask of the teams having a unit or a building in one of the sectors covering the rectangle (x, y, w, h).
+	//! The sectors being 16x16, this is a superset of the teams actually present in the rectangle.
+	Uint32 getSectorsTeamsPresence(int x, int y, int w, int h);
+	
 	//! Return sector at (x,y).
 	Sector *getSector(int x, int y) { return &(sectors[wSector*((y&hMask)>>4)+((x&wMask)>>4)]); }
 	//! Return a sector in the sector array. It is not clean because too high level
 	Sector *getSector(int i) { assert(i>=0); assert(i<sizeSector); return sectors+i; }
 
 	//! Set undermap terrain type at (x,y) (undermap positions)
-	void setUMTerrain(int x, int y, TerrainType t) { undermap[((y&hMask)<<wDec)+(x&wMask)] = (Uint8)t; }
+	void setUMTerrain(int x, int y, TerrainType t) { undermap[((y&hMask)<<wDec)+(x&wMask)] = (Uint8)t; setCellChanged(x, y); }
 	//! Return undermap terrain type at (x,y)
 	TerrainType getUMTerrain(int x, int y) { return (TerrainType)undermap[((y&hMask)<<wDec)+(x&wMask)]; }
 	//! Set undermap terrain type at (x,y) (undermap positions) on an area
@@ -660,6 +763,13 @@ public:
 	template<typename Tint> void updateClearAreasGradient(int teamNumber, bool canSwim);
 	void updateClearAreasGradient(int teamNumber);
 	void updateClearAreasGradient();
+	//! Update the forbidden, guard area and clear area gradients of teamNumber after the flags of the cells in changedCells
+	//! were modified. Only the cells whose value depended on the changed ones, or on the cells recorded by
+	//! setAreaGradientSourceChanged since the last update, are computed again. The result is always the same as the
+	//! one of a full update.
+	void updateForbiddenGradient(int teamNumber, const std::vector<size_t> &changedCells);
+	void updateGuardAreasGradient(int teamNumber, const std::vector<size_t> &changedCells);
+	void updateClearAreasGradient(int teamNumber, const std::vector<size_t> &changedCells);
 	
 	///Implements A* algorithm for point to point pathfinding. Does not cache path, designed to be fast
 	bool pathfindPointToPoint(int x, int y, int targetX, int targetY, int *dx, int *dy, bool canSwim, Uint32 teamMask, int maximumLength);
@@ -780,6 +890,11 @@ public:
 	//! true = clear area
 	Utilities::BitArray localClearAreaMap;
 	
+	//! Stamp given to the changes made from now on, see advanceChangeStamp()
+	Uint32 changeStamp;
+	//! For each block of CHANGE_BLOCK_SIZE x CHANGE_BLOCK_SIZE cells, the stamp of its last change
+	std::vector<Uint32> changedBlocks;
+	
 	///This is the maximum fertility of any point on the map
 	Uint16 fertilityMaximum;
 	
@@ -803,13 +918,17 @@ public:
 	
 	// Used to guide explorers
 	//[int team]
-	// 0=unexplored, 255=just explored
-	Uint8 *exploredArea[Team::MAX_COUNT];
+	// The value of exploredAreaAge at which the cell becomes unexplored again, see getExplored.
+	// Aging the whole area is thus done by incrementing exploredAreaAge.
+	Uint32 *exploredArea[Team::MAX_COUNT];
+	//[int team]
+	// The number of times the explored area has aged
+	Uint32 exploredAreaAge[Team::MAX_COUNT];
 	
 	/// This shows how many "claims" there are on a particular ressource square
 	/// This is so that not all 150 free units go after one piece of wood
 	/// Each square is the gid of the claiming unit
-	Uint16 *clearingAreaClaims[Team::MAX_COUNT];
+	Uint32 *clearingAreaClaims[Team::MAX_COUNT];
 	
 	/// These are integers that tell whether an immobile unit is standing on the
 	/// square, and if so, what team number it is. In terms of the engine, these
@@ -828,10 +947,35 @@ protected:
 	Uint8 **listedAddr;
 	size_t size;
 
+	//! Returns the value of the cell at pos in a forbidden, guard area or clear area gradient before propagation
+	Uint8 areaGradientInitialValue(GradientType gradientType, size_t pos, int teamNumber, bool canSwim);
+	//! Gives areaGradientInitialValue to AreaGradient::repair
+	struct AreaGradientInitialValue;
+	//! Updates an area gradient after the initial value of changedCells changed, repairing it if possible
+	void updateAreaGradient(GradientType gradientType, int teamNumber, bool canSwim, const std::vector<size_t> &changedCells);
+	//! Records that an area gradient was just computed fully
+	void setAreaGradientUpToDate(GradientType gradientType, int teamNumber, bool canSwim);
+	AreaGradient areaGradientRepairer;
+	//! Cells given to setAreaGradientSourceChanged, the first one being change number areaGradientChangesStart
+	std::vector<size_t> areaGradientChanges;
+	Uint64 areaGradientChangesStart;
+	//! For each team, forbidden, guard area and clear area gradient, and canSwim, the number of changes already repaired.
+	//! If it is lower than areaGradientChangesStart, some were dropped and the next update must be a full one.
+	Uint64 areaGradientChangesSeen[Team::MAX_COUNT][3][2];
+
 	Sector *sectors;
 	Sint32 wSector, hSector;
 	int sizeSector;
 	
+	//! Number of cells of each sector occupied by a unit or a building of each team, indexed by sector*Team::MAX_COUNT+team
+	Uint16 *sectorsTeamsCount;
+	//! For each sector, mask of the teams having a non-zero count in sectorsTeamsCount
+	Uint32 *sectorsTeamsPresence;
+	//! Moves the occupation of cell (x, y) in sectorsTeamsCount from the team of oldGid to the team of newGid
+	void updateSectorTeamsPresence(int x, int y, Uint32 oldGid, Uint32 newGid, bool isBuilding);
+	//! Allocates sectorsTeamsCount and sectorsTeamsPresence and counts the units and buildings already in cases
+	void initSectorsTeamsPresence();
+	
 	
 	///This is a single point in the array used for A* algorithm
 	struct AStarAlgorithmPoint
@@ -2508,7 +2508,7 @@ void MapEdit::performAction(const std::string& action, int relMouseX, int relMou
 	{
 		int x;
 		int y;
-		int gid=NOGUID;
+		Uint32 gid=NOGUID;
 		game.map.displayToMapCaseAligned(mouseX, mouseY, &x, &y, viewportX, viewportY);
 		if(game.map.getAirUnit(x, y)!=NOGUID)
 		{
@@ -2639,7 +2639,7 @@ void MapEdit::performAction(const std::string& action, int relMouseX, int relMou
 		int x;
 		int y;
 		game.map.displayToMapCaseAligned(mouseX, mouseY, &x, &y, viewportX, viewportY);
-		int gid=NOGBID;
+		Uint32 gid=NOGBID;
 		for(int t=0; t<32; ++t)
 		{
 			if(game.teams[t] && gid==NOGBID)
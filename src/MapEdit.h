@@ -756,9 +756,9 @@ private:
 	int placingUnitLevel;
 
 	///The gid of the unit that is currently selected
-	int selectedUnitGID;
+	Uint32 selectedUnitGID;
 	///The gid of the building that is currently selected
-	int selectedBuildingGID;
+	Uint32 selectedBuildingGID;
 	
 	///Tells whether the text input box
 	bool isShowingAreaName;
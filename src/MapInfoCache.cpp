@@ -0,0 +1,298 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "MapInfoCache.h"
+#include "MapHeader.h"
+#include "Version.h"
+#include <BinaryStream.h>
+#include <FileManager.h>
+#include <Stream.h>
+#include <StreamBackend.h>
+#include <Toolkit.h>
+#include <algorithm>
+#include <memory>
+
+using namespace GAGCore;
+
+/// The file holding the cache, in the thumbnails write directory
+static const char *cacheFileName = "thumbnails/mapinfo.cache";
+
+MapInfoCache::MapInfoCache()
+{
+	loaded = false;
+	dirty = false;
+	stopRequested = false;
+	thread = NULL;
+}
+
+MapInfoCache::~MapInfoCache()
+{
+	stopWorker();
+	save();
+}
+
+bool MapInfoCache::get(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail)
+{
+	Uint32 mtime, size;
+	if (!getFileStamp(fileName, mtime, size))
+		return false;
+	
+	Entry entry;
+	bool found = false;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		loadIfNeeded();
+		if (isUpToDate(fileName, mtime, size))
+		{
+			entry = entries[fileName];
+			found = true;
+		}
+	}
+	
+	if (!found)
+	{
+		if (!computeEntry(fileName, entry))
+			return false;
+		boost::mutex::scoped_lock lock(mutex);
+		entries[fileName] = entry;
+		dirty = true;
+	}
+	
+	// the constructor leaves the position after the data, rewind it before reading
+	MemoryStreamBackend *backend = new MemoryStreamBackend(entry.header.data(), entry.header.size());
+	backend->seekFromStart(0);
+	InputStream *stream = new BinaryInputStream(backend);
+	bool good = header.load(stream);
+	delete stream;
+	backend = new MemoryStreamBackend(entry.thumbnail.data(), entry.thumbnail.size());
+	backend->seekFromStart(0);
+	stream = new BinaryInputStream(backend);
+	thumbnail.decodeData(stream, VERSION_MINOR);
+	delete stream;
+	
+	// a damaged entry must not hide the map, forget it and read the file instead
+	if (!good || !thumbnail.isLoaded())
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			entries.erase(fileName);
+			dirty = true;
+		}
+		return loadWithoutCache(fileName, header, thumbnail);
+	}
+	return true;
+}
+
+bool MapInfoCache::loadWithoutCache(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail)
+{
+	InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(fileName));
+	bool good = !stream->isEndOfStream() && header.load(stream);
+	delete stream;
+	if (good)
+		thumbnail.loadFromMap(fileName);
+	return good;
+}
+
+void MapInfoCache::prefetch(const std::vector<std::string>& fileNames)
+{
+	stopWorker();
+	
+	boost::mutex::scoped_lock lock(mutex);
+	// the worker takes files from the back, so that they are done in the order given
+	queue.assign(fileNames.rbegin(), fileNames.rend());
+	stopRequested = false;
+	if (!queue.empty())
+		thread = new boost::thread(boost::ref(*this));
+}
+
+void MapInfoCache::cancelPrefetch()
+{
+	stopWorker();
+	boost::mutex::scoped_lock lock(mutex);
+	queue.clear();
+}
+
+void MapInfoCache::save()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if (!dirty)
+		return;
+	
+	OutputStream *stream = new BinaryOutputStream(Toolkit::getFileManager()->openOutputStreamBackend(cacheFileName));
+	if (stream->isEndOfStream())
+	{
+		delete stream;
+		return;
+	}
+	stream->writeUint32(VERSION_MINOR, "versionMinor");
+	stream->writeUint32(entries.size(), "count");
+	for (Entries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+	{
+		stream->writeText(it->first, "fileName");
+		stream->writeUint32(it->second.mtime, "mtime");
+		stream->writeUint32(it->second.size, "size");
+		stream->writeUint32(it->second.header.size(), "headerSize");
+		stream->write(it->second.header.data(), it->second.header.size(), "header");
+		stream->writeUint32(it->second.thumbnail.size(), "thumbnailSize");
+		stream->write(it->second.thumbnail.data(), it->second.thumbnail.size(), "thumbnail");
+	}
+	delete stream;
+	dirty = false;
+}
+
+void MapInfoCache::operator()()
+{
+	while (true)
+	{
+		std::string fileName;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			if (stopRequested || queue.empty())
+				break;
+			fileName = queue.back();
+			queue.pop_back();
+		}
+		
+		Uint32 mtime, size;
+		if (!getFileStamp(fileName, mtime, size))
+			continue;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			loadIfNeeded();
+			if (isUpToDate(fileName, mtime, size))
+				continue;
+		}
+		
+		Entry entry;
+		if (computeEntry(fileName, entry))
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			entries[fileName] = entry;
+			dirty = true;
+		}
+	}
+	save();
+}
+
+void MapInfoCache::loadIfNeeded()
+{
+	if (loaded)
+		return;
+	loaded = true;
+	
+	InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(cacheFileName));
+	if (stream->isEndOfStream())
+	{
+		delete stream;
+		return;
+	}
+	// thumbnails drawn by other versions may differ, start again
+	Uint32 versionMinor = stream->readUint32("versionMinor");
+	if (versionMinor != VERSION_MINOR)
+	{
+		delete stream;
+		return;
+	}
+	Uint32 count = stream->readUint32("count");
+	for (Uint32 i = 0; i < count && !stream->isEndOfStream(); i++)
+	{
+		std::string fileName = stream->readText("fileName");
+		Entry &entry = entries[fileName];
+		entry.mtime = stream->readUint32("mtime");
+		entry.size = stream->readUint32("size");
+		Uint32 headerSize = stream->readUint32("headerSize");
+		entry.header.resize(headerSize);
+		if (headerSize)
+			stream->read(&entry.header[0], headerSize, "header");
+		Uint32 thumbnailSize = stream->readUint32("thumbnailSize");
+		entry.thumbnail.resize(thumbnailSize);
+		if (thumbnailSize)
+			stream->read(&entry.thumbnail[0], thumbnailSize, "thumbnail");
+	}
+	delete stream;
+}
+
+bool MapInfoCache::getFileStamp(const std::string& fileName, Uint32& mtime, Uint32& size)
+{
+	std::auto_ptr<StreamBackend> backend(Toolkit::getFileManager()->openInputStreamBackend(fileName));
+	if (backend->isEndOfStream())
+		return false;
+	backend->seekFromEnd(0);
+	size = backend->getPosition();
+	mtime = Toolkit::getFileManager()->mtime(fileName);
+	return true;
+}
+
+bool MapInfoCache::isUpToDate(const std::string& fileName, Uint32 mtime, Uint32 size)
+{
+	Entries::const_iterator it = entries.find(fileName);
+	return (it != entries.end()) && (it->second.mtime == mtime) && (it->second.size == size);
+}
+
+bool MapInfoCache::computeEntry(const std::string& fileName, Entry& entry)
+{
+	boost::mutex::scoped_lock lock(loadMutex);
+	
+	if (!getFileStamp(fileName, entry.mtime, entry.size))
+		return false;
+	
+	// keep the bytes of the header, to load it exactly as from the file
+	InputStream *stream = new BinaryInputStream(Toolkit::getFileManager()->openInputStreamBackend(fileName));
+	if (stream->isEndOfStream())
+	{
+		delete stream;
+		return false;
+	}
+	MapHeader header;
+	if (!header.load(stream))
+	{
+		delete stream;
+		return false;
+	}
+	size_t headerSize = stream->getPosition();
+	entry.header.resize(headerSize);
+	stream->seekFromStart(0);
+	stream->read(&entry.header[0], headerSize, "header");
+	delete stream;
+	
+	MapThumbnail thumbnail;
+	thumbnail.loadFromMap(fileName);
+	if (!thumbnail.isLoaded())
+		return false;
+	MemoryStreamBackend *backend = new MemoryStreamBackend();
+	OutputStream *thumbnailStream = new BinaryOutputStream(backend);
+	thumbnail.encodeData(thumbnailStream);
+	entry.thumbnail.assign(backend->getBuffer(), backend->getPosition());
+	delete thumbnailStream;
+	return true;
+}
+
+void MapInfoCache::stopWorker()
+{
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		stopRequested = true;
+	}
+	if (thread)
+	{
+		thread->join();
+		delete thread;
+		thread = NULL;
+	}
+}
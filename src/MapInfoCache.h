@@ -0,0 +1,94 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __MAP_INFO_CACHE_H
+#define __MAP_INFO_CACHE_H
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "MapThumbnail.h"
+
+class MapHeader;
+
+/// Keeps the headers and thumbnails of map and game files on disk, so that browsing them
+/// does not require loading the whole map. Entries are keyed by file name and are thrown
+/// away when the modification time or the size of the file changes. A worker thread fills
+/// the entries of the files passed to prefetch() while the user browses.
+class MapInfoCache
+{
+public:
+	MapInfoCache();
+	~MapInfoCache();
+	
+	/// Sets header and thumbnail to those of fileName, from the cache or by loading the file. Returns false if it is not a valid map
+	bool get(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail);
+	/// Fills the cache for fileNames in the background, replacing the previous requests
+	void prefetch(const std::vector<std::string>& fileNames);
+	/// Drops the files left to prefetch and waits for the one being loaded, if any
+	void cancelPrefetch();
+	/// Writes the cache to disk if it changed
+	void save();
+	
+	/// Body of the worker thread
+	void operator()();
+	
+private:
+	struct Entry
+	{
+		Uint32 mtime;
+		Uint32 size;
+		/// The bytes of the map header, as in the file
+		std::string header;
+		/// The thumbnail, as written by MapThumbnail::encodeData, which compresses it
+		std::string thumbnail;
+	};
+	typedef std::map<std::string, Entry> Entries;
+	
+	/// Reads the cache from disk, the first time it is needed. mutex must be locked
+	void loadIfNeeded();
+	/// Returns the modification time and size of fileName, false if it can't be opened
+	static bool getFileStamp(const std::string& fileName, Uint32& mtime, Uint32& size);
+	/// Returns true if there is an entry for fileName with this stamp. mutex must be locked
+	bool isUpToDate(const std::string& fileName, Uint32 mtime, Uint32 size);
+	/// Loads fileName to compute its entry, returns false if it is not a valid map
+	bool computeEntry(const std::string& fileName, Entry& entry);
+	/// Sets header and thumbnail by loading fileName, without the cache. Returns false if it is not a valid map
+	bool loadWithoutCache(const std::string& fileName, MapHeader& header, MapThumbnail& thumbnail);
+	/// Waits for the worker thread to finish
+	void stopWorker();
+	
+	Entries entries;
+	bool loaded;
+	bool dirty;
+	
+	/// Files left to prefetch, the worker thread takes them from the back
+	std::vector<std::string> queue;
+	bool stopRequested;
+	boost::thread *thread;
+	
+	/// Protects everything above
+	boost::mutex mutex;
+	/// Held while loading a map, so that only one is loaded at a time
+	boost::mutex loadMutex;
+};
+
+#endif
@@ -189,10 +189,10 @@ void MapThumbnail::decodeData(GAGCore::InputStream* stream, Uint32 versionMinor)
 	stream->read(compressed, compressedLength, "compressed");
 	//uncompress with zlib
 	unsigned long uncompLen = 128 * 128 * 3;
-	uncompress(buffer, &uncompLen, compressed, compressedLength);
+	int result = uncompress(buffer, &uncompLen, compressed, compressedLength);
 	stream->readLeaveSection();
 	delete[] compressed;
-	loaded=true;
+	loaded = (result == Z_OK && uncompLen == 128 * 128 * 3);
 }
 
 
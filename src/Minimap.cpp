@@ -45,8 +45,11 @@ Minimap::Minimap(bool nox, int menuWidth, int gameWidth, int xOffset, int yOffse
 {
 	if (nox) return;
 
-  // since the update loop goes by row store that row so we gan draw the gray "radar" line 
-	update_row = -1;
+	game = NULL;
+	// the first draw computes the whole picture
+	fullRefresh = true;
+	lastMap = NULL;
+	lastChangeStamp = 0;
 	// The actual minimap picture to be drawn to.
 	surface=new DrawableSurface(width, height);
 }
@@ -63,6 +66,38 @@ void Minimap::setGame(Game& ngame)
 {
 	if (noX) return;
 	game = &ngame;
+	fullRefresh = true;
+}
+
+
+
+// Draws the white line of the viewport square from x1 up to x2 (excluded) at y, wrapping
+// from max back to min
+static void drawWrappedHorzLine(int x1, int x2, int y, int min, int max)
+{
+	if (x1 <= x2)
+	{
+		globalContainer->gfx->drawHorzLine(x1, y, x2-x1, 255, 255, 255);
+	}
+	else
+	{
+		globalContainer->gfx->drawHorzLine(x1, y, max-x1, 255, 255, 255);
+		globalContainer->gfx->drawHorzLine(min, y, x2-min, 255, 255, 255);
+	}
+}
+
+// Same as drawWrappedHorzLine(), for the vertical lines
+static void drawWrappedVertLine(int x, int y1, int y2, int min, int max)
+{
+	if (y1 <= y2)
+	{
+		globalContainer->gfx->drawVertLine(x, y1, y2-y1, 255, 255, 255);
+	}
+	else
+	{
+		globalContainer->gfx->drawVertLine(x, y1, max-y1, 255, 255, 255);
+		globalContainer->gfx->drawVertLine(x, min, y2-min, 255, 255, 255);
+	}
 }
 
 
@@ -108,26 +143,20 @@ void Minimap::draw(int localteam, int viewportX, int viewportY, int viewportW, i
 	offset_x = game->teams[localteam]->startPosX - game->map.getW() / 2;
 	offset_y = game->teams[localteam]->startPosY - game->map.getH() / 2;
 
-	///What row the scan-line ("radar") is to be drawn at
-	int line_row = 0;
-
-	//Render the colorMap and blit the surface
-	if(update_row == -1)
+	//Bring the picture up to date and blit the surface
+	if (needsFullRefresh(localteam))
 	{
-	  // clear the minimap by drawing a black rect over it
+		// clear the minimap by drawing a black rect over it
 		surface->drawFilledRect(0, 0, width, height, 0, 0, 0, Color::ALPHA_OPAQUE);
-		update_row = 0;
-		refreshPixelRows(0, mini_h, localteam);
+		computeBlocksToPixels();
+		lastChangeStamp = game->map.advanceChangeStamp();
+		for (int y=0; y<mini_h; y++)
+			computeColors(y, localteam);
+		fullRefresh = false;
 	}
 	else
 	{
-		///Render 1/25th of the rows at a time
-		const int rows_to_render = std::max(1, mini_h/25);
-		
-		refreshPixelRows(update_row, (update_row + rows_to_render) % (mini_h), localteam);
-		update_row += rows_to_render;
-		update_row %= (mini_h);
-		line_row = update_row;
+		refreshChangedPixels(localteam);
 	}
 	//Draw the surface
 	globalContainer->gfx->drawSurface(gameWidth-menuWidth+xOffset, yOffset, surface);
@@ -139,31 +168,14 @@ void Minimap::draw(int localteam, int viewportX, int viewportY, int viewportW, i
 	convertToScreen(viewportX, viewportY, startx, starty);
 	convertToScreen(viewportX + viewportW, viewportY + viewportH, endx, endy);
 
-	for (int n=startx; n!=endx;)
-	{
-		globalContainer->gfx->drawPixel(n, starty, 255, 255, 255);
-		globalContainer->gfx->drawPixel(n, endy, 255, 255, 255);
-		
-		n+=1;
-		if(n == (mini_x + mini_w))
-			n = mini_x;
-	}
-	for (int n=starty; n!=endy;)
-	{
-		globalContainer->gfx->drawPixel(startx, n, 255, 255, 255);
-		globalContainer->gfx->drawPixel(endx, n, 255, 255, 255);
-		n+=1;
-		if(n == (mini_y + mini_h))
-			n = mini_y;
-	}
+	drawWrappedHorzLine(startx, endx, starty, mini_x, mini_x + mini_w);
+	drawWrappedHorzLine(startx, endx, endy, mini_x, mini_x + mini_w);
+	drawWrappedVertLine(startx, starty, endy, mini_y, mini_y + mini_h);
+	drawWrappedVertLine(endx, starty, endy, mini_y, mini_y + mini_h);
 	///The lines are out of alignment, so a single pixel in the bottom right hand of the square
 	///is never drawn
 	globalContainer->gfx->drawPixel(endx, endy, 255, 255, 255);
 
-	///Draw the line that shows where the minimap is currently updating
-	if(minimapMode == HideFOW)
-		globalContainer->gfx->drawHorzLine(mini_x, mini_y + line_row , mini_w, 100, 100, 100);
-	
 	///Draw a 1 pixel border arround the minimap
 	globalContainer->gfx->drawRect(gameWidth-menuWidth+xOffset-1,
 	                               yOffset-1, 
@@ -212,7 +224,7 @@ void Minimap::convertToScreen(int nx, int ny, int& x, int& y)
 
 void Minimap::resetMinimapDrawing()
 {
-	update_row = -1;
+	fullRefresh = true;
 }
 
 
@@ -256,19 +268,107 @@ void Minimap::computeMinimapPositioning()
 
 
 
-void Minimap::refreshPixelRows(int start, int end, int localteam)
+bool Minimap::needsFullRefresh(int localteam)
+{
+	Uint32 visibleTeams = game->teams[localteam]->me;
+	if (globalContainer->replaying) visibleTeams = globalContainer->replayVisibleTeams;
+	Uint32 allies = game->teams[localteam]->allies;
+
+	// the colors of the units and buildings depend on the local team and its alliances,
+	// and their positioning depends on the local team start position
+	if (lastMap != &game->map || lastLocalTeam != localteam || lastVisibleTeams != visibleTeams
+		|| lastAllies != allies || lastMinimapMode != minimapMode
+		|| lastOffsetX != offset_x || lastOffsetY != offset_y
+		|| lastMiniW != mini_w || lastMiniH != mini_h)
+		fullRefresh = true;
+
+	lastMap = &game->map;
+	lastLocalTeam = localteam;
+	lastVisibleTeams = visibleTeams;
+	lastAllies = allies;
+	lastMinimapMode = minimapMode;
+	lastOffsetX = offset_x;
+	lastOffsetY = offset_y;
+	lastMiniW = mini_w;
+	lastMiniH = mini_h;
+
+	return fullRefresh;
+}
+
+
+
+void Minimap::computeBlocksToPixels()
 {
 	if (noX) return;
 
-	for(int y=start; y!=end;)
+	Map &map = game->map;
+	const int dMx = ((map.getW())<<16) / (mini_w);
+	const int dMy = ((map.getH())<<16) / (mini_h);
+	const int decSPX=offset_x<<16, decSPY=offset_y<<16;
+
+	// a pixel covers the same cells as in computeColor()
+	blockColumnPixels.assign(map.getChangeBlocksW(), std::vector<int>());
+	for (int dx=0; dx<mini_w; dx++)
+		for (int minidxFP=dMx*dx+decSPX; minidxFP<=(dMx*(dx+1))+decSPX; minidxFP+=(1<<16))
+		{
+			std::vector<int> &pixels = blockColumnPixels[((minidxFP>>16) & map.getMaskW()) >> Map::CHANGE_BLOCK_SHIFT];
+			if (pixels.empty() || pixels.back() != dx)
+				pixels.push_back(dx);
+		}
+
+	blockRowPixels.assign(map.getChangeBlocksH(), std::vector<int>());
+	for (int dy=0; dy<mini_h; dy++)
+		for (int minidyFP=dMy*dy+decSPY; minidyFP<=(dMy*(dy+1))+decSPY; minidyFP+=(1<<16))
+		{
+			std::vector<int> &pixels = blockRowPixels[((minidyFP>>16) & map.getMaskH()) >> Map::CHANGE_BLOCK_SHIFT];
+			if (pixels.empty() || pixels.back() != dy)
+				pixels.push_back(dy);
+		}
+
+	dirtyPixels.assign(mini_w*mini_h, 0);
+}
+
+
+
+void Minimap::refreshChangedPixels(int localteam)
+{
+	if (noX) return;
+
+	Map &map = game->map;
+	const Uint32 seenStamp = lastChangeStamp;
+	lastChangeStamp = map.advanceChangeStamp();
+
+	// mark the pixels covering the changed blocks
+	const int blocksW = map.getChangeBlocksW();
+	const int blocksH = map.getChangeBlocksH();
+	bool changed = false;
+	for (int by=0; by<blocksH; by++)
+		for (int bx=0; bx<blocksW; bx++)
+			if (map.getBlockChangeStamp(bx, by) > seenStamp)
+			{
+				const std::vector<int> &rows = blockRowPixels[by];
+				const std::vector<int> &columns = blockColumnPixels[bx];
+				for (size_t i=0; i<rows.size(); i++)
+				{
+					Uint8 *line = &dirtyPixels[rows[i]*mini_w];
+					for (size_t j=0; j<columns.size(); j++)
+						line[columns[j]] = 1;
+				}
+				changed = true;
+			}
+	if (!changed)
+		return;
+
+	// recompute them
+	for (int dy=0; dy<mini_h; dy++)
 	{
-		computeColors(y, localteam);
-		
-		y++;
-		if(y == end)
-			break;
-		if(y == mini_h)
-			y = 0;
+		Uint8 *line = &dirtyPixels[dy*mini_w];
+		for (int dx=0; dx<mini_w; dx++)
+			if (line[dx])
+			{
+				line[dx] = 0;
+				computeColor(dx, dy, localteam);
+			}
 	}
 }
 
@@ -278,16 +378,26 @@ void Minimap::computeColors(int row, int localTeam)
 {
 	if (noX) return;
 
+	for (int dx=0; dx<mini_w; dx++)
+		computeColor(dx, row, localTeam);
+}
+
+
+
+void Minimap::computeColor(int dx, int dy, int localTeam)
+{
+	if (noX) return;
+
 	assert(localTeam>=0);
 	assert(localTeam<Team::MAX_COUNT);
 
-	const int terrainColor[3][3] = {
+	static const int terrainColor[3][3] = {
 		{ 0, 40, 120 }, // Water
 		{ 170, 170, 0 }, // Sand
 		{ 0, 90, 0 }, // Grass
 	};
 
-	const int buildingsUnitsColor[6][3] = {
+	static const int buildingsUnitsColor[6][3] = {
 		{ 10, 240, 20 }, // self
 		{ 220, 200, 20 }, // ally
 		{ 220, 25, 30 }, // enemy
@@ -299,7 +409,6 @@ void Minimap::computeColors(int row, int localTeam)
 	int pcol[3+MAX_RESSOURCES];
 
 	// get data
-	int szX = mini_w;
 	int decX = mini_offset_x, decY = mini_offset_y;
 
 	// Variables for traversing each map square within a minimap square.
@@ -312,124 +421,119 @@ void Minimap::computeColors(int row, int localTeam)
 	Uint32 visibleTeams = game->teams[localTeam]->me;
 	if (globalContainer->replaying) visibleTeams = globalContainer->replayVisibleTeams;
 
-	const int dy = row;
-	for (int dx=0; dx<szX; dx++)
-	{
-		memset(pcol, 0, sizeof(pcol));
-		int nCount = 0;
-		int UnitOrBuildingIndex = -1;
-		
-		// compute
-		for (int minidyFP=dMy*dy+decSPY; minidyFP<=(dMy*(dy+1))+decSPY; minidyFP+=(1<<16)) { // Fixed-point numbers
-			int minidy = minidyFP>>16;
-			for (int minidxFP=dMx*dx+decSPX; minidxFP<=(dMx*(dx+1))+decSPX; minidxFP+=(1<<16)) // Fixed-point numbers
-			{
-				int minidx = minidxFP>>16;
-				bool seenUnderFOW = false;
+	memset(pcol, 0, sizeof(pcol));
+	int nCount = 0;
+	int UnitOrBuildingIndex = -1;
+	
+	// compute
+	for (int minidyFP=dMy*dy+decSPY; minidyFP<=(dMy*(dy+1))+decSPY; minidyFP+=(1<<16)) { // Fixed-point numbers
+		int minidy = minidyFP>>16;
+		for (int minidxFP=dMx*dx+decSPX; minidxFP<=(dMx*(dx+1))+decSPX; minidxFP+=(1<<16)) // Fixed-point numbers
+		{
+			int minidx = minidxFP>>16;
+			bool seenUnderFOW = false;
 
-				Uint16 gid=game->map.getAirUnit(minidx, minidy);
-				if (gid==NOGUID)
-					gid=game->map.getGroundUnit(minidx, minidy);
-				if (gid==NOGUID)
-				{
-					gid=game->map.getBuilding(minidx, minidy);
-					if (gid!=NOGUID)
-					{
-						if (game->teams[Building::GIDtoTeam(gid)]->myBuildings[Building::GIDtoID(gid)]->seenByMask & visibleTeams)
-						{
-							seenUnderFOW = true;
-						}
-					}
-				}
+			Uint32 gid=game->map.getAirUnit(minidx, minidy);
+			if (gid==NOGUID)
+				gid=game->map.getGroundUnit(minidx, minidy);
+			if (gid==NOGUID)
+			{
+				gid=game->map.getBuilding(minidx, minidy);
 				if (gid!=NOGUID)
 				{
-					int teamId=gid/Unit::MAX_COUNT;
-					if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
+					if (game->teams[Building::GIDtoTeam(gid)]->myBuildings[Building::GIDtoID(gid)]->seenByMask & visibleTeams)
 					{
-						if (teamId==localTeam)
-							UnitOrBuildingIndex = 0;
-						else if ((game->teams[localTeam]->allies) & visibleTeams)
-							UnitOrBuildingIndex = 1;
-						else
-							UnitOrBuildingIndex = 2;
-						goto unitOrBuildingFound;
-					}
-					else if (seenUnderFOW)
-					{
-						if (teamId==localTeam)
-							UnitOrBuildingIndex = 3;
-						else if ((game->teams[localTeam]->allies) & visibleTeams)
-							UnitOrBuildingIndex = 4;
-						else
-							UnitOrBuildingIndex = 5;
-						goto unitOrBuildingFound;
+						seenUnderFOW = true;
 					}
 				}
-				
-				if (useMapDiscovered || game->map.isMapDiscovered(minidx, minidy, visibleTeams))
+			}
+			if (gid!=NOGUID)
+			{
+				int teamId=Unit::GIDtoTeam(gid);
+				if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
 				{
-					// get color to add
-					int pcolIndex;
-					Ressource r=game->map.getRessource(minidx, minidy);
-					if (r.type!=NO_RES_TYPE)
-					{
-						pcolIndex=r.type + 3;
-					}
+					if (teamId==localTeam)
+						UnitOrBuildingIndex = 0;
+					else if ((game->teams[localTeam]->allies) & visibleTeams)
+						UnitOrBuildingIndex = 1;
 					else
-					{
-						pcolIndex=game->map.getUMTerrain(minidx,minidy);
-					}
-					
-					// get weight to add
-					int pcolAddValue;
-					if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
-						pcolAddValue=5;
+						UnitOrBuildingIndex = 2;
+					goto unitOrBuildingFound;
+				}
+				else if (seenUnderFOW)
+				{
+					if (teamId==localTeam)
+						UnitOrBuildingIndex = 3;
+					else if ((game->teams[localTeam]->allies) & visibleTeams)
+						UnitOrBuildingIndex = 4;
 					else
-						pcolAddValue=3;
-
-					pcol[pcolIndex]+=pcolAddValue;
+						UnitOrBuildingIndex = 5;
+					goto unitOrBuildingFound;
 				}
-
-				nCount++;
 			}
+			
+			if (useMapDiscovered || game->map.isMapDiscovered(minidx, minidy, visibleTeams))
+			{
+				// get color to add
+				int pcolIndex;
+				Ressource r=game->map.getRessource(minidx, minidy);
+				if (r.type!=NO_RES_TYPE)
+				{
+					pcolIndex=r.type + 3;
+				}
+				else
+				{
+					pcolIndex=game->map.getUMTerrain(minidx,minidy);
+				}
+				
+				// get weight to add
+				int pcolAddValue;
+				if (useMapDiscovered || game->map.isFOWDiscovered(minidx, minidy, visibleTeams))
+					pcolAddValue=5;
+				else
+					pcolAddValue=3;
+
+				pcol[pcolIndex]+=pcolAddValue;
+			}
+
+			nCount++;
 		}
+	}
 
-		// Yes I know, this is *ugly*, but this piece of code *needs* speedup
-		unitOrBuildingFound:
+	// Yes I know, this is *ugly*, but this piece of code *needs* speedup
+	unitOrBuildingFound:
 
-		int r, g, b;
-		if (UnitOrBuildingIndex >= 0)
+	int r, g, b;
+	if (UnitOrBuildingIndex >= 0)
+	{
+		r = buildingsUnitsColor[UnitOrBuildingIndex][0];
+		g = buildingsUnitsColor[UnitOrBuildingIndex][1];
+		b = buildingsUnitsColor[UnitOrBuildingIndex][2];
+	}
+	else
+	{
+		nCount*=5;
+
+		int lr, lg, lb;
+		lr = lg = lb = 0;
+		for (int i=0; i<3; i++)
 		{
-			r = buildingsUnitsColor[UnitOrBuildingIndex][0];
-			g = buildingsUnitsColor[UnitOrBuildingIndex][1];
-			b = buildingsUnitsColor[UnitOrBuildingIndex][2];
-			UnitOrBuildingIndex = -1;
+			lr += pcol[i]*terrainColor[i][0];
+			lg += pcol[i]*terrainColor[i][1];
+			lb += pcol[i]*terrainColor[i][2];
 		}
-		else
+		for (int i=0; i<MAX_RESSOURCES; i++)
 		{
-			nCount*=5;
-
-			int lr, lg, lb;
-			lr = lg = lb = 0;
-			for (int i=0; i<3; i++)
-			{
-				lr += pcol[i]*terrainColor[i][0];
-				lg += pcol[i]*terrainColor[i][1];
-				lb += pcol[i]*terrainColor[i][2];
-			}
-			for (int i=0; i<MAX_RESSOURCES; i++)
-			{
-				RessourceType *rt = globalContainer->ressourcesTypes.get(i);
-				lr += pcol[i+3]*(rt->minimapR);
-				lg += pcol[i+3]*(rt->minimapG);
-				lb += pcol[i+3]*(rt->minimapB);
-			}
-
-			r = lr/nCount;
-			g = lg/nCount;
-			b = lb/nCount;
+			RessourceType *rt = globalContainer->ressourcesTypes.get(i);
+			lr += pcol[i+3]*(rt->minimapR);
+			lg += pcol[i+3]*(rt->minimapG);
+			lb += pcol[i+3]*(rt->minimapB);
 		}
-		surface->drawPixel(dx+decX, dy+decY, r, g, b, Color::ALPHA_OPAQUE);
+
+		r = lr/nCount;
+		g = lg/nCount;
+		b = lb/nCount;
 	}
+	surface->drawPixel(dx+decX, dy+decY, r, g, b, Color::ALPHA_OPAQUE);
 }
 
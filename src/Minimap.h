@@ -22,12 +22,15 @@
 #ifndef Minimap_h
 #define Minimap_h
 
+#include <vector>
+
 #include "GraphicContext.h"
 #include "Game.h"
 
 class Game;
 
-///This class is used to represent a minimap
+///This class is used to represent a minimap. The picture of the map is kept on a surface,
+///on which only the pixels covering the cells the map reports as changed are recomputed.
 class Minimap
 {
 public:
@@ -73,11 +76,21 @@ private:
 	///Computes the minimap positioning
 	void computeMinimapPositioning();
 
-	///Refreshes a range of rows on the screen, handles wrapping
-	void refreshPixelRows(int start, int end, int localteam);
+	///Returns true if the whole picture must be recomputed, because what is
+	///shown does not only depend on the cells of the map anymore
+	bool needsFullRefresh(int localteam);
+
+	///Builds, for each change block of the map, the list of pixel columns and rows covering it
+	void computeBlocksToPixels();
+
+	///Recomputes the pixels covering the blocks the map changed since the last draw
+	void refreshChangedPixels(int localteam);
 
 	/// Computes the colors for positions in the given row
 	void computeColors(int row, int localteam);
+
+	/// Computes the color of the pixel at (dx, dy)
+	void computeColor(int dx, int dy, int localteam);
 	
 	bool noX;
 	int menuWidth;
@@ -86,7 +99,7 @@ private:
 	int yOffset;
 	int width;
 	int height;
-	int update_row;
+	bool fullRefresh;
 	int offset_x;
 	int offset_y;
 	int mini_x;
@@ -99,6 +112,24 @@ private:
 	
 	Game* game;
 
+	///What the current picture was computed for, to detect when it must be fully recomputed
+	Map *lastMap;
+	int lastLocalTeam;
+	Uint32 lastVisibleTeams;
+	Uint32 lastAllies;
+	MinimapMode lastMinimapMode;
+	int lastOffsetX;
+	int lastOffsetY;
+	int lastMiniW;
+	int lastMiniH;
+	///The changes of the map up to this stamp are on the picture
+	Uint32 lastChangeStamp;
+	///The pixel columns covering each column of change blocks, and the pixel rows covering each row
+	std::vector<std::vector<int> > blockColumnPixels;
+	std::vector<std::vector<int> > blockRowPixels;
+	///The pixels to recompute, used by refreshChangedPixels
+	std::vector<Uint8> dirtyPixels;
+
 	///Converts x & y to a position in the color map
 	int position(int x, int y) { return (x * game->map.getH() + y); }
 	
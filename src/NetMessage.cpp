@@ -281,6 +281,13 @@ void NetSendOrder::encodeData(GAGCore::OutputStream* stream) const
 
 
 void NetSendOrder::decodeData(GAGCore::InputStream* stream)
+{
+	decodeData(stream, VERSION_MINOR);
+}
+
+
+
+void NetSendOrder::decodeData(GAGCore::InputStream* stream, Uint32 versionMinor)
 {
 	stream->readEnterSection("NetSendOrder");
 	size_t size=stream->readUint32("size");
@@ -288,7 +295,7 @@ void NetSendOrder::decodeData(GAGCore::InputStream* stream)
 	stream->read(buffer, size, "data");
 	stream->readLeaveSection();
 	
-	order = Order::getOrder(buffer, size, VERSION_MINOR);
+	order = Order::getOrder(buffer, size, versionMinor);
 
 	// If this couldn't be interpreted return it returned a NULL order, so we throw.
 	if (order == boost::shared_ptr<Order>())
@@ -180,6 +180,9 @@ public:
 	///Decodes the data, and reconstructs the Order.
 	void decodeData(GAGCore::InputStream* stream);
 
+	///Decodes the data of an Order written by the given version, such as one read from a replay
+	void decodeData(GAGCore::InputStream* stream, Uint32 versionMinor);
+
 	///Formats the NetSendOrder message with a small amount
 	///of information.
 	std::string format() const;
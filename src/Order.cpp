@@ -23,6 +23,8 @@
 #include "Order.h"
 #include "Utilities.h"
 #include "Brush.h"
+#include "BuildingUtils.h"
+#include "Map.h"
 
 Order::Order(void)
 {
@@ -148,35 +150,49 @@ bool OrderCreate::setData(const Uint8 *data, int dataLength, Uint32 versionMinor
 	return true;
 }
 
+// Orders acting on a building start with its gid, which was a Uint16 before version 84
+
+//! Returns the length of the gid at the start of the data of a building order of the given version
+static int orderGIDLength(Uint32 versionMinor)
+{
+	return (versionMinor < 84) ? 2 : 4;
+}
+
+//! Reads the gid at the start of the data of a building order, converting it if it is from before version 84
+static Uint32 getOrderGID(const Uint8 *data, Uint32 versionMinor)
+{
+	if (versionMinor < 84)
+		return BuildingUtils::GIDfromUint16(getUint16(data, 0));
+	return getUint32(data, 0);
+}
+
 // OrderDelete's code
 
 OrderDelete::OrderDelete(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :Order()
 {
-	assert(dataLength==2);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderDelete::OrderDelete(Uint16 gid)
+OrderDelete::OrderDelete(Uint32 gid)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 }
 
 Uint8 *OrderDelete::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, this->gid, 0);
+	addUint32(data, this->gid, 0);
 	return data;
 }
 
 bool OrderDelete::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	if (dataLength!=orderGIDLength(versionMinor))
 		return false;
-	this->gid=getUint16(data, 0);
-	memcpy(this->data, data, dataLength);
+	this->gid=getOrderGID(data, versionMinor);
 	return true;
 }
 
@@ -184,30 +200,28 @@ bool OrderDelete::setData(const Uint8 *data, int dataLength, Uint32 versionMinor
 
 OrderCancelDelete::OrderCancelDelete(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	assert(dataLength==2);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderCancelDelete::OrderCancelDelete(Uint16 gid)
+OrderCancelDelete::OrderCancelDelete(Uint32 gid)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 }
 
 Uint8 *OrderCancelDelete::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, this->gid, 0);
+	addUint32(data, this->gid, 0);
 	return data;
 }
 
 bool OrderCancelDelete::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if(dataLength != getDataLength())
+	if(dataLength != orderGIDLength(versionMinor))
 		return false;
-	this->gid = getUint16(data, 0);
-	memcpy(this->data, data, dataLength);
+	this->gid = getOrderGID(data, versionMinor);
 	return true;
 }
 
@@ -216,14 +230,13 @@ bool OrderCancelDelete::setData(const Uint8 *data, int dataLength, Uint32 versio
 OrderConstruction::OrderConstruction(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :Order()
 {
-	assert(dataLength==10);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderConstruction::OrderConstruction(Uint16 gid, Uint32 unitWorking, Uint32 unitWorkingFuture)
+OrderConstruction::OrderConstruction(Uint32 gid, Uint32 unitWorking, Uint32 unitWorkingFuture)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 	this->unitWorking=unitWorking;
 	this->unitWorkingFuture=unitWorkingFuture;
@@ -232,20 +245,20 @@ OrderConstruction::OrderConstruction(Uint16 gid, Uint32 unitWorking, Uint32 unit
 Uint8 *OrderConstruction::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, this->gid, 0);
-	addUint32(data, this->unitWorking, 2);
-	addUint32(data, this->unitWorkingFuture, 6);
+	addUint32(data, this->gid, 0);
+	addUint32(data, this->unitWorking, 4);
+	addUint32(data, this->unitWorkingFuture, 8);
 	return data;
 }
 
 bool OrderConstruction::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+8)
 		return false;
-	this->gid=getUint16(data, 0);
-	this->unitWorking=getUint32(data, 2);
-	this->unitWorkingFuture=getUint32(data, 6);
-	memcpy(this->data, data, dataLength);
+	this->gid=getOrderGID(data, versionMinor);
+	this->unitWorking=getUint32(data, pos);
+	this->unitWorkingFuture=getUint32(data, pos+4);
 	return true;
 }
 
@@ -254,14 +267,13 @@ bool OrderConstruction::setData(const Uint8 *data, int dataLength, Uint32 versio
 OrderCancelConstruction::OrderCancelConstruction(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :Order()
 {
-	assert(dataLength==6);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderCancelConstruction::OrderCancelConstruction(Uint16 gid, Uint32 unitWorking)
+OrderCancelConstruction::OrderCancelConstruction(Uint32 gid, Uint32 unitWorking)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 	this->unitWorking=unitWorking;
 }
@@ -269,18 +281,18 @@ OrderCancelConstruction::OrderCancelConstruction(Uint16 gid, Uint32 unitWorking)
 Uint8 *OrderCancelConstruction::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, this->gid, 0);
-	addUint32(data, this->unitWorking, 2);
+	addUint32(data, this->gid, 0);
+	addUint32(data, this->unitWorking, 4);
 	return data;
 }
 
 bool OrderCancelConstruction::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+4)
 		return false;
-	this->gid=getUint16(data, 0);
-	this->unitWorking=getUint32(data, 2);
-	memcpy(this->data, data, dataLength);
+	this->gid=getOrderGID(data, versionMinor);
+	this->unitWorking=getUint32(data, pos);
 	return true;
 }
 
@@ -296,14 +308,13 @@ OrderModify::OrderModify()
 OrderModifyBuilding::OrderModifyBuilding(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength==4);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifyBuilding::OrderModifyBuilding(Uint16 gid, Uint16 numberRequested)
+OrderModifyBuilding::OrderModifyBuilding(Uint32 gid, Uint16 numberRequested)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 	this->numberRequested=numberRequested;
 }
@@ -311,17 +322,18 @@ OrderModifyBuilding::OrderModifyBuilding(Uint16 gid, Uint16 numberRequested)
 Uint8 *OrderModifyBuilding::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
-	addUint16(data, numberRequested, 2);
+	addUint32(data, gid, 0);
+	addUint16(data, numberRequested, 4);
 	return data;
 }
 
 bool OrderModifyBuilding::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=4)
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+2)
 		return false;
-	gid=getUint16(data, 0);
-	numberRequested=getUint16(data, 2);
+	gid=getOrderGID(data, versionMinor);
+	numberRequested=getUint16(data, pos);
 	return true;
 }
 
@@ -330,12 +342,11 @@ bool OrderModifyBuilding::setData(const Uint8 *data, int dataLength, Uint32 vers
 OrderModifyExchange::OrderModifyExchange(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength==10);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifyExchange::OrderModifyExchange(Uint16 gid, Uint32 receiveRessourceMask, Uint32 sendRessourceMask)
+OrderModifyExchange::OrderModifyExchange(Uint32 gid, Uint32 receiveRessourceMask, Uint32 sendRessourceMask)
 {
 	this->gid=gid;
 	this->receiveRessourceMask=receiveRessourceMask;
@@ -345,19 +356,20 @@ OrderModifyExchange::OrderModifyExchange(Uint16 gid, Uint32 receiveRessourceMask
 Uint8 *OrderModifyExchange::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
-	addUint32(data, receiveRessourceMask, 2);
-	addUint32(data, sendRessourceMask, 6);
+	addUint32(data, gid, 0);
+	addUint32(data, receiveRessourceMask, 4);
+	addUint32(data, sendRessourceMask, 8);
 	return data;
 }
 
 bool OrderModifyExchange::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=10)
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+8)
 		return false;
-	gid=getUint16(data, 0);
-	receiveRessourceMask=getUint32(data, 2);
-	sendRessourceMask=getUint32(data, 6);
+	gid=getOrderGID(data, versionMinor);
+	receiveRessourceMask=getUint32(data, pos);
+	sendRessourceMask=getUint32(data, pos+4);
 	return true;
 }
 
@@ -366,12 +378,11 @@ bool OrderModifyExchange::setData(const Uint8 *data, int dataLength, Uint32 vers
 OrderModifySwarm::OrderModifySwarm(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength == getDataLength());
 	bool good = setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifySwarm::OrderModifySwarm(Uint16 gid, Sint32 ratio[NB_UNIT_TYPE])
+OrderModifySwarm::OrderModifySwarm(Uint32 gid, Sint32 ratio[NB_UNIT_TYPE])
 {
 	this->gid = gid;
 	memcpy(this->ratio, ratio, 4*NB_UNIT_TYPE);
@@ -380,19 +391,20 @@ OrderModifySwarm::OrderModifySwarm(Uint16 gid, Sint32 ratio[NB_UNIT_TYPE])
 Uint8 *OrderModifySwarm::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
+	addUint32(data, gid, 0);
 	for (int i=0; i<NB_UNIT_TYPE; i++)
-		addSint32(data, ratio[i], 2+4*i);
+		addSint32(data, ratio[i], 4+4*i);
 	return data;
 }
 
 bool OrderModifySwarm::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength != getDataLength())
+	int pos = orderGIDLength(versionMinor);
+	if (dataLength != pos+4*NB_UNIT_TYPE)
 		return false;
-	gid = getUint16(data, 0);
+	gid = getOrderGID(data, versionMinor);
 	for (int i=0; i<NB_UNIT_TYPE; i++)
-		ratio[i] = getSint32(data, 2+4*i);
+		ratio[i] = getSint32(data, pos+4*i);
 	return true;
 }
 
@@ -401,12 +413,11 @@ bool OrderModifySwarm::setData(const Uint8 *data, int dataLength, Uint32 version
 OrderModifyFlag::OrderModifyFlag(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength==6);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifyFlag::OrderModifyFlag(Uint16 gid, Sint32 range)
+OrderModifyFlag::OrderModifyFlag(Uint32 gid, Sint32 range)
 {
 	this->gid=gid;
 	this->range=range;
@@ -415,17 +426,18 @@ OrderModifyFlag::OrderModifyFlag(Uint16 gid, Sint32 range)
 Uint8 *OrderModifyFlag::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
-	addSint32(data, range, 2);
+	addUint32(data, gid, 0);
+	addSint32(data, range, 4);
 	return data;
 }
 
 bool OrderModifyFlag::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=6)
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+4)
 		return false;
-	gid=getUint16(data, 0);
-	range=getSint32(data,2);
+	gid=getOrderGID(data, versionMinor);
+	range=getSint32(data, pos);
 	return true;
 }
 
@@ -435,12 +447,11 @@ OrderModifyClearingFlag::OrderModifyClearingFlag(const Uint8 *data, int dataLeng
 :OrderModify()
 {
 	this->data=NULL;
-	assert(dataLength==2+BASIC_COUNT);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifyClearingFlag::OrderModifyClearingFlag(Uint16 gid, bool clearingRessources[BASIC_COUNT])
+OrderModifyClearingFlag::OrderModifyClearingFlag(Uint32 gid, bool clearingRessources[BASIC_COUNT])
 {
 	this->data=NULL;
 	this->gid=gid;
@@ -456,20 +467,21 @@ OrderModifyClearingFlag::~OrderModifyClearingFlag(void)
 Uint8 *OrderModifyClearingFlag::getData(void)
 {
 	if (data==NULL)
-		data=(Uint8 *)malloc(2+BASIC_COUNT);
-	addUint16(data, gid, 0);
+		data=(Uint8 *)malloc(getDataLength());
+	addUint32(data, gid, 0);
 	for (int i=0; i<BASIC_COUNT; i++)
-		addUint8(data, (Uint8)clearingRessources[i], 2+i);
+		addUint8(data, (Uint8)clearingRessources[i], 4+i);
 	return data;
 }
 
 bool OrderModifyClearingFlag::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+BASIC_COUNT)
 		return false;
-	this->gid=getUint16(data, 0);
+	this->gid=getOrderGID(data, versionMinor);
 	for (int i=0; i<BASIC_COUNT; i++)
-		clearingRessources[i]=(bool)getUint8(data, 2+i);
+		clearingRessources[i]=(bool)getUint8(data, pos+i);
 	
 	return true;
 }
@@ -479,12 +491,11 @@ bool OrderModifyClearingFlag::setData(const Uint8 *data, int dataLength, Uint32
 OrderModifyMinLevelToFlag::OrderModifyMinLevelToFlag(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength==4);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderModifyMinLevelToFlag::OrderModifyMinLevelToFlag(Uint16 gid, Uint16 minLevelToFlag)
+OrderModifyMinLevelToFlag::OrderModifyMinLevelToFlag(Uint32 gid, Uint16 minLevelToFlag)
 {
 	this->gid=gid;
 	this->minLevelToFlag=minLevelToFlag;
@@ -497,17 +508,18 @@ OrderModifyMinLevelToFlag::~OrderModifyMinLevelToFlag(void)
 Uint8 *OrderModifyMinLevelToFlag::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
-	addUint16(data, minLevelToFlag, 2);
+	addUint32(data, gid, 0);
+	addUint16(data, minLevelToFlag, 4);
 	return data;
 }
 
 bool OrderModifyMinLevelToFlag::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+2)
 		return false;
-	this->gid=getUint16(data, 0);
-	this->minLevelToFlag=getUint16(data, 2);
+	this->gid=getOrderGID(data, versionMinor);
+	this->minLevelToFlag=getUint16(data, pos);
 	return true;
 }
 
@@ -516,12 +528,11 @@ bool OrderModifyMinLevelToFlag::setData(const Uint8 *data, int dataLength, Uint3
 OrderMoveFlag::OrderMoveFlag(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :OrderModify()
 {
-	assert(dataLength==11);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderMoveFlag::OrderMoveFlag(Uint16 gid, Sint32 x, Sint32 y, bool drop)
+OrderMoveFlag::OrderMoveFlag(Uint32 gid, Sint32 x, Sint32 y, bool drop)
 {
 	this->gid=gid;
 	this->x=x;
@@ -532,21 +543,22 @@ OrderMoveFlag::OrderMoveFlag(Uint16 gid, Sint32 x, Sint32 y, bool drop)
 Uint8 *OrderMoveFlag::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, gid, 0);
-	addSint32(data, x, 2);
-	addSint32(data, y, 6);
-	addUint8(data, (Uint8)drop, 10);
+	addUint32(data, gid, 0);
+	addSint32(data, x, 4);
+	addSint32(data, y, 8);
+	addUint8(data, (Uint8)drop, 12);
 	return data;
 }
 
 bool OrderMoveFlag::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=11)
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+9)
 		return false;
-	gid=getUint16(data, 0);
-	x=getSint32(data, 2);
-	y=getSint32(data, 6);
-	drop=(bool)getUint8(data, 10);
+	gid=getOrderGID(data, versionMinor);
+	x=getSint32(data, pos);
+	y=getSint32(data, pos+4);
+	drop=(bool)getUint8(data, pos+8);
 	return true;
 }
 // OrderCancelConstruction's code
@@ -554,14 +566,13 @@ bool OrderMoveFlag::setData(const Uint8 *data, int dataLength, Uint32 versionMin
 OrderChangePriority::OrderChangePriority(const Uint8 *data, int dataLength, Uint32 versionMinor)
 :Order()
 {
-	assert(dataLength==6);
 	bool good=setData(data, dataLength, versionMinor);
 	assert(good);
 }
 
-OrderChangePriority::OrderChangePriority(Uint16 gid, Sint32 priority)
+OrderChangePriority::OrderChangePriority(Uint32 gid, Sint32 priority)
 {
-	assert(gid<32768);
+	assert(gid!=NOGBID);
 	this->gid=gid;
 	this->priority=priority;
 }
@@ -569,18 +580,18 @@ OrderChangePriority::OrderChangePriority(Uint16 gid, Sint32 priority)
 Uint8 *OrderChangePriority::getData(void)
 {
 	assert(sizeof(data) == getDataLength());
-	addUint16(data, this->gid, 0);
-	addSint32(data, this->priority, 2);
+	addUint32(data, this->gid, 0);
+	addSint32(data, this->priority, 4);
 	return data;
 }
 
 bool OrderChangePriority::setData(const Uint8 *data, int dataLength, Uint32 versionMinor)
 {
-	if (dataLength!=getDataLength())
+	int pos=orderGIDLength(versionMinor);
+	if (dataLength!=pos+4)
 		return false;
-	this->gid=getUint16(data, 0);
-	this->priority=getUint32(data, 2);
-	memcpy(this->data, data, dataLength);
+	this->gid=getOrderGID(data, versionMinor);
+	this->priority=getUint32(data, pos);
 	return true;
 }
 
@@ -89,17 +89,17 @@ class OrderDelete:public Order
 {
 public:
 	OrderDelete(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderDelete(Uint16 gid);
+	OrderDelete(Uint32 gid);
 	virtual ~OrderDelete(void) {}
 	Uint8 getOrderType(void) { return ORDER_DELETE; }
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 2; }
+	int getDataLength(void) { return 4; }
 
-	Uint16 gid;
+	Uint32 gid;
 
 protected:
-	Uint8 data[2];
+	Uint8 data[4];
 };
 
 //! Cancel a building deletion if pending
@@ -107,17 +107,17 @@ class OrderCancelDelete:public Order
 {
 public:
 	OrderCancelDelete(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderCancelDelete(Uint16 gid);
+	OrderCancelDelete(Uint32 gid);
 	virtual ~OrderCancelDelete(void) {}
 	Uint8 getOrderType(void) { return ORDER_CANCEL_DELETE; }
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 2; }
+	int getDataLength(void) { return 4; }
 
-	Uint16 gid;
+	Uint32 gid;
 
 protected:
-	Uint8 data[2];
+	Uint8 data[4];
 };
 
 // Upgrade or Repair a building
@@ -125,19 +125,19 @@ class OrderConstruction:public Order
 {
 public:
 	OrderConstruction(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderConstruction(Uint16 gid, Uint32 unitWorking, Uint32 unitWorkingFuture);
+	OrderConstruction(Uint32 gid, Uint32 unitWorking, Uint32 unitWorkingFuture);
 	virtual ~OrderConstruction(void) {}
 	Uint8 getOrderType(void) { return ORDER_CONSTRUCTION; }
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 10; }
+	int getDataLength(void) { return 12; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Uint32 unitWorking;
 	Uint32 unitWorkingFuture;
 
 protected:
-	Uint8 data[10];
+	Uint8 data[12];
 };
 
 //! Cancel a building upgarde or repair if pending
@@ -145,18 +145,18 @@ class OrderCancelConstruction:public Order
 {
 public:
 	OrderCancelConstruction(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderCancelConstruction(Uint16 gid, Uint32 unitWorking);
+	OrderCancelConstruction(Uint32 gid, Uint32 unitWorking);
 	virtual ~OrderCancelConstruction(void) {}
 	Uint8 getOrderType(void) { return ORDER_CANCEL_CONSTRUCTION; }
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 6; }
+	int getDataLength(void) { return 8; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Uint32 unitWorking;
 
 protected:
-	Uint8 data[6];
+	Uint8 data[8];
 };
 
 
@@ -165,18 +165,18 @@ class OrderChangePriority:public Order
 {
 public:
 	OrderChangePriority(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderChangePriority(Uint16 gid, Sint32 priority);
+	OrderChangePriority(Uint32 gid, Sint32 priority);
 	virtual ~OrderChangePriority(void) {}
 	Uint8 getOrderType(void) { return ORDER_CHANGE_PRIORITY; }
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 6; }
+	int getDataLength(void) { return 8; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Sint32 priority;
 
 protected:
-	Uint8 data[6];
+	Uint8 data[8];
 };
 
 
@@ -193,19 +193,19 @@ class OrderModifyBuilding:public OrderModify
 {
 public:
 	OrderModifyBuilding(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifyBuilding(Uint16 gid, Uint16 numberRequested);
+	OrderModifyBuilding(Uint32 gid, Uint16 numberRequested);
 	virtual ~OrderModifyBuilding(void) {}
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 4; }
+	int getDataLength(void) { return 6; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_BUILDING; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Uint16 numberRequested;
 	
 protected:
-	Uint8 data[4];
+	Uint8 data[6];
 };
 
 //! Change the 
@@ -213,73 +213,73 @@ class OrderModifyExchange:public OrderModify
 {
 public:
 	OrderModifyExchange(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifyExchange(Uint16 gid, Uint32 receiveRessourceMask, Uint32 sendRessourceMask);
+	OrderModifyExchange(Uint32 gid, Uint32 receiveRessourceMask, Uint32 sendRessourceMask);
 	virtual ~OrderModifyExchange(void) {}
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 10; }
+	int getDataLength(void) { return 12; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_EXCHANGE; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Uint32 receiveRessourceMask;
 	Uint32 sendRessourceMask;
 	
 protected:
-	Uint8 data[10];
+	Uint8 data[12];
 };
 
 class OrderModifySwarm:public OrderModify
 {
 public:
 	OrderModifySwarm(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifySwarm(Uint16 gid, Sint32 ratio[NB_UNIT_TYPE]);
+	OrderModifySwarm(Uint32 gid, Sint32 ratio[NB_UNIT_TYPE]);
 	virtual ~OrderModifySwarm(void) {}
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 2+4*NB_UNIT_TYPE; }
+	int getDataLength(void) { return 4+4*NB_UNIT_TYPE; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_SWARM; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Sint32 ratio[NB_UNIT_TYPE];
 
 protected:
-	Uint8 data[14];
+	Uint8 data[16];
 };
 
 class OrderModifyFlag:public OrderModify
 {
 public:
 	OrderModifyFlag(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifyFlag(Uint16 gid, Sint32 range);
+	OrderModifyFlag(Uint32 gid, Sint32 range);
 	virtual ~OrderModifyFlag(void) {}
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 6; }
+	int getDataLength(void) { return 8; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_FLAG; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Sint32 range;
 
 protected:
-	Uint8 data[6];
+	Uint8 data[8];
 };
 
 class OrderModifyClearingFlag:public OrderModify
 {
 public:
 	OrderModifyClearingFlag(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifyClearingFlag(Uint16 gid, bool clearingRessources[BASIC_COUNT]);
+	OrderModifyClearingFlag(Uint32 gid, bool clearingRessources[BASIC_COUNT]);
 	virtual ~OrderModifyClearingFlag(void);
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 2+BASIC_COUNT; }
+	int getDataLength(void) { return 4+BASIC_COUNT; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_CLEARING_FLAG; }
 
-	Uint16 gid;
+	Uint32 gid;
 	bool clearingRessources[BASIC_COUNT];
 
 protected:
@@ -290,40 +290,40 @@ class OrderModifyMinLevelToFlag:public OrderModify
 {
 public:
 	OrderModifyMinLevelToFlag(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderModifyMinLevelToFlag(Uint16 gid, Uint16 minLevelToFlag);
+	OrderModifyMinLevelToFlag(Uint32 gid, Uint16 minLevelToFlag);
 	virtual ~OrderModifyMinLevelToFlag(void);
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 4; }
+	int getDataLength(void) { return 6; }
 	Uint8 getOrderType(void) { return ORDER_MODIFY_MIN_LEVEL_TO_FLAG; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Uint16 minLevelToFlag;
 
 protected:
-	Uint8 data[4];
+	Uint8 data[6];
 };
 
 class OrderMoveFlag:public OrderModify
 {
 public:
 	OrderMoveFlag(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	OrderMoveFlag(Uint16 gid, Sint32 x, Sint32 y, bool drop);
+	OrderMoveFlag(Uint32 gid, Sint32 x, Sint32 y, bool drop);
 	virtual ~OrderMoveFlag(void) {}
 
 	Uint8 *getData(void);
 	bool setData(const Uint8 *data, int dataLength, Uint32 versionMinor);
-	int getDataLength(void) { return 11; }
+	int getDataLength(void) { return 13; }
 	Uint8 getOrderType(void) { return ORDER_MOVE_FLAG; }
 
-	Uint16 gid;
+	Uint32 gid;
 	Sint32 x;
 	Sint32 y;
 	bool drop;
 
 protected:
-	Uint8 data[11];
+	Uint8 data[13];
 };
 
 class BrushAccumulator;
@@ -50,9 +50,10 @@ void OverlayArea::compute(Game& game, OverlayType ntype, int localteam)
 	{
 		std::fill(overlay.begin(), overlay.end(), 0);
 		overlaymax = 0;
-		for (int i=0; i<Unit::MAX_COUNT; i++)
+		Team *team=game.teams[localteam];
+		for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 		{
-			Unit *u=game.teams[localteam]->myUnits[i];
+			Unit *u=team->myUnits[i];
 			if (u && u->activity != Unit::ACT_UPGRADING)
 			{
 				if (type == Starving && u->isUnitHungry() && u->hp < u->performance[HP])
@@ -70,9 +71,10 @@ void OverlayArea::compute(Game& game, OverlayType ntype, int localteam)
 	{
 		std::fill(overlay.begin(), overlay.end(), 0);
 		overlaymax = 0;
-		for (int i=0; i<Building::MAX_COUNT; i++)
+		Team *team=game.teams[localteam];
+		for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 		{
-			Building *b = game.teams[localteam]->myBuildings[i];
+			Building *b = team->myBuildings[i];
 			if (b)
 			{
 				if(b->type->shootDamage > 0)
@@ -26,8 +26,11 @@
 #include "Version.h"
 #include "Toolkit.h"
 #include "FileManager.h"
+#include "StreamBackend.h"
 
 #include <iomanip>
+#include <string.h>
+#include <zlib.h>
 
 ReplayReader::ReplayReader()
 {
@@ -38,6 +41,7 @@ ReplayReader::ReplayReader()
 	numOrders = 0;
 	stepsUntilNextOrder = -1;
 	checksum = 0;
+	versionMinor = VERSION_MINOR;
 }
 
 ReplayReader::~ReplayReader()
@@ -70,6 +74,7 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 
 	currentStep = 0;
 	ordersProcessed = 0;
+	keyframes.clear();
 	
 	// Skip to the section in the stream where the header ends
 	if (skipToOrders)
@@ -92,14 +97,17 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 	Uint16 version_major = stream->readUint16("versionMajor");
 	Uint16 version_minor = stream->readUint16("versionMinor");
 
-	// Check the version number. Playing a replay of an older version is impossible.
-	if (version_major != VERSION_MAJOR || version_minor != VERSION_MINOR)
+	// Check the version number. Playing a replay of an older version is impossible,
+	// except for version 83 whose orders only differ by the size of their gids, which Order converts.
+	if (version_major != VERSION_MAJOR || version_minor < 83 || version_minor > VERSION_MINOR)
 	{
 		delete stream;
 		stream = NULL;
 		return false;
 	}
 
+	versionMinor = version_minor;
+
 	// If there are no orders, this is also not a valid replay (there should be at least a NullOrder)
 	if (stream->isEndOfStream())
 	{
@@ -123,7 +131,7 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 		{
 			// Read an order from the stream
 			NetSendOrder msg;
-			msg.decodeData(stream);
+			msg.decodeData(stream, versionMinor);
 			order = msg.getOrder();
 
 			// If we got here, it means the order was valid, so increase the replay length
@@ -158,6 +166,13 @@ bool ReplayReader::loadReplay(GAGCore::InputStream *inputStream, bool skipToOrde
 	}
 	while (order->getOrderType() != ORDER_NULL);
 
+	// Keyframes, if any, are written after the NullOrder. Those from before version 84 hold caches
+	// with Uint16 gids that Game::loadCaches() can't read, so they are ignored.
+	if (versionMinor >= 84)
+		loadKeyframes(stream->getPosition());
+	else
+		keyframes.clear();
+
 	// Go back to the original position in the stream
 	stream->seekFromStart(pos);
 	
@@ -224,7 +239,7 @@ boost::shared_ptr<Order> ReplayReader::retrieveOrder()
 	{
 		// Read the order from the stream
 		NetSendOrder msg;
-		msg.decodeData(stream);
+		msg.decodeData(stream, versionMinor);
 		order = msg.getOrder();
 
 		// Check the checksums (no assert as we also want to check this in release-mode)
@@ -264,3 +279,108 @@ GAGCore::InputStream* ReplayReader::getStream() const
 {
 	return stream;
 }
+
+void ReplayReader::loadKeyframes(size_t ordersEnd)
+{
+	keyframes.clear();
+
+	// The index ends with its position and a signature, 8 bytes in total
+	stream->seekFromEnd(0);
+	size_t streamEnd = stream->getPosition();
+	if (streamEnd < ordersEnd + 12)
+		return;
+	stream->seekFromEnd(-8);
+	Uint32 indexOffset = stream->readUint32("keyframeIndexOffset");
+	char signature[4];
+	stream->read(signature, 4, "keyframeSignature");
+	if (memcmp(signature, "RpKf", 4) != 0 || indexOffset < ordersEnd || indexOffset + 12 > streamEnd)
+		return;
+
+	stream->seekFromStart(indexOffset);
+	Uint32 count = stream->readUint32("keyframeCount");
+	for (Uint32 i = 0; i < count && !stream->isEndOfStream(); i++)
+	{
+		Keyframe keyframe;
+		keyframe.step = stream->readUint32("step");
+		keyframe.ordersProcessed = stream->readUint32("ordersProcessed");
+		keyframe.orderOffset = stream->readUint32("orderOffset");
+		keyframe.stepsSinceLastOrder = stream->readUint16("stepsSinceLastOrder");
+		keyframe.dataOffset = stream->readUint32("dataOffset");
+		keyframe.compressedSize = stream->readUint32("compressedSize");
+		keyframe.size = stream->readUint32("size");
+
+		// Ignore anything that doesn't make sense, including keyframes taken after the last order
+		if (keyframe.step > numSteps || keyframe.ordersProcessed >= numOrders || keyframe.orderOffset >= ordersEnd)
+			continue;
+		if (keyframe.dataOffset < ordersEnd || keyframe.dataOffset + keyframe.compressedSize > indexOffset)
+			continue;
+		if (!keyframes.empty() && keyframe.step <= keyframes.back().step)
+			continue;
+		keyframes.push_back(keyframe);
+	}
+
+	// The step counter in front of the next order must cover the steps already done before the keyframe
+	for (size_t i = 0; i < keyframes.size(); )
+	{
+		stream->seekFromStart(keyframes[i].orderOffset);
+		if (stream->readUint16("replayStepCounter") < keyframes[i].stepsSinceLastOrder)
+			keyframes.erase(keyframes.begin() + i);
+		else
+			i++;
+	}
+}
+
+int ReplayReader::findKeyframe(Uint32 step) const
+{
+	int index = -1;
+	for (size_t i = 0; i < keyframes.size() && keyframes[i].step <= step; i++)
+		index = i;
+	return index;
+}
+
+Uint32 ReplayReader::getKeyframeStep(int index) const
+{
+	assert(index >= 0 && index < (int)keyframes.size());
+	return keyframes[index].step;
+}
+
+GAGCore::InputStream* ReplayReader::openKeyframe(int index)
+{
+	assert(index >= 0 && index < (int)keyframes.size());
+	if (stream == NULL) return NULL;
+
+	const Keyframe &keyframe = keyframes[index];
+
+	// Read the compressed data without losing our place in the orders
+	size_t pos = stream->getPosition();
+	std::vector<Bytef> compressed(keyframe.compressedSize);
+	stream->seekFromStart(keyframe.dataOffset);
+	if (keyframe.compressedSize)
+		stream->read(&compressed[0], keyframe.compressedSize, "keyframeData");
+	stream->seekFromStart(pos);
+
+	std::vector<Bytef> data(keyframe.size);
+	uLongf length = keyframe.size;
+	if (keyframe.size == 0 || uncompress(&data[0], &length, &compressed[0], keyframe.compressedSize) != Z_OK || length != keyframe.size)
+	{
+		std::cerr << "Error in replay: can't read the keyframe at step " << keyframe.step << std::endl;
+		return NULL;
+	}
+
+	// The constructor leaves the position after the data, rewind it before reading
+	MemoryStreamBackend *backend = new MemoryStreamBackend(&data[0], length);
+	backend->seekFromStart(0);
+	return new BinaryInputStream(backend);
+}
+
+void ReplayReader::jumpToKeyframe(int index)
+{
+	assert(index >= 0 && index < (int)keyframes.size());
+	assert(stream);
+
+	const Keyframe &keyframe = keyframes[index];
+	stream->seekFromStart(keyframe.orderOffset);
+	stepsUntilNextOrder = stream->readUint16("replayStepCounter") - keyframe.stepsSinceLastOrder;
+	currentStep = keyframe.step;
+	ordersProcessed = keyframe.ordersProcessed;
+}
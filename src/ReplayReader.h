@@ -22,6 +22,7 @@
 #include <boost/shared_ptr.hpp>
 #include <assert.h>
 #include <string>
+#include <vector>
 #include "Types.h"
 
 namespace GAGCore
@@ -36,6 +37,8 @@ class Order;
 /// If this replay stores checksums, they are checked every time an order is read.
 /// The replay ends early if both the checksum given to this class by setCheckSum(checksum) != 0
 /// AND the order written in the replay file != 0 AND both don't match.
+/// Replays may carry keyframes (see ReplayWriter) that allow jumping close to any step. Replays written
+/// before keyframes existed simply have none, and then the only way to a step is to simulate up to it.
 class ReplayReader
 {
 public:
@@ -82,6 +85,25 @@ public:
 	/// Get the stream that this reader uses, or NULL if there is none
 	GAGCore::InputStream *getStream() const;
 
+	/// Returns the number of keyframes
+	int getKeyframeCount() const { return keyframes.size(); }
+
+	/// Returns the index of the last keyframe taken at or before the given step, or -1 if there is none
+	int findKeyframe(Uint32 step) const;
+
+	/// Returns the step at which the given keyframe was taken
+	Uint32 getKeyframeStep(int index) const;
+
+	/// Returns a stream with the game state of the given keyframe, or NULL if it can't be read.
+	/// The stream starts with the game's checksum (Uint32) and the state of the synchronised random
+	/// generator (text), followed by the saved GameGUI and the caches saved by Game::saveCaches().
+	/// The caller owns the stream.
+	GAGCore::InputStream *openKeyframe(int index);
+
+	/// Continue reading the orders from the given keyframe on.
+	/// Only call this once the game has been restored from openKeyframe(index).
+	void jumpToKeyframe(int index);
+
 private:
 	/// You shouldn't copy-construct this class
 	ReplayReader(const ReplayReader &copy) { assert(false); };
@@ -89,6 +111,32 @@ private:
 	/// You shouldn't use assignment on this class
 	void operator=(const ReplayReader &reader) { assert(false); };
 
+	/// Reads the keyframe index at the end of the stream, if there is one.
+	/// ordersEnd is the position right after the final NullOrder.
+	void loadKeyframes(size_t ordersEnd);
+
+	/// The location of a keyframe in the stream, as written by ReplayWriter
+	struct Keyframe
+	{
+		/// The step after which the snapshot was taken
+		Uint32 step;
+		/// The number of orders before the snapshot
+		Uint32 ordersProcessed;
+		/// The position in the stream of the next order
+		Uint32 orderOffset;
+		/// The number of steps between the previous order and the snapshot
+		Uint16 stepsSinceLastOrder;
+		/// The position in the stream of the compressed game state
+		Uint32 dataOffset;
+		/// The size of the compressed game state
+		Uint32 compressedSize;
+		/// The size of the game state once uncompressed
+		Uint32 size;
+	};
+
+	/// The keyframes of this replay, sorted by step
+	std::vector<Keyframe> keyframes;
+
 	/// The stream it reads the replay from
 	GAGCore::InputStream *stream;
 
@@ -109,6 +157,9 @@ private:
 
 	/// The game's current checksum (or 0 if it's not given)
 	Uint32 checksum;
+
+	/// The minor version the replay was written with, its orders are decoded accordingly
+	Uint32 versionMinor;
 };
 
 #endif
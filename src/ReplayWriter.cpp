@@ -26,8 +26,13 @@
 #include "Version.h"
 #include "Toolkit.h"
 #include "FileManager.h"
+#include "Utilities.h"
 
+#include <algorithm>
 #include <stdio.h>
+#include <iostream>
+#include <sstream>
+#include <zlib.h>
 
 // Write an Order to the stream, with the given checksum
 inline void writeOrder(GAGCore::OutputStream *stream, boost::shared_ptr<Order> order, Uint32 checksum = 0)
@@ -48,11 +53,20 @@ ReplayWriter::ReplayWriter()
 	buffer = NULL;
 	stepsSinceLastOrder = 0;
 	checksum = 0;
+	currentStep = 0;
+	ordersWritten = 0;
+	finished = false;
+	keyframeInterval = KEYFRAME_INTERVAL;
+	nextKeyframeStep = KEYFRAME_INTERVAL;
+	keyframesBytes = 0;
+	compressor = NULL;
+	pendingCompressed = false;
 }
 
 ReplayWriter::~ReplayWriter()
 {
 	finish();
+	collectPendingKeyframe();
 
 	delete buffer;
 }
@@ -94,6 +108,7 @@ bool ReplayWriter::isValid() const
 void ReplayWriter::advanceStep()
 {
 	stepsSinceLastOrder++;
+	currentStep++;
 }
 
 void ReplayWriter::setCheckSum(Uint32 checksum)
@@ -113,27 +128,151 @@ void ReplayWriter::pushOrder(boost::shared_ptr<Order> order)
 	writeOrder(buffer, order, checksum);
 
 	stepsSinceLastOrder = 0;
+	ordersWritten++;
 
 	// Don't flush the buffer. That is done when writing the last Order, in ReplayWriter::finish().
 }
 
+bool ReplayWriter::isKeyframeDue() const
+{
+	return (isValid() && !finished && currentStep >= nextKeyframeStep);
+}
+
+void ReplayWriter::pushKeyframe(GameGUI &gui)
+{
+	if (!isValid() || finished) return;
+
+	// Only one keyframe is compressed at a time
+	collectPendingKeyframe();
+
+	// Serialise the game in memory. The checksum lets the reader make sure the state was restored
+	// faithfully, and the random generator isn't part of a saved game so it is stored alongside.
+	// So are the caches, such as the gradients: a saved game computes them again when loaded,
+	// but the steps played since the start have given them other values, that units follow.
+	MemoryStreamBackend *stateBackend = new MemoryStreamBackend();
+	OutputStream *state = new BinaryOutputStream(stateBackend);
+	state->writeUint32(gui.game.checkSum(NULL, NULL, NULL), "checksum");
+	std::ostringstream randomState;
+	randomState << randomGenerator;
+	state->writeText(randomState.str(), "syncRandState");
+	gui.save(state, "replayKeyframe");
+	gui.game.saveCaches(state);
+
+	pendingKeyframe.step = currentStep;
+	pendingKeyframe.ordersWritten = ordersWritten;
+	pendingKeyframe.orderOffset = buffer->getPosition();
+	pendingKeyframe.stepsSinceLastOrder = stepsSinceLastOrder;
+	pendingKeyframe.size = stateBackend->getPosition();
+	pendingKeyframe.data.clear();
+	const Uint8 *stateData = reinterpret_cast<const Uint8 *>(stateBackend->getBuffer());
+	pendingState.assign(stateData, stateData + pendingKeyframe.size);
+	delete state;
+
+	nextKeyframeStep = currentStep + keyframeInterval;
+
+	// Compress it while the game goes on, a saved game shrinks a lot but zlib takes a while on big maps
+	pendingCompressed = false;
+	compressor = new boost::thread(boost::ref(*this));
+}
+
+void ReplayWriter::operator()()
+{
+	uLongf compressedLength = compressBound(pendingKeyframe.size);
+	std::vector<Bytef> compressed(compressedLength);
+	int result = compress2(&compressed[0], &compressedLength, &pendingState[0], pendingKeyframe.size, Z_DEFAULT_COMPRESSION);
+	std::vector<Uint8>().swap(pendingState);
+	if (result != Z_OK)
+		return;
+	pendingKeyframe.data.assign(reinterpret_cast<const char *>(&compressed[0]), compressedLength);
+	pendingCompressed = true;
+}
+
+void ReplayWriter::collectPendingKeyframe()
+{
+	if (compressor == NULL) return;
+
+	compressor->join();
+	delete compressor;
+	compressor = NULL;
+
+	if (!pendingCompressed)
+	{
+		std::cerr << "ReplayWriter::pushKeyframe : can't compress the keyframe at step " << pendingKeyframe.step << std::endl;
+		return;
+	}
+	keyframes.push_back(pendingKeyframe);
+	keyframesBytes += pendingKeyframe.data.size();
+	pendingKeyframe.data.clear();
+
+	// Keep the memory bounded on long games by halving the density of keyframes
+	while (keyframesBytes > MAX_KEYFRAMES_BYTES && keyframes.size() > 1)
+	{
+		size_t kept = 0;
+		keyframesBytes = 0;
+		for (size_t i = 1; i < keyframes.size(); i += 2)
+		{
+			keyframesBytes += keyframes[i].data.size();
+			keyframes[kept++] = keyframes[i];
+		}
+		keyframes.resize(kept);
+		keyframeInterval *= 2;
+		nextKeyframeStep = std::max(nextKeyframeStep, keyframes.back().step + keyframeInterval);
+	}
+}
+
+void ReplayWriter::writeKeyframes(GAGCore::OutputStream *stream) const
+{
+	// The compressed game states come first
+	std::vector<Uint32> dataOffsets;
+	for (size_t i = 0; i < keyframes.size(); i++)
+	{
+		dataOffsets.push_back(stream->getPosition());
+		stream->write(keyframes[i].data.data(), keyframes[i].data.size(), "keyframeData");
+	}
+
+	// Then the index
+	Uint32 indexOffset = stream->getPosition();
+	stream->writeUint32(keyframes.size(), "keyframeCount");
+	for (size_t i = 0; i < keyframes.size(); i++)
+	{
+		stream->writeUint32(keyframes[i].step, "step");
+		stream->writeUint32(keyframes[i].ordersWritten, "ordersProcessed");
+		stream->writeUint32(keyframes[i].orderOffset, "orderOffset");
+		stream->writeUint16(keyframes[i].stepsSinceLastOrder, "stepsSinceLastOrder");
+		stream->writeUint32(dataOffsets[i], "dataOffset");
+		stream->writeUint32(keyframes[i].data.size(), "compressedSize");
+		stream->writeUint32(keyframes[i].size, "size");
+	}
+
+	// The file ends with the position of the index and a signature, so that the reader can find it
+	stream->writeUint32(indexOffset, "keyframeIndexOffset");
+	stream->write("RpKf", 4, "keyframeSignature");
+}
+
 void ReplayWriter::finish()
 {
-	if (!isValid()) return;
+	if (!isValid() || finished) return;
 
 	// Write the number of steps since last order to the end of the replay
 	buffer->writeUint16(stepsSinceLastOrder, "replayStepsSinceLastOrder");
 
+	// The last keyframe may still be compressing
+	collectPendingKeyframe();
+
 	// We write a NullOrder to mark the end of the replay (like terminating a string with \0)
 	writeOrder(buffer, boost::shared_ptr<Order>(new NullOrder()), 0);
 
+	// The keyframes go after the NullOrder
+	writeKeyframes(buffer);
+
 	// Flush the buffer now
 	buffer->flush();
 
 	stepsSinceLastOrder = 0;
+	finished = true;
 }
 
-bool ReplayWriter::write(const std::string &filename) const
+bool ReplayWriter::write(const std::string &filename)
 {
 	if (!isValid()) return false;
 	if (filename == "") return false;
@@ -162,11 +301,19 @@ bool ReplayWriter::write(const std::string &filename) const
 		fileBackend->putc(c);
 	}
 
-	// Write the number of steps since last order to the end of the replay
-	file->writeUint16(0, "replayStepsSinceLastOrder");
+	// If finish() was called, the buffer already ends with the NullOrder and the keyframes
+	if (!finished)
+	{
+		// Write the number of steps since last order to the end of the replay
+		file->writeUint16(0, "replayStepsSinceLastOrder");
 
-	// Write a NullOrder to the file to make sure it's a NullOrder-terminated replay
-	writeOrder(file, boost::shared_ptr<Order>(new NullOrder()), 0);
+		// Write a NullOrder to the file to make sure it's a NullOrder-terminated replay
+		writeOrder(file, boost::shared_ptr<Order>(new NullOrder()), 0);
+
+		// The keyframes go after the NullOrder. The file is a copy of the buffer, so the offsets are the same.
+		collectPendingKeyframe();
+		writeKeyframes(file);
+	}
 
 	// Flush the file
 	file->flush();
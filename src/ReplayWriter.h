@@ -20,7 +20,10 @@
 #define __ReplayWriter_h
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 #include <assert.h>
+#include <string>
+#include <vector>
 #include "Types.h"
 
 namespace GAGCore
@@ -35,6 +38,11 @@ class Order;
 /// This class is used for writing replays.
 /// ReplayWriter buffers a whole replay and then writes it to a file when you call write()
 /// You can optionally (though preferably) write checksums that will then be checked when reading back the replay.
+/// When enabled (globalContainer->replayKeyframes), a compressed copy of the whole game state is taken every now
+/// and then with pushKeyframe(). These keyframes are stored after the NullOrder that ends the orders, together
+/// with an index, so that ReplayReader can jump to any step without simulating the whole game from the start.
+/// Readers that don't know about keyframes stop at the NullOrder and never see them.
+/// The game is serialised in pushKeyframe(), but compressed on a worker thread while the game goes on.
 class ReplayWriter
 {
 public:
@@ -61,16 +69,25 @@ public:
 	/// Adds the order to the replay
 	void pushOrder(boost::shared_ptr<Order> order);
 
+	/// Returns true if a keyframe should be taken after the current step
+	bool isKeyframeDue() const;
+
+	/// Takes a snapshot of the game (to be called right after the game's syncStep), compressed in the background
+	void pushKeyframe(GameGUI &gui);
+
 	/// Marks the end of the replay
 	void finish();
 
 	/// Write this replay to the given file
 	/// Returns true if successful
-	bool write(const std::string &filename) const;
+	bool write(const std::string &filename);
 
 	/// Get the buffer, if for any reason you would need it
 	GAGCore::OutputStream* getBuffer() const;
 
+	/// Body of the compression thread, compresses pendingState into pendingKeyframe
+	void operator()();
+
 private:
 	/// You shouldn't copy-construct this class
 	ReplayWriter(const ReplayWriter &copy) { assert(false); };
@@ -78,6 +95,35 @@ private:
 	/// You shouldn't use assignment on this class
 	void operator=(const ReplayWriter &writer) { assert(false); };
 
+	/// Write the keyframes and their index to the given stream, which must be right after the final NullOrder
+	void writeKeyframes(GAGCore::OutputStream *stream) const;
+
+	/// Waits for the keyframe being compressed, if any, and adds it to keyframes
+	void collectPendingKeyframe();
+
+	/// A snapshot of the game and the position in the orders where it was taken
+	struct Keyframe
+	{
+		/// The step after which the snapshot was taken
+		Uint32 step;
+		/// The number of orders written before the snapshot
+		Uint32 ordersWritten;
+		/// The position in the stream of the next order
+		Uint32 orderOffset;
+		/// The number of steps between the previous order and the snapshot
+		Uint16 stepsSinceLastOrder;
+		/// The size of the game state before compression
+		Uint32 size;
+		/// The game state, compressed with zlib
+		std::string data;
+	};
+
+	/// Initial number of steps between two keyframes (2 minutes of game time)
+	static const Uint32 KEYFRAME_INTERVAL = 25*60*2;
+
+	/// When the compressed keyframes take more than this many bytes, every other one is dropped and the interval is doubled
+	static const size_t MAX_KEYFRAMES_BYTES = 64*1024*1024;
+
 	/// The StreamBackend of the buffer
 	GAGCore::StreamBackend *bufferBackend;
 
@@ -89,6 +135,39 @@ private:
 
 	/// The game's current checksum (or 0 if it's not given)
 	Uint32 checksum;
+
+	/// The number of steps since the beginning of the replay
+	Uint32 currentStep;
+
+	/// The number of orders written so far
+	Uint32 ordersWritten;
+
+	/// True once the final NullOrder has been written to the buffer
+	bool finished;
+
+	/// The keyframes taken so far
+	std::vector<Keyframe> keyframes;
+
+	/// The current number of steps between two keyframes
+	Uint32 keyframeInterval;
+
+	/// The step at which the next keyframe is due
+	Uint32 nextKeyframeStep;
+
+	/// The total size of the compressed data of keyframes
+	size_t keyframesBytes;
+
+	/// The thread compressing pendingKeyframe, or NULL if there is none
+	boost::thread *compressor;
+
+	/// The keyframe being compressed
+	Keyframe pendingKeyframe;
+
+	/// The serialised game of pendingKeyframe, freed once compressed
+	std::vector<Uint8> pendingState;
+
+	/// True if the compression of pendingKeyframe succeeded
+	bool pendingCompressed;
 };
 
 #endif
@@ -978,7 +978,7 @@ bool Story::testCondition(GameGUI *gui)
 							{
 								for (dx=x-r; dx<x+r && !foundUnit; dx++)
 								{
-									Uint16 gid=game->map.getGroundUnit(dx, dy);
+									Uint32 gid=game->map.getGroundUnit(dx, dy);
 									if (gid!=NOGUID)
 									{
 										int team=Unit::GIDtoTeam(gid);
@@ -999,7 +999,7 @@ bool Story::testCondition(GameGUI *gui)
 								{
 									if(game->map.isPointSet(areaN, x, y))
 									{
-										Uint16 gid=game->map.getGroundUnit(x, y);
+										Uint32 gid=game->map.getGroundUnit(x, y);
 										if (gid!=NOGUID)
 										{
 											int team=Unit::GIDtoTeam(gid);
@@ -1432,7 +1432,7 @@ bool MapScriptSGSL::load(GAGCore::InputStream *stream, Game *game)
 	{
 		stream->readEnterSection(i);
 		std::string name = stream->readText("name");
-		Uint16 gbid = stream->readUint16("gbid");
+		Uint32 gbid = Building::readGID(stream, "gbid", game->mapHeader.getVersionMinor());
 		Building *b = game->teams[Building::GIDtoTeam(gbid)]->myBuildings[Building::GIDtoID(gbid)];
 		assert(b);
 		flags[name] = b;
@@ -1500,7 +1500,7 @@ void MapScriptSGSL::save(GAGCore::OutputStream *stream, const Game *game)
 	{
 		stream->writeEnterSection(i);
 		stream->writeText(it->first, "name");
-		stream->writeUint16(it->second->gid, "x");
+		stream->writeUint32(it->second->gid, "x");
 		stream->writeLeaveSection();
 		i++;
 	}
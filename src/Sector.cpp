@@ -27,6 +27,8 @@
 #include <Stream.h>
 
 #ifndef YOG_SERVER_ONLY
+DEFINE_POOLED_ALLOCATION(UnitDeathAnimation)
+
 UnitDeathAnimation::UnitDeathAnimation(int x, int y, Team *team)
 {
 	this->x = x;
@@ -123,7 +125,7 @@ void Sector::step(void)
 		}
 		else
 		{
-			Uint16 gid = map->getGroundUnit(bullet->targetX, bullet->targetY);
+			Uint32 gid = map->getGroundUnit(bullet->targetX, bullet->targetY);
 			if(gid == NOGUID)
 				gid = map->getAirUnit(bullet->targetX, bullet->targetY);
 			if (gid != NOGUID)
@@ -133,8 +135,11 @@ void Sector::step(void)
 				int id = Unit::GIDtoID(gid);
 				
 				
-				boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(game->stepCounter, bullet->targetX, bullet->targetY, game->teams[team]->myUnits[id]->typeNum));
-				game->teams[team]->pushGameEvent(event);
+				if (game->teams[team]->acceptsGameEvent(GEUnitUnderAttack))
+				{
+					boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(game->stepCounter, bullet->targetX, bullet->targetY, game->teams[team]->myUnits[id]->typeNum));
+					game->teams[team]->pushGameEvent(event);
+				}
 		
 				if (bullet->revealW > 0 && bullet->revealH > 0)
 					game->map.setMapDiscovered(bullet->revealX, bullet->revealY, bullet->revealW, bullet->revealH, Team::teamNumberToMask(team));
@@ -146,7 +151,7 @@ void Sector::step(void)
 			}
 			else
 			{
-				Uint16 gid = map->getBuilding(bullet->targetX, bullet->targetY);
+				Uint32 gid = map->getBuilding(bullet->targetX, bullet->targetY);
 				if (gid != NOGBID)
 				{
 					// we have hit a building
@@ -159,8 +164,11 @@ void Sector::step(void)
 					Building *building = game->teams[team]->myBuildings[id];
 					int damage = bullet->shootDamage-building->type->armor; 
 					
-					boost::shared_ptr<GameEvent> event(new BuildingUnderAttackEvent(game->stepCounter, bullet->targetX, bullet->targetY, building->shortTypeNum));
-					game->teams[team]->pushGameEvent(event);
+					if (game->teams[team]->acceptsGameEvent(GEBuildingUnderAttack))
+					{
+						boost::shared_ptr<GameEvent> event(new BuildingUnderAttackEvent(game->stepCounter, bullet->targetX, bullet->targetY, building->shortTypeNum));
+						game->teams[team]->pushGameEvent(event);
+					}
 					
 					if (damage > 0)
 						building->hp -= damage;
@@ -21,6 +21,7 @@
 #define __SECTOR_H
 
 #include <list>
+#include "FixedSizePool.h"
 
 class Map;
 class Game;
@@ -35,6 +36,7 @@ struct UnitDeathAnimation
 	UnitDeathAnimation(int x, int y, Team *team);
 	int x, y, ticksLeft;
 	Team *team;
+	DECLARE_POOLED_ALLOCATION
 };
 #endif  // !YOG_SERVER_ONLY
 
@@ -0,0 +1,127 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "SlotSet.h"
+#include <assert.h>
+
+SlotSet::SlotSet(size_t capacity)
+{
+	reset(capacity);
+}
+
+void SlotSet::reset(size_t capacity)
+{
+	slotCapacity = capacity;
+	count = 0;
+	words.assign((capacity + 31) / 32, 0);
+}
+
+void SlotSet::grow(size_t capacity)
+{
+	assert(capacity >= slotCapacity);
+	slotCapacity = capacity;
+	words.resize((capacity + 31) / 32, 0);
+}
+
+void SlotSet::insert(int slot)
+{
+	assert(slot >= 0 && (size_t)slot < slotCapacity);
+	unsigned &word = words[slot >> 5];
+	unsigned mask = 1u << (slot & 31);
+	if ((word & mask) == 0)
+	{
+		word |= mask;
+		count++;
+	}
+}
+
+void SlotSet::erase(int slot)
+{
+	assert(slot >= 0 && (size_t)slot < slotCapacity);
+	unsigned &word = words[slot >> 5];
+	unsigned mask = 1u << (slot & 31);
+	if (word & mask)
+	{
+		word &= ~mask;
+		count--;
+	}
+}
+
+bool SlotSet::contains(int slot) const
+{
+	assert(slot >= 0 && (size_t)slot < slotCapacity);
+	return (words[slot >> 5] & (1u << (slot & 31))) != 0;
+}
+
+int SlotSet::first() const
+{
+	return next(-1);
+}
+
+int SlotSet::next(int slot) const
+{
+	int candidate = slot + 1;
+	if (count == 0 || candidate >= (int)slotCapacity)
+		return -1;
+	size_t w = candidate >> 5;
+	// mask out the bits before candidate in its word
+	unsigned word = words[w] & (~0u << (candidate & 31));
+	while (word == 0)
+	{
+		w++;
+		if (w >= words.size())
+			return -1;
+		word = words[w];
+	}
+	return (int)(w << 5) + lowestBit(word);
+}
+
+int SlotSet::firstFree() const
+{
+	if (count == slotCapacity)
+		return -1;
+	for (size_t w = 0; w < words.size(); w++)
+	{
+		unsigned freeBits = ~words[w];
+		if (freeBits)
+		{
+			int slot = (int)(w << 5) + lowestBit(freeBits);
+			if (slot < (int)slotCapacity)
+				return slot;
+			return -1;
+		}
+	}
+	return -1;
+}
+
+int SlotSet::lowestBit(unsigned word)
+{
+	assert(word);
+#ifdef __GNUC__
+	return __builtin_ctz(word);
+#else
+	int bit = 0;
+	while ((word & 1) == 0)
+	{
+		word >>= 1;
+		bit++;
+	}
+	return bit;
+#endif
+}
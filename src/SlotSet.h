@@ -0,0 +1,68 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __SLOT_SET_H
+#define __SLOT_SET_H
+
+#include <cstddef>
+#include <vector>
+
+///This keeps track of which slots of a fixed size table (for instance Team::myUnits) are used.
+///It allows to iterate over the used slots in increasing order, and to find the first free slot,
+///in time proportional to the number of used slots rather than to the size of the table.
+///Slots can be inserted or erased while iterating, next() always returns the first used slot
+///after the given one, as a scan of the whole table would.
+class SlotSet
+{
+public:
+	///Creates a set for slots 0 to capacity-1, all free
+	SlotSet(size_t capacity=0);
+	///Changes the number of slots, all slots become free
+	void reset(size_t capacity);
+	///Increases the number of slots to capacity, the used slots stay used and the new ones are free
+	void grow(size_t capacity);
+
+	///Marks slot as used
+	void insert(int slot);
+	///Marks slot as free
+	void erase(int slot);
+	///Returns true if slot is used
+	bool contains(int slot) const;
+	///Returns the number of used slots
+	size_t size() const { return count; }
+	///Returns the number of slots
+	size_t capacity() const { return slotCapacity; }
+
+	///Returns the first used slot, or -1 if there is none
+	int first() const;
+	///Returns the first used slot after slot, or -1 if there is none
+	int next(int slot) const;
+	///Returns the first free slot, or -1 if all slots are used
+	int firstFree() const;
+
+private:
+	///Returns the index of the lowest bit set in word, which must not be 0
+	static int lowestBit(unsigned word);
+
+	std::vector<unsigned> words;
+	size_t slotCapacity;
+	size_t count;
+};
+
+#endif
@@ -33,14 +33,16 @@ using namespace GAGCore;
 
 #include <SDL_endian.h>
 
-#ifdef WIN32
-#include <malloc.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
 #endif
 
 #define SAMPLE_COUNT_PER_SLICE 4096*8
 #define INTERPOLATION_RANGE 65535
 #define INTERPOLATION_BITS 16
 #define SPEEX_FRAME_SIZE 160
+// number of slices the music thread decodes ahead
+#define MUSIC_SLICES_AHEAD 3
 
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define OGG_BYTEORDER 0
@@ -64,47 +66,104 @@ static void initInterpolationTable(void)
 	}
 }
 
-void SoundMixer::handleVoiceInsertion(int *outputSample, int voicevol)
+void SoundMixer::mixVoices(Sint16 *output, unsigned nsamples, int voicevol)
 {
-	// if no more voice
-	if (voices.empty())
-		return;
-	
-	float value = 0;
-	for (std::map<int, PlayerVoice>::iterator i = voices.begin(); i != voices.end();)
+	// collect the voices having data, starting the new ones
+	PlayerVoice *playing[MAX_VOICES];
+	int playingCount = 0;
+	for (int p=0; p<MAX_VOICES; p++)
 	{
-		struct PlayerVoice &pv = i->second;
-		value += (1-pv.voiceSubIndex) * pv.voiceVal0 + pv.voiceSubIndex * pv.voiceVal1;
+		PlayerVoice &pv = voices[p];
+		if (!pv.playing)
+		{
+			if (!pv.voiceDatas.pop(pv.voiceVal1))
+				continue;
+			pv.playing = true;
+			pv.voiceVal0 = 0;
+			pv.voiceSubIndex = 0;
+		}
+		playing[playingCount++] = &pv;
+	}
 	
-		// increment index, keep track of stereo
-		pv.voiceSubIndex += (8000.0f/44100.0f)*0.5f;
-		if (pv.voiceSubIndex > 1)
+	// if no more voice, the output is left untouched
+	for (unsigned i=0; i<nsamples && playingCount>0; i++)
+	{
+		float value = 0;
+		for (int v=0; v<playingCount;)
 		{
-			pv.voiceSubIndex -= 1;
-			pv.voiceVal0 = pv.voiceVal1;
-			pv.voiceDatas.pop();
-			pv.voiceVal1 = pv.voiceDatas.front();
-			
-			// if there is no more data in this voice, remove it
-			if (pv.voiceDatas.empty())
+			struct PlayerVoice &pv = *playing[v];
+			value += (1-pv.voiceSubIndex) * pv.voiceVal0 + pv.voiceSubIndex * pv.voiceVal1;
+		
+			// increment index, keep track of stereo
+			pv.voiceSubIndex += (8000.0f/44100.0f)*0.5f;
+			if (pv.voiceSubIndex > 1)
 			{
-				// go to next voice
-				std::map<int, PlayerVoice>::iterator j = i;
-				++i;
-				voices.erase(j);
-				continue;
+				pv.voiceSubIndex -= 1;
+				pv.voiceVal0 = pv.voiceVal1;
+				
+				// if there is no more data in this voice, stop playing it
+				if (!pv.voiceDatas.pop(pv.voiceVal1))
+				{
+					pv.playing = false;
+					playing[v] = playing[--playingCount];
+					continue;
+				}
 			}
+			
+			// go to next voice
+			++v;
+		}
+		// saturate
+		value = std::min(value, 32767.0f);
+		value = std::max(value, -32767.0f);
+		value = (value * voicevol)/256;
+		// write sample
+		output[i] = (static_cast<int>(3.0f * (value)) + output[i]) / 4;
+	}
+}
+
+// Multiplies the samples by volume/256, 8 at a time when SSE2 is available
+static void scaleSamples(Sint16 *samples, unsigned count, int volume)
+{
+	unsigned i = 0;
+#ifdef __SSE2__
+	const __m128i v = _mm_set1_epi16(static_cast<short>(volume));
+	for (; i+8<=count; i+=8)
+	{
+		__m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples+i));
+		// the 32 bits products, as in the scalar code
+		__m128i lo = _mm_mullo_epi16(t, v);
+		__m128i hi = _mm_mulhi_epi16(t, v);
+		__m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+		__m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(samples+i), _mm_packs_epi32(p0, p1));
+	}
+#endif
+	for (; i<count; i++)
+		samples[i] = (samples[i] * volume) >> 8;
+}
+
+// Reads len bytes of track, looping to its beginning at its end
+static void readTrack(OggVorbis_File *track, char *p, long len)
+{
+	long rest = len;
+	while(rest > 0)
+	{
+		int bs;
+		long ret = ov_read(track, p, rest, OGG_BYTEORDER, 2, 1, &bs);
+		if (ret == 0) // EOF
+		{
+			ov_pcm_seek(track, 0);
+		}
+		else if (ret < 0) // stream error
+		{
+		}
+		else
+		{
+			rest -= ret;
+			p += ret;
 		}
-		
-		// go to next voice
-		++i;
 	}
-	// saturate
-	value = std::min(value, 32767.0f);
-	value = std::max(value, -32767.0f);
-	value = (value * voicevol)/256;
-	// write sample
-	*outputSample = (static_cast<int>(3.0f * (value)) + (*outputSample)) / 4;
 }
 
 void mixaudio(void *voidMixer, Uint8 *stream, int len)
@@ -115,62 +174,41 @@ void mixaudio(void *voidMixer, Uint8 *stream, int len)
 	int musicvol = static_cast<int>(mixer->musicVolume);
 	int voicevol = static_cast<int>(mixer->voiceVolume);
 
-	assert(mixer->actTrack >= 0);
-	assert(mixer->mode != SoundMixer::MODE_STOPPED);
 	// Dejan: this is supposed to fix reported problem on Gentoo
 	// assert(nsamples == SAMPLE_COUNT_PER_SLICE);
 	assert(nsamples);
 
-	if (mixer->mode == SoundMixer::MODE_EARLY_CHANGE)
+	// take the music decoded ahead, and play silence if there is none
+	unsigned musicCount = static_cast<unsigned>(mixer->musicDatas.pop(mix, nsamples));
+	memset(mix + musicCount, 0, (nsamples - musicCount) * sizeof(Sint16));
+	
+	// volume
+	if (musicvol != 255)
+		scaleSamples(mix, musicCount, musicvol);
+	
+	mixer->mixVoices(mix, nsamples, voicevol);
+}
+
+void SoundMixer::decodeMusicSlice(Sint16 *slice, Sint16 *otherTrack)
+{
+	const unsigned nsamples = SAMPLE_COUNT_PER_SLICE;
+	const long len = nsamples * sizeof(Sint16);
+
+	assert(actTrack >= 0);
+	assert(mode != MODE_STOPPED);
+
+	if (mode == MODE_EARLY_CHANGE)
 	{
-		Sint16 *track0 = reinterpret_cast<Sint16 *>(alloca(len));
-		Sint16 *track1 = reinterpret_cast<Sint16 *>(alloca(len));
-		long rest;
-		char *p;
+		Sint16 *track0 = otherTrack;
+		Sint16 *track1 = slice;
 
 		// read first ogg
-		rest = len;
-		p = reinterpret_cast<char *>(track0);
-		ogg_int64_t firstPos = ov_pcm_tell(mixer->tracks[mixer->actTrack]);
-		while(rest > 0)
-		{
-			int bs;
-			long ret = ov_read(mixer->tracks[mixer->actTrack], p, rest, OGG_BYTEORDER, 2, 1, &bs);
-			if (ret == 0) // EOF
-			{
-				ov_pcm_seek(mixer->tracks[mixer->actTrack], 0);
-			}
-			else if (ret < 0) // stream error
-			{
-			}
-			else
-			{
-				rest -= ret;
-				p += ret;
-			}
-		}
+		ogg_int64_t firstPos = ov_pcm_tell(tracks[actTrack]);
+		readTrack(tracks[actTrack], reinterpret_cast<char *>(track0), len);
 
 		// read second ogg
-		ov_pcm_seek(mixer->tracks[mixer->nextTrack], firstPos);
-		rest = len;
-		p = reinterpret_cast<char *>(track1);
-		while(rest > 0)
-		{
-			int bs;
-			long ret = ov_read(mixer->tracks[mixer->nextTrack], p, rest, OGG_BYTEORDER, 2, 1, &bs);
-			if (ret == 0) // EOF
-			{
-				ov_pcm_seek(mixer->tracks[mixer->nextTrack], 0);
-			}
-			else if (ret < 0) // stream error
-			{
-			}
-			else
-			{
-				rest -= ret;
-				p += ret;
-			}
-		}
+		ov_pcm_seek(tracks[nextTrack], firstPos);
+		readTrack(tracks[nextTrack], reinterpret_cast<char *>(track1), len);
 
 		// mix
 		for (unsigned i=0; i<nsamples; i++)
@@ -178,29 +216,26 @@ void mixaudio(void *voidMixer, Uint8 *stream, int len)
 			int t0 = track0[i];
 			int t1 = track1[i];
 			int intI = interpolationTable[i];
-			int val = (intI*t1+((INTERPOLATION_RANGE-intI)*t0))>>INTERPOLATION_BITS;
-			val = (val * musicvol)>>8;
-			mixer->handleVoiceInsertion(&val, voicevol);
-			mix[i] = val;
+			slice[i] = (intI*t1+((INTERPOLATION_RANGE-intI)*t0))>>INTERPOLATION_BITS;
 		}
 
 		// clear change
-		mixer->actTrack = mixer->nextTrack;
-		mixer->mode = SoundMixer::MODE_NORMAL;
+		actTrack = nextTrack;
+		mode = MODE_NORMAL;
 	}
 	else
 	{
-		// read ogg
+		// read ogg, going to the next track at the end of this one
 		long rest = len;
-		char *p = reinterpret_cast<char *>(mix);
+		char *p = reinterpret_cast<char *>(slice);
 		while(rest > 0)
 		{
 			int bs;
-			long ret = ov_read(mixer->tracks[mixer->actTrack], p, rest, OGG_BYTEORDER, 2, 1, &bs);
+			long ret = ov_read(tracks[actTrack], p, rest, OGG_BYTEORDER, 2, 1, &bs);
 			if (ret == 0) // EOF
 			{
-				mixer->actTrack = mixer->nextTrack;
-				ov_pcm_seek(mixer->tracks[mixer->actTrack], 0);
+				actTrack = nextTrack;
+				ov_pcm_seek(tracks[actTrack], 0);
 			}
 			else if (ret < 0) // stream error
 			{
@@ -212,44 +247,48 @@ void mixaudio(void *voidMixer, Uint8 *stream, int len)
 			}
 		}
 
-		// volume & fading
-		if (mixer->mode == SoundMixer::MODE_NORMAL)
+		// fading
+		if (mode == MODE_START)
 		{
-			if (musicvol != 255)
-				for (unsigned i=0; i<nsamples; i++)
-				{
-					int t = mix[i];
-					t = (t * musicvol) >> 8;
-					mixer->handleVoiceInsertion(&t, voicevol);
-					mix[i] = t;
-				}
+			for (unsigned i=0; i<nsamples; i++)
+				slice[i] = (interpolationTable[i]*slice[i]) >> INTERPOLATION_BITS;
+			mode = MODE_NORMAL;
 		}
-		else if (mixer->mode == SoundMixer::MODE_START)
+		else if (mode == MODE_STOP)
 		{
 			for (unsigned i=0; i<nsamples; i++)
 			{
-				int t = mix[i];
-				t = (interpolationTable[i]*t) >> INTERPOLATION_BITS;
-				t = (t * musicvol) >> 8;
-				mixer->handleVoiceInsertion(&t, voicevol);
-				mix[i] = t;
+				int intI = interpolationTable[i];
+				slice[i] = ((INTERPOLATION_RANGE-intI)*slice[i]) >> INTERPOLATION_BITS;
 			}
-			mixer->mode = SoundMixer::MODE_NORMAL;
+			mode = MODE_STOPPED;
 		}
-		else if (mixer->mode == SoundMixer::MODE_STOP)
+	}
+}
+
+void SoundMixer::operator()()
+{
+	std::vector<Sint16> slice(SAMPLE_COUNT_PER_SLICE);
+	std::vector<Sint16> otherTrack(SAMPLE_COUNT_PER_SLICE);
+	while (true)
+	{
+		bool decoded = false;
 		{
-			for (unsigned i=0; i<nsamples; i++)
+			boost::mutex::scoped_lock lock(musicMutex);
+			if (stopMusicThread)
+				break;
+			if (mode != MODE_STOPPED && musicDatas.write_available() >= SAMPLE_COUNT_PER_SLICE)
 			{
-				int t = mix[i];
-				int intI = interpolationTable[i];
-				t = ((INTERPOLATION_RANGE-intI)*t) >> INTERPOLATION_BITS;
-				t = (t * musicvol) >> 8;
-				mixer->handleVoiceInsertion(&t, voicevol);
-				mix[i] = t;
+				decodeMusicSlice(&slice[0], &otherTrack[0]);
+				decoded = true;
 			}
-			mixer->mode = SoundMixer::MODE_STOPPED;
-			SDL_PauseAudio(1);
 		}
+		
+		// only this thread pushes, so there is room for the whole slice
+		if (decoded)
+			musicDatas.push(&slice[0], SAMPLE_COUNT_PER_SLICE);
+		else
+			SDL_Delay(20);
 	}
 }
 
@@ -277,6 +316,11 @@ void SoundMixer::openAudio(void)
 		mode = MODE_STOPPED;
 	}
 	
+	// the callback plays silence and voices while there is no music
+	if (!musicThread)
+		musicThread = new boost::thread(boost::ref(*this));
+	SDL_PauseAudio(0);
+	
 	// Open Speex decoder
 	speexDecoderState = speex_decoder_init(&speex_nb_mode);
 	int tmp = 1;
@@ -285,7 +329,12 @@ void SoundMixer::openAudio(void)
 }
 
 SoundMixer::SoundMixer(unsigned musicvol, unsigned voicevol, bool mute)
+	: musicDatas(MUSIC_SLICES_AHEAD * SAMPLE_COUNT_PER_SLICE)
 {
+	for (int p=0; p<MAX_VOICES; p++)
+		voices[p].playing = false;
+	musicThread = NULL;
+	stopMusicThread = false;
 	actTrack = -1;
 	nextTrack = -1;
 	this->musicVolume = musicvol;
@@ -324,6 +373,16 @@ SoundMixer::~SoundMixer()
 		speex_decoder_destroy(speexDecoderState);
 	}
 	
+	if (musicThread)
+	{
+		{
+			boost::mutex::scoped_lock lock(musicMutex);
+			stopMusicThread = true;
+		}
+		musicThread->join();
+		delete musicThread;
+	}
+	
 	for (size_t i=0; i<tracks.size(); i++)
 	{
 		ov_clear(tracks[i]);
@@ -348,7 +407,7 @@ int SoundMixer::loadTrack(const std::string name, int index)
 		return -2;
 	}
 
-	SDL_LockAudio();
+	boost::mutex::scoped_lock lock(musicMutex);
 	if (index >= 0 && index< (int)tracks.size())
 	{
 		ov_clear(tracks[index]);
@@ -360,7 +419,6 @@ int SoundMixer::loadTrack(const std::string name, int index)
 		tracks.push_back(oggFile);
 		index = (int)tracks.size()-1;
 	}
-	SDL_UnlockAudio();
 	
 	return index;
 }
@@ -369,7 +427,7 @@ void SoundMixer::setNextTrack(unsigned i, bool earlyChange)
 {
 	if ((soundEnabled) && (i<tracks.size()))
 	{
-		SDL_LockAudio();
+		boost::mutex::scoped_lock lock(musicMutex);
 		
 		// Select next tracks
 		if (actTrack >= 0)
@@ -380,15 +438,12 @@ void SoundMixer::setNextTrack(unsigned i, bool earlyChange)
 		// Select mode
 		if (mode == MODE_STOPPED)
 		{
-			SDL_PauseAudio(0);
 			mode = MODE_START;
 		}
 		else if (earlyChange)
 		{
 			mode = MODE_EARLY_CHANGE;
 		}
-		
-		SDL_UnlockAudio();
 	}
 }
 
@@ -421,40 +476,35 @@ void SoundMixer::setVolume(unsigned musicVolume, unsigned voiceVolume, bool mute
 
 void SoundMixer::stopMusic(void)
 {
-	mode = MODE_STOP;
+	boost::mutex::scoped_lock lock(musicMutex);
+	if (mode != MODE_STOPPED)
+		mode = MODE_STOP;
 }
 
 
 
 bool SoundMixer::isPlayerTransmittingVoice(int player)
 {
-	SDL_LockAudio();
-	if(voices.find(player) != voices.end())
-	{
-		SDL_UnlockAudio();
-		return true;
-	}
-	SDL_UnlockAudio();
-	return false;
+	if (player < 0 || player >= MAX_VOICES)
+		return false;
+	// the voice is transmitting as long as the audio callback has data to play
+	return voices[player].voiceDatas.write_available() < VOICE_QUEUE_SIZE;
 }
 
 
 void SoundMixer::addVoiceData(boost::shared_ptr<OrderVoiceData> order)
 {
-	if (soundEnabled)
+	if (soundEnabled && order->sender >= 0 && order->sender < MAX_VOICES)
 	{
-		SDL_LockAudio();
-		// get or create the voice
 		PlayerVoice &pv = voices[order->sender];
 		// insert 200 ms silence to let packets come if we aer the first
-		if (pv.voiceDatas.empty())
+		if (pv.voiceDatas.write_available() == VOICE_QUEUE_SIZE)
 		{
 			for (size_t j=0; j<2000; j++)
 				pv.voiceDatas.push(0);
-			pv.voiceVal0 = pv.voiceVal1 = 0;
-			pv.voiceSubIndex = 0;
 		}
 		
+		// decoding happens here, in the game thread, the samples not fitting in the queue are dropped
 		SpeexBits bits;
 		speex_bits_init(&bits);
 		speex_bits_read_from(&bits, (char *)order->getFramesData(), order->framesDatasLength);
@@ -463,12 +513,8 @@ void SoundMixer::addVoiceData(boost::shared_ptr<OrderVoiceData> order)
 		{
 			float floatBuffer[SPEEX_FRAME_SIZE];
 			speex_decode(speexDecoderState, &bits, floatBuffer);
-			
-			for (size_t j=0; j<SPEEX_FRAME_SIZE; j++)
-				pv.voiceDatas.push(floatBuffer[j]);
+			pv.voiceDatas.push(floatBuffer, SPEEX_FRAME_SIZE);
 		}
 		speex_bits_destroy(&bits);
-		
-		SDL_UnlockAudio();
 	}
 }
@@ -25,12 +25,16 @@
 #include <vorbis/codec.h>
 #include <vorbis/vorbisfile.h>
 #include <vector>
-#include <queue>
-#include <map>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
 
 class OrderVoiceData;
 
+//! Plays the music and the voip voices. The Ogg tracks are decoded ahead by a music thread and the
+//! voices are decoded by the game thread. Both reach the SDL audio callback through lock-free
+//! single-producer/single-consumer queues, so the callback never waits for the other threads.
 class SoundMixer
 {
 public:
@@ -42,6 +46,7 @@ public:
 		MODE_STOP,
 		MODE_START
 	} mode;
+	//! mode, tracks, actTrack and nextTrack are shared by the game thread and the music thread, protected by musicMutex
 	std::vector<OggVorbis_File *> tracks;
 	int actTrack, nextTrack;
 	bool earlyChange;
@@ -49,27 +54,51 @@ public:
 	unsigned musicVolume;
 	unsigned voiceVolume;
 	
+	//! Number of players that can be heard in voip, voices are indexed by player number
+	enum { MAX_VOICES = 32 };
+	//! Number of 8Khz samples that can be queued for a voice, the samples beyond are dropped
+	enum { VOICE_QUEUE_SIZE = 16384 };
+	
 	//! Voice for one player
 	struct PlayerVoice
 	{
-		//! float sample from speex decoder
-		std::queue<float> voiceDatas;
+		//! float sample from speex decoder, pushed by the game thread and popped by the audio callback
+		boost::lockfree::spsc_queue<float, boost::lockfree::capacity<VOICE_QUEUE_SIZE> > voiceDatas;
+		//! true while the audio callback plays this voice. The fields below are only used by the audio callback
+		bool playing;
 		//! subsample precision for voice (8Khz instead of 44.1Khz)
 		float voiceSubIndex;
 		//! value used for interpolation and optimisation. Linear interpolation is done on the 8Khz audio datas
 		float voiceVal0;
 		float voiceVal1;
 	};
-	//! Map of voices to players
-	std::map<int, PlayerVoice> voices;
+	//! Voices, indexed by player
+	PlayerVoice voices[MAX_VOICES];
 	//! pointer to the structure holding the speex decoder
 	void *speexDecoderState;
 	
-	//! if voice data is available, insert it to output
-	inline void handleVoiceInsertion(int *outputSample, int voicevol);
+	//! Music samples decoded ahead, pushed by the music thread and popped by the audio callback
+	boost::lockfree::spsc_queue<Sint16> musicDatas;
+	
+	//! if voice data is available, insert it to the nsamples of output
+	void mixVoices(Sint16 *output, unsigned nsamples, int voicevol);
+	
+	//! Body of the music thread
+	void operator()();
 	
 protected:
 	void openAudio(void);
+	
+	//! Decodes the next slice of music, with fading but without volume, in slice. otherTrack is a buffer
+	//! of the same size, used when two tracks are mixed. musicMutex must be locked
+	void decodeMusicSlice(Sint16 *slice, Sint16 *otherTrack);
+	
+	//! Protects the music state shared by the game thread and the music thread
+	boost::mutex musicMutex;
+	//! Thread decoding the music ahead
+	boost::thread *musicThread;
+	//! Set to ask the music thread to stop, protected by musicMutex
+	bool stopMusicThread;
 
 public:
 	SoundMixer(unsigned musicvol = 255, unsigned voicevol = 255, bool mute = false);
@@ -20,6 +20,7 @@
 #include <climits>
 //#include <float.h>
 #include <math.h>
+#include <sstream>
 
 #include <Toolkit.h>
 #include <StringTable.h>
@@ -78,13 +79,16 @@ Team::~Team()
 
 void Team::init(void)
 {
-	myUnits = new Unit*[Unit::MAX_COUNT];
-	myBuildings = new Building*[Building::MAX_COUNT];
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	// the tables start with the size they had when gids were Uint16, and grow as needed
+	myUnits = new Unit*[Unit::MAX_COUNT_UINT16];
+	myBuildings = new Building*[Building::MAX_COUNT_UINT16];
+	for (int i=0; i<Unit::MAX_COUNT_UINT16; i++)
 		myUnits[i]=NULL;
 
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=0; i<Building::MAX_COUNT_UINT16; i++)
 		myBuildings[i]=NULL;
+	unitSlots.reset(Unit::MAX_COUNT_UINT16);
+	buildingSlots.reset(Building::MAX_COUNT_UINT16);
 
 	startPosX=startPosY=0;
 	startPosSet=0;
@@ -103,6 +107,12 @@ void Team::init(void)
 		eventCooldownTimers[i]=0;
 
 	noMoreBuildingSitesCountdown=0;
+
+	unitWasFree.assign(Unit::MAX_COUNT_UINT16, false);
+	for(int i=0; i<NB_UNIT_TYPE; ++i)
+		nonFreeUnits[i]=0;
+	nonFreeHarvesters=0;
+	buildingTasksPass=0;
 }
 
 
@@ -134,19 +144,42 @@ bool Team::load(GAGCore::InputStream *stream, BuildingsTypes *buildingstypes, Si
 
 	stream->readEnterSection("Team");
 
+	// the number of slots saved, before version 84 the tables had a fixed size
+	Uint32 unitCount = Unit::MAX_COUNT_UINT16;
+	Uint32 buildingCount = Building::MAX_COUNT_UINT16;
+	if (versionMinor >= 84)
+	{
+		unitCount = stream->readUint32("unitSlotCount");
+		buildingCount = stream->readUint32("buildingSlotCount");
+		if (unitCount > (Uint32)Unit::MAX_COUNT || buildingCount > (Uint32)Building::MAX_COUNT)
+		{
+			stream->readLeaveSection();
+			return false;
+		}
+	}
+	if (unitCount > unitSlots.capacity())
+		growUnits(unitCount);
+	if (buildingCount > buildingSlots.capacity())
+		growBuildings(buildingCount);
+
 	// normal load
 	stream->readEnterSection("myUnits");
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=0; i<(int)unitSlots.capacity(); i++)
 	{
 		if (myUnits[i])
 			delete myUnits[i];
 
+		if (i >= (int)unitCount)
+		{
+			setUnit(i, NULL);
+			continue;
+		}
 		stream->readEnterSection(i);
 		Uint32 isUsed = stream->readUint32("isUsed");
 		if (isUsed)
-			myUnits[i] = new Unit(stream, this, versionMinor);
+			setUnit(i, new Unit(stream, this, versionMinor));
 		else
-			myUnits[i] = NULL;
+			setUnit(i, NULL);
 		stream->readLeaveSection();
 	}
 	stream->readLeaveSection();
@@ -159,16 +192,21 @@ bool Team::load(GAGCore::InputStream *stream, BuildingsTypes *buildingstypes, Si
 
 	prestige = 0;
 	stream->readEnterSection("myBuildings");
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=0; i<(int)buildingSlots.capacity(); i++)
 	{
 		if (myBuildings[i])
 			delete myBuildings[i];
 
+		if (i >= (int)buildingCount)
+		{
+			setBuilding(i, NULL);
+			continue;
+		}
 		stream->readEnterSection(i);
 		Uint32 isUsed = stream->readUint32("isUsed");
 		if (isUsed)
 		{
-			myBuildings[i] = new Building(stream, buildingstypes, this, versionMinor);
+			setBuilding(i, new Building(stream, buildingstypes, this, versionMinor));
 			if (myBuildings[i]->type->unitProductionTime)
 				swarms.push_back(myBuildings[i]);
 			if (myBuildings[i]->type->shootingRange)
@@ -181,14 +219,14 @@ bool Team::load(GAGCore::InputStream *stream, BuildingsTypes *buildingstypes, Si
 				clearingFlags.push_back(myBuildings[i]);
 		}
 		else
-			myBuildings[i] = NULL;
+			setBuilding(i, NULL);
 		stream->readLeaveSection();
 	}
 	stream->readLeaveSection();
 
 	// resolve cross reference
 	stream->readEnterSection("myUnits");
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		if (myUnits[i])
 		{
@@ -200,7 +238,7 @@ bool Team::load(GAGCore::InputStream *stream, BuildingsTypes *buildingstypes, Si
 	stream->readLeaveSection();
 
 	stream->readEnterSection("myBuildings");
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 	{
 		if (myBuildings[i])
 		{
@@ -275,8 +313,10 @@ void Team::save(GAGCore::OutputStream *stream)
 	stream->writeEnterSection("Team");
 
 	// saving team
+	stream->writeUint32(unitSlots.capacity(), "unitSlotCount");
+	stream->writeUint32(buildingSlots.capacity(), "buildingSlotCount");
 	stream->writeEnterSection("myUnits");
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=0; i<(int)unitSlots.capacity(); i++)
 	{
 		stream->writeEnterSection(i);
 		if (myUnits[i])
@@ -293,7 +333,7 @@ void Team::save(GAGCore::OutputStream *stream)
 	stream->writeLeaveSection();
 
 	stream->writeEnterSection("myBuildings");
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=0; i<(int)buildingSlots.capacity(); i++)
 	{
 		stream->writeEnterSection(i);
 		if (myBuildings[i])
@@ -311,7 +351,7 @@ void Team::save(GAGCore::OutputStream *stream)
 
 	// save cross reference
 	stream->writeEnterSection("myUnits");
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		if (myUnits[i])
 		{
@@ -323,7 +363,7 @@ void Team::save(GAGCore::OutputStream *stream)
 	stream->writeLeaveSection();
 
 	stream->writeEnterSection("myBuildings");
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 	{
 		if (myBuildings[i])
 		{
@@ -363,6 +403,172 @@ void Team::save(GAGCore::OutputStream *stream)
 
 
 
+// Saves the gids of a list of buildings, in the order of the list
+template<typename Container>
+static void saveBuildingList(GAGCore::OutputStream *stream, const Container &buildings, const std::string &name)
+{
+	stream->writeEnterSection(name);
+	stream->writeUint32(buildings.size(), "count");
+	for (typename Container::const_iterator it=buildings.begin(); it!=buildings.end(); ++it)
+		stream->writeUint32((*it)->gid, "gid");
+	stream->writeLeaveSection();
+}
+
+// Fills buildings with the buildings of the team whose gids saveBuildingList() saved
+template<typename Container>
+static bool loadBuildingList(GAGCore::InputStream *stream, Team *team, Container &buildings, const std::string &name)
+{
+	buildings.clear();
+	stream->readEnterSection(name);
+	Uint32 count = stream->readUint32("count");
+	for (Uint32 i=0; i<count; i++)
+	{
+		Uint32 gid = stream->readUint32("gid");
+		Building *building = NULL;
+		if (gid < (Uint32)(Building::MAX_COUNT*Team::MAX_COUNT) && Building::GIDtoTeam(gid) == team->teamNumber
+			&& Building::GIDtoID(gid) < (int)team->buildingSlots.capacity())
+			building = team->myBuildings[Building::GIDtoID(gid)];
+		if (building == NULL || stream->isEndOfStream())
+		{
+			stream->readLeaveSection();
+			return false;
+		}
+		buildings.push_back(building);
+	}
+	stream->readLeaveSection();
+	return true;
+}
+
+void Team::saveCaches(GAGCore::OutputStream *stream)
+{
+	stream->writeEnterSection("TeamCaches");
+
+	// load() takes sharedVisionExchange from sharedVisionOther, and resets the others
+	stream->writeUint32(sharedVisionExchange, "sharedVisionExchange");
+	stream->writeSint32(noMoreBuildingSitesCountdown, "noMoreBuildingSitesCountdown");
+	stream->writeUint8(isAlive, "isAlive");
+	stream->writeUint8(hasWon, "hasWon");
+	stream->writeUint8(hasLost, "hasLost");
+	stream->writeUint32(winCondition, "winCondition");
+
+	// The lists are visited in order, load() fills them in slot order
+	for (int i=0; i<NB_ABILITY; i++)
+	{
+		std::ostringstream oss;
+		oss << "upgrade[" << i << "]";
+		saveBuildingList(stream, upgrade[i], oss.str());
+	}
+	saveBuildingList(stream, canFeedUnit, "canFeedUnit");
+	saveBuildingList(stream, canHealUnit, "canHealUnit");
+	saveBuildingList(stream, canExchange, "canExchange");
+	saveBuildingList(stream, buildingsWaitingForDestruction, "buildingsWaitingForDestruction");
+	saveBuildingList(stream, buildingsTryToBuildingSiteRoom, "buildingsTryToBuildingSiteRoom");
+	saveBuildingList(stream, swarms, "swarms");
+	saveBuildingList(stream, turrets, "turrets");
+	saveBuildingList(stream, clearingFlags, "clearingFlags");
+	saveBuildingList(stream, virtualBuildings, "virtualBuildings");
+
+	stream->writeUint32(buildingsNeedingUnits.size(), "buildingsNeedingUnitsCount");
+	for (std::map<int, std::vector<Building*>, std::greater<int> >::iterator i = buildingsNeedingUnits.begin(); i!=buildingsNeedingUnits.end(); ++i)
+	{
+		stream->writeSint32(i->first, "priority");
+		saveBuildingList(stream, i->second, "buildingsNeedingUnits");
+	}
+
+	stream->writeEnterSection("myUnits");
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
+	{
+		stream->writeEnterSection(i);
+		myUnits[i]->saveCaches(stream);
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+
+	stream->writeEnterSection("myBuildings");
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
+	{
+		stream->writeEnterSection(i);
+		myBuildings[i]->saveCaches(stream);
+		stream->writeLeaveSection();
+	}
+	stream->writeLeaveSection();
+
+	stream->writeLeaveSection();
+}
+
+bool Team::loadCaches(GAGCore::InputStream *stream)
+{
+	stream->readEnterSection("TeamCaches");
+
+	sharedVisionExchange = stream->readUint32("sharedVisionExchange");
+	noMoreBuildingSitesCountdown = stream->readSint32("noMoreBuildingSitesCountdown");
+	isAlive = stream->readUint8("isAlive");
+	hasWon = stream->readUint8("hasWon");
+	hasLost = stream->readUint8("hasLost");
+	winCondition = (WinningConditionType)stream->readUint32("winCondition");
+
+	bool ok = true;
+	for (int i=0; i<NB_ABILITY; i++)
+	{
+		std::ostringstream oss;
+		oss << "upgrade[" << i << "]";
+		ok = ok && loadBuildingList(stream, this, upgrade[i], oss.str());
+	}
+	ok = ok && loadBuildingList(stream, this, canFeedUnit, "canFeedUnit");
+	ok = ok && loadBuildingList(stream, this, canHealUnit, "canHealUnit");
+	ok = ok && loadBuildingList(stream, this, canExchange, "canExchange");
+	ok = ok && loadBuildingList(stream, this, buildingsWaitingForDestruction, "buildingsWaitingForDestruction");
+	ok = ok && loadBuildingList(stream, this, buildingsTryToBuildingSiteRoom, "buildingsTryToBuildingSiteRoom");
+	ok = ok && loadBuildingList(stream, this, swarms, "swarms");
+	ok = ok && loadBuildingList(stream, this, turrets, "turrets");
+	ok = ok && loadBuildingList(stream, this, clearingFlags, "clearingFlags");
+	ok = ok && loadBuildingList(stream, this, virtualBuildings, "virtualBuildings");
+
+	buildingsNeedingUnits.clear();
+	Uint32 buildingsNeedingUnitsCount = ok ? stream->readUint32("buildingsNeedingUnitsCount") : 0;
+	for (Uint32 i=0; i<buildingsNeedingUnitsCount && ok; i++)
+	{
+		Sint32 priority = stream->readSint32("priority");
+		ok = loadBuildingList(stream, this, buildingsNeedingUnits[priority], "buildingsNeedingUnits");
+	}
+	if (!ok)
+	{
+		stream->readLeaveSection();
+		return false;
+	}
+
+	// The buckets break ties by age, so the oldest building of the list is inserted first
+	canFeedUnitBuckets.clear();
+	for (std::list<Building *>::reverse_iterator it=canFeedUnit.rbegin(); it!=canFeedUnit.rend(); ++it)
+		canFeedUnitBuckets.insert(*it);
+	canHealUnitBuckets.clear();
+	for (std::list<Building *>::reverse_iterator it=canHealUnit.rbegin(); it!=canHealUnit.rend(); ++it)
+		canHealUnitBuckets.insert(*it);
+
+	stream->readEnterSection("myUnits");
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
+	{
+		stream->readEnterSection(i);
+		myUnits[i]->loadCaches(stream);
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+
+	stream->readEnterSection("myBuildings");
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
+	{
+		stream->readEnterSection(i);
+		myBuildings[i]->loadCaches(stream);
+		stream->readLeaveSection();
+	}
+	stream->readLeaveSection();
+
+	stream->readLeaveSection();
+	return !stream->isEndOfStream();
+}
+
+
+
 
 void Team::createLists(void)
 {
@@ -374,7 +580,7 @@ void Team::createLists(void)
 	turrets.clear();
 	virtualBuildings.clear();
 
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 		if (myBuildings[i])
 	{
 		if (myBuildings[i]->type->unitProductionTime)
@@ -398,6 +604,8 @@ void Team::clearLists(void)
 		upgrade[i].clear();
 	canFeedUnit.clear();
 	canHealUnit.clear();
+	canFeedUnitBuckets.clear();
+	canHealUnitBuckets.clear();
 	canExchange.clear();
 	buildingsWaitingForDestruction.clear();
 	buildingsToBeDestroyed.clear();
@@ -415,7 +623,7 @@ void Team::clearMap(void)
 {
 	assert(map);
 
-	for (int i=0; i<Unit::MAX_COUNT; ++i)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		if (myUnits[i])
 		{
@@ -430,7 +638,7 @@ void Team::clearMap(void)
 		}
 	}
 
-	for (int i=0; i<Building::MAX_COUNT; ++i)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 	{
 		if (myBuildings[i])
 		{
@@ -446,22 +654,114 @@ void Team::clearMap(void)
 
 
 
+void Team::setUnit(int id, Unit *unit)
+{
+	assert(id >= 0 && id < Unit::MAX_COUNT);
+	if (id >= (int)unitSlots.capacity())
+		growUnits(std::min(std::max(2 * unitSlots.capacity(), (size_t)id + 1), (size_t)Unit::MAX_COUNT));
+	myUnits[id] = unit;
+	if (unit)
+		unitSlots.insert(id);
+	else
+		unitSlots.erase(id);
+}
+
+
+
+
+void Team::setBuilding(int id, Building *building)
+{
+	assert(id >= 0 && id < Building::MAX_COUNT);
+	if (id >= (int)buildingSlots.capacity())
+		growBuildings(std::min(std::max(2 * buildingSlots.capacity(), (size_t)id + 1), (size_t)Building::MAX_COUNT));
+	myBuildings[id] = building;
+	if (building)
+		buildingSlots.insert(id);
+	else
+		buildingSlots.erase(id);
+	updateTowerCoverage(id);
+}
+
+int Team::getFreeUnitId(void) const
+{
+	int id = unitSlots.firstFree();
+	if (id == -1)
+		id = unitSlots.capacity();
+	return id < Unit::MAX_COUNT ? id : -1;
+}
+
+int Team::getFreeBuildingId(void) const
+{
+	int id = buildingSlots.firstFree();
+	if (id == -1)
+		id = buildingSlots.capacity();
+	return id < Building::MAX_COUNT ? id : -1;
+}
+
+void Team::growUnits(size_t capacity)
+{
+	size_t oldCapacity = unitSlots.capacity();
+	assert(capacity > oldCapacity && capacity <= (size_t)Unit::MAX_COUNT);
+	Unit **units = new Unit*[capacity];
+	std::copy(myUnits, myUnits + oldCapacity, units);
+	std::fill(units + oldCapacity, units + capacity, (Unit *)NULL);
+	delete [] myUnits;
+	myUnits = units;
+	unitSlots.grow(capacity);
+	unitWasFree.resize(capacity, false);
+}
+
+void Team::growBuildings(size_t capacity)
+{
+	size_t oldCapacity = buildingSlots.capacity();
+	assert(capacity > oldCapacity && capacity <= (size_t)Building::MAX_COUNT);
+	Building **buildings = new Building*[capacity];
+	std::copy(myBuildings, myBuildings + oldCapacity, buildings);
+	std::fill(buildings + oldCapacity, buildings + capacity, (Building *)NULL);
+	delete [] myBuildings;
+	myBuildings = buildings;
+	buildingSlots.grow(capacity);
+}
+
+void Team::updateTowerCoverage(int id)
+{
+	updateTowerCoverageMapSize();
+	Building *b = myBuildings[id];
+	if (b && b->shortTypeNum == IntBuildingType::DEFENSE_BUILDING)
+		towerCoverage.setArea(id, b->posX, b->posY, b->type->shootingRange + 1);
+	else
+		towerCoverage.clearArea(id);
+}
+
+void Team::updateTowerCoverageMapSize(void)
+{
+	towerCoverage.setMapSize(map->getW(), map->getH());
+}
+
+bool Team::isInTowerCoverage(int x, int y) const
+{
+	return towerCoverage.isCovered(x, y);
+}
+
+
+
+
 void Team::clearMem(void)
 {
-	for (int i=0; i<Unit::MAX_COUNT; ++i)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		if (myUnits[i])
 		{
 			delete myUnits[i];
-			myUnits[i] = NULL;
+			setUnit(i, NULL);
 		}
 	}
-	for (int i=0; i<Building::MAX_COUNT; ++i)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 	{
 		if (myBuildings[i])
 		{
 			delete myBuildings[i];
-			myBuildings[i] = NULL;
+			setBuilding(i, NULL);
 		}
 	}
 }
@@ -472,7 +772,7 @@ void Team::clearMem(void)
 void Team::integrity(void)
 {
 	assert(noMoreBuildingSitesCountdown<=noMoreBuildingSitesCountdownMax);
-	for (int id=0; id<Building::MAX_COUNT; id++)
+	for (int id=buildingSlots.first(); id!=-1; id=buildingSlots.next(id))
 	{
 		Building *b=myBuildings[id];
 		if (b)
@@ -493,7 +793,7 @@ void Team::integrity(void)
 		assert(myBuildings[Building::GIDtoID((*it)->gid)]);
 	}
 
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u)
@@ -534,7 +834,7 @@ void Team::setCorrectColor(float value)
 
 void Team::update()
 {
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 		if (myBuildings[i])
 			myBuildings[i]->update();
 }
@@ -558,33 +858,43 @@ Building *Team::findNearestHeal(Unit *unit)
 {
 	if (unit->hungry < 0)
 		return NULL;
+	// Flying units look at buildings by rings of buckets around them, until the ring is
+	// too far to contain a better one. Ties are broken in the order of canHealUnit.
+	Sint32 x = unit->posX;
+	Sint32 y = unit->posY;
+	Building *choosen = NULL;
+	Uint32 choosenSerial = 0;
 	if (unit->performance[FLY])
 	{
-		Sint32 x = unit->posX;
-		Sint32 y = unit->posY;
 		Sint32 maxDist = unit->hungry / unit->race->hungryness + unit->hp;
-		Building *choosen = NULL;
 		Sint32 bestDist2 = maxDist * maxDist;
-		for (std::list<Building *>::iterator bi=canHealUnit.begin(); bi!=canHealUnit.end(); ++bi)
+		for (int ring = 0; ring < canHealUnitBuckets.getRingCount(); ring++)
 		{
-			Building *b=(*bi);
-			Sint32 dist2 = map->warpDistSquare(x, y, b->posX, b->posY);
-			if (dist2 < bestDist2)
+			Sint32 minDist = canHealUnitBuckets.ringMinDistance(ring);
+			if (minDist * minDist > bestDist2 || (!choosen && minDist * minDist == bestDist2))
+				break;
+			bucketsRing.clear();
+			canHealUnitBuckets.getRing(x, y, ring, bucketsRing);
+			for (size_t i = 0; i < bucketsRing.size(); i++)
 			{
-				choosen = b;
-				bestDist2 = dist2;
+				Building *b = bucketsRing[i]->building;
+				Sint32 dist2 = map->warpDistSquare(x, y, b->posX, b->posY);
+				if (dist2 < bestDist2 || (choosen && dist2 == bestDist2 && bucketsRing[i]->serial > choosenSerial))
+				{
+					choosen = b;
+					choosenSerial = bucketsRing[i]->serial;
+					bestDist2 = dist2;
+				}
 			}
 		}
 		return choosen;
 	}
 	else
 	{
-		Sint32 x = unit->posX;
-		Sint32 y = unit->posY;
 		Sint32 maxDist = unit->hungry / race.hungryness + unit->hp;
 		bool canSwim = unit->performance[SWIM];
-		Building *choosen=  NULL;
 		Sint32 bestDist = maxDist;
+		// buildingAvailable computes gradients as a side effect, so it is asked for every building
 		for (std::list<Building *>::iterator bi=canHealUnit.begin(); bi!=canHealUnit.end(); ++bi)
 		{
 			int buildingDist;//initialized in buildingAvailable next line
@@ -613,6 +923,9 @@ Building *Team::findNearestFood(Unit *unit)
 			break;
 		}
 	
+	// Only the inns in the rings of buckets that can be closer than maxDist are looked at,
+	// in the order of the canFeedUnit lists. Flying units stop at the first ring too far
+	// to contain a better one, and break ties in the order of the list.
 	// first, we check for the best food an enemy can offer:
 	Sint32 bestEnemyHappyness = 0;
 	Sint32 maxDist = std::max(0, unit->hungry) / unit->race->hungryness + unit->hp;
@@ -621,76 +934,46 @@ Building *Team::findNearestFood(Unit *unit)
 	{
 		if (unit->verbose)
 			printf("guid=(%d), Team::findNearestFood(), concurency\n", unit->gid);
-		if (unit->performance[FLY])
+		bool fly = unit->performance[FLY];
+		bool canSwim = (unit->performance[SWIM] > 0);
+		Sint32 bestDist = maxDist;
+		for (int ti = 0; ti < header.getNumberOfTeams(); ti++)
 		{
-			Sint32 bestDist = maxDist;
-			for (int ti = 0; ti < header.getNumberOfTeams(); ti++)
+			if (ti == teamNumber)
+				continue;
+			Team *team = game->teams[ti];
+			if ((!team->sharedVisionFood & me) || (team->allies & me))
+				continue;
+			bucketsRing.clear();
+			team->canFeedUnitBuckets.getWithin(unit->posX, unit->posY, maxDist - 1, bucketsRing);
+			for (size_t i = 0; i < bucketsRing.size(); i++)
 			{
-				if (ti == teamNumber)
-					continue;
-				Team *team = game->teams[ti];
-				if ((!team->sharedVisionFood & me) || (team->allies & me))
-					continue;
-				for (std::list<Building *>::iterator bi = team->canFeedUnit.begin(); bi != team->canFeedUnit.end(); ++bi)
+				Building *b = bucketsRing[i]->building;
+				int dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, b->posX, b->posY));
+				if (dist >= maxDist
+					|| !b->canConvertUnit()
+					)
 				{
-					Sint32 dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, (*bi)->posX, (*bi)->posY));
-					if (dist >= maxDist
-						|| !(*bi)->canConvertUnit()
-						)
-					{
-						continue;
-					}
-					int happyness = (*bi)->availableHappynessLevel();
-					if (happyness > bestEnemyHappyness)
-					{
-						bestEnemyHappyness = happyness;
-						bestDist = dist;
-						bestEnemyFood = *bi;
-					}
-					else if (happyness == bestEnemyHappyness && dist < bestDist)
-					{
-						bestDist = dist;
-						bestEnemyFood = *bi;
-					}
-				}
-			}
-		}
-		else
-		{
-			Sint32 bestDist = maxDist;
-			bool canSwim = (unit->performance[SWIM] > 0);
-			for (int ti = 0; ti < header.getNumberOfTeams(); ti++)
-			{
-				if (ti == teamNumber)
 					continue;
-				Team *team = game->teams[ti];
-				if ((!team->sharedVisionFood & me) || (team->allies & me))
-					continue;
-				for (std::list<Building *>::iterator bi = team->canFeedUnit.begin(); bi != team->canFeedUnit.end(); ++bi)
+				}
+				if (!fly)
 				{
-					int dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, (*bi)->posX, (*bi)->posY));
-					if (dist >= maxDist
-						|| !(*bi)->canConvertUnit()
-						)
-					{
-						continue;
-					}
-					if (!map->buildingAvailable(*bi, canSwim, unit->posX, unit->posY, &dist))
+					if (!map->buildingAvailable(b, canSwim, unit->posX, unit->posY, &dist))
 						continue;
 					if (dist >= maxDist)
 						continue;
-					int happyness = (*bi)->availableHappynessLevel();
-					if (happyness > bestEnemyHappyness)
-					{
-						bestEnemyHappyness = happyness;
-						bestDist = dist;
-						bestEnemyFood = *bi;
-					}
-					else if (happyness == bestEnemyHappyness && dist < bestDist)
-					{
-						bestDist = dist;
-						bestEnemyFood = *bi;
-					}
+				}
+				int happyness = b->availableHappynessLevel();
+				if (happyness > bestEnemyHappyness)
+				{
+					bestEnemyHappyness = happyness;
+					bestDist = dist;
+					bestEnemyFood = b;
+				}
+				else if (happyness == bestEnemyHappyness && dist < bestDist)
+				{
+					bestDist = dist;
+					bestEnemyFood = b;
 				}
 			}
 		}
@@ -700,46 +983,58 @@ Building *Team::findNearestFood(Unit *unit)
 
 	//Second, we check if we have any satisfactory inns on our team.
 	// That mean it has to be better or equal than the ennemy food.
-	if (unit->performance[FLY])
+	bool fly = unit->performance[FLY];
+	bool canSwim = (unit->performance[SWIM] > 0);
+	Sint32 bestDist = maxDist;
+	Building *choosenFood = NULL;
+	if (fly)
 	{
-		Sint32 bestDist = maxDist;
-		Building *choosenFood = NULL;
-		for (std::list<Building *>::iterator bi=canFeedUnit.begin(); bi!=canFeedUnit.end(); ++bi)
+		Uint32 choosenSerial = 0;
+		for (int ring = 0; ring < canFeedUnitBuckets.getRingCount(); ring++)
 		{
-			if ((*bi)->availableHappynessLevel() < bestEnemyHappyness)
-				continue;
-			Sint32 dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, (*bi)->posX, (*bi)->posY));
-			if (dist >= bestDist)
-				continue;
-			bestDist = dist;
-			choosenFood = *bi;
+			Sint32 minDist = 1 + canFeedUnitBuckets.ringMinDistance(ring);
+			if (minDist > bestDist || (minDist == bestDist && !choosenFood))
+				break;
+			bucketsRing.clear();
+			canFeedUnitBuckets.getRing(unit->posX, unit->posY, ring, bucketsRing);
+			for (size_t i = 0; i < bucketsRing.size(); i++)
+			{
+				Building *b = bucketsRing[i]->building;
+				if (b->availableHappynessLevel() < bestEnemyHappyness)
+					continue;
+				int dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, b->posX, b->posY));
+				if (dist > bestDist || (dist == bestDist && (!choosenFood || bucketsRing[i]->serial < choosenSerial)))
+					continue;
+				bestDist = dist;
+				choosenFood = b;
+				choosenSerial = bucketsRing[i]->serial;
+			}
 		}
-		if (choosenFood)
-			return choosenFood;
 	}
 	else
 	{
-		bool canSwim = (unit->performance[SWIM] > 0);
-		Sint32 bestDist = maxDist;
-		Building *choosenFood = NULL;
-		for (std::list<Building *>::iterator bi=canFeedUnit.begin(); bi!=canFeedUnit.end(); ++bi)
+		// Gradients are computed by buildingAvailable as a side effect, so walking units must ask
+		// for the very same inns, in the same order, as when the whole canFeedUnit list was read.
+		bucketsRing.clear();
+		canFeedUnitBuckets.getWithin(unit->posX, unit->posY, maxDist - 1, bucketsRing);
+		for (size_t i = 0; i < bucketsRing.size(); i++)
 		{
-			if ((*bi)->availableHappynessLevel() < bestEnemyHappyness)
+			Building *b = bucketsRing[i]->building;
+			if (b->availableHappynessLevel() < bestEnemyHappyness)
 				continue;
-			int dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, (*bi)->posX, (*bi)->posY));
+			int dist = 1 + (Sint32)sqrt(map->warpDistSquare(unit->posX, unit->posY, b->posX, b->posY));
 			if (dist >= bestDist)
 				continue;
-
-			if (!map->buildingAvailable(*bi, canSwim, unit->posX, unit->posY, &dist))
+			if (!map->buildingAvailable(b, canSwim, unit->posX, unit->posY, &dist))
 				continue;
 			if (dist >= bestDist)
 				continue;
 			bestDist = dist;
-			choosenFood = *bi;
+			choosenFood = b;
 		}
-		if (choosenFood)
-			return choosenFood;
 	}
+	if (choosenFood)
+		return choosenFood;
 	
 	return bestEnemyFood;
 }
@@ -859,6 +1154,30 @@ void Team::remove_building_needing_work(Building* b, Sint32 priority)
 
 void Team::updateAllBuildingTasks()
 {
+	// Index the units that can be hired, so that buildings do not have to scan all unit slots for each round
+	buildingTasksPass++;
+	freeUnits.clear();
+	nonFreeHarvesters=0;
+	for(int i=0; i<NB_UNIT_TYPE; ++i)
+		nonFreeUnits[i]=0;
+	std::fill(unitWasFree.begin(), unitWasFree.end(), false);
+	for(int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
+	{
+		Unit *unit=myUnits[i];
+		if(unit->activity == Unit::ACT_RANDOM && unit->medical == Unit::MED_FREE)
+		{
+			unitWasFree[i]=true;
+			freeUnits.push_back(unit);
+		}
+		else
+		{
+			nonFreeUnits[unit->typeNum]++;
+			if(unit->performance[HARVEST])
+				nonFreeHarvesters++;
+		}
+	}
+	freeUnitsRessourceDistance.assign(freeUnits.size()*MAX_NB_RESSOURCES, -2);
+
 	for(std::map<int, std::vector<Building*>, std::greater<int> >::iterator i = buildingsNeedingUnits.begin(); i!=buildingsNeedingUnits.end(); ++i)
 	{
 		std::sort(i->second.begin(), i->second.end(), Team::prioritize_building);
@@ -888,10 +1207,29 @@ void Team::updateAllBuildingTasks()
 
 
 
+bool Team::freeUnitRessourceAvailable(size_t index, int teamNumber, int ressourceType, bool canSwim, int x, int y, int *dist)
+{
+	Sint32 &cached=freeUnitsRessourceDistance[index*MAX_NB_RESSOURCES+ressourceType];
+	if(cached==-2)
+	{
+		int d=0;
+		if(map->ressourceAvailable(teamNumber, ressourceType, canSwim, x, y, &d))
+			cached=d;
+		else
+			cached=-1;
+	}
+	if(cached<0)
+		return false;
+	*dist=cached;
+	return true;
+}
+
+
+
 int Team::maxBuildLevel(void)
 {
 	int maxLevel=0;
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 	{
 		Unit *u=myUnits[i];
 		if (u && u->performance[BUILD])
@@ -914,9 +1252,15 @@ void Team::removeFromAbilitiesLists(Building *building)
 			upgrade[ui].remove(building);
 
 	if (building->type->canFeedUnit)
+	{
 		canFeedUnit.remove(building);
+		canFeedUnitBuckets.remove(building);
+	}
 	if (building->type->canHealUnit)
+	{
 		canHealUnit.remove(building);
+		canHealUnitBuckets.remove(building);
+	}
 	if (building->type->canExchange)
 		canExchange.remove(building);
 
@@ -965,7 +1309,7 @@ void Team::syncStep(void)
 
 	int nbUsefullUnits = 0;
 	int nbUsefullUnitsAlone = 0;
-	for (int i = 0; i < Unit::MAX_COUNT; i++)
+	for (int i = unitSlots.first(); i != -1; i = unitSlots.next(i))
 	{
 		Unit *u = myUnits[i];
 		if (u)
@@ -985,7 +1329,7 @@ void Team::syncStep(void)
 				if(game->selectedUnit == u)
 					game->selectedUnit = NULL;
 				delete u;
-				myUnits[i] = NULL;
+				setUnit(i, NULL);
 			}
 		}
 	}
@@ -1038,7 +1382,7 @@ void Team::syncStep(void)
 		if (game->selectedBuilding==building)
 			game->selectedBuilding=NULL;
 
-		myBuildings[Building::GIDtoID(building->gid)]=NULL;
+		setBuilding(Building::GIDtoID(building->gid), NULL);
 		delete building;
 	}
 
@@ -1058,7 +1402,7 @@ void Team::syncStep(void)
 
 	bool isEnoughFoodInSwarm=false;
 
-	for (int i=0; i<Building::MAX_COUNT; ++i)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 	{
 		if(myBuildings[i])
 		{
@@ -1176,7 +1520,7 @@ bool Team::wasRecentEvent(GameEventType type)
 void Team::dirtyGlobalGradient()
 {
 	game->dirtyWarFlagGradient();
-	for (int id=0; id<Building::MAX_COUNT; id++)
+	for (int id=buildingSlots.first(); id!=-1; id=buildingSlots.next(id))
 	{
 		Building *b=myBuildings[id];
 		if (b)
@@ -1216,7 +1560,7 @@ Uint32 Team::checkSum(std::vector<Uint32> *checkSumsVector, std::vector<Uint32>
 	if (checkSumsVector)
 		checkSumsVector->push_back(cs); // [1+t*20]
 
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=unitSlots.first(); i!=-1; i=unitSlots.next(i))
 		if (myUnits[i])
 	{
 		cs^=myUnits[i]->checkSum(checkSumsVectorForUnits);
@@ -1225,7 +1569,7 @@ Uint32 Team::checkSum(std::vector<Uint32> *checkSumsVector, std::vector<Uint32>
 	if (checkSumsVector)
 		checkSumsVector->push_back(cs); // [2+t*20]
 
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=buildingSlots.first(); i!=-1; i=buildingSlots.next(i))
 		if (myBuildings[i])
 	{
 		cs^=myBuildings[i]->checkSum(checkSumsVectorForBuildings);
@@ -34,6 +34,9 @@
 
 #include "BaseTeam.h"
 #include "WinningConditions.h"
+#include "SlotSet.h"
+#include "BuildingBuckets.h"
+#include "TowerCoverage.h"
 
 class Building;
 class BuildingsTypes;
@@ -55,6 +58,10 @@ public:
 	void setBaseTeam(const BaseTeam *initial);
 	bool load(GAGCore::InputStream *stream, BuildingsTypes *buildingstypes, Sint32 versionMinor);
 	void save(GAGCore::OutputStream *stream);
+	//! Saves the order of the lists of buildings, which load() fills again in slot order, and the caches of the units and buildings
+	void saveCaches(GAGCore::OutputStream *stream);
+	//! Loads what saveCaches() saved, after load() and update() for the same team
+	bool loadCaches(GAGCore::InputStream *stream);
 	
 	//! Used by MapRandomGenerator to fill correctly the list usually filled by load(stream).
 	void createLists(void);
@@ -80,6 +87,10 @@ public:
 
 	///Push a new game event into the queue
 	void pushGameEvent(boost::shared_ptr<GameEvent> event);
+
+	///Returns whether an event of the given type would be kept by pushGameEvent right now.
+	///Use this to avoid creating events that would be ignored because of the cooldown.
+	bool acceptsGameEvent(GameEventType type) const { return eventCooldownTimers[type] == 0; }
 	
 	///Return the top-most event from the queue and remove it
 	boost::shared_ptr<GameEvent> getEvent();
@@ -112,6 +123,8 @@ public:
 	void remove_building_needing_work(Building* b, Sint32 priority);
 	///This function updates all of the buildings in order of highest priority to lowest
 	void updateAllBuildingTasks();
+	///Map::ressourceAvailable for the unit at index in freeUnits, computed once per building tasks pass
+	bool freeUnitRessourceAvailable(size_t index, int teamNumber, int ressourceType, bool canSwim, int x, int y, int *dist);
 
 	//! Return the maximum build level (need at least 1 unit of this level)
 	int maxBuildLevel(void);
@@ -132,19 +145,60 @@ public:
 	
 private:
 	void init(void);
+	///Makes myUnits hold capacity slots, the units stay in their slots
+	void growUnits(size_t capacity);
+	///Makes myBuildings hold capacity slots, the buildings stay in their slots
+	void growBuildings(size_t capacity);
 
 public:
 	// game is the basic (structural) pointer. Map is used for direct access.
 	Game *game;
 	Map *map;
 	
+	///The units of the team by id, unitSlots.capacity() long. It grows as needed, up to Unit::MAX_COUNT.
 	Unit **myUnits;
 	
+	///The buildings of the team by id, buildingSlots.capacity() long. It grows as needed, up to Building::MAX_COUNT.
 	Building **myBuildings;
 
+	///The used slots of myUnits and myBuildings. Loops over the units or buildings of the team
+	///should use them, as their cost is proportional to the number of units or buildings alive.
+	SlotSet unitSlots;
+	SlotSet buildingSlots;
+	///Sets the unit in slot id of myUnits, NULL frees the slot. Always use this instead of writing to myUnits.
+	///myUnits grows if id is past its end, which moves it, so don't keep a pointer to it across this call.
+	void setUnit(int id, Unit *unit);
+	///Sets the building in slot id of myBuildings, NULL frees the slot. Always use this instead of writing to myBuildings.
+	///myBuildings grows if id is past its end, which moves it, so don't keep a pointer to it across this call.
+	void setBuilding(int id, Building *building);
+	///Returns the slot of myUnits a new unit should use, which may be past its end, or -1 if the team has Unit::MAX_COUNT units
+	int getFreeUnitId(void) const;
+	///Returns the slot of myBuildings a new building should use, which may be past its end, or -1 if the team has Building::MAX_COUNT buildings
+	int getFreeBuildingId(void) const;
+	///Updates towerCoverage for the building in slot id of myBuildings. Must be called when a building
+	///changes type or position; setBuilding calls it for added and removed buildings.
+	void updateTowerCoverage(int id);
+	///Recomputes towerCoverage if the size of the map changed. Must be called when the map is
+	///loaded or resized after the buildings of the team were set.
+	void updateTowerCoverageMapSize(void);
+	///Returns true if (x, y) is within shootingRange+1 of a defense building of this team
+	bool isInTowerCoverage(int x, int y) const;
+
 	///This stores the buildings that need units, listed into their hard priorities. They are sorted based on priority.
 	std::map<int, std::vector<Building*>, std::greater<int> > buildingsNeedingUnits;
 
+	///The units that were free (random activity and no medical need) when updateAllBuildingTasks started,
+	///in the order of myUnits. Buildings only look at those when hiring, which keeps the original choices.
+	std::vector<Unit *> freeUnits;
+	///For each unit slot, true if the unit was in freeUnits when updateAllBuildingTasks started
+	std::vector<bool> unitWasFree;
+	///Number of units of each type that were not free when updateAllBuildingTasks started
+	int nonFreeUnits[NB_UNIT_TYPE];
+	///Number of units able to harvest that were not free when updateAllBuildingTasks started
+	int nonFreeHarvesters;
+	///Counts the calls to updateAllBuildingTasks, so that buildings know when their cached distances are outdated
+	Uint32 buildingTasksPass;
+
 	// thoses where the 4 "call-lists" (lists of flags or buildings for units to work on/in) :
 	std::list<Building *> upgrade[NB_ABILITY]; //to upgrade the units' abilities.
 	
@@ -152,6 +206,9 @@ public:
 	std::list<Building *> canFeedUnit; // The buildings with not enough food are not in this list.
 	std::list<Building *> canHealUnit;
 	std::list<Building *> canExchange;
+	// The same buildings as in canFeedUnit and canHealUnit, sorted by position on the map.
+	BuildingBuckets canFeedUnitBuckets;
+	BuildingBuckets canHealUnitBuckets;
 
 	// The lists of building which needs specials updates:
 	std::list<Building *> buildingsWaitingForDestruction;
@@ -214,6 +271,14 @@ public:
 	// TeamStat latestStat; this has been moved to *stats.getLatestStat();
 	TeamStats stats;
 
+private:
+	///Distance from each unit of freeUnits to each ressource, -2 if not computed yet, -1 if not available
+	std::vector<Sint32> freeUnitsRessourceDistance;
+	///Buildings of the ring of buckets being looked at by findNearestHeal and findNearestFood
+	std::vector<const BuildingBuckets::Entry *> bucketsRing;
+	///For each map case, the number of defense buildings of this team in range, with one square per building slot
+	TowerCoverage towerCoverage;
+
 protected:
 	FILE *logFile;
 };
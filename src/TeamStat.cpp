@@ -144,7 +144,7 @@ void TeamStats::step(Team *team, bool reloaded)
 	// handle in game stat step
 	TeamSmoothedStat &smoothedStat=smoothedStats[smoothedIndex];
 	smoothedStat.reset();
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=team->myUnits[i];
 		if ((u)&&(u->medical==Unit::MED_FREE)&&(u->activity==Unit::ACT_RANDOM))
@@ -154,7 +154,7 @@ void TeamStats::step(Team *team, bool reloaded)
 		}
 	}
 	
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b = team->myBuildings[i];
 		if (b)
@@ -201,7 +201,7 @@ void TeamStats::step(Team *team, bool reloaded)
 
 	stat.reset();
 
-	for (int i=0; i<Unit::MAX_COUNT; i++)
+	for (int i=team->unitSlots.first(); i!=-1; i=team->unitSlots.next(i))
 	{
 		Unit *u=team->myUnits[i];
 		if (u)
@@ -259,7 +259,7 @@ void TeamStats::step(Team *team, bool reloaded)
 		}
 	}
 
-	for (int i=0; i<Building::MAX_COUNT; i++)
+	for (int i=team->buildingSlots.first(); i!=-1; i=team->buildingSlots.next(i))
 	{
 		Building *b = team->myBuildings[i];
 		if (b)
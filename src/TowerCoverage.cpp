@@ -0,0 +1,97 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "TowerCoverage.h"
+#include <algorithm>
+#include <cassert>
+
+TowerCoverage::TowerCoverage():
+	w(0),
+	h(0)
+{
+}
+
+void TowerCoverage::setMapSize(int w, int h)
+{
+	if (w == this->w && h == this->h)
+		return;
+	this->w = w;
+	this->h = h;
+	counts.clear();
+	for (size_t i = 0; i < areas.size(); i++)
+		if (areas[i].range >= 0)
+			addArea(areas[i], 1);
+}
+
+void TowerCoverage::setArea(size_t slot, int x, int y, int range)
+{
+	Area none = { 0, 0, -1 };
+	if (slot >= areas.size())
+		areas.resize(slot + 1, none);
+	Area area = { x, y, range };
+	if (range < 0)
+		area = none;
+
+	Area &old = areas[slot];
+	if (old.x == area.x && old.y == area.y && old.range == area.range)
+		return;
+	if (old.range >= 0)
+		addArea(old, -1);
+	if (area.range >= 0)
+		addArea(area, 1);
+	old = area;
+}
+
+void TowerCoverage::clearArea(size_t slot)
+{
+	setArea(slot, 0, 0, -1);
+}
+
+unsigned TowerCoverage::coverCount(int x, int y) const
+{
+	if (counts.empty())
+		return 0;
+	return counts[(y & (h - 1)) * w + (x & (w - 1))];
+}
+
+void TowerCoverage::addArea(const Area &area, int delta)
+{
+	if (w == 0 || h == 0)
+		return;
+	if (counts.empty())
+	{
+		// only squares added while the map had this size can be removed
+		assert(delta > 0);
+		counts.assign(w * h, 0);
+	}
+
+	// the cases at a warpDistMax of at most range, without visiting a case twice on small maps
+	int spanW = std::min(2 * area.range + 1, w);
+	int spanH = std::min(2 * area.range + 1, h);
+	for (int dy = 0; dy < spanH; dy++)
+	{
+		size_t line = ((area.y - area.range + dy) & (h - 1)) * w;
+		for (int dx = 0; dx < spanW; dx++)
+		{
+			unsigned short &count = counts[line + ((area.x - area.range + dx) & (w - 1))];
+			assert(delta > 0 || count > 0);
+			count += delta;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+/*
+  Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+  for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef __TOWER_COVERAGE_H
+#define __TOWER_COVERAGE_H
+
+#include <cstddef>
+#include <vector>
+
+///For each case of a map, the number of squares covering it. Each square belongs to a slot
+///(for instance a slot of Team::myBuildings), so that it can be moved or removed later without
+///knowing what it was. Squares wrap around the map borders, like Map::warpDistMax.
+///The counts are recomputed from the squares when the map size changes, so squares may
+///be set before the size of the map is known, as happens when a game is loaded.
+class TowerCoverage
+{
+public:
+	///Creates a coverage without any square, for a map of size 0x0
+	TowerCoverage();
+
+	///Sets the size of the map, w and h must be powers of two or 0. The counts are recomputed if the size changed.
+	void setMapSize(int w, int h);
+	///Sets the square of slot to the cases at a warpDistMax of at most range of (x, y), replacing the previous one
+	void setArea(size_t slot, int x, int y, int range);
+	///Removes the square of slot, if any
+	void clearArea(size_t slot);
+
+	///Returns the number of squares covering (x, y), coordinates are warped
+	unsigned coverCount(int x, int y) const;
+	///Returns true if (x, y) is covered by at least one square, coordinates are warped
+	bool isCovered(int x, int y) const { return coverCount(x, y) != 0; }
+
+private:
+	struct Area
+	{
+		int x, y, range; // range is -1 when the slot covers nothing
+	};
+	///Adds delta to the counts of the cases covered by area
+	void addArea(const Area &area, int delta);
+
+	///The square of each slot
+	std::vector<Area> areas;
+	///For each case, the number of squares covering it. Empty until the first square is added to a non-empty map.
+	std::vector<unsigned short> counts;
+	int w, h;
+};
+
+#endif
@@ -34,18 +34,20 @@
 #include <set>
 #include <climits>
 
+DEFINE_POOLED_ALLOCATION(Unit)
+
 Unit::Unit(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor)
 {
 	init(0,0,0,0,owner,0);
 	load(stream, owner, versionMinor);
 }
 
-Unit::Unit(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, int level)
+Unit::Unit(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, int level)
 {
 	init(x, y, gid, typeNum, team, level);
 }
 
-void Unit::init(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, int level)
+void Unit::init(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, int level)
 {
 	logFile = globalContainer->logFileManager->getFile("Unit.log");
 	
@@ -157,7 +159,7 @@ void Unit::load(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor)
 	assert(race);
 
 	// identity
-	gid = stream->readUint16("gid");
+	gid = readGID(stream, "gid", versionMinor);
 	this->owner = owner;
 	isDead = stream->readSint32("isDead");
 
@@ -247,7 +249,7 @@ void Unit::save(GAGCore::OutputStream *stream)
 	stream->writeText(skinName, "skinName");
 
 	// identity
-	stream->writeUint16(gid, "gid");
+	stream->writeUint32(gid, "gid");
 	stream->writeSint32(isDead, "isDead");
 
 	// position
@@ -312,21 +314,21 @@ void Unit::save(GAGCore::OutputStream *stream)
 void Unit::loadCrossRef(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor)
 {
 	stream->readEnterSection("Unit");
-	Uint16 gbid;
+	Uint32 gbid;
 	
-	gbid = stream->readUint16("attachedBuilding");
+	gbid = Building::readGID(stream, "attachedBuilding", versionMinor);
 	if (gbid == NOGBID)
 		attachedBuilding = NULL;
 	else
 		attachedBuilding = owner->myBuildings[Building::GIDtoID(gbid)];
 	
-	gbid = stream->readUint16("targetBuilding");
+	gbid = Building::readGID(stream, "targetBuilding", versionMinor);
 	if (gbid == NOGBID)
 		targetBuilding = NULL;
 	else
 		targetBuilding = owner->myBuildings[Building::GIDtoID(gbid)];
 		
-	gbid = stream->readUint16("ownExchangeBuilding");
+	gbid = Building::readGID(stream, "ownExchangeBuilding", versionMinor);
 	if (gbid == NOGBID)
 		ownExchangeBuilding = NULL;
 	else
@@ -340,23 +342,44 @@ void Unit::saveCrossRef(GAGCore::OutputStream *stream)
 	stream->writeEnterSection("Unit");
 	
 	if (attachedBuilding)
-		stream->writeUint16(attachedBuilding->gid, "attachedBuilding");
+		stream->writeUint32(attachedBuilding->gid, "attachedBuilding");
 	else
-		stream->writeUint16(NOGBID, "attachedBuilding");
+		stream->writeUint32(NOGBID, "attachedBuilding");
 		
 	if (targetBuilding)
-		stream->writeUint16(targetBuilding->gid, "targetBuilding");
+		stream->writeUint32(targetBuilding->gid, "targetBuilding");
 	else
-		stream->writeUint16(NOGBID, "targetBuilding");
+		stream->writeUint32(NOGBID, "targetBuilding");
 		
 	if (ownExchangeBuilding)
-		stream->writeUint16(ownExchangeBuilding->gid, "ownExchangeBuilding");
+		stream->writeUint32(ownExchangeBuilding->gid, "ownExchangeBuilding");
 	else
-		stream->writeUint16(NOGBID, "ownExchangeBuilding");
+		stream->writeUint32(NOGBID, "ownExchangeBuilding");
 		
 	stream->writeLeaveSection();
 }
 
+void Unit::saveCaches(GAGCore::OutputStream *stream)
+{
+	stream->writeEnterSection("UnitCaches");
+	stream->writeSint32(jobTimer, "jobTimer");
+	// the claim in Map::clearingAreaClaims
+	stream->writeUint32(previousClearingAreaX, "previousClearingAreaX");
+	stream->writeUint32(previousClearingAreaY, "previousClearingAreaY");
+	stream->writeUint32(previousClearingAreaDistance, "previousClearingAreaDistance");
+	stream->writeLeaveSection();
+}
+
+void Unit::loadCaches(GAGCore::InputStream *stream)
+{
+	stream->readEnterSection("UnitCaches");
+	jobTimer = stream->readSint32("jobTimer");
+	previousClearingAreaX = stream->readUint32("previousClearingAreaX");
+	previousClearingAreaY = stream->readUint32("previousClearingAreaY");
+	previousClearingAreaDistance = stream->readUint32("previousClearingAreaDistance");
+	stream->readLeaveSection();
+}
+
 void Unit::setTargetBuilding(Building * b)
 {
 	if(targetBuilding!=NULL) {
@@ -474,7 +497,7 @@ void Unit::syncStep(void)
 	assert(speed>0);
 	if ((action==ATTACK_SPEED) && (delta>=128) && (delta<(128+speed)))
 	{
-		Uint16 enemyGUID=owner->map->getGroundUnit(posX+dx, posY+dy);
+		Uint32 enemyGUID=owner->map->getGroundUnit(posX+dx, posY+dy);
 		if (enemyGUID!=NOGUID)
 		{
 			int enemyID=GIDtoID(enemyGUID);
@@ -488,14 +511,17 @@ void Unit::syncStep(void)
 			
 			enemy->underAttackTimer = 240;
 
-			boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(owner->game->stepCounter, enemy->posX, enemy->posY, enemy->typeNum));
-			enemy->owner->pushGameEvent(event);
+			if (enemy->owner->acceptsGameEvent(GEUnitUnderAttack))
+			{
+				boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(owner->game->stepCounter, enemy->posX, enemy->posY, enemy->typeNum));
+				enemy->owner->pushGameEvent(event);
+			}
 
 			incrementExperience(degats);
 		}
 		else
 		{
-			Uint16 enemyGBID=owner->map->getBuilding(posX+dx, posY+dy);
+			Uint32 enemyGBID=owner->map->getBuilding(posX+dx, posY+dy);
 			if (enemyGBID!=NOGBID)
 			{
 				int enemyID=Building::GIDtoID(enemyGBID);
@@ -508,8 +534,11 @@ void Unit::syncStep(void)
 			
 				enemy->underAttackTimer = 240;
 
-				boost::shared_ptr<GameEvent> event(new BuildingUnderAttackEvent(owner->game->stepCounter, enemy->posX, enemy->posY, enemy->shortTypeNum));
-				enemy->owner->pushGameEvent(event);
+				if (enemy->owner->acceptsGameEvent(GEBuildingUnderAttack))
+				{
+					boost::shared_ptr<GameEvent> event(new BuildingUnderAttackEvent(owner->game->stepCounter, enemy->posX, enemy->posY, enemy->shortTypeNum));
+					enemy->owner->pushGameEvent(event);
+				}
 
 				if (enemy->hp<0)
 					enemy->kill();
@@ -656,18 +685,19 @@ void Unit::handleMagic(void)
 	Team **teams = owner->game->teams;
 	
 	bool hasUsedMagicAction = false;
-	if (performance[MAGIC_ATTACK_AIR] || performance[MAGIC_ATTACK_GROUND])
+	const int ATTACK_RANGE=3;
+	if ((performance[MAGIC_ATTACK_AIR] || performance[MAGIC_ATTACK_GROUND]) &&
+		(map->getSectorsTeamsPresence(posX-ATTACK_RANGE, posY-ATTACK_RANGE, 2*ATTACK_RANGE+1, 2*ATTACK_RANGE+1) & owner->enemies))
 	{
-		std::set<Uint16> damagedBuildings;
+		std::set<Uint32> damagedBuildings;
 		damagedBuildings.insert(NOGBID);
-		int ATTACK_RANGE=3;
 		for (int yi=posY-ATTACK_RANGE; yi<=posY+ATTACK_RANGE; yi++)
 			for (int xi=posX-ATTACK_RANGE; xi<=posX+ATTACK_RANGE; xi++)
 			{
 				// damaging enemy units:
 				for (int altitude=0; altitude<2; altitude++)
 				{
-					Uint16 targetGUID;
+					Uint32 targetGUID;
 					Sint32 attackForce;
 					if ((altitude == 1) && performance[MAGIC_ATTACK_AIR])
 					{
@@ -684,7 +714,7 @@ void Unit::handleMagic(void)
 					if (targetGUID != NOGUID)
 					{
 						Sint32 targetTeam = Unit::GIDtoTeam(targetGUID);
-						Uint16 targetID = Unit::GIDtoID(targetGUID);
+						Sint32 targetID = Unit::GIDtoID(targetGUID);
 						Uint32 targetTeamMask = 1<<targetTeam;
 						if (owner->enemies & targetTeamMask)
 						{
@@ -694,8 +724,11 @@ void Unit::handleMagic(void)
 							{
 								enemyUnit->hp -= damage;
 								
-								boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(owner->game->stepCounter, xi, yi, enemyUnit->typeNum));
-								enemyUnit->owner->pushGameEvent(event);
+								if (enemyUnit->owner->acceptsGameEvent(GEUnitUnderAttack))
+								{
+									boost::shared_ptr<GameEvent> event(new UnitUnderAttackEvent(owner->game->stepCounter, xi, yi, enemyUnit->typeNum));
+									enemyUnit->owner->pushGameEvent(event);
+								}
 								
 								incrementExperience(damage);
 								magicActionAnimation = MAGIC_ACTION_ANIMATION_FRAME_COUNT;
@@ -906,24 +939,18 @@ void Unit::handleActivity(void)
 					targetTeam->unitConversionGained++;
 					
 					// Find free slot in other team
-					int targetID=-1;
-					for (int i=0; i<Unit::MAX_COUNT; i++)//we search for a free place for a unit.
-						if (targetTeam->myUnits[i]==NULL)
-						{
-							targetID=i;
-							break;
-						}
+					int targetID=targetTeam->getFreeUnitId();//we search for a free place for a unit.
 
 					// If free slot, do the conversion, change owner and ID
 					if (targetID!=-1)
 					{
 						Sint32 currentID=Unit::GIDtoID(gid);
 						assert(currentTeam->myUnits[currentID]);
-						currentTeam->myUnits[currentID]=NULL;
-						targetTeam->myUnits[targetID]=this;
-						Uint16 targetGID=(GIDfrom(targetID, targetTeam->teamNumber));
+						currentTeam->setUnit(currentID, NULL);
+						targetTeam->setUnit(targetID, this);
+						Uint32 targetGID=(GIDfrom(targetID, targetTeam->teamNumber));
 						if (verbose)
-							printf("Unit guid=%d (%d) switched to guid=%d (%d)\n", gid, Unit::GIDtoTeam(gid), targetGID, Unit::GIDtoTeam(targetGID));
+							printf("Unit guid=%u (%d) switched to guid=%u (%d)\n", gid, Unit::GIDtoTeam(gid), targetGID, Unit::GIDtoTeam(targetGID));
 						if (performance[FLY])
 						{
 							assert(owner->map->getAirUnit(posX, posY)==gid);
@@ -1386,18 +1413,12 @@ void Unit::handleDisplacement(void)
 
 bool Unit::locationIsInEnemyGuardTowerRange(int x, int y)const
 {
-	//TODO: totally fix this totally hacky implementation.
+	//TODO: this looks at the position of the unit, not at (x, y), as it always did.
 	for(int i=0;i<Team::MAX_COUNT;i++)
 	{
 		Team *t = owner->game->teams[i];
-		if((t)&&(owner->enemies & t->me))
-		{
-			for(int j=0;j<Building::MAX_COUNT;j++)
-			{
-				Building *b = t->myBuildings[j];
-				if((b)&&(b->shortTypeNum==IntBuildingType::DEFENSE_BUILDING)&&(owner->map->warpDistMax(b->posX,b->posY,posX,posY) <= b->type->shootingRange + 1))return true;
-			}
-		}
+		if((t)&&(owner->enemies & t->me)&&(t->isInTowerCoverage(posX, posY)))
+			return true;
 	}
 	return false;
 }
@@ -1582,8 +1603,9 @@ void Unit::handleMovement(void)
 			else
 			{
 				Building *tempTargetBuilding=NULL;
-				// we look for the best target to attack around us
-				for (int x=-8; x<=8; x++)
+				// we look for the best target to attack around us, if any enemy is in the sectors around
+				bool enemiesAround = (owner->map->getSectorsTeamsPresence(posX-8, posY-8, 17, 17) & owner->enemies) != 0;
+				for (int x=-8; enemiesAround && x<=8; x++)
 				{
 					for (int y=-8; y<=8; y++)
 					{
@@ -1593,7 +1615,7 @@ void Unit::handleMovement(void)
 								owner->map->warpDistSquare(posX+x, posY+y, attachedBuilding->posX, attachedBuilding->posY)
 									>((int)attachedBuilding->unitStayRange*(int)attachedBuilding->unitStayRange))
 								continue;
-							Uint16 gid;
+							Uint32 gid;
 							gid=owner->map->getBuilding(posX+x, posY+y);
 							if (gid!=NOGBID)
 							{
@@ -1813,7 +1835,7 @@ void Unit::handleMovement(void)
 				{
 					int tempTargetX, tempTargetY;
 					bool path = owner->map->getGlobalGradientDestination(owner->map->clearAreasGradient[owner->teamNumber][performance[SWIM]>0], posX, posY, &tempTargetX, &tempTargetY);
-					int guid = owner->map->isClearingAreaClaimed(tempTargetX, tempTargetY, owner->teamNumber);
+					Uint32 guid = owner->map->isClearingAreaClaimed(tempTargetX, tempTargetY, owner->teamNumber);
 					int other_distance = INT_MAX;
 					if(guid != NOGUID)
 					{
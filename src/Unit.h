@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "UnitUtils.h"
+#include "FixedSizePool.h"
 #include <GAGSys.h>
 #include "UnitConsts.h"
 #include "Ressource.h"
@@ -47,16 +48,20 @@ namespace GAGCore
 // a unit
 class Unit : public UnitUtils
 {
-	void init(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, int level);
+	void init(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, int level);
 public:
 	Unit(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor);
-	Unit(int x, int y, Uint16 gid, Sint32 typeNum, Team *team, int level);
+	Unit(int x, int y, Uint32 gid, Sint32 typeNum, Team *team, int level);
 	virtual ~Unit(void) { }
+	DECLARE_POOLED_ALLOCATION
 	
 	void load(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor);
 	void save(GAGCore::OutputStream *stream);
 	void loadCrossRef(GAGCore::InputStream *stream, Team *owner, Sint32 versionMinor);
 	void saveCrossRef(GAGCore::OutputStream *stream);
+	//! Saves the fields that load() resets
+	void saveCaches(GAGCore::OutputStream *stream);
+	void loadCaches(GAGCore::InputStream *stream);
 	
 	///This function is called by a Building that has subscribed this unit.
 	///If the unit has been subscribed for upgrading or for food, as opposed
@@ -196,7 +201,7 @@ public:
 	std::string skinName;
 	
 	// identity
-	Uint16 gid; // for reservation see GIDtoID() and GIDtoTeam().
+	Uint32 gid; // for reservation see GIDtoID() and GIDtoTeam().
 	Team *owner;
 	Sint32 isDead; // (bool) if true is dead, will be garbage collected next turn
 
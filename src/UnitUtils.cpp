@@ -19,21 +19,23 @@
 
 #include "UnitUtils.h"
 #include "Team.h"
+#include "Map.h"
+#include <Stream.h>
 
 
-Sint32 UnitUtils::GIDtoID(Uint16 gid)
+Sint32 UnitUtils::GIDtoID(Uint32 gid)
 {
-	assert(gid < UnitUtils::MAX_COUNT * Team::MAX_COUNT);
+	assert(gid < (Uint32)(UnitUtils::MAX_COUNT * Team::MAX_COUNT));
 	return (gid % UnitUtils::MAX_COUNT);
 }
 
-Sint32 UnitUtils::GIDtoTeam(Uint16 gid)
+Sint32 UnitUtils::GIDtoTeam(Uint32 gid)
 {
-	assert(gid < UnitUtils::MAX_COUNT * Team::MAX_COUNT);
+	assert(gid < (Uint32)(UnitUtils::MAX_COUNT * Team::MAX_COUNT));
 	return (gid / UnitUtils::MAX_COUNT);
 }
 
-Uint16 UnitUtils::GIDfrom(Sint32 id, Sint32 team)
+Uint32 UnitUtils::GIDfrom(Sint32 id, Sint32 team)
 {
 	assert(id >= 0);
 	assert(id < UnitUtils::MAX_COUNT);
@@ -41,3 +43,17 @@ Uint16 UnitUtils::GIDfrom(Sint32 id, Sint32 team)
 	assert(team < Team::MAX_COUNT);
 	return id + team * UnitUtils::MAX_COUNT;
 }
+
+Uint32 UnitUtils::GIDfromUint16(Uint16 gid)
+{
+	if (gid == 0xFFFF)
+		return NOGUID;
+	return GIDfrom(gid % UnitUtils::MAX_COUNT_UINT16, gid / UnitUtils::MAX_COUNT_UINT16);
+}
+
+Uint32 UnitUtils::readGID(GAGCore::InputStream *stream, const std::string &name, Sint32 versionMinor)
+{
+	if (versionMinor < 84)
+		return GIDfromUint16(stream->readUint16(name));
+	return stream->readUint32(name);
+}
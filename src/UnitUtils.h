@@ -21,15 +21,28 @@
 #define __UNIT_UTILS_H
 
 #include <SDL_net.h>
+#include <string>
+
+namespace GAGCore
+{
+	class InputStream;
+}
 
 class UnitUtils
 {
  public:
-	static Sint32 GIDtoID(Uint16 gid);
-	static Sint32 GIDtoTeam(Uint16 gid);
-	static Uint16 GIDfrom(Sint32 id, Sint32 team);
-
-	static const int MAX_COUNT = 1024;
+	static Sint32 GIDtoID(Uint32 gid);
+	static Sint32 GIDtoTeam(Uint32 gid);
+	static Uint32 GIDfrom(Sint32 id, Sint32 team);
+	///Converts a gid saved before version 84, when gids were Uint16 and teams had 1024 units at most
+	static Uint32 GIDfromUint16(Uint16 gid);
+	///Reads a gid, converting it if the stream was saved before version 84
+	static Uint32 readGID(GAGCore::InputStream *stream, const std::string &name, Sint32 versionMinor);
+
+	///The maximum number of units per team. The tables of a team grow up to this size when needed.
+	static const int MAX_COUNT = 65536;
+	///The number of units per team when gids were Uint16, before version 84
+	static const int MAX_COUNT_UINT16 = 1024;
 };
 
 
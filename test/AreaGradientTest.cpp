@@ -0,0 +1,189 @@
+/*
+ Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+ for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "AreaGradientTest.h"
+#include "../src/AreaGradient.h"
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+CPPUNIT_TEST_SUITE_REGISTRATION( AreaGradientTest );
+
+// A map of initial values: 0 for obstacles, 255 for the sources, 1 elsewhere
+struct AreaMap
+{
+	int wDec, hDec;
+	std::vector<unsigned char> initial;
+	std::vector<unsigned char> gradient;
+
+	AreaMap(int wDec, int hDec):
+		wDec(wDec),
+		hDec(hDec),
+		initial((size_t)1 << (wDec + hDec), 1)
+	{
+	}
+	size_t size() const { return initial.size(); }
+	unsigned char operator()(size_t pos) const { return initial[pos]; }
+};
+
+// The full update, as Map::updateGlobalGradientVersionSimple does it from the sources
+static void computeFully(const AreaMap &map, std::vector<unsigned char> &gradient)
+{
+	gradient = map.initial;
+	size_t wMask = ((size_t)1 << map.wDec) - 1;
+	size_t hMask = ((size_t)1 << map.hDec) - 1;
+	std::vector<size_t> listedAddr;
+	for (size_t i = 0; i < gradient.size(); i++)
+		if (gradient[i] == 255)
+			listedAddr.push_back(i);
+	for (size_t listCountRead = 0; listCountRead < listedAddr.size(); listCountRead++)
+	{
+		size_t i = listedAddr[listCountRead];
+		unsigned char g = gradient[i] - 1;
+		if (g <= 1)
+			continue;
+		size_t y = i >> map.wDec;
+		size_t x = i & wMask;
+		for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				size_t n = (((y + dy) & hMask) << map.wDec) | ((x + dx) & wMask);
+				if (gradient[n] > 0 && gradient[n] < g)
+				{
+					gradient[n] = g;
+					listedAddr.push_back(n);
+				}
+			}
+	}
+}
+
+// Sets the rectangle (x, y, w, h) to value, adding the cells which changed to changedCells
+static void paint(AreaMap &map, int x, int y, int w, int h, unsigned char value, std::vector<size_t> &changedCells)
+{
+	size_t wMask = ((size_t)1 << map.wDec) - 1;
+	size_t hMask = ((size_t)1 << map.hDec) - 1;
+	for (int dy = 0; dy < h; dy++)
+		for (int dx = 0; dx < w; dx++)
+		{
+			size_t pos = (((y + dy) & hMask) << map.wDec) | ((x + dx) & wMask);
+			if (map.initial[pos] != value)
+			{
+				map.initial[pos] = value;
+				changedCells.push_back(pos);
+			}
+		}
+}
+
+// Fills the map with obstacles and a few source areas
+static void fillRandomly(AreaMap &map)
+{
+	std::vector<size_t> ignored;
+	for (size_t i = 0; i < map.size(); i++)
+		map.initial[i] = (rand() % 8 == 0) ? 0 : 1;
+	int w = 1 << map.wDec;
+	int h = 1 << map.hDec;
+	for (int i = 0; i < 4; i++)
+		paint(map, rand() % w, rand() % h, 1 + rand() % 12, 1 + rand() % 12, 255, ignored);
+}
+
+// Paints a random brush stroke of sources, free cells or obstacles
+static void paintRandomly(AreaMap &map, std::vector<size_t> &changedCells)
+{
+	static const unsigned char values[4] = { 255, 255, 1, 0 };
+	int w = 1 << map.wDec;
+	int h = 1 << map.hDec;
+	paint(map, rand() % w, rand() % h, 1 + rand() % 6, 1 + rand() % 6, values[rand() % 4], changedCells);
+}
+
+void AreaGradientTest::setUp()
+{
+	srand(42);
+}
+void AreaGradientTest::tearDown()
+{
+}
+void AreaGradientTest::testSmallChanges()
+{
+	AreaMap map(6, 5);
+	fillRandomly(map);
+	computeFully(map, map.gradient);
+	AreaGradient repairer;
+	repairer.setSize(map.wDec, map.hDec);
+
+	std::vector<unsigned char> expected;
+	for (int i = 0; i < 200; i++)
+	{
+		std::vector<size_t> changedCells;
+		paintRandomly(map, changedCells);
+		repairer.repair(&map.gradient[0], map, changedCells);
+		computeFully(map, expected);
+		CPPUNIT_ASSERT(map.gradient == expected);
+	}
+}
+// Changes made at different times must be repaired in one go, even if a cell changed back and forth
+void AreaGradientTest::testAccumulatedChanges()
+{
+	AreaMap map(5, 6);
+	fillRandomly(map);
+	computeFully(map, map.gradient);
+	AreaGradient repairer;
+	repairer.setSize(map.wDec, map.hDec);
+
+	std::vector<unsigned char> expected;
+	for (int i = 0; i < 50; i++)
+	{
+		std::vector<size_t> changedCells;
+		for (int j = 0; j < 10; j++)
+			paintRandomly(map, changedCells);
+		repairer.repair(&map.gradient[0], map, changedCells);
+		computeFully(map, expected);
+		CPPUNIT_ASSERT(map.gradient == expected);
+	}
+}
+// Measures brush strokes on a 512x512 map, the size of the largest maps
+void AreaGradientTest::testBenchmark512()
+{
+	AreaMap map(9, 9);
+	fillRandomly(map);
+	computeFully(map, map.gradient);
+	AreaGradient repairer;
+	repairer.setSize(map.wDec, map.hDec);
+
+	const int strokes = 100;
+	std::vector<unsigned char> expected;
+	clock_t repairTicks = 0;
+	clock_t fullTicks = 0;
+	for (int i = 0; i < strokes; i++)
+	{
+		std::vector<size_t> changedCells;
+		paintRandomly(map, changedCells);
+
+		clock_t start = clock();
+		repairer.repair(&map.gradient[0], map, changedCells);
+		repairTicks += clock() - start;
+
+		start = clock();
+		computeFully(map, expected);
+		fullTicks += clock() - start;
+
+		CPPUNIT_ASSERT(map.gradient == expected);
+	}
+	std::cout << "\nAreaGradientTest::testBenchmark512: " << strokes << " strokes, repair "
+		<< (1000.0 * repairTicks / CLOCKS_PER_SEC) << " ms, full update "
+		<< (1000.0 * fullTicks / CLOCKS_PER_SEC) << " ms\n";
+}
@@ -0,0 +1,129 @@
+/*
+ Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+ for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "SlotSetTest.h"
+#include "../src/SlotSet.h"
+#include <vector>
+CPPUNIT_TEST_SUITE_REGISTRATION( SlotSetTest );
+
+// initial size of the unit and building tables of a team
+const static int CAPACITY = 1024;
+
+void SlotSetTest::setUp()
+{
+}
+void SlotSetTest::tearDown()
+{
+}
+void SlotSetTest::testEmpty()
+{
+	SlotSet slots(CAPACITY);
+	CPPUNIT_ASSERT_EQUAL((size_t)0, slots.size());
+	CPPUNIT_ASSERT_EQUAL(-1, slots.first());
+	CPPUNIT_ASSERT_EQUAL(0, slots.firstFree());
+}
+void SlotSetTest::testInsertErase()
+{
+	SlotSet slots(CAPACITY);
+	slots.insert(5);
+	slots.insert(5);
+	slots.insert(CAPACITY-1);
+	CPPUNIT_ASSERT_EQUAL((size_t)2, slots.size());
+	CPPUNIT_ASSERT(slots.contains(5));
+	CPPUNIT_ASSERT(slots.contains(CAPACITY-1));
+	CPPUNIT_ASSERT(!slots.contains(6));
+	slots.erase(5);
+	slots.erase(5);
+	CPPUNIT_ASSERT_EQUAL((size_t)1, slots.size());
+	CPPUNIT_ASSERT(!slots.contains(5));
+}
+//the used slots must come in the same order as a scan of the whole table
+void SlotSetTest::testIterationOrder()
+{
+	SlotSet slots(CAPACITY);
+	std::vector<bool> table(CAPACITY, false);
+	for (int i=0; i<CAPACITY; i+=7)
+	{
+		slots.insert(i);
+		table[i] = true;
+	}
+	slots.insert(31);
+	table[31] = true;
+	slots.insert(32);
+	table[32] = true;
+
+	int slot = slots.first();
+	for (int i=0; i<CAPACITY; i++)
+	{
+		if (table[i])
+		{
+			CPPUNIT_ASSERT_EQUAL(i, slot);
+			slot = slots.next(slot);
+		}
+	}
+	CPPUNIT_ASSERT_EQUAL(-1, slot);
+}
+void SlotSetTest::testEraseWhileIterating()
+{
+	SlotSet slots(CAPACITY);
+	for (int i=0; i<100; i++)
+		slots.insert(i);
+	int visited = 0;
+	for (int i=slots.first(); i!=-1; i=slots.next(i))
+	{
+		// removing the current slot and adding one later on must behave like a table scan
+		slots.erase(i);
+		if (i == 10)
+			slots.insert(500);
+		visited++;
+	}
+	CPPUNIT_ASSERT_EQUAL(101, visited);
+	CPPUNIT_ASSERT_EQUAL((size_t)0, slots.size());
+}
+void SlotSetTest::testFirstFree()
+{
+	SlotSet slots(40);
+	for (int i=0; i<40; i++)
+	{
+		CPPUNIT_ASSERT_EQUAL(i, slots.firstFree());
+		slots.insert(i);
+	}
+	CPPUNIT_ASSERT_EQUAL(-1, slots.firstFree());
+	slots.erase(33);
+	CPPUNIT_ASSERT_EQUAL(33, slots.firstFree());
+	slots.erase(2);
+	CPPUNIT_ASSERT_EQUAL(2, slots.firstFree());
+}
+//the tables of a team grow when they are full
+void SlotSetTest::testGrow()
+{
+	SlotSet slots(40);
+	for (int i=0; i<40; i++)
+		slots.insert(i);
+	slots.erase(7);
+	slots.grow(100);
+	CPPUNIT_ASSERT_EQUAL((size_t)100, slots.capacity());
+	CPPUNIT_ASSERT_EQUAL((size_t)39, slots.size());
+	CPPUNIT_ASSERT(slots.contains(39));
+	CPPUNIT_ASSERT(!slots.contains(7));
+	CPPUNIT_ASSERT_EQUAL(7, slots.firstFree());
+	slots.insert(7);
+	CPPUNIT_ASSERT_EQUAL(40, slots.firstFree());
+	slots.insert(99);
+	CPPUNIT_ASSERT_EQUAL(99, slots.next(39));
+}
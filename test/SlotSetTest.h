@@ -0,0 +1,48 @@
+/*
+ Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+ for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SLOTSETTEST_H_
+#define SLOTSETTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SlotSetTest: public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( SlotSetTest );
+		CPPUNIT_TEST( testEmpty );
+		CPPUNIT_TEST( testInsertErase );
+		CPPUNIT_TEST( testIterationOrder );
+		CPPUNIT_TEST( testEraseWhileIterating );
+		CPPUNIT_TEST( testFirstFree );
+		CPPUNIT_TEST( testGrow );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testEmpty();
+	void testInsertErase();
+	void testIterationOrder();
+	void testEraseWhileIterating();
+	void testFirstFree();
+	void testGrow();
+};
+
+#endif /* SLOTSETTEST_H_ */
@@ -0,0 +1,127 @@
+/*
+ Copyright (C) 2001-2004 Stephane Magnenat & Luc-Olivier de Charrière
+ for any question or comment contact us at <stephane at magnenat dot net> or <NuageBleu at gmail dot com>
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "TowerCoverageTest.h"
+#include "../src/TowerCoverage.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+CPPUNIT_TEST_SUITE_REGISTRATION( TowerCoverageTest );
+
+struct Square
+{
+	int x, y, range;
+};
+
+// distance along one axis of a map that wraps around, as Map::warpDistMax
+static int warpDist(int a, int b, int size)
+{
+	int d = std::abs(a - b) % size;
+	return std::min(d, size - d);
+}
+
+// number of squares covering (x, y), computed without TowerCoverage
+static unsigned countCovering(const std::vector<Square> &squares, int x, int y, int w, int h)
+{
+	unsigned count = 0;
+	for (size_t i = 0; i < squares.size(); i++)
+		if (squares[i].range >= 0 &&
+			warpDist(x, squares[i].x, w) <= squares[i].range &&
+			warpDist(y, squares[i].y, h) <= squares[i].range)
+			count++;
+	return count;
+}
+
+static void checkCoverage(const TowerCoverage &coverage, const std::vector<Square> &squares, int w, int h)
+{
+	for (int y = 0; y < h; y++)
+		for (int x = 0; x < w; x++)
+			CPPUNIT_ASSERT_EQUAL(countCovering(squares, x, y, w, h), coverage.coverCount(x, y));
+}
+
+void TowerCoverageTest::setUp()
+{
+}
+void TowerCoverageTest::tearDown()
+{
+}
+void TowerCoverageTest::testMatchesDistance()
+{
+	TowerCoverage coverage;
+	coverage.setMapSize(32, 16);
+	std::vector<Square> squares;
+	Square inside = { 10, 8, 3 };
+	Square acrossBorders = { 0, 15, 4 };
+	Square widerThanMap = { 20, 3, 9 };
+	squares.push_back(inside);
+	squares.push_back(acrossBorders);
+	squares.push_back(widerThanMap);
+	for (size_t i = 0; i < squares.size(); i++)
+		coverage.setArea(i, squares[i].x, squares[i].y, squares[i].range);
+	checkCoverage(coverage, squares, 32, 16);
+
+	// moving and removing squares
+	squares[0].x = 30;
+	coverage.setArea(0, squares[0].x, squares[0].y, squares[0].range);
+	squares[2].range = -1;
+	coverage.clearArea(2);
+	checkCoverage(coverage, squares, 32, 16);
+	CPPUNIT_ASSERT(coverage.isCovered(31, 8));
+	CPPUNIT_ASSERT(!coverage.isCovered(10, 8));
+}
+// A game is loaded with its buildings before the map: the squares set then must be
+// counted once the map size is known, and removing them afterwards must not underflow
+void TowerCoverageTest::testAreasSetBeforeMapSize()
+{
+	TowerCoverage coverage;
+	std::vector<Square> squares;
+	Square tower = { 5, 5, 2 };
+	Square other = { 60, 60, 3 };
+	squares.push_back(tower);
+	squares.push_back(other);
+	coverage.setArea(0, tower.x, tower.y, tower.range);
+	coverage.setArea(1, other.x, other.y, other.range);
+	CPPUNIT_ASSERT(!coverage.isCovered(5, 5));
+
+	coverage.setMapSize(64, 64);
+	checkCoverage(coverage, squares, 64, 64);
+	CPPUNIT_ASSERT(coverage.isCovered(5, 5));
+
+	// the tower is destroyed
+	coverage.clearArea(0);
+	squares[0].range = -1;
+	checkCoverage(coverage, squares, 64, 64);
+	CPPUNIT_ASSERT(!coverage.isCovered(5, 5));
+	CPPUNIT_ASSERT(coverage.isCovered(62, 62));
+}
+void TowerCoverageTest::testMapResize()
+{
+	TowerCoverage coverage;
+	coverage.setMapSize(16, 16);
+	std::vector<Square> squares;
+	Square tower = { 14, 1, 2 };
+	squares.push_back(tower);
+	coverage.setArea(0, tower.x, tower.y, tower.range);
+	checkCoverage(coverage, squares, 16, 16);
+
+	coverage.setMapSize(64, 32);
+	checkCoverage(coverage, squares, 64, 32);
+	coverage.clearArea(0);
+	squares[0].range = -1;
+	checkCoverage(coverage, squares, 64, 32);
+}